@@ -198,6 +198,7 @@ void Adafruit_LEDBackpack::blinkRate(uint8_t b) {
 }
 
 Adafruit_LEDBackpack::Adafruit_LEDBackpack(void) {
+  changedrows = 0;
 }
 
 void Adafruit_LEDBackpack::begin(uint8_t _addr = 0x70) {
@@ -211,6 +212,9 @@ void Adafruit_LEDBackpack::begin(uint8_t _addr = 0x70) {
   blinkRate(HT16K33_BLINK_OFF);
   
   setBrightness(15); // max brightness
+
+  // we don't know what the display shows
+  changedrows = 0xFF;
 }
 
 void Adafruit_LEDBackpack::writeDisplay(void) {
@@ -222,11 +226,40 @@ void Adafruit_LEDBackpack::writeDisplay(void) {
     Wire.write(displaybuffer[i] >> 8);    
   }
   Wire.endTransmission();  
+
+  changedrows = 0;
+}
+
+boolean Adafruit_LEDBackpack::writeChangedRows(uint8_t maxRows) {
+  uint8_t i = 0;
+  while ((changedrows != 0) && (maxRows != 0)) {
+    // skip the rows that did not change
+    while (!(changedrows & (1 << i))) i++;
+
+    Wire.beginTransmission(i2c_addr);
+    Wire.write(i * 2); // each row has two addresses
+
+    uint8_t rows = 0;
+    while ((i < 8) && (changedrows & (1 << i)) && (rows < maxRows) && (rows < (HT16K33_WIRE_BUFFER - 1) / 2)) {
+      Wire.write(displaybuffer[i] & 0xFF);
+      Wire.write(displaybuffer[i] >> 8);
+      changedrows &= ~(1 << i);
+      i++;
+      rows++;
+    }
+    Wire.endTransmission();
+
+    maxRows -= rows;
+  }
+
+  return changedrows != 0;
 }
 
 void Adafruit_LEDBackpack::clear(void) {
   for (uint8_t i=0; i<8; i++) {
+    const uint16_t previous = displaybuffer[i];
     displaybuffer[i] = 0;
+    rowChanged(i, previous);
   }
 }
 
@@ -324,11 +357,13 @@ void Adafruit_8x16matrix::drawPixel(int16_t x, int16_t y, uint16_t color) {
   if ((y < 0) || (y >= 8)) return;
   if ((x < 0) || (x >= 16)) return;
 
+  const uint16_t previous = displaybuffer[y];
   if (color) {
     displaybuffer[y] |= 1 << x;
   } else {
     displaybuffer[y] &= ~(1 << x);
   }
+  rowChanged(y, previous);
 }
 
 
@@ -362,11 +397,13 @@ void Adafruit_8x8matrix::drawPixel(int16_t x, int16_t y, uint16_t color) {
   x %= 8;
 
 
+  const uint16_t previous = displaybuffer[y];
   if (color) {
     displaybuffer[y] |= 1 << x;
   } else {
     displaybuffer[y] &= ~(1 << x);
   }
+  rowChanged(y, previous);
 }
 
 /******************************* 8x8 BICOLOR MATRIX OBJECT */
@@ -393,6 +430,7 @@ void Adafruit_BicolorMatrix::drawPixel(int16_t x, int16_t y, uint16_t color) {
     break;
   }
 
+  const uint16_t previous = displaybuffer[y];
   if (color == LED_GREEN) {
     // Turn on green LED.
     displaybuffer[y] |= 1 << x;
@@ -410,6 +448,7 @@ void Adafruit_BicolorMatrix::drawPixel(int16_t x, int16_t y, uint16_t color) {
     // Turn off green and red LED.
     displaybuffer[y] &= ~(1 << x) & ~(1 << (x+8));
   }
+  rowChanged(y, previous);
 }
 
 /******************************* 7 SEGMENT OBJECT */
@@ -53,6 +53,14 @@
 
 #define SEVENSEG_DIGITS 5
 
+// The size of the Wire transmit buffer, one byte of which is taken by the
+// register address. Each row needs 2 bytes
+#ifdef BUFFER_LENGTH
+ #define HT16K33_WIRE_BUFFER BUFFER_LENGTH
+#else
+ #define HT16K33_WIRE_BUFFER 32
+#endif
+
 
 // this is the raw HT16K33 controller
 class Adafruit_LEDBackpack {
@@ -62,13 +70,25 @@ class Adafruit_LEDBackpack {
   void setBrightness(uint8_t b);
   void blinkRate(uint8_t b);
   void writeDisplay(void);
+  // Sends at most maxRows of the rows changed since they were last sent,
+  // consecutive rows in the same transmission. Returns true if changed rows
+  // are left. Only changes made by clear() and the drawPixel() of matrices
+  // are tracked, use writeDisplay() after writing displaybuffer directly
+  boolean writeChangedRows(uint8_t maxRows);
+  boolean displayChanged(void) const { return changedrows != 0; }
   void clear(void);
 
   uint16_t displaybuffer[8]; 
 
   void init(uint8_t a);
  protected:
+  void rowChanged(uint8_t row, uint16_t previous) {
+    if (displaybuffer[row] != previous) changedrows |= 1 << row;
+  }
+
   uint8_t i2c_addr;
+  // Bit i is set if row i is different from the one on the display
+  uint8_t changedrows;
 };
 
 class Adafruit_AlphaNum4 : public Adafruit_LEDBackpack {
@@ -81,6 +81,30 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   WIRE.endTransmission();
 }
 
+// Sets the OFF tick of count consecutive channels starting from first (the ON
+// tick is always 0). This relies on the auto increment mode turned on in
+// setPWMFreq(): all channels that fit in the Wire buffer are sent in a single
+// transaction, so that a whole frame needs only a few transactions
+void Adafruit_PWMServoDriver::setPWMRange(uint8_t first, uint8_t count, const uint16_t *off) {
+  while (count > 0) {
+    const uint8_t n = min(count, PCA9685_CHANNELS_PER_TRANSMISSION);
+
+    WIRE.beginTransmission(_i2caddr);
+    WIRE.write(LED0_ON_L+4*first);
+    for (uint8_t i = 0; i < n; ++i) {
+      WIRE.write(0);
+      WIRE.write(0);
+      WIRE.write(off[i]);
+      WIRE.write(off[i]>>8);
+    }
+    WIRE.endTransmission();
+
+    first += n;
+    off += n;
+    count -= n;
+  }
+}
+
 // Sets pin without having to deal with on/off tick placement and properly handles
 // a zero value as completely off.  Optional invert parameter supports inverting
 // the pulse for sinking to ground.  Val should be a value from 0 to 4095 inclusive.
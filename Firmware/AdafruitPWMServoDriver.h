@@ -42,6 +42,15 @@
 #define ALLLED_OFF_L 0xFC
 #define ALLLED_OFF_H 0xFD
 
+// The size of the Wire transmit buffer, one byte of which is taken by the
+// register address. Each channel needs 4 bytes (ON and OFF ticks)
+#ifdef BUFFER_LENGTH
+ #define PCA9685_WIRE_BUFFER BUFFER_LENGTH
+#else
+ #define PCA9685_WIRE_BUFFER 32
+#endif
+#define PCA9685_CHANNELS_PER_TRANSMISSION ((PCA9685_WIRE_BUFFER - 1) / 4)
+
 
 class Adafruit_PWMServoDriver {
  public:
@@ -50,6 +59,7 @@ class Adafruit_PWMServoDriver {
   void reset(void);
   void setPWMFreq(float freq);
   void setPWM(uint8_t num, uint16_t on, uint16_t off);
+  void setPWMRange(uint8_t first, uint8_t count, const uint16_t *off);
   void setPin(uint8_t num, uint16_t val, bool invert=false);
 
  private:
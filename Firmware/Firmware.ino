@@ -19,11 +19,26 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
  ******************************************************************************/
 
+// Uncomment to run the benchmark of the interpolation performed by the sequence
+// player instead of the normal firmware (see stepbenchmark.h)
+// #define STEP_BENCHMARK
+
 // import Wire library to use I²C (I have to include it here because doing it
 // only in Adafruit_PWMServoDriver.cpp doesn't work...)
 #include <Wire.h>
+// The same for the EEPROM library, used by SequenceStorage
+#include <EEPROM.h>
 #include "serialcommunication.h"
 #include "sequenceplayer.h"
+#include "sequencestorage.h"
+#include "calibrationstorage.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "syncclock.h"
+#include "face.h"
+#ifdef STEP_BENCHMARK
+	#include "stepbenchmark.h"
+#endif
 #include <stdlib.h>
 // import backpack library to use LED backpacks
 #include "AdafruitLEDBackpack.h"
@@ -31,34 +46,82 @@
 #include "AdafruitGFX.h"
 
 // The possible states
-enum States {IdleState, StreamMode, StreamModeStopping, ImmediateMode};
+enum States {IdleState, StreamMode, StreamModeStopping, ImmediateMode, BaudRateConfirm, UploadMode, StoredPlayback};
 
-// The minimum and maximum PWM value of all servos
-const unsigned int servoMin[SequencePoint::dim] = {1150,  500,  500,  800,  900,  550,  800,  550,  920,  500,  750, 1000,  500,  750,  650, 1450};
-const unsigned int servoMax[SequencePoint::dim] = {1770, 1840, 1800, 2200, 1700, 1750, 2050, 1670, 2000, 1700, 2020, 1800, 1800, 1650, 2000, 2200};
-const unsigned int servoMid[SequencePoint::dim] = {1500, 1840, 1000, 1150, 1300, 1400, 1160, 1250, 1300, 1320, 1100, 1420, 1350, 1650,  650, 1800};
+// The minimum, maximum and rest PWM value of all servos used when no calibration is stored in the
+// EEPROM. They are kept in program memory, only the calibration in use takes RAM
+const unsigned int defaultServoMin[SequencePoint::dim] PROGMEM = {1150,  500,  500,  800,  900,  550,  800,  550,  920,  500,  750, 1000,  500,  750,  650, 1450};
+const unsigned int defaultServoMax[SequencePoint::dim] PROGMEM = {1770, 1840, 1800, 2200, 1700, 1750, 2050, 1670, 2000, 1700, 2020, 1800, 1800, 1650, 2000, 2200};
+const unsigned int defaultServoMid[SequencePoint::dim] PROGMEM = {1500, 1840, 1000, 1150, 1300, 1400, 1160, 1250, 1300, 1320, 1100, 1420, 1350, 1650,  650, 1800};
 
 // The current status
 States status = IdleState;
-// The baud rate to use for communication with computer
+// The baud rate to use for communication with computer. This is the rate used when idle, the PC
+// can ask to use a different one during streaming
 const long baudRate = 115200;
+// How long to wait for the confirmation of a new baud rate before returning to baudRate, in
+// milliseconds
+const unsigned long baudRateConfirmTimeout = 1000;
+// The time when we switched to a new baud rate
+unsigned long baudRateChangeTime = 0;
 // The object that handles communication
 SerialCommunication serialCommunication;
-// The microseconds of the last loop
-unsigned long lastTime = 0;
-// The object controlling the servos
-SequencePlayer sequencePlayer(servoMin, servoMax);
-// Each how many milliseconds we should send the battery charge
-const unsigned long batteryInterval = 500;
-// The milliseconds we last sent the battery charge
-unsigned long lastBatteryTime = 0;
-// This is true if the sequence buffer was full
-bool sequenceBufferWasFull = false;
+// The calibration of servos, read from the EEPROM in setup(). This is also the object filled by
+// serialCommunication when the PC sends a new calibration
+Calibration calibration;
+// The object storing the calibration in the EEPROM
+CalibrationStorage calibrationStorage;
+// The object controlling the servos. The calibration is set again in setup(), once it is loaded
+SequencePlayer sequencePlayer(calibration);
+// The clock used to play sequences, which the PC can synchronize with its own
+SyncClock syncClock;
+// The scheduler running all periodic tasks
+Scheduler scheduler;
+// The maximum number of commands executed by one run of the serial task. Commands already in the
+// receive buffer are executed together, this limit only matters when the PC sends continuously
+const unsigned char maxCommandsPerTask = 8;
+// The period of servo updates in microseconds (10000 means 100 Hz)
+const unsigned long servoUpdatePeriod = 10000;
+// The period of battery charge packets in microseconds
+const unsigned long batteryPeriod = 500000;
+// The period of task overruns packets in microseconds
+const unsigned long overrunsPeriod = 1000000;
+// The period of telemetry packets in microseconds
+const unsigned long telemetryPeriod = 1000000;
+// The period of face updates in microseconds. This is the same of servo updates, so that the face
+// task always runs right after the servo task and its transmissions never delay servo frames
+const unsigned long facePeriod = servoUpdatePeriod;
+// The counters sent in telemetry packets
+Telemetry telemetry;
+// Whether the buffer of the sequence player was empty after the last step, used to count
+// underruns
+bool playerBufferWasEmpty = true;
+// How many points the PC can still send without waiting for new credits. This is never more
+// than the number of free slots in the sequence player buffer
+unsigned char grantedCredits = 0;
+// How often acks are sent while streaming even if nothing changed, in milliseconds. Acks are
+// cumulative, so this fixes lost ones
+const unsigned long ackRefreshPeriod = 100;
+// The time when the last ack was sent
+unsigned long lastAckTime = 0;
 // Battery pin
 const int batteryPin = 3;
+// The object storing a sequence in the EEPROM
+SequenceStorage sequenceStorage;
+// The point filled by serialCommunication during uploads
+SequencePoint uploadPoint;
+// The number of points of the sequence being uploaded and the index of the next one
+unsigned int uploadNumPoints = 0;
+unsigned int uploadIndex = 0;
+// The number of points of the stored sequence being played and the index of the next one to
+// add to the sequence player buffer
+unsigned int storedNumPoints = 0;
+unsigned int storedPointIndex = 0;
+// Whether the stored sequence is played continuously
+bool storedPlaybackLoop = false;
 
 // The face object
-Adafruit_8x8matrix face = Adafruit_8x8matrix();
+Face face;
 
 // A bitmap for a smile
 static const uint8_t PROGMEM smile_bmp[] =
@@ -71,176 +134,478 @@ static const uint8_t PROGMEM smile_bmp[] =
     B00111100,
     B00000000 };
 
+// The smile with closed eyes, to blink
+static const uint8_t PROGMEM smile_blink_bmp[] =
+  { B00000000,
+    B00000000,
+    B00000000,
+    B00100100,
+    B00000000,
+    B01000010,
+    B00111100,
+    B00000000 };
+
 /**
  * \brief Initializes led for the face
  */
 void initializeFace()
 {
 	// initialize LED backpack over I²C at the given address, NOW WITH THE CORRECT ADDRESS!!!
-	face.begin(0x71);
-
-	// set rotation to match the position on the robot
-	face.setRotation(3);
-
-	// set an appropriate brightness (0-15)
-	face.setBrightness(7);
+	// Rotation matches the position on the robot, brightness is 0-15
+	face.begin(0x71, 3, 7);
 }
 
 /**
  * \brief Draws a smiling face
+ *
+ * The face is sent to the display by faceTask()
  */
 void smile()
 {
-	// clear whatever was left on the display
-	face.clear();
-
-	// send bitmap to cover the entire display area
-	face.drawBitmap(0, 0, smile_bmp, 8, 8, LED_ON);
-
-	// show image
-	face.writeDisplay();
+	face.setExpression(smile_bmp, smile_blink_bmp, millis());
 }
 
-void setup()
+/**
+ * \brief Reads the calibration from the EEPROM
+ *
+ * If no valid calibration is stored, the default one is used
+ */
+void loadCalibration()
 {
-	// initialize Adafruit's LED backpack
-	initializeFace();
-	// draw a smiling face
-	smile();
- 
-	// Initializing the object handling serial communication
-	serialCommunication.begin(baudRate);
+	if (calibrationStorage.read(calibration)) {
+		return;
+	}
 
-	// The initial position of servos
-	SequencePoint startPos;
-	startPos.duration = 0;
-	startPos.timeToTarget = 0;
 	for (int i = 0; i < SequencePoint::dim; ++i) {
-		unsigned long p = (unsigned long)(servoMid[i] - servoMin[i]) * 256 / (unsigned long)(servoMax[i] - servoMin[i]);
-		startPos.point[i] = p;
+		calibration.servoMin[i] = pgm_read_word(&defaultServoMin[i]);
+		calibration.servoMax[i] = pgm_read_word(&defaultServoMax[i]);
+		calibration.servoMid[i] = pgm_read_word(&defaultServoMid[i]);
 	}
+}
 
-	// Initializing the object handling servos
-	sequencePlayer.begin(startPos);
+/**
+ * \brief Fills the sequence player buffer with points of the stored sequence
+ *
+ * When the last point is reached, either restarts from the first one or moves
+ * to the StreamModeStopping state
+ */
+void fillFromStorage()
+{
+	SequencePoint* p;
+	while ((status == StoredPlayback) && ((p = sequencePlayer.pointToFill()) != NULL)) {
+		sequenceStorage.readPoint(storedPointIndex, *p);
+		sequencePlayer.pointFilled();
 
-	// Setting the point to fill. The buffer cannot be full at this stage!
-	serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+		++storedPointIndex;
+		if (storedPointIndex == storedNumPoints) {
+			if (storedPlaybackLoop) {
+				storedPointIndex = 0;
+			} else {
+				status = StreamModeStopping;
+			}
+		}
+	}
+}
 
+/**
+ * \brief Sends an ack to the PC, giving it credits for all free slots
+ */
+void sendAck()
+{
+	grantedCredits = sequencePlayer.freeSlots();
+	serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+	serialCommunication.sendAck(grantedCredits);
+	lastAckTime = millis();
 }
 
-void loop()
+/**
+ * \brief The task moving servos
+ */
+void servoTask()
 {
-	// Moving servos.We do this even when idle because in that case we are sure the buffer is empty
-	const bool emptyBuffer = !sequencePlayer.step();
+	// When playing the stored sequence we have to feed the buffer ourself
+	if (status == StoredPlayback) {
+		fillFromStorage();
+	}
+
+	// Moving servos. We do this even when idle because in that case we are sure the buffer is empty
+	const unsigned long stepStart = micros();
+	syncClock.update(millis());
+	const bool emptyBuffer = !sequencePlayer.step(syncClock.time());
+	telemetry.stepTime(micros() - stepStart);
+
+	// If the buffer has just become empty while streaming, the PC is not sending points fast enough
+	if ((status == StreamMode) && emptyBuffer && !playerBufferWasEmpty) {
+		telemetry.underrun();
+	}
+	playerBufferWasEmpty = emptyBuffer;
 
 	if ((status == StreamModeStopping) && emptyBuffer) {
 		// We have finally stopped, clearing the sequence player buffer and returning idle
 		sequencePlayer.clearBuffer();
 		status = IdleState;
+		serialCommunication.endFramedStream();
 		serialCommunication.sendSequenceFinished();
-	} else if ((status == StreamMode) && sequenceBufferWasFull && (!sequencePlayer.bufferFull())) {
-		// If the buffer was full and it is no longer full, sending a buffer not full package
-		serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
-		serialCommunication.sendBufferNotFull();
-
-		sequenceBufferWasFull = false;
-	}
-
-	// Checking if there are new commands
-	if (serialCommunication.commandReceived()) {
-		switch (status) {
-			case IdleState:
-				if (serialCommunication.isStartStream()) {
-					// Checking that we got the correct point dimension
-					if (serialCommunication.pointDimension() != SequencePoint::dim) {
-						serialCommunication.sendDebugPacket("Invalid point dimension");
-					} else {
-						status = StreamMode;
-						sequenceBufferWasFull = false;
-						serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
-					}
-				} else if (serialCommunication.isStartImmediate()) {
-					// Checking that we got the correct point dimension
-					if (serialCommunication.pointDimension() != SequencePoint::dim) {
-						serialCommunication.sendDebugPacket("Invalid point dimension");
-					} else {
-						status = ImmediateMode;
-						sequenceBufferWasFull = false;
-						serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+
+		// Going back to the default baud rate (the sequence finished packet is sent with the old one)
+		serialCommunication.changeBaudRate(baudRate);
+	} else if ((status == StreamMode) && (sequencePlayer.freeSlots() > grantedCredits)) {
+		// Some slots have been freed, giving the PC new credits
+		sendAck();
+	} else if (((status == StreamMode) || (status == StreamModeStopping)) && ((millis() - lastAckTime) >= ackRefreshPeriod)) {
+		// Repeating the last ack in case it was lost
+		sendAck();
+	}
+}
+
+/**
+ * \brief Handles the commands used to synchronize the clock
+ *
+ * These commands are accepted in any state
+ * \return true if the received command was a clock command
+ */
+bool clockCommandReceived()
+{
+	if (serialCommunication.isClockPing()) {
+		// Answering immediately, the PC uses the round trip time to estimate when we read the clock
+		serialCommunication.sendClockPong(serialCommunication.receivedPingId(), millis());
+	} else if (serialCommunication.isSetClock()) {
+		syncClock.update(millis());
+		syncClock.set(serialCommunication.receivedClockLocalTime(), serialCommunication.receivedClockTime(), serialCommunication.receivedClockDrift());
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * \brief Handles the set calibration command
+ *
+ * This is accepted in any state, but the calibration is only changed when idle
+ * (segments being played use the old one). The command has already been
+ * written into calibration, which is restored if it is not accepted
+ * \return true if the received command was a set calibration command
+ */
+bool calibrationCommandReceived()
+{
+	if (!serialCommunication.isSetCalibration()) {
+		return false;
+	}
+
+	const bool accepted = (status == IdleState) && (serialCommunication.pointDimension() == SequencePoint::dim) && calibration.isValid();
+	if (accepted) {
+		// The player recomputes its tables now, not while playing
+		calibrationStorage.store(calibration);
+		sequencePlayer.setCalibration(calibration);
+	} else {
+		loadCalibration();
+	}
+	serialCommunication.sendCalibrationSet(accepted);
+
+	return true;
+}
+
+/**
+ * \brief Executes the command received by serialCommunication
+ *
+ * What to do depends on the current state
+ */
+void executeCommand()
+{
+	switch (status) {
+		case IdleState:
+			if (serialCommunication.isStartStream()) {
+				// Checking that we got the correct point dimension
+				if (serialCommunication.pointDimension() != SequencePoint::dim) {
+					serialCommunication.sendDebugPacket("Invalid point dimension");
+				} else {
+					status = StreamMode;
+					if (serialCommunication.hasStartTime()) {
+						sequencePlayer.setStartTime(serialCommunication.receivedStartTime());
 					}
+					grantedCredits = sequencePlayer.freeSlots();
+					serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+
+					// Telling the PC how many points it can send straight away. From now on points
+					// arrive in frames
+					serialCommunication.beginFramedStream();
+					serialCommunication.sendStreamStarted(grantedCredits);
+					lastAckTime = millis();
+				}
+			} else if (serialCommunication.isStartImmediate()) {
+				// Checking that we got the correct point dimension
+				if (serialCommunication.pointDimension() != SequencePoint::dim) {
+					serialCommunication.sendDebugPacket("Invalid point dimension");
 				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					status = ImmediateMode;
+					serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
 				}
-				break;
-			case StreamMode:
-				if (serialCommunication.isSequencePoint()) {
-					// If the queue was full, sending a debug packet
-					if (serialCommunication.nextSequencePointToFill() == NULL) {
-						serialCommunication.sendDebugPacket("Sequence point received but buffer full");
+			} else if (serialCommunication.isUploadSequence()) {
+				// Checking the point dimension and whether the sequence fits
+				uploadNumPoints = serialCommunication.receivedNumPoints();
+				const bool accepted = (serialCommunication.pointDimension() == SequencePoint::dim) && sequenceStorage.beginUpload(uploadNumPoints);
+				serialCommunication.sendUploadStarted(accepted, sequenceStorage.capacity());
+
+				if (accepted) {
+					uploadIndex = 0;
+					if (uploadNumPoints == 0) {
+						sequenceStorage.endUpload();
+						serialCommunication.sendUploadFinished();
 					} else {
-						// Marking the point as complete
-						sequencePlayer.pointFilled();
-
-						// Checking what to send in response and setting the next object
-						// to fill
-						sequenceBufferWasFull = sequencePlayer.bufferFull();
-						if (sequenceBufferWasFull) {
-							serialCommunication.setNextSequencePointToFill(NULL);
-							serialCommunication.sendBufferFull();
-						} else {
-							serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
-							serialCommunication.sendBufferNotFull();
-						}
+						status = UploadMode;
+						serialCommunication.setNextSequencePointToFill(&uploadPoint);
+					}
+				}
+			} else if (serialCommunication.isPlayStored()) {
+				storedNumPoints = sequenceStorage.numPoints();
+				if (storedNumPoints == 0) {
+					// Nothing to play, telling the PC we have already finished
+					serialCommunication.sendDebugPacket("No stored sequence");
+					serialCommunication.sendSequenceFinished();
+				} else {
+					status = StoredPlayback;
+					storedPointIndex = 0;
+					storedPlaybackLoop = serialCommunication.playStoredLoop();
+					if (serialCommunication.hasStartTime()) {
+						sequencePlayer.setStartTime(serialCommunication.receivedStartTime());
 					}
-				} else if (serialCommunication.isStop()) {
-					// Setting status to stopping. We still have to play all remaining sequence points
-					status = StreamModeStopping;
+
+					// We do not accept points from the PC while playing
+					serialCommunication.setNextSequencePointToFill(NULL);
+				}
+			} else if (serialCommunication.isChangeBaudRate()) {
+				// Answering with the current baud rate, then switching to the new one and waiting
+				// for the PC to confirm
+				if (SerialCommunication::isBaudRateSupported(serialCommunication.receivedBaudRate())) {
+					serialCommunication.sendBaudRateChange(true);
+					serialCommunication.changeBaudRate(serialCommunication.receivedBaudRate());
+					baudRateChangeTime = millis();
+					status = BaudRateConfirm;
 				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					serialCommunication.sendBaudRateChange(false);
 				}
-				break;
-			case StreamModeStopping:
-				// We do not expect any packet here
-				serialCommunication.sendDebugPacket("Unexpected command (sequence stopping)");
-				break;
-			case ImmediateMode:
-				if (serialCommunication.isSequencePoint()) {
-					// If the queue was full, sending a debug packet
-					if (serialCommunication.nextSequencePointToFill() == NULL) {
-						serialCommunication.sendDebugPacket("Sequence point received but buffer full");
-					} else {
-						// Setting both sequence point duration and timeToTarget to 0, so that the new
-						// position is immediately reached
-						serialCommunication.nextSequencePointToFill()->duration = 0;
-						serialCommunication.nextSequencePointToFill()->timeToTarget = 0;
-
-						// Marking the point as complete
-						sequencePlayer.pointFilled();
-						serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+			} else {
+				serialCommunication.sendDebugPacket("Unexpected command");
+			}
+			break;
+		case BaudRateConfirm:
+			// Here we ignore anything that is not a confirmation, the PC could still be using
+			// the old baud rate
+			if (serialCommunication.isConfirmBaudRate()) {
+				serialCommunication.sendBaudRateConfirmed();
+				status = IdleState;
+			}
+			break;
+		case StreamMode:
+			if (serialCommunication.isSequencePoint()) {
+				// If the queue was full, sending a debug packet
+				if (serialCommunication.nextSequencePointToFill() == NULL) {
+					serialCommunication.sendDebugPacket("Sequence point received but buffer full");
+					telemetry.droppedPoint();
+				} else {
+					// Marking the point as complete. The PC used one of its credits. We do not
+					// answer here, new credits are sent by the servo task when slots are freed
+					sequencePlayer.pointFilled();
+					if (grantedCredits > 0) {
+						--grantedCredits;
 					}
-				} else if (serialCommunication.isStop()) {
-					// Clearing the sequence player buffer and returning idle
-					sequencePlayer.clearBuffer();
+
+					// Setting the next object to fill (this is NULL if the buffer is full)
+					serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+				}
+			} else if (serialCommunication.isStop()) {
+				// Setting status to stopping. We still have to play all remaining sequence points
+				status = StreamModeStopping;
+			} else {
+				serialCommunication.sendDebugPacket("Unexpected command");
+			}
+			break;
+		case UploadMode:
+			if (serialCommunication.isSequencePoint()) {
+				// Storing the point. This is slow, so the PC only sends the next point when we
+				// give it a new credit
+				sequenceStorage.storePoint(uploadIndex, uploadPoint);
+				++uploadIndex;
+
+				if (uploadIndex == uploadNumPoints) {
+					sequenceStorage.endUpload();
+					serialCommunication.sendUploadFinished();
+
 					status = IdleState;
+					serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
 				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					serialCommunication.sendCredits(1);
 				}
-				break;
-		}
+			} else if (serialCommunication.isStop()) {
+				// Upload aborted, the stored sequence remains invalid
+				status = IdleState;
+				serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+			} else {
+				serialCommunication.sendDebugPacket("Unexpected command (uploading)");
+			}
+			break;
+		case StoredPlayback:
+			if (serialCommunication.isStop()) {
+				// Setting status to stopping. We still have to play all points in the buffer
+				status = StreamModeStopping;
+			} else {
+				serialCommunication.sendDebugPacket("Unexpected command (playing stored sequence)");
+			}
+			break;
+		case StreamModeStopping:
+			// We do not expect any packet here
+			serialCommunication.sendDebugPacket("Unexpected command (sequence stopping)");
+			break;
+		case ImmediateMode:
+			if (serialCommunication.isSequencePoint()) {
+				// If the queue was full, sending a debug packet
+				if (serialCommunication.nextSequencePointToFill() == NULL) {
+					serialCommunication.sendDebugPacket("Sequence point received but buffer full");
+					telemetry.droppedPoint();
+				} else {
+					// Setting both sequence point duration and timeToTarget to 0, so that the new
+					// position is immediately reached
+					serialCommunication.nextSequencePointToFill()->duration = 0;
+					serialCommunication.nextSequencePointToFill()->timeToTarget = 0;
+
+					// Marking the point as complete
+					sequencePlayer.pointFilled();
+					serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+				}
+			} else if (serialCommunication.isStop()) {
+				// Clearing the sequence player buffer and returning idle
+				sequencePlayer.clearBuffer();
+				status = IdleState;
+				serialCommunication.changeBaudRate(baudRate);
+			} else {
+				serialCommunication.sendDebugPacket("Unexpected command");
+			}
+			break;
+	}
+}
+
+/**
+ * \brief The task reading and executing commands from the serial line
+ */
+void serialTask()
+{
+	// If the PC did not confirm the new baud rate in time, going back to the default one
+	if ((status == BaudRateConfirm) && ((millis() - baudRateChangeTime) > baudRateConfirmTimeout)) {
+		serialCommunication.changeBaudRate(baudRate);
+		status = IdleState;
 	}
 
-	// Checking if we have to send the battery level
-	const unsigned long curBatteryTime = millis();
-	if ((curBatteryTime - lastBatteryTime) > batteryInterval) {
-		// Sending battery charge. 420 = 100% - 300 = 0%
-		int v = (analogRead(batteryPin) - 300) * 256 / (420 - 300);
-		if (v < 0) {
-			v = 0;
-		} else if (v > 255) {
-			v = 255;
+	// Executing all the commands we have already received, but not too many not to delay servos
+	for (unsigned char i = 0; (i < maxCommandsPerTask) && serialCommunication.commandReceived(); ++i) {
+		if (!clockCommandReceived() && !calibrationCommandReceived()) {
+			executeCommand();
 		}
-		serialCommunication.sendBatteryCharge(v);
+	}
+
+	// If a frame was lost, the PC must know immediately
+	if (serialCommunication.ackPending() && ((status == StreamMode) || (status == StreamModeStopping))) {
+		sendAck();
+	}
+}
+
+/**
+ * \brief The task sending the battery charge
+ */
+void batteryTask()
+{
+	// Sending battery charge. 420 = 100% - 300 = 0%
+	int v = (analogRead(batteryPin) - 300) * 256 / (420 - 300);
+	if (v < 0) {
+		v = 0;
+	} else if (v > 255) {
+		v = 255;
+	}
+	serialCommunication.sendBatteryCharge(v);
+}
 
-		lastBatteryTime = curBatteryTime;
+/**
+ * \brief The task sending the overruns of all tasks
+ */
+void overrunsTask()
+{
+	unsigned int overruns[Scheduler::maxTasks];
+	for (unsigned char i = 0; i < scheduler.numTasks(); ++i) {
+		overruns[i] = scheduler.overruns(i);
 	}
+	serialCommunication.sendTaskOverruns(overruns, scheduler.numTasks());
+}
+
+/**
+ * \brief The task sending the telemetry packet
+ */
+void telemetryTask()
+{
+	const unsigned long now = micros();
+	const unsigned char bufferedPoints = (SequencePlayer::bufferDimension - 1) - sequencePlayer.freeSlots();
+	serialCommunication.sendTelemetry(telemetry, now, bufferedPoints);
+
+	telemetry.startPeriod(now);
+}
+
+/**
+ * \brief The task animating the face and sending its changed rows
+ */
+void faceTask()
+{
+	face.update(millis());
+}
+
+void setup()
+{
+	// initialize Adafruit's LED backpack
+	initializeFace();
+	// draw a smiling face
+	smile();
+ 
+	// Initializing the object handling serial communication
+	serialCommunication.begin(baudRate);
+	serialCommunication.setCalibrationToFill(&calibration);
+
+	// Loading the calibration of this robot
+	loadCalibration();
+	sequencePlayer.setCalibration(calibration);
+
+	// The initial position of servos
+	SequencePoint startPos;
+	startPos.duration = 0;
+	startPos.timeToTarget = 0;
+	startPos.startSlope = SequencePoint::linearSlope;
+	startPos.endSlope = SequencePoint::linearSlope;
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		startPos.point[i] = calibration.restPosition(i);
+	}
+
+	// Initializing the object handling servos
+	sequencePlayer.begin(startPos);
+
+#ifdef STEP_BENCHMARK
+	// Running the benchmark, no task is added so the firmware does nothing else
+	StepBenchmark::run(sequencePlayer, calibration.servoMin, calibration.servoMax);
+	return;
+#endif
+
+	// Setting the point to fill. The buffer cannot be full at this stage!
+	serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
+
+	// Adding tasks to the scheduler. The order of tasks is the one of overruns in the task
+	// overruns packet
+	scheduler.addTask(servoTask, servoUpdatePeriod);
+	scheduler.addTask(serialTask, 0);
+	scheduler.addTask(batteryTask, batteryPeriod);
+	scheduler.addTask(overrunsTask, overrunsPeriod);
+	scheduler.addTask(telemetryTask, telemetryPeriod);
+	scheduler.addTask(faceTask, facePeriod);
+	telemetry.startPeriod(micros());
+}
+
+void loop()
+{
+	scheduler.run();
+	telemetry.loopIteration();
 }
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "sequencepoint.h"
+
+/**
+ * \brief The calibration of the servos of a robot
+ *
+ * For each servo this has the PWM values of the minimum and maximum position
+ * (positions from 0 to 255 are mapped linearly between them) and the PWM of
+ * the rest position, where servos are moved when the firmware starts. Each
+ * robot has its own calibration, which is stored in the EEPROM (see
+ * CalibrationStorage) and can be changed by the PC with a set calibration
+ * packet, so that the same firmware works on all robots
+ */
+struct Calibration
+{
+	/**
+	 * \brief The maximum PWM value
+	 *
+	 * The PWM driver has 12 bits of resolution
+	 */
+	static const unsigned int maxPWM = 4095;
+
+	/**
+	 * \brief The PWM of the minimum position of each servo
+	 */
+	unsigned int servoMin[SequencePoint::dim];
+
+	/**
+	 * \brief The PWM of the maximum position of each servo
+	 */
+	unsigned int servoMax[SequencePoint::dim];
+
+	/**
+	 * \brief The PWM of the rest position of each servo
+	 */
+	unsigned int servoMid[SequencePoint::dim];
+
+	/**
+	 * \brief Returns true if the calibration can be used
+	 *
+	 * For each servo the minimum must be less than the maximum, the rest
+	 * position must be between them and all values must not be greater
+	 * than maxPWM
+	 * \return true if the calibration can be used
+	 */
+	bool isValid() const
+	{
+		for (unsigned char i = 0; i < SequencePoint::dim; ++i) {
+			if ((servoMin[i] >= servoMax[i]) || (servoMax[i] > maxPWM) || (servoMid[i] < servoMin[i]) || (servoMid[i] > servoMax[i])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief Returns the rest position of a servo
+	 *
+	 * \param i the index of the servo
+	 * \return the position (from 0 to 255) nearest to the rest PWM
+	 */
+	unsigned char restPosition(unsigned char i) const
+	{
+		const unsigned long range = servoMax[i] - servoMin[i];
+
+		return (unsigned char) (((unsigned long) (servoMid[i] - servoMin[i]) * 255 + range / 2) / range);
+	}
+};
+
+#endif
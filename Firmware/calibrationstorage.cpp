@@ -0,0 +1,84 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "calibrationstorage.h"
+#include <EEPROM.h>
+
+CalibrationStorage::CalibrationStorage()
+{
+}
+
+bool CalibrationStorage::isValid() const
+{
+	const unsigned int address = baseAddress();
+
+	return (EEPROM.length() >= size) && (EEPROM.read(address) == validMarker) && (EEPROM.read(address + 1) == SequencePoint::dim);
+}
+
+bool CalibrationStorage::read(Calibration& c) const
+{
+	if (!isValid()) {
+		return false;
+	}
+
+	// Reading into a copy, the calibration is only changed if the stored one is valid
+	Calibration stored;
+	unsigned int address = baseAddress() + 2;
+	for (unsigned char i = 0; i < SequencePoint::dim; ++i, address += 6) {
+		stored.servoMin[i] = (((unsigned int) EEPROM.read(address)) << 8) | EEPROM.read(address + 1);
+		stored.servoMax[i] = (((unsigned int) EEPROM.read(address + 2)) << 8) | EEPROM.read(address + 3);
+		stored.servoMid[i] = (((unsigned int) EEPROM.read(address + 4)) << 8) | EEPROM.read(address + 5);
+	}
+
+	if (!stored.isValid()) {
+		return false;
+	}
+	c = stored;
+
+	return true;
+}
+
+void CalibrationStorage::store(const Calibration& c)
+{
+	const unsigned int base = baseAddress();
+
+	// Invalidating first, so that an interrupted write does not leave a corrupted calibration
+	EEPROM.update(base, 0);
+
+	unsigned int address = base + 2;
+	for (unsigned char i = 0; i < SequencePoint::dim; ++i, address += 6) {
+		EEPROM.update(address, (c.servoMin[i] >> 8) & 0xFF);
+		EEPROM.update(address + 1, c.servoMin[i] & 0xFF);
+		EEPROM.update(address + 2, (c.servoMax[i] >> 8) & 0xFF);
+		EEPROM.update(address + 3, c.servoMax[i] & 0xFF);
+		EEPROM.update(address + 4, (c.servoMid[i] >> 8) & 0xFF);
+		EEPROM.update(address + 5, c.servoMid[i] & 0xFF);
+	}
+
+	EEPROM.update(base + 1, SequencePoint::dim);
+	EEPROM.update(base, validMarker);
+}
+
+unsigned int CalibrationStorage::baseAddress()
+{
+	return EEPROM.length() - size;
+}
@@ -0,0 +1,102 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef CALIBRATIONSTORAGE_H
+#define CALIBRATIONSTORAGE_H
+
+#include "calibration.h"
+
+/**
+ * \brief The class storing the calibration of servos in the EEPROM
+ *
+ * The calibration takes the last size bytes of the EEPROM (the sequence
+ * stored by SequenceStorage is at the beginning, its capacity takes this into
+ * account): a marker telling whether the calibration is valid and the number
+ * of servos, followed by the minimum, maximum and rest PWM of each servo (2
+ * bytes each, most significant byte first). Only changed bytes are written,
+ * but writing a whole calibration takes about 300 milliseconds, so this should
+ * only be used when servos are still.
+ */
+class CalibrationStorage
+{
+public:
+	/**
+	 * \brief The number of bytes taken by the calibration
+	 */
+	static const unsigned int size = 2 + 6 * SequencePoint::dim;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	CalibrationStorage();
+
+	/**
+	 * \brief Returns true if a valid calibration is stored
+	 *
+	 * \return true if a valid calibration is stored
+	 */
+	bool isValid() const;
+
+	/**
+	 * \brief Reads the stored calibration
+	 *
+	 * \param c the object to fill with the calibration. This is not
+	 *          changed if no valid calibration is stored
+	 * \return false if no valid calibration is stored
+	 */
+	bool read(Calibration& c) const;
+
+	/**
+	 * \brief Stores a calibration
+	 *
+	 * \param c the calibration to store, it must be valid (see
+	 *          Calibration::isValid())
+	 */
+	void store(const Calibration& c);
+
+private:
+	/**
+	 * \brief The value of the first byte when the stored calibration is
+	 *        valid
+	 */
+	static const unsigned char validMarker = 0x5A;
+
+	/**
+	 * \brief Returns the address of the first byte of the calibration
+	 *
+	 * \return the address of the calibration
+	 */
+	static unsigned int baseAddress();
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	CalibrationStorage(const CalibrationStorage&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	CalibrationStorage& operator=(const CalibrationStorage&);
+};
+
+#endif
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef CRC8_H
+#define CRC8_H
+
+/**
+ * \brief Adds a byte to a CRC-8
+ *
+ * This is the CRC-8 with polynomial 0x07 (x^8 + x^2 + x + 1), computed bit by
+ * bit to avoid a 256 bytes table. Start with 0 and add all bytes in order. It
+ * detects all errors of up to 2 bits and all bursts of up to 8 bits in the
+ * frames of the streaming protocol
+ * \param crc the CRC of the previous bytes
+ * \param v the byte to add
+ * \return the CRC including v
+ */
+inline unsigned char crc8Update(unsigned char crc, unsigned char v)
+{
+	crc ^= v;
+	for (unsigned char i = 0; i < 8; ++i) {
+		crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+	}
+
+	return crc;
+}
+
+#endif
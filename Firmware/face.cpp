@@ -0,0 +1,76 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "face.h"
+
+Face::Face()
+	: m_matrix()
+	, m_bitmap(NULL)
+	, m_blinkBitmap(NULL)
+	, m_blinking(false)
+	, m_lastBlinkTime(0)
+{
+}
+
+void Face::begin(uint8_t address, uint8_t rotation, uint8_t brightness)
+{
+	m_matrix.begin(address);
+	m_matrix.setRotation(rotation);
+	m_matrix.setBrightness(brightness);
+}
+
+void Face::setExpression(const uint8_t* bitmap, const uint8_t* blinkBitmap, unsigned long now)
+{
+	m_bitmap = bitmap;
+	m_blinkBitmap = blinkBitmap;
+	m_blinking = false;
+	m_lastBlinkTime = now;
+
+	draw(m_bitmap);
+}
+
+void Face::update(unsigned long now)
+{
+	// Showing or hiding the blink bitmap
+	if (m_blinkBitmap != NULL) {
+		const unsigned long elapsed = now - m_lastBlinkTime;
+		if ((!m_blinking && (elapsed >= blinkPeriod)) || (m_blinking && (elapsed >= blinkDuration))) {
+			m_blinking = !m_blinking;
+			m_lastBlinkTime = now;
+
+			draw(m_blinking ? m_blinkBitmap : m_bitmap);
+		}
+	}
+
+	m_matrix.writeChangedRows(rowsPerUpdate);
+}
+
+void Face::draw(const uint8_t* bitmap)
+{
+	if (bitmap == NULL) {
+		m_matrix.clear();
+	} else {
+		// Drawing the background too, instead of clearing the matrix, so that rows that do not
+		// change are not sent
+		m_matrix.drawBitmap(0, 0, bitmap, 8, 8, LED_ON, LED_OFF);
+	}
+}
@@ -0,0 +1,141 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef FACE_H
+#define FACE_H
+
+#include "AdafruitLEDBackpack.h"
+
+/**
+ * \brief The class animating the face of the robot on the LED matrix
+ *
+ * The face shares the I²C bus with the servo driver, so it is never written
+ * all at once: update() must be called periodically (the firmware does it
+ * right after each servo update) and each call sends at most rowsPerUpdate of
+ * the rows that changed since the last time they were sent. Rows that did not
+ * change are not sent at all, so a still face takes no time on the bus. The
+ * expression is an 8x8 bitmap in program memory. An expression can have a
+ * second bitmap that is shown for blinkDuration milliseconds every
+ * blinkPeriod milliseconds (to blink). Changing expression only changes the
+ * LED matrix buffer, the new face reaches the display in the next updates
+ */
+class Face
+{
+public:
+	/**
+	 * \brief The maximum number of rows sent by each update
+	 *
+	 * Each row takes 2 bytes, so this is a 5 bytes transmission including
+	 * the register address (about half a millisecond at 100 kHz)
+	 */
+	static const uint8_t rowsPerUpdate = 2;
+
+	/**
+	 * \brief The time between two blinks in milliseconds
+	 */
+	static const unsigned long blinkPeriod = 4000;
+
+	/**
+	 * \brief How long the blink bitmap is shown in milliseconds
+	 */
+	static const unsigned long blinkDuration = 150;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	Face();
+
+	/**
+	 * \brief Initializes the LED matrix
+	 *
+	 * This uses the I²C bus, call it only during setup
+	 * \param address the I²C address of the LED matrix
+	 * \param rotation the rotation of the matrix on the robot
+	 * \param brightness the brightness (0 to 15)
+	 */
+	void begin(uint8_t address, uint8_t rotation, uint8_t brightness);
+
+	/**
+	 * \brief Sets the expression
+	 *
+	 * \param bitmap the 8x8 bitmap of the expression, in program memory
+	 * \param blinkBitmap the 8x8 bitmap to show when blinking, in program
+	 *                    memory. Use NULL to never blink
+	 * \param now the current time in milliseconds
+	 */
+	void setExpression(const uint8_t* bitmap, const uint8_t* blinkBitmap, unsigned long now);
+
+	/**
+	 * \brief Advances the animation and sends part of the changed rows
+	 *
+	 * \param now the current time in milliseconds
+	 */
+	void update(unsigned long now);
+
+private:
+	/**
+	 * \brief Draws a bitmap in the buffer of the LED matrix
+	 *
+	 * Only rows that change are marked to be sent
+	 * \param bitmap the 8x8 bitmap, in program memory
+	 */
+	void draw(const uint8_t* bitmap);
+
+	/**
+	 * \brief The LED matrix
+	 */
+	Adafruit_8x8matrix m_matrix;
+
+	/**
+	 * \brief The bitmap of the current expression
+	 */
+	const uint8_t* m_bitmap;
+
+	/**
+	 * \brief The bitmap shown when blinking, NULL if the expression does
+	 *        not blink
+	 */
+	const uint8_t* m_blinkBitmap;
+
+	/**
+	 * \brief True if the blink bitmap is shown
+	 */
+	bool m_blinking;
+
+	/**
+	 * \brief The time when the blink bitmap was last shown or hidden
+	 */
+	unsigned long m_lastBlinkTime;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	Face(const Face&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	Face& operator=(const Face&);
+};
+
+#endif
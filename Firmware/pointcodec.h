@@ -0,0 +1,279 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef POINTCODEC_H
+#define POINTCODEC_H
+
+#include <stddef.h>
+
+/**
+ * \brief The encoding of points in sequence packets and delta sequence packets
+ *
+ * This header is shared by the firmware, the GUI and the tdd projects, so that
+ * all of them agree on the layout of packets (the protocol is described in the
+ * documentation of StreamEngine in the GUI). The dimension of points is a
+ * template parameter: sizes are compile time constants, loops on positions
+ * have a fixed number of iterations and the template cannot be instantiated
+ * with a dimension the mask of delta sequence packets cannot represent. No
+ * function allocates memory, packets are written to a buffer of the caller
+ * with room for at least maxPacketSize bytes. Durations and times to target
+ * are sent as 2 bytes, larger values are truncated
+ */
+template <unsigned char DimT>
+class PointCodec
+{
+public:
+	/**
+	 * \brief The maximum dimension of points (the bits of the mask of delta
+	 *        sequence packets)
+	 */
+	static const unsigned char maxDim = 16;
+
+	/**
+	 * \brief The dimension of points
+	 */
+	static const unsigned char dim = DimT;
+
+	/**
+	 * \brief The bytes of duration and time to target in a sequence
+	 *        packet
+	 */
+	static const unsigned char timesSize = 4;
+
+	/**
+	 * \brief The size of a sequence packet, including the type
+	 */
+	static const unsigned char sequencePacketSize = 1 + timesSize + dim;
+
+	/**
+	 * \brief The maximum size of a delta sequence packet, including the
+	 *        type
+	 */
+	static const unsigned char maxDeltaPacketSize = 1 + 1 + 2 + timesSize + 2 + dim;
+
+	/**
+	 * \brief The maximum size of any packet created by this class
+	 */
+	static const unsigned char maxPacketSize = maxDeltaPacketSize;
+
+	/**
+	 * \brief The flag of delta sequence packets with a 1 byte duration
+	 */
+	static const unsigned char shortDurationFlag = 0x01;
+
+	/**
+	 * \brief The flag of delta sequence packets with a 1 byte time to
+	 *        target
+	 */
+	static const unsigned char shortTimeToTargetFlag = 0x02;
+
+	/**
+	 * \brief The flag of delta sequence packets with the slopes of the
+	 *        easing profile
+	 */
+	static const unsigned char easingFlag = 0x04;
+
+	/**
+	 * \brief The slope of the linear motion (1.0 in Q6 fixed point)
+	 */
+	static const unsigned char linearSlope = 64;
+
+public:
+	/**
+	 * \brief Returns the number of bytes of a delta sequence packet after
+	 *        the type and before the changed positions
+	 *
+	 * \param flags the flags of the packet
+	 * \return the number of bytes from the flags to the mask, both included
+	 */
+	static unsigned char deltaHeaderSize(unsigned char flags)
+	{
+		return 1 + ((flags & easingFlag) ? 2 : 0) + ((flags & shortDurationFlag) ? 1 : 2) + ((flags & shortTimeToTargetFlag) ? 1 : 2) + 2;
+	}
+
+	/**
+	 * \brief Returns the number of positions in the mask of a delta
+	 *        sequence packet
+	 *
+	 * Bits beyond the dimension of points are ignored
+	 * \param mask the mask
+	 * \return the number of changed positions
+	 */
+	static unsigned char numChanged(unsigned int mask)
+	{
+		unsigned char n = 0;
+		for (unsigned char i = 0; i < dim; ++i) {
+			if (mask & (1U << i)) {
+				++n;
+			}
+		}
+
+		return n;
+	}
+
+	/**
+	 * \brief Writes a sequence packet
+	 *
+	 * \param duration the duration of the point in milliseconds
+	 * \param timeToTarget the time to reach the point in milliseconds
+	 * \param values the dim positions of the point
+	 * \param packet the buffer where the packet is written
+	 * \return the size of the packet (always sequencePacketSize)
+	 */
+	static unsigned char encodeSequencePacket(unsigned int duration, unsigned int timeToTarget, const unsigned char* values, unsigned char* packet)
+	{
+		packet[0] = 'P';
+		packet[1] = (duration >> 8) & 0xFF;
+		packet[2] = duration & 0xFF;
+		packet[3] = (timeToTarget >> 8) & 0xFF;
+		packet[4] = timeToTarget & 0xFF;
+		for (unsigned char i = 0; i < dim; ++i) {
+			packet[1 + timesSize + i] = values[i];
+		}
+
+		return sequencePacketSize;
+	}
+
+	/**
+	 * \brief Writes a delta sequence packet
+	 *
+	 * \param duration the duration of the point in milliseconds
+	 * \param timeToTarget the time to reach the point in milliseconds
+	 * \param startSlope the slope of the easing profile at the start
+	 * \param endSlope the slope of the easing profile at the end
+	 * \param values the dim positions of the point
+	 * \param previousValues the dim positions of the previous point sent,
+	 *                       NULL to send all positions
+	 * \param packet the buffer where the packet is written
+	 * \return the size of the packet
+	 */
+	static unsigned char encodeDeltaPacket(unsigned int duration, unsigned int timeToTarget, unsigned char startSlope, unsigned char endSlope, const unsigned char* values, const unsigned char* previousValues, unsigned char* packet)
+	{
+		// Duration and time to target fit in one byte if the most significant byte is 0
+		const bool shortDuration = (((duration >> 8) & 0xFF) == 0);
+		const bool shortTimeToTarget = (((timeToTarget >> 8) & 0xFF) == 0);
+		const bool linear = (startSlope == linearSlope) && (endSlope == linearSlope);
+
+		unsigned char size = 0;
+		packet[size++] = 'Q';
+		packet[size++] = (shortDuration ? shortDurationFlag : 0) | (shortTimeToTarget ? shortTimeToTargetFlag : 0) | (linear ? 0 : easingFlag);
+		if (!linear) {
+			packet[size++] = startSlope;
+			packet[size++] = endSlope;
+		}
+		if (!shortDuration) {
+			packet[size++] = (duration >> 8) & 0xFF;
+		}
+		packet[size++] = duration & 0xFF;
+		if (!shortTimeToTarget) {
+			packet[size++] = (timeToTarget >> 8) & 0xFF;
+		}
+		packet[size++] = timeToTarget & 0xFF;
+
+		// The mask is written before the positions, but computed together with them
+		unsigned int mask = 0;
+		unsigned char* const maskBytes = packet + size;
+		size += 2;
+		for (unsigned char i = 0; i < dim; ++i) {
+			if ((previousValues == NULL) || (values[i] != previousValues[i])) {
+				mask |= (1U << i);
+				packet[size++] = values[i];
+			}
+		}
+		maskBytes[0] = (mask >> 8) & 0xFF;
+		maskBytes[1] = mask & 0xFF;
+
+		return size;
+	}
+
+	/**
+	 * \brief Writes the shortest packet for a point of a stream
+	 *
+	 * Points with an easing profile always need the delta sequence packet,
+	 * linear ones use it only if it is shorter than the sequence packet
+	 * \param duration the duration of the point in milliseconds
+	 * \param timeToTarget the time to reach the point in milliseconds
+	 * \param startSlope the slope of the easing profile at the start
+	 * \param endSlope the slope of the easing profile at the end
+	 * \param values the dim positions of the point
+	 * \param previousValues the dim positions of the previous point sent,
+	 *                       NULL if this is the first one
+	 * \param packet the buffer where the packet is written
+	 * \return the size of the packet
+	 */
+	static unsigned char encodeStreamPacket(unsigned int duration, unsigned int timeToTarget, unsigned char startSlope, unsigned char endSlope, const unsigned char* values, const unsigned char* previousValues, unsigned char* packet)
+	{
+		const bool linear = (startSlope == linearSlope) && (endSlope == linearSlope);
+		if ((previousValues != NULL) || !linear) {
+			const unsigned char size = encodeDeltaPacket(duration, timeToTarget, startSlope, endSlope, values, previousValues, packet);
+			if (!linear || (size < sequencePacketSize)) {
+				return size;
+			}
+		}
+
+		return encodeSequencePacket(duration, timeToTarget, values, packet);
+	}
+
+private:
+	/**
+	 * \brief This has a negative size, and does not compile, if points
+	 *        have no positions or more than the mask can represent
+	 */
+	typedef char DimensionCheck[((DimT > 0) && (DimT <= maxDim)) ? 1 : -1];
+
+	/**
+	 * \brief Constructor is disabled, this class only has static members
+	 */
+	PointCodec();
+};
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::maxDim;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::dim;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::timesSize;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::sequencePacketSize;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::maxDeltaPacketSize;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::maxPacketSize;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::shortDurationFlag;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::shortTimeToTargetFlag;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::easingFlag;
+
+template <unsigned char DimT>
+const unsigned char PointCodec<DimT>::linearSlope;
+
+#endif
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "scheduler.h"
+#include <Arduino.h>
+
+Scheduler::Scheduler()
+	: m_tasks()
+	, m_numTasks(0)
+{
+}
+
+int Scheduler::addTask(TaskFunction function, unsigned long period)
+{
+	if (m_numTasks == maxTasks) {
+		return -1;
+	}
+
+	Task& t = m_tasks[m_numTasks];
+	t.function = function;
+	t.period = period;
+	t.nextActivation = 0;
+	t.overruns = 0;
+	t.started = false;
+
+	return m_numTasks++;
+}
+
+void Scheduler::run()
+{
+	for (unsigned char i = 0; i < m_numTasks; ++i) {
+		Task& t = m_tasks[i];
+
+		if (t.period == 0) {
+			t.function();
+
+			continue;
+		}
+
+		// Reading the time for each task, because previous tasks could have
+		// taken a long time. The cast to long makes the checks work when micros()
+		// wraps around
+		const unsigned long now = micros();
+		if (!t.started) {
+			t.started = true;
+			t.nextActivation = now;
+		} else if (long(now - t.nextActivation) < 0) {
+			// Not yet time for this task
+			continue;
+		}
+
+		// Computing when the next activation should happen. If we are already past it,
+		// we missed at least one deadline: counting the overrun and realigning the
+		// schedule to the current time
+		t.nextActivation += t.period;
+		if (long(now - t.nextActivation) >= 0) {
+			if (t.overruns != 0xFFFF) {
+				++t.overruns;
+			}
+			t.nextActivation = now + t.period;
+		}
+
+		t.function();
+	}
+}
+
+void Scheduler::resetOverruns()
+{
+	for (unsigned char i = 0; i < m_numTasks; ++i) {
+		m_tasks[i].overruns = 0;
+	}
+}
@@ -0,0 +1,157 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/**
+ * \brief A simple cooperative scheduler for fixed-rate tasks
+ *
+ * Tasks are functions that are called periodically by run(), which must be
+ * called continuously inside loop(). Each task has a period in microseconds: a
+ * period of 0 means that the task is executed at every call of run(). Tasks
+ * are never preempted, so a slow task delays all the others. When a task
+ * starts after the deadline of its following activation, it has missed at
+ * least one activation: in this case the overrun counter of the task is
+ * incremented and its schedule is realigned to the current time (missed
+ * activations are not recovered). Tasks are executed in the order in which
+ * they were added. Everything is statically allocated, there can be at most
+ * maxTasks tasks
+ */
+class Scheduler
+{
+public:
+	/**
+	 * \brief The type of task functions
+	 */
+	typedef void (*TaskFunction)();
+
+	/**
+	 * \brief The maximum number of tasks
+	 */
+	static const unsigned char maxTasks = 8;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	Scheduler();
+
+	/**
+	 * \brief Adds a task
+	 *
+	 * The first activation of the task happens at the first call of run()
+	 * \param function the function to call
+	 * \param period the period of the task in microseconds. Use 0 to call
+	 *               the function at every run() call
+	 * \return the index of the task or -1 if there are already maxTasks
+	 *         tasks
+	 */
+	int addTask(TaskFunction function, unsigned long period);
+
+	/**
+	 * \brief Executes all tasks that are due
+	 *
+	 * Call this inside loop()
+	 */
+	void run();
+
+	/**
+	 * \brief Returns the number of tasks
+	 *
+	 * \return the number of tasks
+	 */
+	unsigned char numTasks() const
+	{
+		return m_numTasks;
+	}
+
+	/**
+	 * \brief Returns how many times a task missed its deadline
+	 *
+	 * The counter saturates at its maximum value
+	 * \param task the index of the task
+	 * \return the number of overruns of the task
+	 */
+	unsigned int overruns(unsigned char task) const
+	{
+		return m_tasks[task].overruns;
+	}
+
+	/**
+	 * \brief Resets the overrun counters of all tasks
+	 */
+	void resetOverruns();
+
+private:
+	/**
+	 * \brief The structure with information about a task
+	 */
+	struct Task
+	{
+		/**
+		 * \brief The function to call
+		 */
+		TaskFunction function;
+
+		/**
+		 * \brief The period in microseconds
+		 */
+		unsigned long period;
+
+		/**
+		 * \brief The time of the next activation in microseconds
+		 */
+		unsigned long nextActivation;
+
+		/**
+		 * \brief The number of missed deadlines
+		 */
+		unsigned int overruns;
+
+		/**
+		 * \brief False until the task is executed the first time
+		 */
+		bool started;
+	};
+
+	/**
+	 * \brief The list of tasks
+	 */
+	Task m_tasks[maxTasks];
+
+	/**
+	 * \brief The number of tasks
+	 */
+	unsigned char m_numTasks;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	Scheduler(const Scheduler&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	Scheduler& operator=(const Scheduler&);
+};
+
+#endif
@@ -28,33 +28,54 @@
 // #include "serialcommunication.h"
 // extern SerialCommunication serialCommunication;
 
-SequencePlayer::SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim])
+SequencePlayer::SequencePlayer(const Calibration& calibration)
 	: m_pwm()
+	, m_pointToFillData()
 	, m_curPoint(1)
 	, m_prevPoint(0)
 	, m_pointToFill(1)
 	, m_stepStartTime(0)
+	, m_stepStartTimeSet(false)
 	, m_startingNewPoint(true)
+	, m_startTime(0)
+	, m_waitingStartTime(false)
+	, m_lastPWM()
 {
-	// Copying the minimum PWM for servos and computing the range
-	memcpy(m_servoMin, servoMin, sizeof(m_servoMin));
+	setCalibration(calibration);
+}
+
+void SequencePlayer::setCalibration(const Calibration& calibration)
+{
+	// Copying the minimum PWM for servos and computing the range and the slope of the
+	// mapping from positions to PWM values (rounded to the nearest value)
+	memcpy(m_servoMin, calibration.servoMin, sizeof(m_servoMin));
 	for (int i = 0; i < SequencePoint::dim; ++i) {
-		m_servoRange[i] = servoMax[i] - servoMin[i];
+		m_servoRange[i] = calibration.servoMax[i] - calibration.servoMin[i];
+		m_servoScale[i] = ((((unsigned long) m_servoRange[i]) << 16) + 127) / 255;
 	}
 }
 
 void SequencePlayer::begin(const SequencePoint& curPos)
 {
-	memcpy(&(m_buffer[m_prevPoint]), &curPos, sizeof(SequencePoint));
+	// The previous segment is a segment ending in the current position
+	memcpy(&m_pointToFillData, &curPos, sizeof(SequencePoint));
+	SequenceSegment& prev = m_buffer[m_prevPoint];
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		prev.startPWM[i] = servoPWM(i, curPos.point[i]);
+		prev.deltaPWM[i] = 0;
+	}
+	prev.duration = curPos.duration;
+	prev.timeToTarget = curPos.timeToTarget;
+	prev.timeToTargetReciprocal = 0;
+	prev.startSlope = SequencePoint::linearSlope;
+	prev.endSlope = SequencePoint::linearSlope;
 
 	// Initializing the pwm driver
 	m_pwm.begin();
 	m_pwm.setPWMFreq(200);
 
 	// Moving all servos to their position
-	for (int i = 0; i < SequencePoint::dim; ++i) {
-		moveServo(i, curPos.point[i]);
-	}
+	moveServos(prev.startPWM, true);
 }
 
 SequencePoint* SequencePlayer::pointToFill()
@@ -63,56 +84,113 @@ SequencePoint* SequencePlayer::pointToFill()
 		return NULL;
 	}
 
-	return &(m_buffer[m_pointToFill]);
+	return &m_pointToFillData;
 }
 
 void SequencePlayer::pointFilled()
 {
-	m_pointToFill = (m_pointToFill + 1) % bufferDimension;
+	// The new segment starts where the last segment in the buffer ends
+	const SequenceSegment& prev = m_buffer[(m_pointToFill + bufferDimension - 1) % bufferDimension];
+	SequenceSegment& segment = m_buffer[m_pointToFill];
+
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		const uint16_t start = prev.startPWM[i] + prev.deltaPWM[i];
+		segment.startPWM[i] = start;
+		segment.deltaPWM[i] = int16_t(servoPWM(i, m_pointToFillData.point[i])) - int16_t(start);
+	}
+	segment.duration = m_pointToFillData.duration;
+	segment.timeToTarget = m_pointToFillData.timeToTarget;
+
+	// Computing the reciprocal of the time to target. This is the only division needed for
+	// the whole segment
+	const unsigned int timeToTarget = m_pointToFillData.timeToTarget;
+	segment.timeToTargetReciprocal = (timeToTarget == 0) ? 0 : (((1UL << 24) + (timeToTarget / 2)) / timeToTarget);
+
+	// Slopes out of range would make the motion overshoot the target
+	const unsigned char maxSlope = SequencePoint::maxSlope;
+	segment.startSlope = min(m_pointToFillData.startSlope, maxSlope);
+	segment.endSlope = min(m_pointToFillData.endSlope, maxSlope);
+
+	m_pointToFill = nextIndex(m_pointToFill);
 }
 
 void SequencePlayer::forceNextPoint()
 {
 	m_startingNewPoint = true;
-	m_curPoint = (m_curPoint + 1) % bufferDimension;
-	m_prevPoint = (m_prevPoint + 1) % bufferDimension;
+	m_stepStartTimeSet = false;
+	m_curPoint = nextIndex(m_curPoint);
+	m_prevPoint = nextIndex(m_prevPoint);
+}
+
+void SequencePlayer::setStartTime(unsigned long startTime)
+{
+	m_startTime = startTime;
+	m_waitingStartTime = true;
 }
 
-bool SequencePlayer::step()
+bool SequencePlayer::step(unsigned long curTime)
 {
 	if (bufferEmpty()) {
 		return false;
 	}
 
-	if (m_startingNewPoint) {
+	if (m_waitingStartTime) {
+		// Waiting for the start time (the comparison works across the wrap around of time), then
+		// the point starts exactly at that time
+		if (((long) (curTime - m_startTime)) < 0) {
+			return true;
+		}
+
+		m_waitingStartTime = false;
+		m_startingNewPoint = true;
+		m_stepStartTime = m_startTime;
+		m_stepStartTimeSet = true;
+	}
+
+	if (m_startingNewPoint && !m_stepStartTimeSet) {
 		// Storing the start time
-		m_stepStartTime = millis();
+		m_stepStartTime = curTime;
 	}
 
 	// Now checking how much has passed since we being move
-	const unsigned long stepTime = millis() - m_stepStartTime;
+	const unsigned long stepTime = curTime - m_stepStartTime;
+	const unsigned long pointTime = (unsigned long) m_buffer[m_curPoint].timeToTarget + m_buffer[m_curPoint].duration;
 
 	// Checking what to do. Notice that if both timeToTarget and duration are 0, we move
-	// to the target position directly. If the first check, the !m_startingNewPoint condition
-	// is checked to avoid skipping a point that has both timeToTarget and duration to 0 when
-	// millis() changes between the two calls above
-	if ((!m_startingNewPoint) && (stepTime > (m_buffer[m_curPoint].timeToTarget + m_buffer[m_curPoint].duration))) {
-		// The current step has finished, moving to the next one and recursively calling self
+	// to the target position directly. In the first check, the !m_startingNewPoint condition
+	// is checked to avoid skipping a point without moving servos at least once (this could
+	// happen with points having both timeToTarget and duration to 0 or when the point
+	// started while step() was not being called)
+	if ((!m_startingNewPoint) && (stepTime > pointTime)) {
+		// The current step has finished, moving to the next one and recursively calling self.
+		// If the next point is already in the buffer, it starts exactly when this one ended
+		const unsigned long pointEndTime = m_stepStartTime + pointTime;
 		forceNextPoint();
+		if (!bufferEmpty()) {
+			m_stepStartTime = pointEndTime;
+			m_stepStartTimeSet = true;
+		}
 
-		return step();
+		return step(curTime);
 	} else {
 		// Checking if we have to move (if not we simply wait)
 		if ((m_startingNewPoint) || (stepTime <= m_buffer[m_curPoint].timeToTarget)) {
-			// We have not reached the point yet, moving servos
+			// We have not reached the point yet, computing the whole frame
+			// and then moving servos. If the point started late, we could already be
+			// past the time to target
+			const unsigned long moveTime = min(stepTime, (unsigned long) m_buffer[m_curPoint].timeToTarget);
+			const unsigned long fraction = currentFraction(moveTime);
+			uint16_t pwm[SequencePoint::dim];
 			for (int i = 0; i < SequencePoint::dim; ++i) {
-				moveServo(i, currentServoPos(i, stepTime));
+				pwm[i] = currentServoPWM(i, fraction);
 			}
+			moveServos(pwm);
 		}
 	}
 
-	// Resetting the startingNewPoint flag
+	// Resetting the flags for the starting of a new point
 	m_startingNewPoint = false;
+	m_stepStartTimeSet = false;
 
 	// If we get here, the buffer is not empty for sure (the only point in which the buffer
 	// can become empty is when we recursively call self. In that case the check is at the
@@ -128,30 +206,86 @@ void SequencePlayer::clearBuffer()
 	// We also set the flag for the starting of a new point to true to store the start time
 	// the first time step() is called with a point
 	m_startingNewPoint = true;
+	m_stepStartTimeSet = false;
+	m_waitingStartTime = false;
 }
 
-unsigned char SequencePlayer::currentServoPos(int servo, unsigned long curTime)
+unsigned long SequencePlayer::currentFraction(unsigned long curTime) const
 {
-	// Computing the new position. This is still a value between 0 and 255.
-	// If timeToTarget is 0, the new position will be the one in curPoint
-	unsigned char newPos;
+	// If timeToTarget is 0, the point is reached immediately
+	const unsigned long reciprocal = m_buffer[m_curPoint].timeToTargetReciprocal;
+	if (reciprocal == 0) {
+		return 1UL << 16;
+	}
 
-	if (m_buffer[m_curPoint].timeToTarget == 0) {
-		newPos = m_buffer[m_curPoint].point[servo];
-	} else {
-		const long d = long(m_buffer[m_curPoint].point[servo]) - long(m_buffer[m_prevPoint].point[servo]);
-		const long newP = long(m_buffer[m_prevPoint].point[servo]) + ((d * long(curTime)) / long(m_buffer[m_curPoint].timeToTarget));
-		newPos = (unsigned char) newP;
+	// Here curTime <= timeToTarget, so the product is at most about 2^24
+	const unsigned long fraction = min((curTime * reciprocal) >> 8, 1UL << 16);
+
+	const SequenceSegment& segment = m_buffer[m_curPoint];
+	if ((segment.startSlope == SequencePoint::linearSlope) && (segment.endSlope == SequencePoint::linearSlope)) {
+		return fraction;
 	}
 
-	return newPos;
+	return easeFraction(fraction, segment.startSlope, segment.endSlope);
 }
 
-void SequencePlayer::moveServo(int servo, unsigned char pos)
+unsigned long SequencePlayer::easeFraction(unsigned long fraction, unsigned char startSlope, unsigned char endSlope)
 {
-	// Here we map the position in the PWM range. pos is always a value between 0 and 255
-	const long mappedPos = ((long(pos) * m_servoRange[servo]) / 255) + m_servoMin[servo];
+	// Coefficients are in Q12 (slopes are in Q6) and the fraction is taken in Q15, so that
+	// all products fit a long: coefficients are at most 6 in absolute value and the partial
+	// sums of Horner's method are at most 10. All products are rounded
+	const long a1 = long(startSlope) << 6;
+	const long a2 = (3L << 12) - (long(startSlope) << 7) - (long(endSlope) << 6);
+	const long a3 = ((long(startSlope) + long(endSlope)) << 6) - (2L << 12);
+	const long f = long(fraction >> 1);
+
+	long v = ((a3 * f + (1L << 14)) >> 15) + a2;
+	v = ((v * f + (1L << 14)) >> 15) + a1;
+
+	// The last product is in Q27, shifting by 11 with rounding to get Q16
+	v = (v * f + (1L << 10)) >> 11;
+
+	// Slopes are never above 3, so the profile never leaves [0, 1]. Here we only protect
+	// from rounding errors
+	return (unsigned long) max(0L, min(v, 1L << 16));
+}
+
+uint16_t SequencePlayer::currentServoPWM(int servo, unsigned long fraction) const
+{
+	// Computing the new PWM value. The fraction is in Q16, so we add half unit before
+	// shifting to round the result
+	const SequenceSegment& segment = m_buffer[m_curPoint];
+
+	return segment.startPWM[servo] + ((long(segment.deltaPWM[servo]) * long(fraction) + (1L << 15)) >> 16);
+}
 
-	// Moving servo
-	m_pwm.setPWM(servo, 0, mappedPos);
+uint16_t SequencePlayer::servoPWM(int servo, unsigned char pos) const
+{
+	// Here we map the position in the PWM range. pos is always a value between 0 and 255,
+	// m_servoScale is in Q16, so we add half unit before shifting to round the result
+	return ((pos * m_servoScale[servo] + (1UL << 15)) >> 16) + m_servoMin[servo];
+}
+
+void SequencePlayer::moveServos(const uint16_t pwm[SequencePoint::dim], bool forceAll)
+{
+	int first = 0;
+	while (first < SequencePoint::dim) {
+		// Skipping channels that didn't change
+		if ((!forceAll) && (pwm[first] == m_lastPWM[first])) {
+			++first;
+			continue;
+		}
+
+		// Looking for the end of the run of changed channels
+		int last = first + 1;
+		while ((last < SequencePoint::dim) && (forceAll || (pwm[last] != m_lastPWM[last]))) {
+			++last;
+		}
+
+		// Sending the whole run, the driver splits it in chunks that fit the Wire buffer
+		m_pwm.setPWMRange(first, last - first, &(pwm[first]));
+		memcpy(&(m_lastPWM[first]), &(pwm[first]), (last - first) * sizeof(uint16_t));
+
+		first = last;
+	}
 }
@@ -23,40 +23,136 @@
 #define SEQUENCEPLAYER_H
 
 #include "sequencepoint.h"
+#include "calibration.h"
 #include "AdafruitPWMServoDriver.h"
 
+// The amount of SRAM in bytes reserved to the buffer of SequencePlayer. The
+// number of segments in the buffer is computed from this value. Change it here
+// to use a different amount of memory. By default we use a quarter of the SRAM
+#ifndef SEQUENCEPLAYER_BUFFER_RAM
+	#if defined(RAMSTART) && defined(RAMEND)
+		#define SEQUENCEPLAYER_BUFFER_RAM ((RAMEND - RAMSTART + 1) / 4)
+	#else
+		#define SEQUENCEPLAYER_BUFFER_RAM 512
+	#endif
+#endif
+
+/**
+ * \brief A segment of the sequence, ready to be played
+ *
+ * This is the result of the transformation of a SequencePoint performed when
+ * the point is added to the buffer of SequencePlayer: positions are already
+ * mapped to PWM values and the segment stores where each servo starts and how
+ * much it has to move to reach the point, so that playing the segment only
+ * requires a multiplication and a shift per servo (plus three
+ * multiplications per step for the easing profile). Interpolation works
+ * with the full resolution of PWM values. The PWM value at the end of the
+ * segment is startPWM + deltaPWM
+ */
+struct SequenceSegment
+{
+	/**
+	 * \brief The PWM values of servos at the beginning of the segment
+	 */
+	uint16_t startPWM[SequencePoint::dim];
+
+	/**
+	 * \brief The PWM increment of servos from the beginning to the end of
+	 *        the segment
+	 */
+	int16_t deltaPWM[SequencePoint::dim];
+
+	/**
+	 * \brief The duration of the point in milliseconds
+	 */
+	unsigned int duration;
+
+	/**
+	 * \brief The time to reach this point in milliseconds
+	 */
+	unsigned int timeToTarget;
+
+	/**
+	 * \brief The reciprocal of timeToTarget
+	 *
+	 * This is 2^24 / timeToTarget, so that the covered fraction of the
+	 * segment is computed using only a multiplication and a shift. It is 0
+	 * if timeToTarget is 0
+	 */
+	unsigned long timeToTargetReciprocal;
+
+	/**
+	 * \brief The slope of the easing profile at the start of the segment
+	 *
+	 * See SequencePoint for the meaning of slopes
+	 */
+	unsigned char startSlope;
+
+	/**
+	 * \brief The slope of the easing profile at the end of the segment
+	 */
+	unsigned char endSlope;
+};
+
 /**
  * \brief The class controlling the servos
  *
- * This class stores sequence points and moves servos. Sequence points are in
- * a ring buffer. To add a sequence point use the pointer returned by the
- * function pointToFill(), then call pointFilled() when the sequence point is
- * valid. To play the sequence call step(). This class internally uses millis()
- * to compute the position of servos. Never move servos controlled by this class
- * externally: here we need to keep the current position to compute the velocity
- * at which servos must move to a new postition. The current position of servos
- * is stored in the buffer but it never cleared. After instantiating this class,
- * always call begin before starting to use the object. We internally use an
- * Adafruit_PWMServoDriver object to control the servos
+ * This class stores sequence points and moves servos. Sequence points are
+ * received in a SequencePoint object: to add a sequence point use the pointer
+ * returned by the function pointToFill(), then call pointFilled() when the
+ * sequence point is valid. pointFilled() transforms the point into a
+ * SequenceSegment which is stored in a ring buffer, so that all the work that
+ * only depends on the point is done once. The point returned by pointToFill()
+ * is never cleared, so it always contains the last point that was filled. To
+ * play the sequence call step() periodically, passing the current time in
+ * milliseconds, which is used to compute the position of servos. When a point
+ * ends and the following one is already in the buffer, the following point
+ * starts exactly when the previous one ended, so that the period at which
+ * step() is called doesn't accumulate timing errors. The start of the first
+ * point can be scheduled with setStartTime(), so that more hardware sharing
+ * the same clock (see SyncClock) start a sequence together: since each point
+ * starts when the previous one ends, the whole sequence stays aligned.
+ * Never move servos controlled by this class externally: here we need to keep
+ * the current position to compute the velocity at which servos must move to a
+ * new postition. The current position of servos is stored in the buffer but it
+ * never cleared. After instantiating this class, always call begin before
+ * starting to use the object. We internally use an Adafruit_PWMServoDriver
+ * object to control the servos
  */
 class SequencePlayer
 {
 public:
 	/**
-	 * \brief How many sequence points we can buffer
+	 * \brief How many sequence segments we can buffer
+	 *
+	 * This is computed at compile time from SEQUENCEPLAYER_BUFFER_RAM. It
+	 * is at least 2 and at most 256, so that the number of free slots
+	 * always fits a byte. One of the segments is always taken by the last
+	 * reached point, so at most bufferDimension - 1 points can be waiting
+	 * to be played
 	 */
-	static const int bufferDimension = 4;
+	static const int bufferDimension = ((SEQUENCEPLAYER_BUFFER_RAM / sizeof(SequenceSegment)) < 2) ? 2 : (((SEQUENCEPLAYER_BUFFER_RAM / sizeof(SequenceSegment)) > 256) ? 256 : (SEQUENCEPLAYER_BUFFER_RAM / sizeof(SequenceSegment)));
 
 public:
 	/**
 	 * \brief Constructor
 	 *
-	 * \param servoMin the vector with the minimum valus of the PWM of
-	 *                 servos
-	 * \param servoMax the vector with the maximum valus of the PWM of
-	 *                 servos
+	 * \param calibration the calibration of servos. Only the minimum and
+	 *                    maximum PWM are used
 	 */
-	SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim]);
+	SequencePlayer(const Calibration& calibration);
+
+	/**
+	 * \brief Changes the calibration of servos
+	 *
+	 * This recomputes the tables used to map positions to PWM values, so
+	 * the cost is paid here and not when points are added. Segments already
+	 * in the buffer keep the PWM values of the old calibration, so only
+	 * call this when no sequence is being played: the next point moves
+	 * servos from where they are to its position with the new calibration
+	 * \param calibration the new calibration of servos
+	 */
+	void setCalibration(const Calibration& calibration);
 
 	/**
 	 * \brief Initializes servos
@@ -69,12 +165,11 @@ public:
 	void begin(const SequencePoint& curPos);
 
 	/**
-	 * \brief Returns a pointer to the next point in the buffer to fill
+	 * \brief Returns a pointer to the point to fill
 	 *
 	 * This returns NULL if the buffer is full. This function keeps
 	 * returning the same point until the pointFilled() function is called
-	 * \return a pointer to the next point in the buffer to fill or NULL if
-	 *         the buffer is full
+	 * \return a pointer to the point to fill or NULL if the buffer is full
 	 */
 	SequencePoint* pointToFill();
 
@@ -82,7 +177,8 @@ public:
 	 * \brief Sets the point previously returned by pointToFill as filled
 	 *
 	 * Call this after you have finished modifying the point returned by the
-	 * pointToFill() function
+	 * pointToFill() function. This transforms the point into a segment and
+	 * adds it to the buffer
 	 */
 	void pointFilled();
 
@@ -95,15 +191,31 @@ public:
 	 */
 	void forceNextPoint();
 
+	/**
+	 * \brief Sets the time when the next point starts
+	 *
+	 * Servos are not moved until the given time, then the first point in
+	 * the buffer starts exactly at that time (if step() is called late,
+	 * the point is played as if it had started on time). This only
+	 * applies to the first point after the buffer was empty: call this
+	 * just after clearBuffer() or when the buffer is empty. clearBuffer()
+	 * removes the start time
+	 * \param startTime the time when the next point starts, in the same
+	 *                  units of the time passed to step()
+	 */
+	void setStartTime(unsigned long startTime);
+
 	/**
 	 * \brief Performs a step
 	 *
 	 * This function can either move servos, wait or move to the next
 	 * sequence point. It only returns false if it cannot do anything
 	 * because the buffer is empty
+	 * \param curTime the current time in milliseconds (i.e. the value of
+	 *                millis())
 	 * \return false if the buffer is empty, true otherwise
 	 */
-	bool step();
+	bool step(unsigned long curTime);
 
 	/**
 	 * \brief Clears the buffer
@@ -132,25 +244,89 @@ public:
 		return (m_prevPoint == m_pointToFill);
 	}
 
+	/**
+	 * \brief Returns how many points can be added to the buffer
+	 *
+	 * \return the number of free slots in the buffer
+	 */
+	unsigned char freeSlots() const
+	{
+		return (m_prevPoint - m_pointToFill + bufferDimension) % bufferDimension;
+	}
+
 private:
 	/**
-	 * \brief Computes the position the servo it should have at the given
-	 *        time
+	 * \brief Returns the index following i in the ring buffer
 	 *
-	 * \param servo the index of the servo to move
-	 * \param curTime the current step time. This MUST be lower than the
-	 *                timeToTarget of the current step
-	 * \return the position the servo should have
+	 * \param i the index in the buffer
+	 * \return the index following i
+	 */
+	static int nextIndex(int i)
+	{
+		return ((i + 1) == bufferDimension) ? 0 : (i + 1);
+	}
+
+	/**
+	 * \brief Computes the fraction of the current segment that has been
+	 *        covered at the given time
+	 *
+	 * This uses the reciprocal of the time to target, so that no division
+	 * is needed. The easing profile of the segment is applied to the
+	 * fraction of time (see easeFraction())
+	 * \param curTime the current step time. This MUST be lower than or
+	 *                equal to the timeToTarget of the current step
+	 * \return the covered fraction in Q16 fixed point (65536 means that
+	 *         the point has been reached)
+	 */
+	unsigned long currentFraction(unsigned long curTime) const;
+
+	/**
+	 * \brief Applies an easing profile to a fraction of time
+	 *
+	 * The profile is the cubic Hermite curve a1 * f + a2 * f^2 + a3 * f^3,
+	 * with a1 = s, a2 = 3 - 2 * s - e and a3 = s + e - 2 (s and e are the
+	 * start and end slopes). It is evaluated with Horner's method in fixed
+	 * point, using only 32 bits integers
+	 * \param fraction the fraction of time in Q16 fixed point
+	 * \param startSlope the slope at the start in Q6 fixed point
+	 * \param endSlope the slope at the end in Q6 fixed point
+	 * \return the covered fraction in Q16 fixed point
 	 */
-	unsigned char currentServoPos(int servo, unsigned long curTime);
+	static unsigned long easeFraction(unsigned long fraction, unsigned char startSlope, unsigned char endSlope);
 
 	/**
-	 * \brief Moves one servo to specified position
+	 * \brief Computes the PWM value the servo should have at the given
+	 *        fraction of the current segment
 	 *
 	 * \param servo the index of the servo to move
-	 * \param pos the position to which the servo should be moved
+	 * \param fraction the fraction of the current segment, as returned by
+	 *                 currentFraction()
+	 * \return the PWM value the servo should have
+	 */
+	uint16_t currentServoPWM(int servo, unsigned long fraction) const;
+
+	/**
+	 * \brief Returns the PWM value for one servo at the specified position
+	 *
+	 * This uses m_servoScale, so that no division is needed
+	 * \param servo the index of the servo
+	 * \param pos the position of the servo, between 0 and 255
+	 * \return the PWM value to send to the driver
 	 */
-	void moveServo(int servo, unsigned char pos);
+	uint16_t servoPWM(int servo, unsigned char pos) const;
+
+	/**
+	 * \brief Moves all servos at once
+	 *
+	 * Only channels whose PWM value differs from the last one sent are
+	 * written, and each contiguous run of changed channels is sent in as
+	 * few I²C transactions as possible (see
+	 * Adafruit_PWMServoDriver::setPWMRange())
+	 * \param pwm the PWM values of all servos
+	 * \param forceAll if true all channels are written, regardless of
+	 *                 whether they changed or not
+	 */
+	void moveServos(const uint16_t pwm[SequencePoint::dim], bool forceAll = false);
 
 	/**
 	 * \brief The driver of motors
@@ -158,9 +334,14 @@ private:
 	Adafruit_PWMServoDriver m_pwm;
 
 	/**
-	 * \brief The buffer for sequence points
+	 * \brief The point that is filled before being added to the buffer
 	 */
-	SequencePoint m_buffer[bufferDimension];
+	SequencePoint m_pointToFillData;
+
+	/**
+	 * \brief The buffer for sequence segments
+	 */
+	SequenceSegment m_buffer[bufferDimension];
 
 	/**
 	 * \brief The index of the current point in the buffer
@@ -180,10 +361,18 @@ private:
 	/**
 	 * \brief The time the sequence point started in milliseconds
 	 *
-	 * This is set using millis()
+	 * This is set using the time passed to step()
 	 */
 	unsigned long m_stepStartTime;
 
+	/**
+	 * \brief True if m_stepStartTime has already been set for the point that
+	 *        is starting
+	 *
+	 * This is true when the new point starts when the previous one ended
+	 */
+	bool m_stepStartTimeSet;
+
 	/**
 	 * \brief Set to true when starting a new sequence point
 	 *
@@ -191,6 +380,19 @@ private:
 	 */
 	bool m_startingNewPoint;
 
+	/**
+	 * \brief The time when the next point starts
+	 *
+	 * This is only used if m_waitingStartTime is true
+	 */
+	unsigned long m_startTime;
+
+	/**
+	 * \brief True if we are waiting for m_startTime before starting the
+	 *        next point
+	 */
+	bool m_waitingStartTime;
+
 	/**
 	 * \brief The minimum value for servos PWM
 	 */
@@ -204,6 +406,21 @@ private:
 	 */
 	unsigned int m_servoRange[SequencePoint::dim];
 
+	/**
+	 * \brief The slope of the mapping from positions to PWM values
+	 *
+	 * This is m_servoRange * 2^16 / 255 (i.e. the PWM increment for a unit
+	 * increment of the position in Q16 fixed point)
+	 */
+	unsigned long m_servoScale[SequencePoint::dim];
+
+	/**
+	 * \brief The last PWM value sent to each servo
+	 *
+	 * This is used to only send the channels that changed
+	 */
+	uint16_t m_lastPWM[SequencePoint::dim];
+
 	/**
 	 * \brief Copy constructor is disabled
 	 */
@@ -22,8 +22,17 @@
 #ifndef SEQUENCEPOINT_H
 #define SEQUENCEPOINT_H
 
+#include "pointcodec.h"
+
 /**
  * \brief A single point of the sequence
+ *
+ * The motion towards the point follows an easing profile: the covered fraction
+ * of the motion is a cubic Hermite curve of the elapsed fraction of
+ * timeToTarget, with the given slopes at the start and at the end. Slopes are
+ * in Q6 fixed point (linearSlope, i.e. 1.0, at both ends is the linear motion)
+ * and range from 0 to maxSlope, so that the motion never overshoots the
+ * target
  */
 struct SequencePoint
 {
@@ -32,6 +41,21 @@ struct SequencePoint
 	 */
 	static const unsigned char dim = 16;
 
+	/**
+	 * \brief The encoding of points of this dimension in packets
+	 */
+	typedef PointCodec<dim> Codec;
+
+	/**
+	 * \brief The slope of the linear motion
+	 */
+	static const unsigned char linearSlope = Codec::linearSlope;
+
+	/**
+	 * \brief The maximum slope of the easing profile
+	 */
+	static const unsigned char maxSlope = 192;
+
 	/**
 	 * \brief The point coordinates
 	 */
@@ -46,6 +70,16 @@ struct SequencePoint
 	 * \brief The time to reach this point in milliseconds
 	 */
 	unsigned int timeToTarget;
+
+	/**
+	 * \brief The slope of the easing profile at the start of the motion
+	 */
+	unsigned char startSlope;
+
+	/**
+	 * \brief The slope of the easing profile at the end of the motion
+	 */
+	unsigned char endSlope;
 };
 
 #endif
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencestorage.h"
+#include "calibrationstorage.h"
+#include <EEPROM.h>
+
+SequenceStorage::SequenceStorage()
+	: m_uploadNumPoints(0)
+{
+}
+
+unsigned int SequenceStorage::capacity() const
+{
+	// The end of the EEPROM is taken by the calibration of servos
+	const unsigned int size = EEPROM.length() - CalibrationStorage::size;
+	if ((EEPROM.length() < CalibrationStorage::size) || (size < (baseAddress + headerSize))) {
+		return 0;
+	}
+
+	return (size - baseAddress - headerSize) / pointSize;
+}
+
+bool SequenceStorage::isValid() const
+{
+	return (EEPROM.read(baseAddress) == validMarker) && (EEPROM.read(baseAddress + 1) == SequencePoint::dim);
+}
+
+unsigned int SequenceStorage::numPoints() const
+{
+	if (!isValid()) {
+		return 0;
+	}
+
+	return (((unsigned int) EEPROM.read(baseAddress + 2)) << 8) | EEPROM.read(baseAddress + 3);
+}
+
+bool SequenceStorage::beginUpload(unsigned int numPoints)
+{
+	if (numPoints > capacity()) {
+		return false;
+	}
+
+	// Invalidating the stored sequence until the upload is complete
+	EEPROM.update(baseAddress, 0);
+	m_uploadNumPoints = numPoints;
+
+	return true;
+}
+
+void SequenceStorage::storePoint(unsigned int i, const SequencePoint& p)
+{
+	const unsigned int address = pointAddress(i);
+
+	// Using update() instead of write() to avoid wearing the EEPROM when storing the same
+	// sequence again
+	EEPROM.update(address, (p.duration >> 8) & 0xFF);
+	EEPROM.update(address + 1, p.duration & 0xFF);
+	EEPROM.update(address + 2, (p.timeToTarget >> 8) & 0xFF);
+	EEPROM.update(address + 3, p.timeToTarget & 0xFF);
+	for (unsigned int c = 0; c < SequencePoint::dim; ++c) {
+		EEPROM.update(address + 4 + c, p.point[c]);
+	}
+}
+
+void SequenceStorage::endUpload()
+{
+	// Writing the marker last, so that the sequence is valid only when complete
+	EEPROM.update(baseAddress + 1, SequencePoint::dim);
+	EEPROM.update(baseAddress + 2, (m_uploadNumPoints >> 8) & 0xFF);
+	EEPROM.update(baseAddress + 3, m_uploadNumPoints & 0xFF);
+	EEPROM.update(baseAddress, validMarker);
+}
+
+void SequenceStorage::readPoint(unsigned int i, SequencePoint& p) const
+{
+	const unsigned int address = pointAddress(i);
+
+	p.duration = (((unsigned int) EEPROM.read(address)) << 8) | EEPROM.read(address + 1);
+	p.timeToTarget = (((unsigned int) EEPROM.read(address + 2)) << 8) | EEPROM.read(address + 3);
+	p.startSlope = SequencePoint::linearSlope;
+	p.endSlope = SequencePoint::linearSlope;
+	for (unsigned int c = 0; c < SequencePoint::dim; ++c) {
+		p.point[c] = EEPROM.read(address + 4 + c);
+	}
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCESTORAGE_H
+#define SEQUENCESTORAGE_H
+
+#include "sequencepoint.h"
+
+/**
+ * \brief The class storing a whole sequence in the EEPROM
+ *
+ * This allows playing a sequence without the PC. The sequence is stored in the
+ * EEPROM starting at baseAddress with a small header (a marker telling whether
+ * the stored sequence is valid, the point dimension and the number of points)
+ * followed by points. Each point takes pointSize bytes: duration and time to
+ * target (2 bytes each, most significant byte first) followed by positions.
+ * The easing profile is not stored, stored points are always linear. The end
+ * of the EEPROM is reserved for the calibration of servos (see
+ * CalibrationStorage).
+ * To store a sequence call beginUpload(), then storePoint() for each point and
+ * finally endUpload(): the sequence is marked as invalid until endUpload() is
+ * called, so an interrupted upload does not leave a corrupted sequence.
+ * Writing to the EEPROM is slow (about 3.3 milliseconds per byte), so this
+ * should only be used when servos are still.
+ */
+class SequenceStorage
+{
+public:
+	/**
+	 * \brief The address in the EEPROM where the sequence starts
+	 */
+	static const unsigned int baseAddress = 0;
+
+	/**
+	 * \brief The size of the header
+	 */
+	static const unsigned int headerSize = 4;
+
+	/**
+	 * \brief The number of bytes taken by each point
+	 */
+	static const unsigned int pointSize = 4 + SequencePoint::dim;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	SequenceStorage();
+
+	/**
+	 * \brief Returns the maximum number of points that can be stored
+	 *
+	 * \return the maximum number of points that can be stored
+	 */
+	unsigned int capacity() const;
+
+	/**
+	 * \brief Returns true if a complete sequence is stored
+	 *
+	 * \return true if a complete sequence is stored
+	 */
+	bool isValid() const;
+
+	/**
+	 * \brief Returns the number of stored points
+	 *
+	 * This is 0 if isValid() is false
+	 * \return the number of stored points
+	 */
+	unsigned int numPoints() const;
+
+	/**
+	 * \brief Starts storing a new sequence
+	 *
+	 * This invalidates the stored sequence
+	 * \param numPoints the number of points of the new sequence
+	 * \return false if the sequence is too long
+	 */
+	bool beginUpload(unsigned int numPoints);
+
+	/**
+	 * \brief Stores a point
+	 *
+	 * \param i the index of the point. This must be less than the number
+	 *          of points passed to beginUpload()
+	 * \param p the point to store
+	 */
+	void storePoint(unsigned int i, const SequencePoint& p);
+
+	/**
+	 * \brief Marks the sequence as complete and valid
+	 */
+	void endUpload();
+
+	/**
+	 * \brief Reads a point
+	 *
+	 * \param i the index of the point. This must be less than numPoints()
+	 * \param p the object to fill with the point
+	 */
+	void readPoint(unsigned int i, SequencePoint& p) const;
+
+private:
+	/**
+	 * \brief The value of the first byte of the header when the stored
+	 *        sequence is valid
+	 */
+	static const unsigned char validMarker = 0xA5;
+
+	/**
+	 * \brief Returns the address of the i-th point
+	 *
+	 * \param i the index of the point
+	 * \return the address of the point
+	 */
+	static unsigned int pointAddress(unsigned int i)
+	{
+		return baseAddress + headerSize + i * pointSize;
+	}
+
+	/**
+	 * \brief The number of points of the sequence being uploaded
+	 */
+	unsigned int m_uploadNumPoints;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	SequenceStorage(const SequenceStorage&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	SequenceStorage& operator=(const SequenceStorage&);
+};
+
+#endif
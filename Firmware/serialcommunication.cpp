@@ -20,85 +20,337 @@
  ******************************************************************************/
 
 #include "serialcommunication.h"
+#include "crc8.h"
 #include <string.h>
 #include <math.h>
 #include <Arduino.h>
 
+// The size of the receive buffer of the serial line. Old versions of the Arduino core don't
+// define it, but they also use 64 bytes
+#ifndef SERIAL_RX_BUFFER_SIZE
+	#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+
 SerialCommunication::SerialCommunication()
 	: m_pointToFill(NULL)
+	, m_calibrationToFill(NULL)
 	, m_receivedCommand(0)
 	, m_receivedPacketBytes(0)
 	, m_receivedPointDim(0)
+	, m_receivedBaudRate(0)
+	, m_receivedNumPoints(0)
+	, m_receivedPlayFlags(0)
+	, m_receivedStartTime(0)
+	, m_receivedPingId(0)
+	, m_receivedClockLocalTime(0)
+	, m_receivedClockTime(0)
+	, m_receivedClockDrift(0)
+	, m_baudRate(0)
+	, m_deltaFlags(0)
+	, m_deltaMask(0)
+	, m_deltaChannel(0)
+	, m_deltaPacketLength(0)
+	, m_framedStream(false)
+	, m_frameState(NoFrame)
+	, m_frameSequence(0)
+	, m_frameChecksum(0)
+	, m_framePoint()
+	, m_frameBaseValid(false)
+	, m_expectedSequence(0)
+	, m_frameGap(false)
+	, m_ackPending(false)
+	, m_receiveBufferStart(0)
+	, m_receiveBufferEnd(0)
+	, m_receiveBufferPeak(0)
+	, m_receiveOverruns(0)
+	, m_receiveBufferWasFull(false)
 {
 }
 
 void SerialCommunication::begin(long baudRate)
 {
 	Serial.begin(baudRate);
+	m_baudRate = baudRate;
 }
 
-bool SerialCommunication::commandReceived()
+bool SerialCommunication::isBaudRateSupported(unsigned long baudRate)
+{
+	if ((baudRate == 0) || (baudRate > maxBaudRate)) {
+		return false;
+	}
+
+	// The UART runs in double speed mode, so the rate is F_CPU / (8 * divisor)
+	const unsigned long divisor = ((F_CPU / 8) + (baudRate / 2)) / baudRate;
+	if ((divisor == 0) || (divisor > 4096)) {
+		return false;
+	}
+	const unsigned long actualBaudRate = (F_CPU / 8) / divisor;
+	const unsigned long error = (actualBaudRate > baudRate) ? (actualBaudRate - baudRate) : (baudRate - actualBaudRate);
+
+	return (error * 50) <= baudRate;
+}
+
+bool SerialCommunication::changeBaudRate(unsigned long baudRate)
 {
-	bool retVal = false;
+	if (baudRate == m_baudRate) {
+		return true;
+	} else if (!isBaudRateSupported(baudRate)) {
+		return false;
+	}
+
+	// Waiting for pending data to be sent with the old rate, then restarting
+	Serial.flush();
+	Serial.end();
+	Serial.begin(baudRate);
+	m_baudRate = baudRate;
+
+	// Forgetting whatever we were receiving
 	while (Serial.available() > 0) {
-		// Reading one byte
-		const int v = Serial.read();
-
-		// Checking what to do
-		if (previousCommandComplete()) {
-			// New package. First of all resetting the number of bytes for the package
-			m_receivedPacketBytes = 0;
-
-			// Setting the received command to the byte we just read and checking if the
-			// command if finished here (the only command that ends in one byte is 'H')
-			m_receivedCommand = (char) v;
-			if (m_receivedCommand == 'H') {
-				retVal = true;
+		Serial.read();
+	}
+	m_receiveBufferStart = 0;
+	m_receiveBufferEnd = 0;
+	m_receivedCommand = 0;
+	m_frameState = NoFrame;
+	m_receivedPacketBytes = 0;
+
+	return true;
+}
+
+bool SerialCommunication::commandReceived()
+{
+	while (true) {
+		// Taking everything the Arduino core has received when we have parsed our buffer
+		if (m_receiveBufferStart == m_receiveBufferEnd) {
+			fillReceiveBuffer();
+
+			if (m_receiveBufferStart == m_receiveBufferEnd) {
 				break;
 			}
-		} else if ((m_receivedCommand == 'S') || (m_receivedCommand == 'I')) {
-			++m_receivedPacketBytes;
+		}
 
-			// The byte we received is the point dimension, storing and returning true
-			m_receivedPointDim = (unsigned char) v;
-			retVal = true;
-			break;
-		} else if (m_receivedCommand == 'P') {
-			++m_receivedPacketBytes;
-
-			if (m_pointToFill != NULL) {
-				switch (m_receivedPacketBytes) {
-					case 1:
-						m_pointToFill->duration = ((unsigned char) v) << 8;
-						break;
-					case 2:
-						m_pointToFill->duration += (unsigned char) v;
-						break;
-					case 3:
-						m_pointToFill->timeToTarget = ((unsigned char) v) << 8;
-						break;
-					case 4:
-						m_pointToFill->timeToTarget += (unsigned char) v;
-						break;
-					default:
-						m_pointToFill->point[m_receivedPacketBytes - 5] = (unsigned char) v;
-						break;
-				}
+		// Reading one byte
+		const unsigned char firstByte = m_receiveBufferStart;
+		const int v = m_receiveBuffer[m_receiveBufferStart++];
+
+		// The sequence number and the checksum of frames are not part of the framed command.
+		// While streaming with frames, bytes outside frames are ignored: they can only come from
+		// corrupted frames
+		if (m_framedStream && (m_frameState == NoFrame)) {
+			if (v == 'F') {
+				m_frameState = FrameSequence;
+			}
+			continue;
+		} else if (m_frameState == FrameSequence) {
+			beginFrame((unsigned char) v);
+			continue;
+		} else if (m_frameState == FrameChecksum) {
+			m_frameState = NoFrame;
+			if (frameAccepted((unsigned char) v)) {
+				return true;
 			}
+			continue;
+		}
 
-			if (m_receivedPacketBytes == (SequencePoint::dim + 4)) {
-				retVal = true;
-				break;
+		const bool complete = parseByte(v);
+
+		// The checksum covers all bytes parseByte() consumed (it can take more than one)
+		if (m_frameState == FrameCommand) {
+			for (unsigned char i = firstByte; i < m_receiveBufferStart; ++i) {
+				m_frameChecksum = crc8Update(m_frameChecksum, m_receiveBuffer[i]);
 			}
+		}
+
+		if (m_receivedCommand == 'F') {
+			// A new frame starts, dropping the one we were receiving, if any
+			m_frameState = FrameSequence;
+		} else if (complete && (m_frameState == FrameCommand)) {
+			m_frameState = FrameChecksum;
+		} else if (complete) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SerialCommunication::parseByte(int v)
+{
+	if (previousCommandComplete()) {
+		// New package. First of all resetting the number of bytes for the package
+		m_receivedPacketBytes = 0;
+
+		// Setting the received command to the byte we just read and checking if the
+		// command if finished here (the only commands that end in one byte are 'H' and 'K')
+		m_receivedCommand = (char) v;
+		if ((m_receivedCommand == 'H') || (m_receivedCommand == 'K')) {
+			return true;
+		}
+	} else if ((m_receivedCommand == 'S') || (m_receivedCommand == 'I')) {
+		++m_receivedPacketBytes;
+
+		// The byte we received is the point dimension, storing and returning true
+		m_receivedPointDim = (unsigned char) v;
+		return true;
+	} else if (m_receivedCommand == 'R') {
+		++m_receivedPacketBytes;
+
+		// The baud rate, most significant byte first
+		if (m_receivedPacketBytes == 1) {
+			m_receivedBaudRate = 0;
+		}
+		m_receivedBaudRate = (m_receivedBaudRate << 8) | ((unsigned char) v);
+
+		if (m_receivedPacketBytes == 4) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'U') {
+		++m_receivedPacketBytes;
+
+		// The point dimension followed by the number of points, most significant byte first
+		switch (m_receivedPacketBytes) {
+			case 1:
+				m_receivedPointDim = (unsigned char) v;
+				break;
+			case 2:
+				m_receivedNumPoints = ((unsigned char) v) << 8;
+				break;
+			default:
+				m_receivedNumPoints += (unsigned char) v;
+				break;
+		}
+
+		if (m_receivedPacketBytes == 3) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'Y') {
+		++m_receivedPacketBytes;
+
+		// The flags, optionally followed by the start time, most significant byte first
+		if (m_receivedPacketBytes == 1) {
+			m_receivedPlayFlags = (unsigned char) v;
+			m_receivedStartTime = 0;
+		} else {
+			m_receivedStartTime = (m_receivedStartTime << 8) | ((unsigned char) v);
+		}
+
+		if (m_receivedPacketBytes == playStoredLength()) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'G') {
+		++m_receivedPacketBytes;
+
+		// The point dimension followed by the start time, most significant byte first
+		if (m_receivedPacketBytes == 1) {
+			m_receivedPointDim = (unsigned char) v;
+			m_receivedStartTime = 0;
 		} else {
-			// If we get here the previous packet was unknown. Here we set m_receivedCommand
-			// to what we received and do another cycle
-			m_receivedCommand = (char) v;
-			m_receivedPacketBytes = 0;
+			m_receivedStartTime = (m_receivedStartTime << 8) | ((unsigned char) v);
+		}
+
+		if (m_receivedPacketBytes == 5) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'C') {
+		++m_receivedPacketBytes;
+
+		// The identifier of the ping
+		m_receivedPingId = (unsigned char) v;
+		return true;
+	} else if (m_receivedCommand == 'Z') {
+		++m_receivedPacketBytes;
+
+		// Local time, time and drift, 4 bytes each, most significant byte first
+		if (m_receivedPacketBytes == 1) {
+			m_receivedClockLocalTime = 0;
+			m_receivedClockTime = 0;
+			m_receivedClockDrift = 0;
+		}
+		if (m_receivedPacketBytes <= 4) {
+			m_receivedClockLocalTime = (m_receivedClockLocalTime << 8) | ((unsigned char) v);
+		} else if (m_receivedPacketBytes <= 8) {
+			m_receivedClockTime = (m_receivedClockTime << 8) | ((unsigned char) v);
+		} else {
+			m_receivedClockDrift = (long) ((((unsigned long) m_receivedClockDrift) << 8) | ((unsigned char) v));
+		}
+
+		if (m_receivedPacketBytes == 12) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'L') {
+		++m_receivedPacketBytes;
+
+		// The number of servos followed by minimum, maximum and rest PWM of each servo, most
+		// significant byte first
+		if (m_receivedPacketBytes == 1) {
+			m_receivedPointDim = (unsigned char) v;
+		} else if (m_calibrationToFill != NULL) {
+			const unsigned char offset = m_receivedPacketBytes - 2;
+			unsigned int* const values[3] = {m_calibrationToFill->servoMin, m_calibrationToFill->servoMax, m_calibrationToFill->servoMid};
+			unsigned int& value = values[(offset % 6) / 2][offset / 6];
+			if ((offset % 2) == 0) {
+				value = ((unsigned char) v) << 8;
+			} else {
+				value += (unsigned char) v;
+			}
+		}
+
+		if (m_receivedPacketBytes == calibrationLength) {
+			return true;
+		}
+	} else if ((m_receivedCommand == 'P') && (m_receivedPacketBytes >= SequencePoint::Codec::timesSize)) {
+		// Positions, copying all those we already have in one go (v is the first one)
+		const unsigned char offset = m_receivedPacketBytes - SequencePoint::Codec::timesSize;
+		const unsigned char n = min(SequencePoint::dim - offset, 1 + (m_receiveBufferEnd - m_receiveBufferStart));
+		SequencePoint* const target = pointTarget();
+		if (target != NULL) {
+			memcpy(target->point + offset, m_receiveBuffer + (m_receiveBufferStart - 1), n);
+		}
+		m_receiveBufferStart += n - 1;
+		m_receivedPacketBytes += n;
+
+		if (m_receivedPacketBytes == (SequencePoint::Codec::sequencePacketSize - 1)) {
+			return true;
+		}
+	} else if (m_receivedCommand == 'P') {
+		++m_receivedPacketBytes;
+
+		// The duration and the time to target, most significant byte first
+		SequencePoint* const target = pointTarget();
+		if (target != NULL) {
+			switch (m_receivedPacketBytes) {
+				case 1:
+					target->duration = ((unsigned char) v) << 8;
+					target->startSlope = SequencePoint::linearSlope;
+					target->endSlope = SequencePoint::linearSlope;
+					break;
+				case 2:
+					target->duration += (unsigned char) v;
+					break;
+				case 3:
+					target->timeToTarget = ((unsigned char) v) << 8;
+					break;
+				case 4:
+					target->timeToTarget += (unsigned char) v;
+					break;
+			}
+		}
+	} else if (m_receivedCommand == 'Q') {
+		++m_receivedPacketBytes;
+
+		decodeDeltaPacketByte((unsigned char) v);
+
+		if (m_receivedPacketBytes == m_deltaPacketLength) {
+			return true;
 		}
+	} else {
+		// If we get here the previous packet was unknown. Here we set m_receivedCommand
+		// to what we received and do another cycle
+		m_receivedCommand = (char) v;
+		m_receivedPacketBytes = 0;
 	}
 
-	return retVal;
+	return false;
 }
 
 void SerialCommunication::setNextSequencePointToFill(SequencePoint* p)
@@ -106,14 +358,80 @@ void SerialCommunication::setNextSequencePointToFill(SequencePoint* p)
 	m_pointToFill = p;
 }
 
-void SerialCommunication::sendBufferNotFull()
+void SerialCommunication::setCalibrationToFill(Calibration* c)
+{
+	m_calibrationToFill = c;
+}
+
+void SerialCommunication::beginFramedStream()
+{
+	m_framedStream = true;
+	m_frameState = NoFrame;
+	m_expectedSequence = 0;
+	m_frameGap = false;
+	m_ackPending = false;
+}
+
+void SerialCommunication::endFramedStream()
+{
+	m_framedStream = false;
+	m_frameState = NoFrame;
+}
+
+void SerialCommunication::sendAck(unsigned char freeSlots)
+{
+	const unsigned char flags = m_frameGap ? retransmitFlag : 0;
+	const unsigned char crc = crc8Update(crc8Update(crc8Update(0, m_expectedSequence), freeSlots), flags);
+
+	Serial.write('X');
+	Serial.write(m_expectedSequence);
+	Serial.write(freeSlots);
+	Serial.write(flags);
+	Serial.write(crc);
+
+	m_ackPending = false;
+}
+
+void SerialCommunication::sendStreamStarted(unsigned char freeSlots)
+{
+	Serial.write('A');
+	Serial.write(freeSlots);
+}
+
+void SerialCommunication::sendCredits(unsigned char credits)
 {
 	Serial.write('N');
+	Serial.write(credits);
+}
+
+void SerialCommunication::sendBaudRateChange(bool accepted)
+{
+	Serial.write('R');
+	Serial.write(accepted ? 1 : 0);
+}
+
+void SerialCommunication::sendBaudRateConfirmed()
+{
+	Serial.write('K');
 }
 
-void SerialCommunication::sendBufferFull()
+void SerialCommunication::sendUploadStarted(bool accepted, unsigned int capacity)
 {
-	Serial.write('F');
+	Serial.write('U');
+	Serial.write(accepted ? 1 : 0);
+	Serial.write((capacity >> 8) & 0xFF);
+	Serial.write(capacity & 0xFF);
+}
+
+void SerialCommunication::sendUploadFinished()
+{
+	Serial.write('W');
+}
+
+void SerialCommunication::sendCalibrationSet(bool accepted)
+{
+	Serial.write('L');
+	Serial.write(accepted ? 1 : 0);
 }
 
 void SerialCommunication::sendSequenceFinished()
@@ -138,10 +456,243 @@ void SerialCommunication::sendBatteryCharge(unsigned char v)
 	Serial.write(v);
 }
 
+void SerialCommunication::sendTaskOverruns(const unsigned int overruns[], unsigned char numTasks)
+{
+	Serial.write('O');
+	Serial.write(numTasks);
+	for (unsigned char i = 0; i < numTasks; ++i) {
+		Serial.write((overruns[i] >> 8) & 0xFF);
+		Serial.write(overruns[i] & 0xFF);
+	}
+}
+
+void SerialCommunication::sendClockPong(unsigned char id, unsigned long localTime)
+{
+	Serial.write('C');
+	Serial.write(id);
+	Serial.write((localTime >> 24) & 0xFF);
+	Serial.write((localTime >> 16) & 0xFF);
+	Serial.write((localTime >> 8) & 0xFF);
+	Serial.write(localTime & 0xFF);
+}
+
+void SerialCommunication::sendTelemetry(const Telemetry& telemetry, unsigned long now, unsigned char bufferedPoints)
+{
+	const unsigned long loopsPerSecond = telemetry.loopsPerSecond(now);
+	const unsigned int maxStepTime = telemetry.maxStepTime();
+	const unsigned int meanStepTime = telemetry.meanStepTime();
+	const unsigned int underruns = telemetry.underruns();
+	const unsigned int droppedPoints = telemetry.droppedPoints();
+
+	Serial.write('T');
+	Serial.write((loopsPerSecond >> 24) & 0xFF);
+	Serial.write((loopsPerSecond >> 16) & 0xFF);
+	Serial.write((loopsPerSecond >> 8) & 0xFF);
+	Serial.write(loopsPerSecond & 0xFF);
+	Serial.write((maxStepTime >> 8) & 0xFF);
+	Serial.write(maxStepTime & 0xFF);
+	Serial.write((meanStepTime >> 8) & 0xFF);
+	Serial.write(meanStepTime & 0xFF);
+	Serial.write(bufferedPoints);
+	Serial.write((underruns >> 8) & 0xFF);
+	Serial.write(underruns & 0xFF);
+	Serial.write((m_receiveOverruns >> 8) & 0xFF);
+	Serial.write(m_receiveOverruns & 0xFF);
+	Serial.write((droppedPoints >> 8) & 0xFF);
+	Serial.write(droppedPoints & 0xFF);
+	Serial.write(m_receiveBufferPeak);
+
+	// The peak is per telemetry period
+	m_receiveBufferPeak = 0;
+}
+
 bool SerialCommunication::previousCommandComplete() const
 {
 	return (m_receivedCommand == 0) ||
 	       (m_receivedCommand == 'H') ||
+	       (m_receivedCommand == 'K') ||
+	       ((m_receivedPacketBytes == 4) && (m_receivedCommand == 'R')) ||
+	       ((m_receivedPacketBytes == 3) && (m_receivedCommand == 'U')) ||
+	       ((m_receivedPacketBytes != 0) && (m_receivedPacketBytes == playStoredLength()) && (m_receivedCommand == 'Y')) ||
+	       ((m_receivedPacketBytes == 5) && (m_receivedCommand == 'G')) ||
+	       ((m_receivedPacketBytes == 1) && (m_receivedCommand == 'C')) ||
+	       ((m_receivedPacketBytes == 12) && (m_receivedCommand == 'Z')) ||
+	       ((m_receivedPacketBytes == calibrationLength) && (m_receivedCommand == 'L')) ||
 	       ((m_receivedPacketBytes == 1) && ((m_receivedCommand == 'S') || (m_receivedCommand == 'I'))) ||
-	       ((m_receivedPacketBytes == (SequencePoint::dim + 4)) && (m_receivedCommand == 'P'));
+	       ((m_receivedPacketBytes == (SequencePoint::Codec::sequencePacketSize - 1)) && (m_receivedCommand == 'P')) ||
+	       ((m_receivedPacketBytes != 0) && (m_receivedPacketBytes == m_deltaPacketLength) && (m_receivedCommand == 'Q'));
+}
+
+bool SerialCommunication::isSequencedCommand() const
+{
+	return isSequencePoint() || isStop();
+}
+
+void SerialCommunication::beginFrame(unsigned char sequence)
+{
+	m_frameState = FrameCommand;
+	m_frameSequence = sequence;
+	m_frameChecksum = crc8Update(0, sequence);
+
+	// The framed command starts from the next byte
+	m_receivedCommand = 0;
+	m_receivedPacketBytes = 0;
+
+	// Points are decoded in m_framePoint and only copied to the object to fill if the frame is
+	// valid. Delta packets need the previous point, which is in the object to fill
+	m_frameBaseValid = (m_pointToFill != NULL);
+	if (m_frameBaseValid) {
+		memcpy(&m_framePoint, m_pointToFill, sizeof(SequencePoint));
+	}
+}
+
+bool SerialCommunication::frameAccepted(unsigned char checksum)
+{
+	if (checksum != m_frameChecksum) {
+		requestRetransmit();
+		return false;
+	}
+
+	// Only points and stops use the sequence number, and only while streaming. Other commands
+	// (e.g. clock pings) are executed as soon as they arrive and are never sent again
+	if (!isSequencedCommand()) {
+		return true;
+	} else if (!m_framedStream) {
+		return false;
+	}
+
+	// A frame past the expected one means that some frames were lost, one before it is a
+	// retransmission of a frame we already have (the PC only needs a new ack)
+	const unsigned char distance = m_frameSequence - m_expectedSequence;
+	if ((distance != 0) && (distance < 128)) {
+		requestRetransmit();
+		return false;
+	} else if (distance != 0) {
+		m_ackPending = true;
+		return false;
+	}
+
+	if (isSequencePoint()) {
+		// If the buffer is full we cannot take the point, the PC must send it again
+		if (!m_frameBaseValid || (m_pointToFill == NULL)) {
+			requestRetransmit();
+			return false;
+		}
+		memcpy(m_pointToFill, &m_framePoint, sizeof(SequencePoint));
+	}
+
+	++m_expectedSequence;
+	m_frameGap = false;
+
+	return true;
+}
+
+void SerialCommunication::requestRetransmit()
+{
+	if (!m_framedStream) {
+		return;
+	}
+
+	// Only asking once, acks sent later repeat the request until the missing frame arrives
+	if (!m_frameGap) {
+		m_frameGap = true;
+		m_ackPending = true;
+	}
+}
+
+SequencePoint* SerialCommunication::pointTarget()
+{
+	return (m_frameState == FrameCommand) ? &m_framePoint : m_pointToFill;
+}
+
+void SerialCommunication::fillReceiveBuffer()
+{
+	// The ring buffer of the Arduino core holds at most SERIAL_RX_BUFFER_SIZE - 1 bytes
+	int available = Serial.available();
+	const bool receiveBufferFull = (available >= (SERIAL_RX_BUFFER_SIZE - 1));
+	if (receiveBufferFull && !m_receiveBufferWasFull && (m_receiveOverruns != 0xFFFF)) {
+		++m_receiveOverruns;
+	}
+	m_receiveBufferWasFull = receiveBufferFull;
+	if (available > m_receiveBufferPeak) {
+		m_receiveBufferPeak = available;
+	}
+
+	// This is only called when everything has been parsed, so we can restart from the beginning
+	m_receiveBufferStart = 0;
+	m_receiveBufferEnd = 0;
+	while ((available > 0) && (m_receiveBufferEnd < receiveBufferSize)) {
+		m_receiveBuffer[m_receiveBufferEnd++] = (unsigned char) Serial.read();
+		--available;
+	}
+}
+
+void SerialCommunication::decodeDeltaPacketByte(unsigned char v)
+{
+	SequencePoint* const target = pointTarget();
+
+	if (m_receivedPacketBytes == 1) {
+		// The flags, now we know the length of the header (the number of values is only
+		// known after the mask)
+		m_deltaFlags = v;
+		m_deltaMask = 0;
+		m_deltaChannel = 0;
+		m_deltaPacketLength = SequencePoint::Codec::deltaHeaderSize(m_deltaFlags);
+
+		if (target != NULL) {
+			target->duration = 0;
+			target->timeToTarget = 0;
+			target->startSlope = SequencePoint::linearSlope;
+			target->endSlope = SequencePoint::linearSlope;
+		}
+
+		return;
+	}
+
+	const unsigned char easingEnd = 1 + ((m_deltaFlags & SequencePoint::Codec::easingFlag) ? 2 : 0);
+	const unsigned char durationEnd = easingEnd + ((m_deltaFlags & SequencePoint::Codec::shortDurationFlag) ? 1 : 2);
+	const unsigned char timeToTargetEnd = durationEnd + ((m_deltaFlags & SequencePoint::Codec::shortTimeToTargetFlag) ? 1 : 2);
+	const unsigned char maskEnd = timeToTargetEnd + 2;
+
+	if (m_receivedPacketBytes <= easingEnd) {
+		if (target != NULL) {
+			if (m_receivedPacketBytes == 2) {
+				target->startSlope = v;
+			} else {
+				target->endSlope = v;
+			}
+		}
+	} else if (m_receivedPacketBytes <= durationEnd) {
+		if (target != NULL) {
+			target->duration = (target->duration << 8) | v;
+		}
+	} else if (m_receivedPacketBytes <= timeToTargetEnd) {
+		if (target != NULL) {
+			target->timeToTarget = (target->timeToTarget << 8) | v;
+		}
+	} else if (m_receivedPacketBytes <= maskEnd) {
+		m_deltaMask = (m_deltaMask << 8) | v;
+
+		if (m_receivedPacketBytes == maskEnd) {
+			// Now we know how many values follow
+			m_deltaPacketLength += SequencePoint::Codec::numChanged(m_deltaMask);
+
+			skipUnchangedChannels();
+		}
+	} else {
+		// A value for the current channel, then moving to the next changed one
+		if (target != NULL) {
+			target->point[m_deltaChannel] = v;
+		}
+		++m_deltaChannel;
+
+		skipUnchangedChannels();
+	}
+}
+
+void SerialCommunication::skipUnchangedChannels()
+{
+	while ((m_deltaChannel < SequencePoint::dim) && !(m_deltaMask & (1U << m_deltaChannel))) {
+		++m_deltaChannel;
+	}
 }
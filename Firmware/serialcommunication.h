@@ -23,6 +23,8 @@
 #define SERIALCOMMUNICATION_H
 
 #include "sequencepoint.h"
+#include "calibration.h"
+#include "telemetry.h"
 
 /**
  * \brief The class handling the serial communication with the PC
@@ -33,7 +35,32 @@
  * has arrived using the is*() functions(); if it returns false, you must call
  * it again until it returns true to be able to rely on the value of the is*()
  * functions. Sequence points are written directly inside a SequencePoint object
- * that is provided using the setNextSequencePointToFill() function.
+ * that is provided using the setNextSequencePointToFill() function. Sequence
+ * points can arrive either as full packets ('P') or as delta packets ('Q'): the
+ * latter only contain the positions that changed, the others are left untouched
+ * in the SequencePoint object. This means that the object to fill must always
+ * contain the previously received point (the PC sends a full packet first).
+ * Full packets always have the linear easing profile, delta packets can carry
+ * the slopes of the profile (see SequencePoint); if they don't, the profile is
+ * linear. In the same way, set calibration packets are written directly inside
+ * the Calibration object provided with setCalibrationToFill().
+ *
+ * Received bytes are moved from the buffer of the Arduino core to our own
+ * buffer in one go and parsed from there, so that the positions of full
+ * sequence packets are copied into the SequencePoint object with memcpy. The
+ * bytes left in our buffer are parsed by the next call of commandReceived(),
+ * so several commands can be decoded one after the other without waiting for
+ * new bytes: call commandReceived() in a loop to execute all of them.
+ *
+ * While streaming, all commands arrive in frames (see beginFramedStream()):
+ * each frame has a sequence number and a CRC-8 (see crc8Update()), so that
+ * corrupted or lost frames are detected and bytes outside frames are ignored.
+ * Points and stops are only returned by commandReceived() if their frame is
+ * valid and has the expected sequence number, the others are dropped and the
+ * PC is asked to send them again with acks (see sendAck()). Other commands
+ * only need a valid frame. Points in frames are decoded in a separate object and only
+ * copied to the object to fill when the frame is valid, so a corrupted frame
+ * never changes the previous point delta packets refer to.
  *
  * NOTE: we read the point dimension from start packages, but we always expect
  *       points to have a dimension equal to SequencePoint::dim. Check
@@ -57,6 +84,44 @@ public:
 	 */
 	void begin(long baudRate);
 
+	/**
+	 * \brief Returns the current baud rate
+	 *
+	 * \return the current baud rate
+	 */
+	unsigned long baudRate() const
+	{
+		return m_baudRate;
+	}
+
+	/**
+	 * \brief Returns true if the given baud rate can be used
+	 *
+	 * The rate must not be greater than maxBaudRate and the error of the
+	 * actual rate generated by the UART with respect to the requested one
+	 * must not be greater than 2%
+	 * \param baudRate the baud rate to check
+	 * \return true if the baud rate can be used
+	 */
+	static bool isBaudRateSupported(unsigned long baudRate);
+
+	/**
+	 * \brief Changes the baud rate
+	 *
+	 * This waits until all pending data has been sent with the old baud
+	 * rate, then restarts the serial line with the new one. Any partially
+	 * received command and any data not read yet are discarded. If the
+	 * baud rate is the current one, this does nothing
+	 * \param baudRate the new baud rate
+	 * \return false if the baud rate is not supported
+	 */
+	bool changeBaudRate(unsigned long baudRate);
+
+	/**
+	 * \brief The maximum baud rate we accept
+	 */
+	static const unsigned long maxBaudRate = 1000000;
+
 	/**
 	 * \brief Returns true if a command has been received
 	 *
@@ -64,7 +129,8 @@ public:
 	 * only after this function returns true and before you call this
 	 * function again. If this function returns false, do not rely on other
 	 * functions related to received data because they could have wrong
-	 * values.
+	 * values. When this returns true, further commands may already be
+	 * in the receive buffer: calling this again returns them immediately
 	 * \return true if a command has been received
 	 */
 	bool commandReceived();
@@ -76,17 +142,19 @@ public:
 	 */
 	bool isSequencePoint() const
 	{
-		return (m_receivedCommand == 'P');
+		return (m_receivedCommand == 'P') || (m_receivedCommand == 'Q');
 	}
 
 	/**
 	 * \brief Returns true if we received a start stream command
 	 *
+	 * This is also true for the start stream at time command, use
+	 * hasStartTime() to tell them apart
 	 * \return true if we received a start stream command
 	 */
 	bool isStartStream() const
 	{
-		return (m_receivedCommand == 'S');
+		return (m_receivedCommand == 'S') || (m_receivedCommand == 'G');
 	}
 
 	/**
@@ -109,6 +177,185 @@ public:
 		return (m_receivedCommand == 'H');
 	}
 
+	/**
+	 * \brief Returns true if we received a change baud rate command
+	 *
+	 * \return true if we received a change baud rate command
+	 */
+	bool isChangeBaudRate() const
+	{
+		return (m_receivedCommand == 'R');
+	}
+
+	/**
+	 * \brief Returns true if we received a confirm baud rate command
+	 *
+	 * \return true if we received a confirm baud rate command
+	 */
+	bool isConfirmBaudRate() const
+	{
+		return (m_receivedCommand == 'K');
+	}
+
+	/**
+	 * \brief Returns the baud rate in the last change baud rate command
+	 *
+	 * This is only valid after we received a change baud rate command
+	 * \return the requested baud rate
+	 */
+	unsigned long receivedBaudRate() const
+	{
+		return m_receivedBaudRate;
+	}
+
+	/**
+	 * \brief Returns true if we received an upload sequence command
+	 *
+	 * The point dimension is returned by pointDimension()
+	 * \return true if we received an upload sequence command
+	 */
+	bool isUploadSequence() const
+	{
+		return (m_receivedCommand == 'U');
+	}
+
+	/**
+	 * \brief Returns the number of points in the last upload sequence
+	 *        command
+	 *
+	 * This is only valid after we received an upload sequence command
+	 * \return the number of points to upload
+	 */
+	unsigned int receivedNumPoints() const
+	{
+		return m_receivedNumPoints;
+	}
+
+	/**
+	 * \brief Returns true if we received a play stored sequence command
+	 *
+	 * \return true if we received a play stored sequence command
+	 */
+	bool isPlayStored() const
+	{
+		return (m_receivedCommand == 'Y');
+	}
+
+	/**
+	 * \brief Returns true if the stored sequence should be played
+	 *        continuously
+	 *
+	 * This is only valid after we received a play stored sequence command
+	 * \return true if the stored sequence should be played continuously
+	 */
+	bool playStoredLoop() const
+	{
+		return (m_receivedPlayFlags & playLoopFlag) != 0;
+	}
+
+	/**
+	 * \brief Returns true if the last start stream or play stored sequence
+	 *        command has a start time
+	 *
+	 * The start time is returned by receivedStartTime()
+	 * \return true if the command has a start time
+	 */
+	bool hasStartTime() const
+	{
+		return (m_receivedCommand == 'G') || ((m_receivedCommand == 'Y') && ((m_receivedPlayFlags & playStartTimeFlag) != 0));
+	}
+
+	/**
+	 * \brief Returns the start time of the last start stream or play stored
+	 *        sequence command
+	 *
+	 * This is only valid if hasStartTime() returns true. The time refers to
+	 * the synchronized clock (see SyncClock)
+	 * \return the start time in milliseconds
+	 */
+	unsigned long receivedStartTime() const
+	{
+		return m_receivedStartTime;
+	}
+
+	/**
+	 * \brief Returns true if we received a clock ping command
+	 *
+	 * The identifier of the ping is returned by receivedPingId(), the
+	 * answer is sent with sendClockPong()
+	 * \return true if we received a clock ping command
+	 */
+	bool isClockPing() const
+	{
+		return (m_receivedCommand == 'C');
+	}
+
+	/**
+	 * \brief Returns the identifier of the last clock ping command
+	 *
+	 * \return the identifier of the ping
+	 */
+	unsigned char receivedPingId() const
+	{
+		return m_receivedPingId;
+	}
+
+	/**
+	 * \brief Returns true if we received a set clock command
+	 *
+	 * The parameters are returned by receivedClockLocalTime(),
+	 * receivedClockTime() and receivedClockDrift() and have the meaning of
+	 * the parameters of SyncClock::set()
+	 * \return true if we received a set clock command
+	 */
+	bool isSetClock() const
+	{
+		return (m_receivedCommand == 'Z');
+	}
+
+	/**
+	 * \brief Returns the local time of the last set clock command
+	 *
+	 * \return the local time in milliseconds
+	 */
+	unsigned long receivedClockLocalTime() const
+	{
+		return m_receivedClockLocalTime;
+	}
+
+	/**
+	 * \brief Returns the time of the last set clock command
+	 *
+	 * \return the time in milliseconds
+	 */
+	unsigned long receivedClockTime() const
+	{
+		return m_receivedClockTime;
+	}
+
+	/**
+	 * \brief Returns the drift of the last set clock command
+	 *
+	 * \return the drift in units of 2^-24
+	 */
+	long receivedClockDrift() const
+	{
+		return m_receivedClockDrift;
+	}
+
+	/**
+	 * \brief Returns true if we received a set calibration command
+	 *
+	 * The calibration has been written in the object passed to
+	 * setCalibrationToFill() and the number of servos is returned by
+	 * pointDimension()
+	 * \return true if we received a set calibration command
+	 */
+	bool isSetCalibration() const
+	{
+		return (m_receivedCommand == 'L');
+	}
+
 	/**
 	 * \brief Returns the received command
 	 *
@@ -152,6 +399,58 @@ public:
 		return m_pointToFill;
 	}
 
+	/**
+	 * \brief Sets the object to fill with the next set calibration packet
+	 *
+	 * The object is written as bytes arrive, so it could contain a partial
+	 * calibration if it is used before isSetCalibration() returns true
+	 * \param c the object to store the calibration
+	 */
+	void setCalibrationToFill(Calibration* c);
+
+	/**
+	 * \brief Starts accepting commands only in frames
+	 *
+	 * Call this when the stream starts, before sending the stream started
+	 * packet: the first point has sequence number 0. Bytes that are not in
+	 * a frame are ignored from now on
+	 */
+	void beginFramedStream();
+
+	/**
+	 * \brief Stops expecting frames
+	 *
+	 * Call this when the stream is over. Points and stops in frames
+	 * received afterwards are ignored, other framed commands are still
+	 * accepted (the PC could have sent them before knowing that the stream
+	 * is over)
+	 */
+	void endFramedStream();
+
+	/**
+	 * \brief Returns true if the PC needs an ack as soon as possible
+	 *
+	 * This happens when a frame is lost or corrupted (the PC has to send it
+	 * again) or when we receive a frame we already have (the PC did not get
+	 * our last ack)
+	 * \return true if sendAck() should be called now
+	 */
+	bool ackPending() const
+	{
+		return m_ackPending;
+	}
+
+	/**
+	 * \brief Sends an ack packet
+	 *
+	 * The ack tells the PC the sequence number of the next frame we expect
+	 * and how many points it can send after it. Both are cumulative, so a
+	 * lost ack is fixed by the next one. If a frame was lost, the ack also
+	 * asks the PC to send again all frames from the expected one
+	 * \param freeSlots how many points we can accept
+	 */
+	void sendAck(unsigned char freeSlots);
+
 	/**
 	 * \brief Returns the received point dimension
 	 *
@@ -164,14 +463,62 @@ public:
 	}
 
 	/**
-	 * \brief Sends a buffer not full package
+	 * \brief Sends a stream started package
+	 *
+	 * This is the answer to a start stream command
+	 * \param freeSlots how many points the PC can send before waiting for
+	 *                  flow control packets
+	 */
+	void sendStreamStarted(unsigned char freeSlots);
+
+	/**
+	 * \brief Sends a credits package
+	 *
+	 * This tells the PC that it can send further points
+	 * \param credits how many more points the PC can send
 	 */
-	void sendBufferNotFull();
+	void sendCredits(unsigned char credits);
 
 	/**
-	 * \brief Sends a buffer full package
+	 * \brief Sends a change baud rate package
+	 *
+	 * This is the answer to a change baud rate command and must be sent
+	 * with the old baud rate
+	 * \param accepted whether the new baud rate is going to be used
+	 */
+	void sendBaudRateChange(bool accepted);
+
+	/**
+	 * \brief Sends a baud rate confirmed package
+	 *
+	 * This is the answer to a confirm baud rate command
 	 */
-	void sendBufferFull();
+	void sendBaudRateConfirmed();
+
+	/**
+	 * \brief Sends an upload started package
+	 *
+	 * This is the answer to an upload sequence command. If the upload is
+	 * accepted, the PC can send the first point
+	 * \param accepted whether the upload is accepted
+	 * \param capacity the maximum number of points that can be stored
+	 */
+	void sendUploadStarted(bool accepted, unsigned int capacity);
+
+	/**
+	 * \brief Sends an upload finished package
+	 *
+	 * This is sent when the last point of the sequence has been stored
+	 */
+	void sendUploadFinished();
+
+	/**
+	 * \brief Sends a calibration set package
+	 *
+	 * This is the answer to a set calibration command
+	 * \param accepted whether the calibration has been stored and is in use
+	 */
+	void sendCalibrationSet(bool accepted);
 
 	/**
 	 * \brief Sends a sequence finished package
@@ -193,6 +540,68 @@ public:
 	 */
 	void sendBatteryCharge(unsigned char v);
 
+	/**
+	 * \brief Sends a task overruns packet
+	 *
+	 * \param overruns the number of times each task of the scheduler
+	 *                 missed its deadline
+	 * \param numTasks the number of elements in overruns
+	 */
+	void sendTaskOverruns(const unsigned int overruns[], unsigned char numTasks);
+
+	/**
+	 * \brief Sends a telemetry packet
+	 *
+	 * The packet also contains the number of times the receive buffer of the
+	 * serial line was found full (see receiveOverruns()) and the peak of its
+	 * fill level (see receiveBufferPeak()), which is reset here
+	 * \param telemetry the counters to send
+	 * \param now the current time in microseconds, used to compute loop
+	 *            iterations per second
+	 * \param bufferedPoints the number of points in the buffer of the
+	 *                       sequence player
+	 */
+	void sendTelemetry(const Telemetry& telemetry, unsigned long now, unsigned char bufferedPoints);
+
+	/**
+	 * \brief Sends a clock pong packet
+	 *
+	 * This is the answer to a clock ping command and must be sent as soon
+	 * as possible
+	 * \param id the identifier of the ping
+	 * \param localTime the current local time (i.e. the value of millis())
+	 */
+	void sendClockPong(unsigned char id, unsigned long localTime);
+
+	/**
+	 * \brief Returns how many times the receive buffer of the serial line
+	 *        was found full
+	 *
+	 * When the buffer is full, bytes arriving from the PC are lost. The
+	 * Arduino core doesn't tell us when this happens, so we count the times
+	 * we find the buffer full when reading from it, which means that bytes may
+	 * have been lost. The counter saturates at 0xFFFF
+	 * \return how many times the receive buffer was found full
+	 */
+	unsigned int receiveOverruns() const
+	{
+		return m_receiveOverruns;
+	}
+
+	/**
+	 * \brief Returns the maximum number of bytes found in the receive
+	 *        buffer of the serial line since the last telemetry packet
+	 *
+	 * The buffer of the Arduino core holds SERIAL_RX_BUFFER_SIZE - 1 bytes
+	 * (63 on most boards): values close to it mean that commands are not
+	 * read fast enough and overruns are about to happen
+	 * \return the peak of the fill level of the receive buffer
+	 */
+	unsigned char receiveBufferPeak() const
+	{
+		return m_receiveBufferPeak;
+	}
+
 private:
 	/**
 	 * \brief Returns true if the previous command we received is complete
@@ -201,11 +610,147 @@ private:
 	 */
 	bool previousCommandComplete() const;
 
+	/**
+	 * \brief Parses one byte of a command
+	 *
+	 * This can consume more than one byte from m_receiveBuffer (v is the
+	 * first one)
+	 * \param v the byte to parse
+	 * \return true if the command is complete
+	 */
+	bool parseByte(int v);
+
+	/**
+	 * \brief Returns true if the received command uses the sequence number
+	 *        of its frame
+	 *
+	 * \return true for points and stop commands
+	 */
+	bool isSequencedCommand() const;
+
+	/**
+	 * \brief Starts receiving the command of a frame
+	 *
+	 * \param sequence the sequence number of the frame
+	 */
+	void beginFrame(unsigned char sequence);
+
+	/**
+	 * \brief Checks a frame that has been completely received
+	 *
+	 * If the frame is accepted and contains a point, the point is copied to
+	 * the object to fill
+	 * \param checksum the checksum at the end of the frame
+	 * \return true if the command in the frame can be executed
+	 */
+	bool frameAccepted(unsigned char checksum);
+
+	/**
+	 * \brief Records that a frame has been lost
+	 */
+	void requestRetransmit();
+
+	/**
+	 * \brief Returns the object where the point being received is decoded
+	 *
+	 * \return the object for the point being received, NULL if the point
+	 *         must be discarded
+	 */
+	SequencePoint* pointTarget();
+
+	/**
+	 * \brief Moves the bytes received by the Arduino core to
+	 *        m_receiveBuffer
+	 *
+	 * This must only be called when all bytes in m_receiveBuffer have been
+	 * parsed. This also updates the overrun counter and the peak of the fill
+	 * level of the buffer of the Arduino core
+	 */
+	void fillReceiveBuffer();
+
+	/**
+	 * \brief Decodes one byte of a delta sequence packet
+	 *
+	 * m_receivedPacketBytes must already take into account this byte
+	 * \param v the byte to decode
+	 */
+	void decodeDeltaPacketByte(unsigned char v);
+
+	/**
+	 * \brief Moves m_deltaChannel to the next channel in the mask of the
+	 *        delta packet
+	 *
+	 * If m_deltaChannel is already a channel in the mask, it is not changed
+	 */
+	void skipUnchangedChannels();
+
+	/**
+	 * \brief The flag of ack packets asking the PC to send again all frames
+	 *        from the expected one
+	 */
+	static const unsigned char retransmitFlag = 0x01;
+
+	/**
+	 * \brief The parts of a frame
+	 */
+	enum FrameState {
+		NoFrame,
+		FrameSequence,
+		FrameCommand,
+		FrameChecksum
+	};
+
+	/**
+	 * \brief The flag of play stored sequence packets telling that the
+	 *        sequence is played continuously
+	 */
+	static const unsigned char playLoopFlag = 0x01;
+
+	/**
+	 * \brief The flag of play stored sequence packets telling that the
+	 *        start time follows
+	 */
+	static const unsigned char playStartTimeFlag = 0x02;
+
+	/**
+	 * \brief Returns the number of bytes past the command type of the play
+	 *        stored sequence command
+	 *
+	 * This is only valid after the flags have been received
+	 * \return the length of the play stored sequence command
+	 */
+	unsigned char playStoredLength() const
+	{
+		return ((m_receivedPlayFlags & playStartTimeFlag) != 0) ? 5 : 1;
+	}
+
+	/**
+	 * \brief The number of bytes past the command type of the set
+	 *        calibration command
+	 *
+	 * The number of servos followed by the minimum, maximum and rest PWM of
+	 * each servo (2 bytes each)
+	 */
+	static const unsigned char calibrationLength = 1 + 6 * SequencePoint::dim;
+
+	/**
+	 * \brief The size of m_receiveBuffer
+	 *
+	 * This is the same as the buffer of the Arduino core, so that it can be
+	 * emptied with one call to fillReceiveBuffer()
+	 */
+	static const unsigned char receiveBufferSize = 64;
+
 	/**
 	 * \brief The pointer to the next SequencePoint object to fill
 	 */
 	SequencePoint* m_pointToFill;
 
+	/**
+	 * \brief The pointer to the Calibration object to fill
+	 */
+	Calibration* m_calibrationToFill;
+
 	/**
 	 * \brief The command we received
 	 *
@@ -228,6 +773,158 @@ private:
 	 */
 	unsigned char m_receivedPointDim;
 
+	/**
+	 * \brief The received baud rate
+	 */
+	unsigned long m_receivedBaudRate;
+
+	/**
+	 * \brief The received number of points to upload
+	 */
+	unsigned int m_receivedNumPoints;
+
+	/**
+	 * \brief The received flags of the play stored sequence command
+	 */
+	unsigned char m_receivedPlayFlags;
+
+	/**
+	 * \brief The received start time
+	 */
+	unsigned long m_receivedStartTime;
+
+	/**
+	 * \brief The received identifier of the clock ping
+	 */
+	unsigned char m_receivedPingId;
+
+	/**
+	 * \brief The received local time of the set clock command
+	 */
+	unsigned long m_receivedClockLocalTime;
+
+	/**
+	 * \brief The received time of the set clock command
+	 */
+	unsigned long m_receivedClockTime;
+
+	/**
+	 * \brief The received drift of the set clock command
+	 */
+	long m_receivedClockDrift;
+
+	/**
+	 * \brief The current baud rate
+	 */
+	unsigned long m_baudRate;
+
+	/**
+	 * \brief The flags of the delta packet we are receiving
+	 */
+	unsigned char m_deltaFlags;
+
+	/**
+	 * \brief The mask of changed channels of the delta packet we are
+	 *        receiving
+	 *
+	 * Bit i refers to channel i. Points have 16 channels, so the mask is
+	 * 2 bytes long
+	 */
+	unsigned int m_deltaMask;
+
+	/**
+	 * \brief The channel the next value of the delta packet refers to
+	 */
+	unsigned char m_deltaChannel;
+
+	/**
+	 * \brief The total length of the delta packet we are receiving
+	 *
+	 * This excludes the command type and is updated as the packet is
+	 * received (we only know the full length after receiving the mask)
+	 */
+	unsigned char m_deltaPacketLength;
+
+	/**
+	 * \brief True if commands must be in frames
+	 */
+	bool m_framedStream;
+
+	/**
+	 * \brief The part of the frame we expect next
+	 */
+	FrameState m_frameState;
+
+	/**
+	 * \brief The sequence number of the frame being received
+	 */
+	unsigned char m_frameSequence;
+
+	/**
+	 * \brief The CRC-8 of the frame being received
+	 */
+	unsigned char m_frameChecksum;
+
+	/**
+	 * \brief The object where points in frames are decoded
+	 */
+	SequencePoint m_framePoint;
+
+	/**
+	 * \brief True if m_framePoint had the previous point when the frame
+	 *        started
+	 */
+	bool m_frameBaseValid;
+
+	/**
+	 * \brief The sequence number of the next frame we accept
+	 */
+	unsigned char m_expectedSequence;
+
+	/**
+	 * \brief True if a frame was lost and we are waiting for it
+	 */
+	bool m_frameGap;
+
+	/**
+	 * \brief True if an ack should be sent as soon as possible
+	 */
+	bool m_ackPending;
+
+	/**
+	 * \brief The bytes taken from the buffer of the Arduino core
+	 */
+	unsigned char m_receiveBuffer[receiveBufferSize];
+
+	/**
+	 * \brief The index of the next byte to parse in m_receiveBuffer
+	 */
+	unsigned char m_receiveBufferStart;
+
+	/**
+	 * \brief The index past the last byte in m_receiveBuffer
+	 */
+	unsigned char m_receiveBufferEnd;
+
+	/**
+	 * \brief The maximum fill level of the buffer of the Arduino core since
+	 *        the last telemetry packet
+	 */
+	unsigned char m_receiveBufferPeak;
+
+	/**
+	 * \brief How many times the receive buffer was found full
+	 */
+	unsigned int m_receiveOverruns;
+
+	/**
+	 * \brief True if the receive buffer was full the last time
+	 *        fillReceiveBuffer() was called
+	 *
+	 * This is used to count a full buffer only once
+	 */
+	bool m_receiveBufferWasFull;
+
 	/**
 	 * \brief Copy constructor is disabled
 	 */
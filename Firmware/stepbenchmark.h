@@ -0,0 +1,193 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef STEPBENCHMARK_H
+#define STEPBENCHMARK_H
+
+#include <Arduino.h>
+#include "sequenceplayer.h"
+
+/**
+ * \file stepbenchmark.h
+ *
+ * A micro-benchmark of the interpolation performed by SequencePlayer. To use
+ * it, uncomment the definition of STEP_BENCHMARK at the beginning of
+ * Firmware.ino: the firmware then runs the benchmark at startup, prints the
+ * results as text on the serial line (use the serial monitor, the GUI doesn't
+ * understand them) and does nothing else. The benchmark reports the cycles
+ * needed to compute a whole frame with the original kernel (two long
+ * divisions per servo) and with the one working on precomputed segments (a
+ * multiplication and a shift per servo), and the cycles per call of SequencePlayer::step(), which
+ * also include writing changed channels to the servo driver. This is only
+ * meant to be included by Firmware.ino
+ */
+
+namespace StepBenchmark {
+	/**
+	 * \brief The number of iterations of each measure
+	 */
+	const unsigned int iterations = 1000;
+
+	/**
+	 * \brief Used to prevent the compiler from optimizing kernels away
+	 */
+	volatile unsigned long sink = 0;
+
+	/**
+	 * \brief Converts a time in microseconds for all iterations to cycles
+	 *        per iteration
+	 *
+	 * \param elapsed the time taken by all iterations in microseconds
+	 * \return the cycles per iteration
+	 */
+	unsigned long cyclesPerIteration(unsigned long elapsed)
+	{
+		return (elapsed * (F_CPU / 1000000UL)) / iterations;
+	}
+
+	/**
+	 * \brief Measures the kernel originally used by SequencePlayer
+	 *
+	 * \param prev the previous point
+	 * \param cur the current point
+	 * \param servoMin the minimum PWM of servos
+	 * \param servoRange the PWM range of servos
+	 * \return the cycles per frame
+	 */
+	unsigned long divisionKernel(const SequencePoint& prev, const SequencePoint& cur, const unsigned int servoMin[], const unsigned int servoRange[])
+	{
+		const unsigned long start = micros();
+		for (unsigned int it = 0; it < iterations; ++it) {
+			const long curTime = it % cur.timeToTarget;
+			for (int i = 0; i < SequencePoint::dim; ++i) {
+				const long d = long(cur.point[i]) - long(prev.point[i]);
+				const unsigned char pos = (unsigned char) (long(prev.point[i]) + ((d * curTime) / long(cur.timeToTarget)));
+				sink += ((long(pos) * servoRange[i]) / 255) + servoMin[i];
+			}
+		}
+
+		return cyclesPerIteration(micros() - start);
+	}
+
+	/**
+	 * \brief Measures the segment kernel used by SequencePlayer
+	 *
+	 * Here positions are mapped to PWM values once per segment and then
+	 * interpolation is performed directly on PWM values
+	 * \param prev the previous point
+	 * \param cur the current point
+	 * \param servoMin the minimum PWM of servos
+	 * \param servoRange the PWM range of servos
+	 * \return the cycles per frame
+	 */
+	unsigned long segmentKernel(const SequencePoint& prev, const SequencePoint& cur, const unsigned int servoMin[], const unsigned int servoRange[])
+	{
+		// Precomputations, performed once per segment when the point is added to the
+		// buffer
+		uint16_t startPWM[SequencePoint::dim];
+		int16_t deltaPWM[SequencePoint::dim];
+		for (int i = 0; i < SequencePoint::dim; ++i) {
+			const unsigned long servoScale = ((((unsigned long) servoRange[i]) << 16) + 127) / 255;
+			startPWM[i] = ((prev.point[i] * servoScale + (1UL << 15)) >> 16) + servoMin[i];
+			deltaPWM[i] = int16_t(((cur.point[i] * servoScale + (1UL << 15)) >> 16) + servoMin[i]) - int16_t(startPWM[i]);
+		}
+		const unsigned long reciprocal = ((1UL << 24) + (cur.timeToTarget / 2)) / cur.timeToTarget;
+
+		const unsigned long start = micros();
+		for (unsigned int it = 0; it < iterations; ++it) {
+			const unsigned long curTime = it % cur.timeToTarget;
+			const unsigned long fraction = min((curTime * reciprocal) >> 8, 1UL << 16);
+			for (int i = 0; i < SequencePoint::dim; ++i) {
+				sink += startPWM[i] + ((long(deltaPWM[i]) * long(fraction) + (1L << 15)) >> 16);
+			}
+		}
+
+		return cyclesPerIteration(micros() - start);
+	}
+
+	/**
+	 * \brief Measures SequencePlayer::step()
+	 *
+	 * The buffer of the player is filled with points moving all servos
+	 * and step() is called with a simulated time advancing by 1
+	 * millisecond per call. The buffer is cleared at the end
+	 * \param player the player to use. It must have been initialized
+	 * \return the cycles per call of step()
+	 */
+	unsigned long step(SequencePlayer& player)
+	{
+		// Filling the buffer. Each point lasts more than the whole benchmark
+		unsigned char p = 0;
+		while (player.pointToFill() != NULL) {
+			SequencePoint* point = player.pointToFill();
+			point->duration = 0;
+			point->timeToTarget = iterations * 2;
+			point->startSlope = SequencePoint::linearSlope;
+			point->endSlope = SequencePoint::linearSlope;
+			for (int i = 0; i < SequencePoint::dim; ++i) {
+				point->point[i] = (p + i * 16) & 0xFF;
+			}
+			player.pointFilled();
+			p += 128;
+		}
+
+		unsigned long elapsed = 0;
+		for (unsigned int it = 0; it < iterations; ++it) {
+			const unsigned long start = micros();
+			player.step(it);
+			elapsed += micros() - start;
+		}
+
+		player.clearBuffer();
+
+		return cyclesPerIteration(elapsed);
+	}
+
+	/**
+	 * \brief Runs the whole benchmark and prints the results
+	 *
+	 * \param player the player to use. It must have been initialized
+	 * \param servoMin the minimum PWM of servos
+	 * \param servoMax the maximum PWM of servos
+	 */
+	void run(SequencePlayer& player, const unsigned int servoMin[], const unsigned int servoMax[])
+	{
+		unsigned int servoRange[SequencePoint::dim];
+		SequencePoint prev;
+		SequencePoint cur;
+		cur.duration = 0;
+		cur.timeToTarget = 777;
+		for (int i = 0; i < SequencePoint::dim; ++i) {
+			servoRange[i] = servoMax[i] - servoMin[i];
+			prev.point[i] = i * 16;
+			cur.point[i] = 255 - (i * 16);
+		}
+
+		Serial.print("Division kernel, cycles per frame: ");
+		Serial.println(divisionKernel(prev, cur, servoMin, servoRange));
+		Serial.print("Segment kernel, cycles per frame: ");
+		Serial.println(segmentKernel(prev, cur, servoMin, servoRange));
+		Serial.print("SequencePlayer::step(), cycles per call: ");
+		Serial.println(step(player));
+	}
+}
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "syncclock.h"
+
+SyncClock::SyncClock()
+	: m_localTime(0)
+	, m_time(0)
+	, m_drift(0)
+	, m_driftRemainder(0)
+	, m_holdBack(0)
+{
+}
+
+void SyncClock::update(unsigned long localTime)
+{
+	// Long intervals are split, so that applying the drift cannot overflow
+	unsigned long interval = localTime - m_localTime;
+	m_localTime = localTime;
+	while (interval > maxInterval) {
+		advance(maxInterval);
+		interval -= maxInterval;
+	}
+	advance(interval);
+}
+
+void SyncClock::set(unsigned long localTime, unsigned long time, long drift)
+{
+	if (drift > maxDrift) {
+		drift = maxDrift;
+	} else if (drift < -maxDrift) {
+		drift = -maxDrift;
+	}
+	m_drift = drift;
+	m_driftRemainder = 0;
+
+	// The time now, ignoring the drift since localTime (the PC sends localTime shortly after
+	// reading it from us)
+	const unsigned long newTime = time + (m_localTime - localTime);
+	const long difference = (long) (newTime - m_time);
+	if (difference >= 0) {
+		m_time = newTime;
+		m_holdBack = 0;
+	} else {
+		// Never going backwards, stopping the clock instead
+		m_holdBack = (unsigned long) (-difference);
+	}
+}
+
+void SyncClock::advance(unsigned long interval)
+{
+	// Applying the drift. m_driftRemainder stays between 0 and 2^24 - 1, the shift of negative
+	// values is arithmetic with avr-gcc
+	m_driftRemainder += (long) interval * m_drift;
+	const long correction = m_driftRemainder >> 24;
+	m_driftRemainder -= correction * (1L << 24);
+
+	long step = (long) interval + correction;
+	if (step < 0) {
+		m_holdBack += (unsigned long) (-step);
+		return;
+	}
+
+	// Consuming the time to hold back first
+	if (m_holdBack >= (unsigned long) step) {
+		m_holdBack -= step;
+	} else {
+		m_time += step - m_holdBack;
+		m_holdBack = 0;
+	}
+}
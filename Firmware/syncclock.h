@@ -0,0 +1,144 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SYNCCLOCK_H
+#define SYNCCLOCK_H
+
+/**
+ * \brief The clock used to play sequences, which can be synchronized with the
+ *        clock of the PC
+ *
+ * The clock advances with the local clock (millis()), corrected by a drift
+ * rate. The PC measures the offset and the drift of the local clock with
+ * clock pings and then sets the time this clock had at a given local time and
+ * the drift rate (see set()), so that all hardware connected to the same PC
+ * share the same time. The clock never goes backwards: when it is set to an
+ * earlier time it stops until the local clock catches up, so that the sequence
+ * player never sees time decreasing. Until set() is called this is the same as
+ * the local clock. Call update() periodically (at least every few seconds)
+ * with the current local time. All times are in milliseconds and wrap around
+ * like millis()
+ */
+class SyncClock
+{
+public:
+	/**
+	 * \brief The maximum absolute value of the drift rate
+	 *
+	 * This is about 6%, much more than the error of any oscillator
+	 */
+	static const long maxDrift = 1L << 20;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	SyncClock();
+
+	/**
+	 * \brief Advances the clock to the given local time
+	 *
+	 * \param localTime the current local time (i.e. the value of millis())
+	 */
+	void update(unsigned long localTime);
+
+	/**
+	 * \brief Sets the time and the drift rate of the clock
+	 *
+	 * Call update() with the current local time before this function
+	 * \param localTime the local time to which time refers. This must not
+	 *                  be later than the last time passed to update()
+	 * \param time the time the clock had at localTime
+	 * \param drift the correction of the rate of the local clock in units
+	 *              of 2^-24 (i.e. the clock advances by 1 + drift / 2^24
+	 *              milliseconds for each local millisecond). It is clamped
+	 *              to maxDrift
+	 */
+	void set(unsigned long localTime, unsigned long time, long drift);
+
+	/**
+	 * \brief Returns the current time
+	 *
+	 * This is the time at the last call of update()
+	 * \return the current time in milliseconds
+	 */
+	unsigned long time() const
+	{
+		return m_time;
+	}
+
+private:
+	/**
+	 * \brief Advances the clock by a local interval
+	 *
+	 * \param interval the local interval in milliseconds. This must be at
+	 *                 most maxInterval
+	 */
+	void advance(unsigned long interval);
+
+	/**
+	 * \brief The maximum interval that can be passed to advance()
+	 *
+	 * This avoids overflows when the drift is applied
+	 */
+	static const unsigned long maxInterval = 1024;
+
+	/**
+	 * \brief The local time of the last update
+	 */
+	unsigned long m_localTime;
+
+	/**
+	 * \brief The current time
+	 */
+	unsigned long m_time;
+
+	/**
+	 * \brief The correction of the rate in units of 2^-24
+	 */
+	long m_drift;
+
+	/**
+	 * \brief The fraction of millisecond accumulated by the drift
+	 *
+	 * This is in units of 2^-24 and is always between 0 and 2^24 - 1
+	 */
+	long m_driftRemainder;
+
+	/**
+	 * \brief How many milliseconds the clock must still stop
+	 *
+	 * This is not 0 after the clock was set to an earlier time
+	 */
+	unsigned long m_holdBack;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	SyncClock(const SyncClock&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	SyncClock& operator=(const SyncClock&);
+};
+
+#endif
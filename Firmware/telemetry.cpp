@@ -0,0 +1,101 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "telemetry.h"
+
+namespace {
+	/**
+	 * \brief The maximum value of 16 bits counters
+	 */
+	const unsigned int maxCounter = 0xFFFF;
+
+	/**
+	 * \brief Saturates a value to 16 bits
+	 *
+	 * \param v the value
+	 * \return v or maxCounter if v is greater
+	 */
+	unsigned int saturate(unsigned long v)
+	{
+		return (v > maxCounter) ? maxCounter : (unsigned int) v;
+	}
+}
+
+Telemetry::Telemetry()
+	: m_periodStart(0)
+	, m_loopIterations(0)
+	, m_steps(0)
+	, m_totalStepTime(0)
+	, m_maxStepTime(0)
+	, m_underruns(0)
+	, m_droppedPoints(0)
+{
+}
+
+void Telemetry::startPeriod(unsigned long now)
+{
+	m_periodStart = now;
+	m_loopIterations = 0;
+	m_steps = 0;
+	m_totalStepTime = 0;
+	m_maxStepTime = 0;
+}
+
+void Telemetry::stepTime(unsigned long t)
+{
+	++m_steps;
+	m_totalStepTime += t;
+	if (t > m_maxStepTime) {
+		m_maxStepTime = t;
+	}
+}
+
+void Telemetry::underrun()
+{
+	if (m_underruns != maxCounter) {
+		++m_underruns;
+	}
+}
+
+void Telemetry::droppedPoint()
+{
+	if (m_droppedPoints != maxCounter) {
+		++m_droppedPoints;
+	}
+}
+
+unsigned long Telemetry::loopsPerSecond(unsigned long now) const
+{
+	// Working in milliseconds, iterations * 1000 fits 32 bits for any realistic period
+	const unsigned long elapsed = (now - m_periodStart) / 1000;
+
+	return (elapsed == 0) ? 0 : ((m_loopIterations * 1000) / elapsed);
+}
+
+unsigned int Telemetry::maxStepTime() const
+{
+	return saturate(m_maxStepTime);
+}
+
+unsigned int Telemetry::meanStepTime() const
+{
+	return (m_steps == 0) ? 0 : saturate(m_totalStepTime / m_steps);
+}
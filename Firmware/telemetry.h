@@ -0,0 +1,166 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/**
+ * \brief The counters describing how the firmware is performing
+ *
+ * The counters are periodically sent to the PC in the telemetry packet (see
+ * SerialCommunication::sendTelemetry()). Loop iterations and step() times are
+ * measured over a period, which starts when startPeriod() is called; the
+ * other counters are never reset and saturate at their maximum value
+ */
+class Telemetry
+{
+public:
+	/**
+	 * \brief Constructor
+	 */
+	Telemetry();
+
+	/**
+	 * \brief Starts a new measuring period
+	 *
+	 * This resets loop iterations and step() times
+	 * \param now the current time in microseconds
+	 */
+	void startPeriod(unsigned long now);
+
+	/**
+	 * \brief Counts an iteration of loop()
+	 */
+	void loopIteration()
+	{
+		++m_loopIterations;
+	}
+
+	/**
+	 * \brief Records the time taken by a call to SequencePlayer::step()
+	 *
+	 * \param t the time in microseconds
+	 */
+	void stepTime(unsigned long t);
+
+	/**
+	 * \brief Counts an underrun (the buffer of the player became empty
+	 *        while streaming)
+	 */
+	void underrun();
+
+	/**
+	 * \brief Counts a sequence point that was dropped because the buffer
+	 *        was full
+	 */
+	void droppedPoint();
+
+	/**
+	 * \brief Returns the loop iterations per second in the current period
+	 *
+	 * \param now the current time in microseconds
+	 * \return the loop iterations per second
+	 */
+	unsigned long loopsPerSecond(unsigned long now) const;
+
+	/**
+	 * \brief Returns the maximum time of step() in the current period
+	 *
+	 * \return the maximum time of step() in microseconds, saturated at
+	 *         0xFFFF
+	 */
+	unsigned int maxStepTime() const;
+
+	/**
+	 * \brief Returns the mean time of step() in the current period
+	 *
+	 * \return the mean time of step() in microseconds, saturated at 0xFFFF
+	 */
+	unsigned int meanStepTime() const;
+
+	/**
+	 * \brief Returns the number of underruns
+	 *
+	 * \return the number of underruns
+	 */
+	unsigned int underruns() const
+	{
+		return m_underruns;
+	}
+
+	/**
+	 * \brief Returns the number of dropped sequence points
+	 *
+	 * \return the number of dropped sequence points
+	 */
+	unsigned int droppedPoints() const
+	{
+		return m_droppedPoints;
+	}
+
+private:
+	/**
+	 * \brief When the current period started in microseconds
+	 */
+	unsigned long m_periodStart;
+
+	/**
+	 * \brief The loop iterations in the current period
+	 */
+	unsigned long m_loopIterations;
+
+	/**
+	 * \brief The number of calls to step() in the current period
+	 */
+	unsigned long m_steps;
+
+	/**
+	 * \brief The total time of step() in the current period
+	 */
+	unsigned long m_totalStepTime;
+
+	/**
+	 * \brief The maximum time of step() in the current period
+	 */
+	unsigned long m_maxStepTime;
+
+	/**
+	 * \brief The number of underruns
+	 */
+	unsigned int m_underruns;
+
+	/**
+	 * \brief The number of dropped sequence points
+	 */
+	unsigned int m_droppedPoints;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	Telemetry(const Telemetry&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	Telemetry& operator=(const Telemetry&);
+};
+
+#endif
@@ -0,0 +1,237 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// Qt 5.4
+//import QtQuick 2.4
+//import QtQuick.Controls 1.3
+//import QtQuick.Window 2.2
+//import QtQuick.Dialogs 1.2
+//import QtQuick.Layouts 1.1
+
+// Qt 5.2
+import QtQuick 2.0
+import QtQuick.Controls 1.1
+import QtQuick.Window 2.0
+import QtQuick.Dialogs 1.1
+import QtQuick.Layouts 1.1
+
+// A window to handle more hardware (see DeviceManager). Each row is a device,
+// the first one is the device used by the rest of the user interface
+Window {
+	id: mainItem
+
+	title: "Devices"
+	width: 640
+	height: 360
+	flags: Qt.Dialog
+
+	QtObject {
+		id: internal
+
+		// The device whose sequence is being chosen
+		property int sequenceDevice: -1
+
+		// The device whose calibration is being chosen
+		property int calibrationDevice: -1
+	}
+
+	ColumnLayout {
+		anchors.fill: parent
+
+		ScrollView {
+			Layout.fillWidth: true
+			Layout.fillHeight: true
+
+			ColumnLayout {
+				Repeater {
+					model: deviceManager.count
+
+					RowLayout {
+						// The device of this row
+						property var device: deviceManager.device(index)
+
+						TextField {
+							Layout.preferredWidth: 150
+							enabled: !device.isConnected
+
+							text: device.serialPortName
+
+							onTextChanged: device.serialPortName = text;
+						}
+
+						Button {
+							text: device.isConnected ? "Disconnect" : "Connect"
+							enabled: !device.isStreaming
+
+							onClicked: {
+								if (device.isConnected) {
+									device.closeSerial();
+								} else {
+									device.openSerial();
+								}
+							}
+						}
+
+						Button {
+							text: "Sequence..."
+							enabled: !device.isStreaming
+
+							onClicked: {
+								internal.sequenceDevice = index;
+								sequenceDialog.open();
+							}
+						}
+
+						Button {
+							text: "Calibration..."
+							enabled: device.isConnected && !device.isStreaming
+
+							onClicked: {
+								internal.calibrationDevice = index;
+								calibrationDialog.open();
+							}
+						}
+
+						CheckBox {
+							text: "Clock sync"
+							checked: device.clockSync
+
+							onCheckedChanged: device.clockSync = checked;
+						}
+
+						// The state of clock synchronization of the device
+						Text {
+							visible: device.clockSync
+							text: device.isClockSynced ? ("RTT: " + device.clockRoundTrip + "ms Drift: " + device.clockDrift.toFixed(1) + "ppm") : "Not synced"
+						}
+
+						// The flow control state of the device
+						Text {
+							text: "Credits: " + device.credits + " Buffered: " + ((device.bufferedPoints === -1) ? "-" : device.bufferedPoints) + " Sent: " + device.pointsSent + " Resent: " + device.framesRetransmitted
+						}
+
+						Button {
+							text: "Remove"
+							visible: index !== 0
+							enabled: !device.isStreaming
+
+							onClicked: deviceManager.removeDevice(index);
+						}
+					}
+				}
+			}
+		}
+
+		RowLayout {
+			TextField {
+				id: newPortField
+				Layout.fillWidth: true
+
+				placeholderText: "Serial port of the new device"
+			}
+
+			Button {
+				text: "Add"
+				enabled: newPortField.text !== ""
+
+				onClicked: {
+					deviceManager.addDevice(newPortField.text);
+					newPortField.text = "";
+				}
+			}
+		}
+
+		RowLayout {
+			Text {
+				text: "Start delay (ms):"
+			}
+
+			TextField {
+				validator: IntValidator {
+					bottom: 0
+					top: 10000
+				}
+
+				text: deviceManager.startDelay
+
+				onTextChanged: deviceManager.startDelay = parseInt(text)
+			}
+
+			Button {
+				text: "Connect all"
+
+				onClicked: deviceManager.openAll();
+			}
+
+			Button {
+				text: "Start all"
+				enabled: deviceManager.streamingDevices === 0
+
+				onClicked: deviceManager.startAll(sequence, false);
+			}
+
+			Button {
+				text: "Play stored on all"
+				enabled: deviceManager.streamingDevices === 0
+
+				onClicked: deviceManager.playAllStored();
+			}
+
+			Button {
+				text: "Stop all"
+				enabled: deviceManager.streamingDevices !== 0
+
+				onClicked: deviceManager.stopAll();
+			}
+		}
+
+		// The throughput of all devices together
+		Text {
+			text: "Streaming devices: " + deviceManager.streamingDevices + " Points/s: " + deviceManager.pointsPerSecond.toFixed(1) + " Bytes/s: " + deviceManager.bytesPerSecond.toFixed(0)
+		}
+
+		Button {
+			Layout.alignment: Qt.AlignRight
+
+			text: "Close"
+
+			onClicked: mainItem.close();
+		}
+	}
+
+	FileDialog {
+		id: sequenceDialog
+		title: "Sequence of the device..."
+		nameFilters: ["Sequence files (*.seq *.seqb)", "All files (*)"]
+		selectExisting: true
+
+		onAccepted: deviceManager.setDeviceSequence(internal.sequenceDevice, sequenceDialog.fileUrl);
+	}
+
+	FileDialog {
+		id: calibrationDialog
+		title: "Calibration of the device..."
+		nameFilters: ["Calibration files (*.json)", "All files (*)"]
+		selectExisting: true
+
+		onAccepted: deviceManager.sendDeviceCalibration(internal.calibrationDevice, calibrationDialog.fileUrl);
+	}
+}
@@ -81,6 +81,115 @@ Window {
 
 				onTextChanged: serialCommunication.baudRate = parseFloat(text)
 			}
+
+			Text {
+				text: "Stream baud rate:"
+			}
+
+			// This is the field to set the baud rate to negotiate when streaming. Setting it
+			// below the baud rate disables negotiation
+			TextField {
+				id: streamBaudRateField
+				Layout.fillWidth: true
+
+				validator: IntValidator {
+					bottom: 0
+					top: 1000000
+				}
+
+				text: serialCommunication.streamBaudRate;
+
+				onTextChanged: serialCommunication.streamBaudRate = parseFloat(text)
+			}
+
+			// This enables the compilation of sequences before streaming (see TrajectoryCompiler)
+			CheckBox {
+				text: "Simplify, tolerance:"
+				checked: serialCommunication.compileTrajectory
+
+				onClicked: serialCommunication.compileTrajectory = checked;
+			}
+
+			TextField {
+				Layout.fillWidth: true
+				enabled: serialCommunication.compileTrajectory
+
+				validator: DoubleValidator {
+					bottom: 0
+					top: 255
+				}
+
+				text: serialCommunication.trajectoryTolerance;
+
+				onTextChanged: serialCommunication.trajectoryTolerance = parseFloat(text)
+			}
+
+			// Compiled segments get easing profiles if this is checked
+			CheckBox {
+				Layout.columnSpan: 2
+				text: "Fit easing profiles"
+				enabled: serialCommunication.compileTrajectory
+				checked: serialCommunication.trajectoryEasing
+
+				onClicked: serialCommunication.trajectoryEasing = checked;
+			}
+
+			// The limits of servos, steps exceeding them are highlighted in the timeline (see
+			// MotionAnalysis)
+			Text {
+				text: "Max velocity (units/s):"
+			}
+
+			TextField {
+				Layout.fillWidth: true
+
+				validator: DoubleValidator {
+					bottom: 0
+				}
+
+				text: sequence.motion.maxVelocity;
+
+				onTextChanged: sequence.motion.maxVelocity = parseFloat(text)
+			}
+
+			Text {
+				text: "Max acceleration (units/s^2):"
+			}
+
+			TextField {
+				Layout.fillWidth: true
+
+				validator: DoubleValidator {
+					bottom: 0
+				}
+
+				text: sequence.motion.maxAcceleration;
+
+				onTextChanged: sequence.motion.maxAcceleration = parseFloat(text)
+			}
+
+			// This enables writing raw serial data to the file below (see FrameCapture)
+			CheckBox {
+				id: captureCheckBox
+				text: "Capture to:"
+				checked: serialCommunication.isCapturing
+
+				onClicked: {
+					if (checked) {
+						serialCommunication.startCapture(captureFileField.text);
+					} else {
+						serialCommunication.stopCapture();
+					}
+				}
+			}
+
+			TextField {
+				id: captureFileField
+				Layout.fillWidth: true
+				enabled: !serialCommunication.isCapturing
+
+				text: "serialcapture.bin"
+			}
 		}
 
 		Button {
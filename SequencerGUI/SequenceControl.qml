@@ -75,16 +75,86 @@ Item {
 
 		Button {
 			text: "Stop"
-			enabled: serialCommunication.isStreamMode
+			enabled: serialCommunication.isStreamMode || serialCommunication.isUploadMode || serialCommunication.isStoredPlaybackMode
 
 			Layout.fillWidth: true
 
 			onClicked: serialCommunication.stop()
 		}
 
+		Button {
+			text: serialCommunication.isUploadMode ? ("Uploading (" + serialCommunication.uploadedPoints + "/" + sequence.numPoints + ")") : "Upload sequence to robot"
+			enabled: serialCommunication.isConnected && (!serialCommunication.isStreaming)
+
+			Layout.fillWidth: true
+
+			onClicked: serialCommunication.uploadSequence(sequence);
+		}
+
+		Button {
+			text: "Play sequence stored in robot"
+			enabled: serialCommunication.isConnected && (!serialCommunication.isStreaming)
+
+			Layout.fillWidth: true
+
+			onClicked: serialCommunication.playStored();
+		}
+
+		// The preview plays the sequence without hardware, sliders of servos show it while it
+		// is active (see PlaybackPreview)
+		RowLayout {
+			Layout.fillWidth: true
+
+			Button {
+				text: sequence.preview.isPlaying ? "Pause preview" : "Preview"
+				enabled: sequence.numPoints > 0
+
+				Layout.fillWidth: true
+
+				onClicked: {
+					if (sequence.preview.isPlaying) {
+						sequence.preview.pause();
+					} else {
+						sequence.preview.play();
+					}
+				}
+			}
+
+			Button {
+				text: "Stop preview"
+				enabled: sequence.preview.isActive
+
+				Layout.fillWidth: true
+
+				onClicked: sequence.preview.stop();
+			}
+		}
+
+		// Dragging this moves the preview to a time of the sequence
+		Slider {
+			minimumValue: 0
+			maximumValue: Math.max(1, sequence.preview.duration)
+			value: sequence.preview.position
+			enabled: sequence.numPoints > 0
+			updateValueWhileDragging: true
+
+			Layout.fillWidth: true
+
+			onValueChanged: {
+				if (pressed) {
+					sequence.preview.position = value;
+				}
+			}
+		}
+
+		Text {
+			text: "Preview: " + sequence.preview.position + "/" + sequence.preview.duration + " ms" +
+			      (sequence.preview.isActive ? (", step " + sequence.preview.playingPoint) : "")
+		}
+
 		CheckBox {
 			text: "Immediate mode"
-			enabled: serialCommunication.isConnected && (!serialCommunication.isStreamMode)
+			enabled: serialCommunication.isConnected && (!serialCommunication.isStreaming || serialCommunication.isImmediateMode)
 
 			Layout.fillWidth: true
 
@@ -157,6 +227,87 @@ Item {
 
 			Layout.fillWidth: true
 		}
+
+		// Graphs of the telemetry of the hardware. They are sampled with the same period of
+		// telemetry packets, so that a sample is added even if values do not change
+		Timer {
+			interval: 1000
+			repeat: true
+			running: serialCommunication.isConnected
+
+			onTriggered: {
+				if (serialCommunication.loopsPerSecond >= 0) {
+					loopsGraph.addSample(serialCommunication.loopsPerSecond);
+					stepTimeGraph.addSample(serialCommunication.maxStepTime);
+					bufferGraph.addSample(serialCommunication.bufferedPoints);
+				}
+			}
+
+			onRunningChanged: {
+				if (running) {
+					loopsGraph.clear();
+					stepTimeGraph.clear();
+					bufferGraph.clear();
+				}
+			}
+		}
+
+		TelemetryGraph {
+			id: loopsGraph
+			label: "Loop iterations"
+			unit: "/s"
+
+			Layout.fillWidth: true
+		}
+
+		TelemetryGraph {
+			id: stepTimeGraph
+			label: "Max step time (mean " + ((serialCommunication.meanStepTime < 0) ? "unknown" : (serialCommunication.meanStepTime + " us")) + ")"
+			unit: "us"
+
+			Layout.fillWidth: true
+		}
+
+		TelemetryGraph {
+			id: bufferGraph
+			label: "Buffered points"
+			unit: ""
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "Underruns: " + ((serialCommunication.underruns < 0) ? "unknown" : serialCommunication.underruns) +
+			      ", receive overruns: " + ((serialCommunication.receiveOverruns < 0) ? "unknown" : serialCommunication.receiveOverruns) +
+			      ", receive peak: " + ((serialCommunication.receiveBufferPeak < 0) ? "unknown" : (serialCommunication.receiveBufferPeak + "/63")) +
+			      ", dropped points: " + ((serialCommunication.droppedPoints < 0) ? "unknown" : serialCommunication.droppedPoints)
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "Streamed step: " + ((serialCommunication.playhead < 0) ? "none" : serialCommunication.playhead)
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "Link speed: " + ((serialCommunication.linkBaudRate < 0) ? "not connected" : (serialCommunication.linkBaudRate + " baud"))
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "Hardware buffer: " + ((serialCommunication.hardwareBufferSize < 0) ? "unknown" : (serialCommunication.hardwareBufferSize + " points"))
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "Task overruns (servo, serial, battery, overruns, telemetry, face): " + ((serialCommunication.taskOverruns.length == 0) ? "unknown" : serialCommunication.taskOverruns.join(", "))
+
+			Layout.fillWidth: true
+		}
 	}
 }
 
@@ -6,11 +6,34 @@ QT += qml quick widgets serialport
 # QMAKE_CXXFLAGS += -std=c++14 -Wall -Wextra
 QMAKE_CXXFLAGS += -std=c++11 -Wall -Wextra
 
+# The encoding of points is shared with the firmware
+INCLUDEPATH += ../Firmware
+
+# Use CONFIG+=sequence_8bit to store positions of points as 8 bits integers
+sequence_8bit {
+    DEFINES += SEQUENCE_8BIT_VALUES
+}
+
 SOURCES += main.cpp \
     sequencer.cpp \
     sequence.cpp \
+    sequencecommand.cpp \
+    sequenceedit.cpp \
+    sequencefile.cpp \
+    sequencejournal.cpp \
+    sequencemodel.cpp \
+    motionanalysis.cpp \
+    playbackpreview.cpp \
+    calibrationprofile.cpp \
     sequencepoint.cpp \
-    serialcommunication.cpp
+    sequencesnapshot.cpp \
+    serialcommunication.cpp \
+    devicemanager.cpp \
+    trajectorycompiler.cpp \
+    clocksync.cpp \
+    streamengine.cpp \
+    logging.cpp \
+    framecapture.cpp
 
 RESOURCES += qml.qrc
 
@@ -22,7 +45,27 @@ include(deployment.pri)
 
 HEADERS += \
     sequencer.h \
+    hardwaretelemetry.h \
     sequence.h \
+    sequencecommand.h \
+    sequenceedit.h \
+    sequencefile.h \
+    sequencejournal.h \
+    sequencemodel.h \
+    motionanalysis.h \
+    playbackpreview.h \
+    calibrationprofile.h \
     sequencepoint.h \
+    pointstorage.h \
+    sequencesnapshot.h \
     utils.h \
-    serialcommunication.h
+    serialcommunication.h \
+    devicemanager.h \
+    streamstatistics.h \
+    clocksync.h \
+    trajectorycompiler.h \
+    streamengine.h \
+    logging.h \
+    framecapture.h \
+    ../Firmware/pointcodec.h \
+    ../Firmware/crc8.h
@@ -33,8 +33,9 @@ import QtQuick.Layouts 1.1
 Item {
 	id: mainItem
 
-	// Only enabled if there is a valid point
-	enabled: (sequence.curPoint >= 0)
+	// Only enabled if there is a valid point. While the preview is active this shows
+	// the position of the servo in the preview and cannot be edited
+	enabled: (sequence.curPoint >= 0) && (!sequence.preview.isActive)
 
 	// The id of the servo controlled by this item. You MUST set this to a
 	// valid value (greater or equal to 0)
@@ -75,8 +76,9 @@ Item {
 				textInput.text = value
 
 				// Here we also update the value in the sequence
-				// if we have a valid servoID
-				if ((mainItem.servoID >= 0) && (mainItem.servoID < sequence.pointDim)) {
+				// if we have a valid servoID and the value is not
+				// the one of the preview
+				if ((mainItem.servoID >= 0) && (mainItem.servoID < sequence.pointDim) && (!sequence.preview.isActive)) {
 					sequence.setPointCoordinate(servoID, value)
 				}
 			}
@@ -128,6 +130,8 @@ Item {
 		// re-read value for the sequence
 		sequence.onCurPointChanged.connect(fixLimitsAndValue);
 		sequence.onCurPointValuesChanged.connect(fixLimitsAndValue);
+		sequence.preview.onPositionChanged.connect(fixLimitsAndValue);
+		sequence.preview.onIsActiveChanged.connect(fixLimitsAndValue);
 	}
 
 	// Sets the limits and value to the ones for the current point
@@ -148,7 +152,7 @@ Item {
 
 		// Finally setting value. We only set the value of the slider,
 		// this will automatically change the value of the text field
-		slider.value = value;
+		slider.value = sequence.preview.isActive ? sequence.preview.value(mainItem.servoID) : value;
 	}
 }
 
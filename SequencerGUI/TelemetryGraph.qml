@@ -0,0 +1,113 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// Qt 5.4
+//import QtQuick 2.4
+
+// Qt 5.2
+import QtQuick 2.0
+
+// A small graph with the history of a value received from the hardware. Call
+// addSample() to add a value, the graph shows the last maxSamples values
+// scaled between 0 and the maximum of the displayed ones
+Item {
+	id: mainItem
+	implicitHeight: 50
+	implicitWidth: 200
+
+	// The name of the value, shown with the last sample
+	property string label: ""
+	// The unit of measure of the value
+	property string unit: ""
+	// How many samples are displayed
+	property int maxSamples: 60
+	// The samples, the last one is the most recent
+	property var samples: []
+
+	// Adds a sample, removing the oldest one if there are already maxSamples
+	function addSample(v)
+	{
+		var s = samples;
+		s.push(v);
+		if (s.length > maxSamples) {
+			s.shift();
+		}
+		samples = s;
+
+		canvas.requestPaint();
+	}
+
+	// Removes all samples
+	function clear()
+	{
+		samples = [];
+
+		canvas.requestPaint();
+	}
+
+	Rectangle {
+		anchors.fill: parent
+		color: "white"
+		border.color: "gray"
+	}
+
+	Canvas {
+		id: canvas
+		anchors.fill: parent
+		anchors.margins: 2
+
+		onPaint: {
+			var ctx = getContext("2d");
+			ctx.clearRect(0, 0, width, height);
+
+			if (samples.length < 2) {
+				return;
+			}
+
+			var maxValue = Math.max.apply(Math, samples);
+			if (maxValue <= 0) {
+				maxValue = 1;
+			}
+
+			ctx.strokeStyle = "steelblue";
+			ctx.lineWidth = 1;
+			ctx.beginPath();
+			for (var i = 0; i < samples.length; ++i) {
+				var x = i * width / (maxSamples - 1);
+				var y = height - (samples[i] * height / maxValue);
+				if (i == 0) {
+					ctx.moveTo(x, y);
+				} else {
+					ctx.lineTo(x, y);
+				}
+			}
+			ctx.stroke();
+		}
+	}
+
+	Text {
+		anchors.left: parent.left
+		anchors.top: parent.top
+		anchors.margins: 3
+		font.pixelSize: 10
+		text: label + ": " + ((samples.length == 0) ? "unknown" : (samples[samples.length - 1] + " " + unit))
+	}
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// Qt 5.4
+//import QtQuick 2.4
+
+// Qt 5.2
+import QtQuick 2.0
+
+// The timeline with all the steps of the sequence. Only visible steps have a
+// delegate, so this works with sequences of any length. Clicking on a step
+// makes it the current one. Steps exceeding the limits of servos (see
+// MotionAnalysis) are highlighted
+Item {
+	id: mainItem
+	implicitHeight: 60
+	implicitWidth: 200
+
+	ListView {
+		id: timeline
+		anchors.fill: parent
+		anchors.margins: 5
+		orientation: ListView.Horizontal
+		clip: true
+		spacing: 2
+
+		model: sequence.model
+		currentIndex: sequence.curPoint
+		highlightMoveDuration: 0
+
+		delegate: Rectangle {
+			// The width is proportional to the time spent on the step
+			width: Math.max(30, (timeToTarget + duration) / 20)
+			height: timeline.height
+			color: ListView.isCurrentItem ? "lightsteelblue" : "lightgray"
+			border.color: tooFast ? "red" : "gray"
+			border.width: tooFast ? 2 : 1
+
+			Text {
+				anchors.centerIn: parent
+				horizontalAlignment: Text.AlignHCenter
+				text: index + "\n" + duration + " ms"
+			}
+
+			MouseArea {
+				anchors.fill: parent
+
+				onClicked: sequence.setCurPoint(index)
+			}
+		}
+	}
+}
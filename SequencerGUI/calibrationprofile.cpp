@@ -0,0 +1,236 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "calibrationprofile.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+
+namespace {
+	/**
+	 * \brief The number of channels of the default profile
+	 */
+	const int defaultNumChannels = 16;
+
+	/**
+	 * \brief The PWM values of the default profile
+	 *
+	 * These must be the same of the default calibration of the firmware
+	 */
+	const int defaultPWMMin[defaultNumChannels] = {1150,  500,  500,  800,  900,  550,  800,  550,  920,  500,  750, 1000,  500,  750,  650, 1450};
+	const int defaultPWMMax[defaultNumChannels] = {1770, 1840, 1800, 2200, 1700, 1750, 2050, 1670, 2000, 1700, 2020, 1800, 1800, 1650, 2000, 2200};
+	const int defaultPWMRest[defaultNumChannels] = {1500, 1840, 1000, 1150, 1300, 1400, 1160, 1250, 1300, 1320, 1100, 1420, 1350, 1650,  650, 1800};
+
+	/**
+	 * \brief The default limits of durations and times to target in
+	 *        milliseconds
+	 */
+	const int defaultMinDuration = 3;
+	const int defaultMaxDuration = 3000;
+	const int defaultMinTimeToTarget = 1;
+	const int defaultMaxTimeToTarget = 10000;
+
+	/**
+	 * \brief The maximum duration and time to target, they are sent as 2
+	 *        bytes
+	 */
+	const int maxTiming = 65535;
+
+	/**
+	 * \brief Reads an optional integer from a JSON object
+	 *
+	 * \param json the object
+	 * \param key the key to read
+	 * \param defaultValue the value to use if the key is missing
+	 * \param ok set to false if the key is present but is not a number
+	 * \return the value
+	 */
+	int readInt(const QJsonObject& json, const char* key, int defaultValue, bool& ok)
+	{
+		const QJsonValue v = json[key];
+		if (v.isUndefined()) {
+			return defaultValue;
+		} else if (!v.isDouble()) {
+			ok = false;
+			return defaultValue;
+		}
+
+		return static_cast<int>(v.toDouble());
+	}
+}
+
+CalibrationProfile::CalibrationProfile()
+	: m_channels()
+	, m_minDuration(defaultMinDuration)
+	, m_maxDuration(defaultMaxDuration)
+	, m_minTimeToTarget(defaultMinTimeToTarget)
+	, m_maxTimeToTarget(defaultMaxTimeToTarget)
+{
+}
+
+CalibrationProfile CalibrationProfile::defaultProfile()
+{
+	CalibrationProfile p;
+
+	for (int c = 0; c < defaultNumChannels; ++c) {
+		p.appendChannel(Channel{defaultPWMMin[c], defaultPWMMax[c], defaultPWMRest[c], 0.0, 255.0});
+	}
+
+	return p;
+}
+
+CalibrationProfile CalibrationProfile::load(QString filename)
+{
+	QFile f(filename);
+
+	if (!f.open(QIODevice::ReadOnly)) {
+		qDebug() << "CalibrationProfile error: cannot open" << filename;
+		return CalibrationProfile();
+	}
+
+	const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+	CalibrationProfile p;
+	if (!doc.isObject() || !p.fromJson(doc.object()) || !p.isValid()) {
+		qDebug() << "CalibrationProfile error: invalid calibration in" << filename;
+		return CalibrationProfile();
+	}
+
+	return p;
+}
+
+bool CalibrationProfile::save(QString filename) const
+{
+	QFile f(filename);
+
+	if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		return false;
+	}
+
+	f.write(QJsonDocument(toJson()).toJson());
+
+	return f.error() == QFileDevice::NoError;
+}
+
+bool CalibrationProfile::fromJson(const QJsonObject& json)
+{
+	m_channels.clear();
+
+	const QJsonValue channels = json["channels"];
+	if (!channels.isArray()) {
+		return false;
+	}
+
+	bool ok = true;
+	for (auto v: channels.toArray()) {
+		if (!v.isObject()) {
+			return false;
+		}
+
+		// PWM values are mandatory, the range of positions is the full one if missing
+		const QJsonObject o = v.toObject();
+		if (!o["pwmMin"].isDouble() || !o["pwmMax"].isDouble() || !o["pwmRest"].isDouble()) {
+			return false;
+		}
+		Channel c;
+		c.pwmMin = static_cast<int>(o["pwmMin"].toDouble());
+		c.pwmMax = static_cast<int>(o["pwmMax"].toDouble());
+		c.pwmRest = static_cast<int>(o["pwmRest"].toDouble());
+		c.minPosition = o["minPosition"].toDouble(0.0);
+		c.maxPosition = o["maxPosition"].toDouble(255.0);
+
+		m_channels.append(c);
+	}
+
+	m_minDuration = readInt(json, "minDuration", defaultMinDuration, ok);
+	m_maxDuration = readInt(json, "maxDuration", defaultMaxDuration, ok);
+	m_minTimeToTarget = readInt(json, "minTimeToTarget", defaultMinTimeToTarget, ok);
+	m_maxTimeToTarget = readInt(json, "maxTimeToTarget", defaultMaxTimeToTarget, ok);
+
+	return ok;
+}
+
+QJsonObject CalibrationProfile::toJson() const
+{
+	QJsonArray channels;
+	for (const Channel& c: m_channels) {
+		QJsonObject o;
+		o.insert("pwmMin", c.pwmMin);
+		o.insert("pwmMax", c.pwmMax);
+		o.insert("pwmRest", c.pwmRest);
+		o.insert("minPosition", c.minPosition);
+		o.insert("maxPosition", c.maxPosition);
+		channels.append(o);
+	}
+
+	QJsonObject json;
+	json.insert("channels", channels);
+	json.insert("minDuration", m_minDuration);
+	json.insert("maxDuration", m_maxDuration);
+	json.insert("minTimeToTarget", m_minTimeToTarget);
+	json.insert("maxTimeToTarget", m_maxTimeToTarget);
+
+	return json;
+}
+
+bool CalibrationProfile::isValid() const
+{
+	if (m_channels.isEmpty()) {
+		return false;
+	}
+
+	for (const Channel& c: m_channels) {
+		if ((c.pwmMin < 0) || (c.pwmMin >= c.pwmMax) || (c.pwmMax > maxPWM) || (c.pwmRest < c.pwmMin) || (c.pwmRest > c.pwmMax)) {
+			return false;
+		}
+		if ((c.minPosition < 0.0) || (c.minPosition > c.maxPosition) || (c.maxPosition > 255.0)) {
+			return false;
+		}
+	}
+
+	return (m_minDuration >= 0) && (m_minDuration <= m_maxDuration) && (m_maxDuration <= maxTiming) &&
+	       (m_minTimeToTarget >= 0) && (m_minTimeToTarget <= m_maxTimeToTarget) && (m_maxTimeToTarget <= maxTiming);
+}
+
+void CalibrationProfile::appendChannel(const Channel& channel)
+{
+	m_channels.append(channel);
+}
+
+SequencePoint CalibrationProfile::minPoint() const
+{
+	QVector<double> p(m_channels.size());
+	for (int c = 0; c < m_channels.size(); ++c) {
+		p[c] = m_channels[c].minPosition;
+	}
+
+	return SequencePoint(p, m_minDuration, m_minTimeToTarget);
+}
+
+SequencePoint CalibrationProfile::maxPoint() const
+{
+	QVector<double> p(m_channels.size());
+	for (int c = 0; c < m_channels.size(); ++c) {
+		p[c] = m_channels[c].maxPosition;
+	}
+
+	return SequencePoint(p, m_maxDuration, m_maxTimeToTarget);
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef CALIBRATIONPROFILE_H
+#define CALIBRATIONPROFILE_H
+
+#include <QVector>
+#include <QString>
+#include <QJsonObject>
+#include <QMetaType>
+#include "sequencepoint.h"
+
+/**
+ * \brief The calibration of the servos of a robot
+ *
+ * For each channel this has the PWM values of the minimum and maximum position
+ * (the hardware maps positions from 0 to 255 linearly between them), the PWM
+ * of the rest position, where servos are moved when the hardware starts, and
+ * the range of positions the sequence may use (some servos cannot use their
+ * full range on the robot). The profile also has the limits of durations and
+ * times to target. The PWM values are sent to the hardware with the "set
+ * calibration" packet (see StreamEngine), which stores them in its EEPROM,
+ * while the limits of the sequence are built from the other values (see
+ * minPoint() and maxPoint()), so that one file describes a robot. Profiles
+ * are saved as JSON objects: a "channels" list with one object per channel
+ * (with keys pwmMin, pwmMax, pwmRest and the optional minPosition and
+ * maxPosition) and the optional minDuration, maxDuration, minTimeToTarget and
+ * maxTimeToTarget keys. A default constructed profile has no channels and is
+ * not valid, defaultProfile() is the calibration of the robot this program was
+ * written for.
+ */
+class CalibrationProfile
+{
+public:
+	/**
+	 * \brief The maximum PWM value
+	 *
+	 * The PWM driver of the hardware has 12 bits of resolution
+	 */
+	static const int maxPWM = 4095;
+
+	/**
+	 * \brief The calibration of one channel
+	 */
+	struct Channel
+	{
+		/**
+		 * \brief The PWM of the minimum position
+		 */
+		int pwmMin;
+
+		/**
+		 * \brief The PWM of the maximum position
+		 */
+		int pwmMax;
+
+		/**
+		 * \brief The PWM of the rest position
+		 */
+		int pwmRest;
+
+		/**
+		 * \brief The minimum position the sequence may use
+		 */
+		double minPosition;
+
+		/**
+		 * \brief The maximum position the sequence may use
+		 */
+		double maxPosition;
+	};
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * The profile has no channels
+	 */
+	CalibrationProfile();
+
+	/**
+	 * \brief Returns the default profile
+	 *
+	 * This is the calibration used by the hardware when none is stored in
+	 * its EEPROM
+	 * \return the default profile
+	 */
+	static CalibrationProfile defaultProfile();
+
+	/**
+	 * \brief Loads a profile from a JSON file
+	 *
+	 * \param filename the name of the file to load
+	 * \return the profile, not valid in case of error
+	 */
+	static CalibrationProfile load(QString filename);
+
+	/**
+	 * \brief Saves the profile to a JSON file
+	 *
+	 * \param filename the name of the file
+	 * \return false in case of error
+	 */
+	bool save(QString filename) const;
+
+	/**
+	 * \brief Initializes this object from its JSON representation
+	 *
+	 * \param json the JSON object to read
+	 * \return false in case of error
+	 */
+	bool fromJson(const QJsonObject& json);
+
+	/**
+	 * \brief Returns the JSON representation of this object
+	 *
+	 * \return The JSON representation of this object
+	 */
+	QJsonObject toJson() const;
+
+	/**
+	 * \brief Returns true if the profile can be used
+	 *
+	 * There must be at least one channel. For each channel the minimum PWM
+	 * must be less than the maximum, the rest PWM must be between them, no
+	 * value can be greater than maxPWM and the range of positions must be
+	 * within 0 and 255. Minimum durations and times to target must not be
+	 * greater than the maximum ones
+	 * \return true if the profile can be used
+	 */
+	bool isValid() const;
+
+	/**
+	 * \brief Returns the number of channels
+	 *
+	 * \return the number of channels
+	 */
+	int numChannels() const
+	{
+		return m_channels.size();
+	}
+
+	/**
+	 * \brief Returns the calibration of a channel
+	 *
+	 * \param c the index of the channel. It must be valid
+	 * \return the calibration of the channel
+	 */
+	const Channel& channel(int c) const
+	{
+		return m_channels[c];
+	}
+
+	/**
+	 * \brief Adds a channel at the end
+	 *
+	 * \param channel the calibration of the channel
+	 */
+	void appendChannel(const Channel& channel);
+
+	/**
+	 * \brief Returns the minimum values of the points of a sequence
+	 *
+	 * \return the minimum position of each channel, the minimum duration and
+	 *         the minimum time to target
+	 */
+	SequencePoint minPoint() const;
+
+	/**
+	 * \brief Returns the maximum values of the points of a sequence
+	 *
+	 * \return the maximum position of each channel, the maximum duration and
+	 *         the maximum time to target
+	 */
+	SequencePoint maxPoint() const;
+
+private:
+	/**
+	 * \brief The calibration of channels
+	 */
+	QVector<Channel> m_channels;
+
+	/**
+	 * \brief The minimum duration in milliseconds
+	 */
+	int m_minDuration;
+
+	/**
+	 * \brief The maximum duration in milliseconds
+	 */
+	int m_maxDuration;
+
+	/**
+	 * \brief The minimum time to target in milliseconds
+	 */
+	int m_minTimeToTarget;
+
+	/**
+	 * \brief The maximum time to target in milliseconds
+	 */
+	int m_maxTimeToTarget;
+};
+
+// Profiles are passed to the I/O thread with queued connections
+Q_DECLARE_METATYPE(CalibrationProfile)
+
+#endif // CALIBRATIONPROFILE_H
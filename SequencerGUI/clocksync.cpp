@@ -0,0 +1,150 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "clocksync.h"
+#include <cmath>
+
+namespace {
+	/**
+	 * \brief The maximum absolute value of the drift
+	 *
+	 * This is the same limit used by the hardware
+	 */
+	const qint32 maxDrift = 1 << 20;
+}
+
+ClockSync::ClockSync()
+	: m_pingId(0)
+	, m_pingTime(-1)
+	, m_windowPings(0)
+	, m_windowBest()
+	, m_lastLocalTime(-1)
+	, m_samples()
+	, m_synced(false)
+	, m_referenceLocalTime(0)
+	, m_referenceTime(0)
+	, m_drift(0)
+	, m_roundTrip(-1)
+{
+}
+
+void ClockSync::reset()
+{
+	m_pingTime = -1;
+	m_windowPings = 0;
+	m_lastLocalTime = -1;
+	m_samples.clear();
+	m_synced = false;
+	m_referenceLocalTime = 0;
+	m_referenceTime = 0;
+	m_drift = 0;
+	m_roundTrip = -1;
+}
+
+bool ClockSync::canPing(qint64 now) const
+{
+	return (m_pingTime == -1) || ((now - m_pingTime) > pingTimeout);
+}
+
+quint8 ClockSync::pingSent(qint64 now)
+{
+	++m_pingId;
+	m_pingTime = now;
+
+	return m_pingId;
+}
+
+bool ClockSync::pongReceived(quint8 id, quint32 localTime, qint64 now)
+{
+	if ((m_pingTime == -1) || (id != m_pingId)) {
+		return false;
+	}
+
+	// Removing the wrap around of the local time
+	if (m_lastLocalTime == -1) {
+		m_lastLocalTime = localTime;
+	} else {
+		m_lastLocalTime += quint32(localTime - quint32(m_lastLocalTime));
+	}
+
+	const Sample sample{m_lastLocalTime, (m_pingTime + now) / 2.0, now - m_pingTime};
+	m_pingTime = -1;
+
+	// Keeping the sample with the shortest round trip, it has the smallest error
+	if ((m_windowPings == 0) || (sample.roundTrip < m_windowBest.roundTrip)) {
+		m_windowBest = sample;
+	}
+	++m_windowPings;
+	if (m_windowPings < pingsPerWindow) {
+		return false;
+	}
+
+	m_windowPings = 0;
+	m_samples.append(m_windowBest);
+	if (m_samples.size() > maxSamples) {
+		m_samples.removeFirst();
+	}
+	estimate();
+
+	return true;
+}
+
+void ClockSync::estimate()
+{
+	const Sample& last = m_samples.last();
+
+	// Least squares fit of the time of the PC against the local time. Values are relative to the
+	// last sample to keep them small
+	double slope = 1.0;
+	double intercept = 0.0;
+	if ((last.localTime - m_samples.first().localTime) >= minDriftSpan) {
+		double meanX = 0.0;
+		double meanY = 0.0;
+		for (const Sample& s: m_samples) {
+			meanX += s.localTime - last.localTime;
+			meanY += s.time - last.time;
+		}
+		meanX /= m_samples.size();
+		meanY /= m_samples.size();
+
+		double sxx = 0.0;
+		double sxy = 0.0;
+		for (const Sample& s: m_samples) {
+			const double dx = (s.localTime - last.localTime) - meanX;
+			sxx += dx * dx;
+			sxy += dx * ((s.time - last.time) - meanY);
+		}
+		slope = sxy / sxx;
+		intercept = meanY - slope * meanX;
+	} else {
+		// Without drift the offset is the mean one
+		for (const Sample& s: m_samples) {
+			intercept += (s.time - last.time) - (s.localTime - last.localTime);
+		}
+		intercept /= m_samples.size();
+	}
+
+	m_synced = true;
+	m_referenceLocalTime = quint32(last.localTime);
+	m_referenceTime = quint32(qint64(std::floor(last.time + intercept + 0.5)));
+	m_drift = qint32(qBound(double(-maxDrift), std::floor((slope - 1.0) * (1 << 24) + 0.5), double(maxDrift)));
+	m_roundTrip = int(last.roundTrip);
+}
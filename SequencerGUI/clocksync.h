@@ -0,0 +1,266 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * \brief The class estimating the offset and the drift of the clock of the
+ *        hardware
+ *
+ * The PC sends clock pings and the hardware answers with its local time. Each
+ * answer is a sample: the local time of the hardware corresponds to the time
+ * of the PC halfway between sending the ping and receiving the answer, with an
+ * error that is at most half the round trip time. Pings are grouped in windows
+ * of pingsPerWindow and only the sample with the shortest round trip of each
+ * window is kept. The time of the PC is then estimated from the local time of
+ * the hardware with a least squares fit of the last maxSamples samples: the
+ * intercept is the offset, the slope is the drift. The drift is only estimated
+ * once samples span at least minDriftSpan milliseconds, before it is assumed
+ * to be 0. After each window the parameters to send to the hardware with the
+ * "set clock" packet are available (see StreamEngine), so that the clock
+ * used by the hardware to play sequences follows the clock of the PC. Times of
+ * the PC are in milliseconds (see StreamEngine::currentTime()), local times of
+ * the hardware are the 32 bits values of millis() and can wrap around.
+ */
+class ClockSync
+{
+public:
+	/**
+	 * \brief The number of pings in a window
+	 */
+	static const int pingsPerWindow = 8;
+
+	/**
+	 * \brief The number of samples used to estimate offset and drift
+	 */
+	static const int maxSamples = 30;
+
+	/**
+	 * \brief The minimum time spanned by samples to estimate the drift, in
+	 *        milliseconds
+	 */
+	static const int minDriftSpan = 10000;
+
+	/**
+	 * \brief The time after which a ping without answer is considered lost,
+	 *        in milliseconds
+	 */
+	static const int pingTimeout = 1000;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	ClockSync();
+
+	/**
+	 * \brief Forgets all samples
+	 *
+	 * Call this when the hardware could have been restarted
+	 */
+	void reset();
+
+	/**
+	 * \brief Returns true if a new ping can be sent
+	 *
+	 * This is false while waiting for the answer to the previous ping,
+	 * unless it timed out
+	 * \param now the current time of the PC
+	 * \return true if a new ping can be sent
+	 */
+	bool canPing(qint64 now) const;
+
+	/**
+	 * \brief Records that a ping is being sent
+	 *
+	 * \param now the current time of the PC
+	 * \return the identifier to put in the ping
+	 */
+	quint8 pingSent(qint64 now);
+
+	/**
+	 * \brief Records the answer to a ping
+	 *
+	 * Answers with an unexpected identifier are discarded
+	 * \param id the identifier in the answer
+	 * \param localTime the local time of the hardware in the answer
+	 * \param now the current time of the PC
+	 * \return true if a window was completed and new parameters are
+	 *         available
+	 */
+	bool pongReceived(quint8 id, quint32 localTime, qint64 now);
+
+	/**
+	 * \brief Returns true if parameters have been estimated at least once
+	 *
+	 * \return true if the clock is synchronized
+	 */
+	bool isSynced() const
+	{
+		return m_synced;
+	}
+
+	/**
+	 * \brief Returns the local time of the hardware to which
+	 *        referenceTime() refers
+	 *
+	 * This is the local time of the last kept sample
+	 * \return the local time of the hardware
+	 */
+	quint32 referenceLocalTime() const
+	{
+		return m_referenceLocalTime;
+	}
+
+	/**
+	 * \brief Returns the time of the PC at referenceLocalTime()
+	 *
+	 * Only the lower 32 bits of the time are sent to the hardware
+	 * \return the estimated time of the PC
+	 */
+	quint32 referenceTime() const
+	{
+		return m_referenceTime;
+	}
+
+	/**
+	 * \brief Returns the correction of the rate of the clock of the
+	 *        hardware
+	 *
+	 * \return the drift in units of 2^-24 (see the "set clock" packet)
+	 */
+	qint32 drift() const
+	{
+		return m_drift;
+	}
+
+	/**
+	 * \brief Returns the correction of the rate of the clock of the
+	 *        hardware in parts per million
+	 *
+	 * \return the drift in parts per million
+	 */
+	double driftPpm() const
+	{
+		return m_drift * 1.0e6 / (1 << 24);
+	}
+
+	/**
+	 * \brief Returns the round trip time of the last kept sample
+	 *
+	 * \return the round trip time in milliseconds, -1 if not synchronized
+	 */
+	int roundTrip() const
+	{
+		return m_roundTrip;
+	}
+
+private:
+	/**
+	 * \brief A sample of the local time of the hardware
+	 */
+	struct Sample
+	{
+		/**
+		 * \brief The local time of the hardware, without wrap around
+		 */
+		qint64 localTime;
+
+		/**
+		 * \brief The corresponding time of the PC
+		 */
+		double time;
+
+		/**
+		 * \brief The round trip time of the ping in milliseconds
+		 */
+		qint64 roundTrip;
+	};
+
+	/**
+	 * \brief Fits the samples and updates the parameters
+	 */
+	void estimate();
+
+	/**
+	 * \brief The identifier of the last ping
+	 */
+	quint8 m_pingId;
+
+	/**
+	 * \brief The time the last ping was sent, -1 if it was answered
+	 */
+	qint64 m_pingTime;
+
+	/**
+	 * \brief The number of answers received in the current window
+	 */
+	int m_windowPings;
+
+	/**
+	 * \brief The sample with the shortest round trip in the current
+	 *        window
+	 */
+	Sample m_windowBest;
+
+	/**
+	 * \brief The last local time of the hardware, without wrap around
+	 *
+	 * This is -1 if no answer was received
+	 */
+	qint64 m_lastLocalTime;
+
+	/**
+	 * \brief The kept samples, the oldest first
+	 */
+	QVector<Sample> m_samples;
+
+	/**
+	 * \brief True if parameters have been estimated
+	 */
+	bool m_synced;
+
+	/**
+	 * \brief The local time to which m_referenceTime refers
+	 */
+	quint32 m_referenceLocalTime;
+
+	/**
+	 * \brief The estimated time of the PC at m_referenceLocalTime
+	 */
+	quint32 m_referenceTime;
+
+	/**
+	 * \brief The drift in units of 2^-24
+	 */
+	qint32 m_drift;
+
+	/**
+	 * \brief The round trip time of the last kept sample
+	 */
+	int m_roundTrip;
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,284 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "devicemanager.h"
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+	/**
+	 * \brief The interval between two updates of the throughput in
+	 *        milliseconds
+	 */
+	const int throughputIntervalMs = 1000;
+}
+
+DeviceManager::DeviceManager(QObject* parent)
+	: QObject(parent)
+	, m_devices()
+	, m_startDelay(500)
+	, m_throughputTimer(this)
+	, m_throughputClock()
+	, m_streamingDevices(0)
+	, m_totalPointsSent(0)
+	, m_totalBytesSent(0)
+	, m_pointsPerSecond(0.0)
+	, m_bytesPerSecond(0.0)
+{
+	// The first device, used by the rest of the user interface
+	m_devices.push_back(Device{std::make_unique<SerialCommunication>(), nullptr, QString(), 0, 0});
+
+	connect(&m_throughputTimer, &QTimer::timeout, this, &DeviceManager::updateThroughput);
+	m_throughputTimer.start(throughputIntervalMs);
+	m_throughputClock.start();
+}
+
+DeviceManager::~DeviceManager()
+{
+}
+
+SerialCommunication* DeviceManager::device(int i) const
+{
+	return isValidDevice(i) ? m_devices[i].communication.get() : nullptr;
+}
+
+QString DeviceManager::deviceSequence(int i) const
+{
+	return isValidDevice(i) ? m_devices[i].filename : QString();
+}
+
+int DeviceManager::addDevice(QString portName)
+{
+	const SerialCommunication* const first = m_devices.front().communication.get();
+
+	std::unique_ptr<SerialCommunication> communication = std::make_unique<SerialCommunication>();
+	communication->setSerialPortName(portName);
+	communication->setBaudRate(first->baudRate());
+	communication->setStreamBaudRate(first->streamBaudRate());
+	communication->setOneShotSequence(first->oneShotSequence());
+	communication->setClockSync(first->clockSync());
+	communication->setCompileTrajectory(first->compileTrajectory());
+	communication->setTrajectoryTolerance(first->trajectoryTolerance());
+	communication->setTrajectoryEasing(first->trajectoryEasing());
+
+	m_devices.push_back(Device{std::move(communication), nullptr, QString(), 0, 0});
+
+	emit countChanged();
+
+	return count() - 1;
+}
+
+bool DeviceManager::removeDevice(int i)
+{
+	if (!isValidDevice(i) || (i == 0)) {
+		qDebug() << "DeviceManager error: cannot remove device" << i;
+		return false;
+	}
+	if (m_devices[i].communication->isStreaming()) {
+		qDebug() << "DeviceManager error: cannot remove a device while it is streaming";
+		return false;
+	}
+
+	// The destructor of SerialCommunication closes the port and stops the thread
+	m_devices.erase(m_devices.begin() + i);
+
+	emit countChanged();
+
+	return true;
+}
+
+bool DeviceManager::setDeviceSequence(int i, QString filename)
+{
+	if (!isValidDevice(i)) {
+		qDebug() << "DeviceManager error: invalid device" << i;
+		return false;
+	}
+
+	Device& d = m_devices[i];
+	if (filename.isEmpty()) {
+		d.sequence.reset();
+		d.filename.clear();
+
+		return true;
+	}
+
+	const QString localFile = QUrl(filename).toLocalFile();
+	std::unique_ptr<Sequence> s = Sequence::load(localFile);
+	if (!s->isValid()) {
+		qDebug() << "DeviceManager error: cannot load the sequence" << localFile;
+		return false;
+	}
+
+	d.sequence = std::move(s);
+	d.filename = localFile;
+
+	return true;
+}
+
+bool DeviceManager::sendDeviceCalibration(int i, QString filename)
+{
+	if (!isValidDevice(i)) {
+		qDebug() << "DeviceManager error: invalid device" << i;
+		return false;
+	}
+
+	const QString localFile = QUrl(filename).toLocalFile();
+	const CalibrationProfile p = CalibrationProfile::load(localFile);
+	if (!p.isValid()) {
+		qDebug() << "DeviceManager error: cannot load the calibration" << localFile;
+		return false;
+	}
+
+	return m_devices[i].communication->sendCalibration(p);
+}
+
+bool DeviceManager::openAll()
+{
+	bool ok = true;
+	for (Device& d: m_devices) {
+		if (!d.communication->isConnected() && !d.communication->openSerial()) {
+			qDebug() << "DeviceManager error: cannot open" << d.communication->serialPortName();
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+bool DeviceManager::closeAll()
+{
+	bool ok = true;
+	for (Device& d: m_devices) {
+		ok = d.communication->closeSerial() && ok;
+	}
+
+	return ok;
+}
+
+bool DeviceManager::startAll(Sequence* sequence, bool startFromCurrent)
+{
+	return startConnected([sequence, startFromCurrent](Device& d, qint64 startTime) {
+		if (d.sequence) {
+			return d.communication->startStreamAt(d.sequence.get(), false, startTime);
+		} else {
+			return d.communication->startStreamAt(sequence, startFromCurrent, startTime);
+		}
+	});
+}
+
+bool DeviceManager::playAllStored()
+{
+	return startConnected([](Device& d, qint64 startTime) {
+		return d.communication->playStoredAt(startTime);
+	});
+}
+
+bool DeviceManager::stopAll()
+{
+	bool ok = true;
+	for (Device& d: m_devices) {
+		if (d.communication->isStreaming()) {
+			ok = d.communication->stop() && ok;
+		}
+	}
+
+	return ok;
+}
+
+template <class StartFunction>
+bool DeviceManager::startConnected(StartFunction start)
+{
+	// All devices share the same start time, the handshake is performed in the meantime
+	const qint64 startTime = StreamEngine::currentTime() + m_startDelay;
+
+	std::vector<SerialCommunication*> started;
+	for (Device& d: m_devices) {
+		SerialCommunication* const communication = d.communication.get();
+		if (!communication->isConnected()) {
+			continue;
+		}
+
+		if (!start(d, startTime)) {
+			qDebug() << "DeviceManager error: cannot start" << communication->serialPortName();
+
+			for (SerialCommunication* s: started) {
+				s->stop();
+			}
+
+			return false;
+		}
+
+		started.push_back(communication);
+	}
+
+	if (started.empty()) {
+		qDebug() << "DeviceManager error: cannot start, no device is connected";
+		return false;
+	}
+
+	return true;
+}
+
+void DeviceManager::setStartDelay(int startDelay)
+{
+	startDelay = std::max(0, startDelay);
+
+	if (startDelay != m_startDelay) {
+		m_startDelay = startDelay;
+
+		emit startDelayChanged();
+	}
+}
+
+void DeviceManager::updateThroughput()
+{
+	const double elapsed = m_throughputClock.restart() / 1000.0;
+
+	int streamingDevices = 0;
+	qint64 totalPointsSent = 0;
+	qint64 totalBytesSent = 0;
+	qint64 points = 0;
+	qint64 bytes = 0;
+	for (Device& d: m_devices) {
+		const StreamStatistics& s = d.communication->statistics();
+
+		if (d.communication->isStreaming()) {
+			++streamingDevices;
+		}
+		totalPointsSent += s.pointsSent;
+		totalBytesSent += s.bytesSent;
+
+		// Counters restart when the port is reopened
+		points += std::max(Q_INT64_C(0), s.pointsSent - d.lastPointsSent);
+		bytes += std::max(Q_INT64_C(0), s.bytesSent - d.lastBytesSent);
+		d.lastPointsSent = s.pointsSent;
+		d.lastBytesSent = s.bytesSent;
+	}
+
+	m_streamingDevices = streamingDevices;
+	m_totalPointsSent = totalPointsSent;
+	m_totalBytesSent = totalBytesSent;
+	m_pointsPerSecond = (elapsed > 0.0) ? (points / elapsed) : 0.0;
+	m_bytesPerSecond = (elapsed > 0.0) ? (bytes / elapsed) : 0.0;
+
+	emit throughputChanged();
+}
@@ -0,0 +1,426 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef DEVICEMANAGER_H
+#define DEVICEMANAGER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <memory>
+#include <vector>
+#include "utils.h"
+#include "sequence.h"
+#include "serialcommunication.h"
+
+/**
+ * \brief The class handling more hardware connected to different serial ports
+ *
+ * This keeps a list of devices, each one with its own SerialCommunication
+ * object. The first device always exists and is the one used by the rest of
+ * the user interface (see Sequencer::serialCommunication()), more devices can
+ * be added with addDevice(). Every SerialCommunication has its own stream
+ * engine living in a separate thread, so the communication with a device never
+ * waits for the others or for the user interface. There is one thread per
+ * device instead of a pool or a single event loop shared by all engines
+ * because an engine blocks its thread while it compiles the trajectory of a
+ * stream (see SerialCommunication::compileTrajectory) and while the GUI waits
+ * for its blocking calls: with a shared thread, starting a device would stall
+ * the flow control of those already streaming. The threads mostly sleep
+ * waiting for data and the number of devices is small (a few robots), so
+ * their cost is negligible.
+ *
+ * The startAll() function starts streaming on all connected devices with a
+ * shared start time: the handshake with each device is performed immediately
+ * and all devices begin playing when the startDelay expires. If the clock of a
+ * device is synchronized (see SerialCommunication::clockSync), it receives
+ * points in advance and waits for the start time by itself, otherwise the
+ * first point is sent at the start time. Synchronized devices also stay
+ * aligned over long sequences. playAllStored() does the same with the
+ * sequences stored in the devices. Each device plays the sequence set with
+ * setDeviceSequence() or the one passed to startAll() if no sequence was set.
+ * The flow control state of each device is available from its
+ * SerialCommunication object, the throughput of all devices together is
+ * updated once per second.
+ */
+class DeviceManager : public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(int count READ count NOTIFY countChanged)
+	Q_PROPERTY(int startDelay READ startDelay WRITE setStartDelay NOTIFY startDelayChanged)
+	Q_PROPERTY(int streamingDevices READ streamingDevices NOTIFY throughputChanged)
+	Q_PROPERTY(qint64 totalPointsSent READ totalPointsSent NOTIFY throughputChanged)
+	Q_PROPERTY(qint64 totalBytesSent READ totalBytesSent NOTIFY throughputChanged)
+	Q_PROPERTY(double pointsPerSecond READ pointsPerSecond NOTIFY throughputChanged)
+	Q_PROPERTY(double bytesPerSecond READ bytesPerSecond NOTIFY throughputChanged)
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * The first device is created here
+	 * \param parent the parent object
+	 */
+	explicit DeviceManager(QObject* parent = nullptr);
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	DeviceManager(const DeviceManager& other) = delete;
+
+	/**
+	 * \brief Move constructor is deleted
+	 *
+	 * \param other the object to move into this
+	 */
+	DeviceManager(DeviceManager&& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	DeviceManager& operator=(const DeviceManager& other) = delete;
+
+	/**
+	 * \brief Move operator is deleted
+	 */
+	DeviceManager& operator=(DeviceManager&& other) = delete;
+
+	/**
+	 * \brief Destructor
+	 */
+	virtual ~DeviceManager();
+
+	/**
+	 * \brief Returns the number of devices
+	 *
+	 * \return the number of devices
+	 */
+	int count() const
+	{
+		return int(m_devices.size());
+	}
+
+	/**
+	 * \brief Returns the object communicating with a device
+	 *
+	 * \param i the index of the device
+	 * \return the object communicating with the device or nullptr if i is
+	 *         not valid
+	 */
+	Q_INVOKABLE SerialCommunication* device(int i) const;
+
+	/**
+	 * \brief Returns the name of the file of the sequence played by a
+	 *        device
+	 *
+	 * \param i the index of the device
+	 * \return the name of the file, empty if the device plays the sequence
+	 *         passed to startAll()
+	 */
+	Q_INVOKABLE QString deviceSequence(int i) const;
+
+	/**
+	 * \brief Adds a device
+	 *
+	 * The new device uses the same baud rates and the same oneShotSequence
+	 * and clockSync flags and the trajectory compilation settings of the
+	 * first one. The serial port is not opened
+	 * \param portName the name of the serial port of the device
+	 * \return the index of the new device
+	 */
+	Q_INVOKABLE int addDevice(QString portName);
+
+	/**
+	 * \brief Removes a device
+	 *
+	 * The first device cannot be removed, nor devices that are streaming.
+	 * The serial port of the device is closed
+	 * \param i the index of the device
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool removeDevice(int i);
+
+	/**
+	 * \brief Sets the sequence played by a device
+	 *
+	 * \param i the index of the device
+	 * \param filename the sequence file to load. If empty the device plays
+	 *                 the sequence passed to startAll()
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool setDeviceSequence(int i, QString filename);
+
+	/**
+	 * \brief Sends a calibration profile to a device
+	 *
+	 * The device must be connected and not streaming (see
+	 * SerialCommunication::sendCalibration())
+	 * \param i the index of the device
+	 * \param filename the calibration file to load
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool sendDeviceCalibration(int i, QString filename);
+
+	/**
+	 * \brief Opens the serial ports of all devices
+	 *
+	 * \return false if any port could not be opened
+	 */
+	Q_INVOKABLE bool openAll();
+
+	/**
+	 * \brief Closes the serial ports of all devices
+	 *
+	 * \return false if any port could not be closed
+	 */
+	Q_INVOKABLE bool closeAll();
+
+	/**
+	 * \brief Starts streaming on all connected devices together
+	 *
+	 * If the stream cannot be started on a device, the streams already
+	 * started are stopped
+	 * \param sequence the sequence to play on devices for which no sequence
+	 *                 has been set
+	 * \param startFromCurrent if true the streaming starts from the current
+	 *                         point, otherwise starts from the beginning.
+	 *                         This is only used for sequence
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool startAll(Sequence* sequence, bool startFromCurrent = false);
+
+	/**
+	 * \brief Starts playing the stored sequence on all connected devices
+	 *        together
+	 *
+	 * If playback cannot be started on a device, the devices already
+	 * started are stopped
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool playAllStored();
+
+	/**
+	 * \brief Stops the current modality on all devices
+	 *
+	 * \return false if the modality could not be stopped on any device
+	 */
+	Q_INVOKABLE bool stopAll();
+
+	/**
+	 * \brief Returns the time between startAll() and the first point
+	 *
+	 * \return the start delay in milliseconds
+	 */
+	int startDelay() const
+	{
+		return m_startDelay;
+	}
+
+	/**
+	 * \brief Sets the time between startAll() and the first point
+	 *
+	 * This must be long enough for the handshake with the hardware
+	 * (including baud rate negotiation), devices that are not ready in time
+	 * start late
+	 * \param startDelay the start delay in milliseconds
+	 */
+	void setStartDelay(int startDelay);
+
+	/**
+	 * \brief Returns the number of devices that are streaming
+	 *
+	 * \return the number of devices that are streaming
+	 */
+	int streamingDevices() const
+	{
+		return m_streamingDevices;
+	}
+
+	/**
+	 * \brief Returns the points sent to all devices since their serial
+	 *        ports were opened
+	 *
+	 * \return the total number of points sent
+	 */
+	qint64 totalPointsSent() const
+	{
+		return m_totalPointsSent;
+	}
+
+	/**
+	 * \brief Returns the bytes sent to all devices since their serial
+	 *        ports were opened
+	 *
+	 * \return the total number of bytes sent
+	 */
+	qint64 totalBytesSent() const
+	{
+		return m_totalBytesSent;
+	}
+
+	/**
+	 * \brief Returns the points sent to all devices per second
+	 *
+	 * \return the points per second in the last second
+	 */
+	double pointsPerSecond() const
+	{
+		return m_pointsPerSecond;
+	}
+
+	/**
+	 * \brief Returns the bytes sent to all devices per second
+	 *
+	 * \return the bytes per second in the last second
+	 */
+	double bytesPerSecond() const
+	{
+		return m_bytesPerSecond;
+	}
+
+signals:
+	/**
+	 * \brief The signal emitted when devices are added or removed
+	 */
+	void countChanged();
+
+	/**
+	 * \brief The signal emitted when the start delay changes
+	 */
+	void startDelayChanged();
+
+	/**
+	 * \brief The signal emitted when the throughput is updated
+	 */
+	void throughputChanged();
+
+private slots:
+	/**
+	 * \brief Computes the throughput of all devices
+	 *
+	 * This is called once per second
+	 */
+	void updateThroughput();
+
+private:
+	/**
+	 * \brief Starts all connected devices with a shared start time
+	 *
+	 * \param start the function starting a device, it takes the data of
+	 *              the device and the start time
+	 * \return false in case of error
+	 */
+	template <class StartFunction>
+	bool startConnected(StartFunction start);
+
+	/**
+	 * \brief The structure with the data of a device
+	 */
+	struct Device
+	{
+		/**
+		 * \brief The object communicating with the device
+		 */
+		std::unique_ptr<SerialCommunication> communication;
+
+		/**
+		 * \brief The sequence to play, nullptr to play the one passed
+		 *        to startAll()
+		 */
+		std::unique_ptr<Sequence> sequence;
+
+		/**
+		 * \brief The file of the sequence to play
+		 */
+		QString filename;
+
+		/**
+		 * \brief The points sent when the throughput was last updated
+		 */
+		qint64 lastPointsSent;
+
+		/**
+		 * \brief The bytes sent when the throughput was last updated
+		 */
+		qint64 lastBytesSent;
+	};
+
+	/**
+	 * \brief Returns true if i is the index of a device
+	 *
+	 * \param i the index to check
+	 * \return true if i is valid
+	 */
+	bool isValidDevice(int i) const
+	{
+		return (i >= 0) && (i < count());
+	}
+
+	/**
+	 * \brief The devices
+	 */
+	std::vector<Device> m_devices;
+
+	/**
+	 * \brief The time between startAll() and the first point in
+	 *        milliseconds
+	 */
+	int m_startDelay;
+
+	/**
+	 * \brief The timer to update the throughput
+	 */
+	QTimer m_throughputTimer;
+
+	/**
+	 * \brief The time since the throughput was last updated
+	 */
+	QElapsedTimer m_throughputClock;
+
+	/**
+	 * \brief The number of devices that are streaming
+	 */
+	int m_streamingDevices;
+
+	/**
+	 * \brief The points sent to all devices
+	 */
+	qint64 m_totalPointsSent;
+
+	/**
+	 * \brief The bytes sent to all devices
+	 */
+	qint64 m_totalBytesSent;
+
+	/**
+	 * \brief The points sent to all devices per second
+	 */
+	double m_pointsPerSecond;
+
+	/**
+	 * \brief The bytes sent to all devices per second
+	 */
+	double m_bytesPerSecond;
+};
+
+#endif // DEVICEMANAGER_H
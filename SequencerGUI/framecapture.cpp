@@ -0,0 +1,70 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "framecapture.h"
+#include <QtEndian>
+
+FrameCapture::FrameCapture()
+	: m_file()
+	, m_timer()
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	close();
+}
+
+bool FrameCapture::open(QString filename)
+{
+	close();
+
+	m_file.setFileName(filename);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+
+	// Writing the header
+	m_file.write("SQCAP\x01", 6);
+
+	m_timer.start();
+
+	return true;
+}
+
+void FrameCapture::close()
+{
+	if (m_file.isOpen()) {
+		m_file.close();
+	}
+}
+
+void FrameCapture::writeRecord(char direction, const QByteArray& data)
+{
+	char header[13];
+
+	header[0] = direction;
+	qToBigEndian<quint64>(m_timer.nsecsElapsed() / 1000, reinterpret_cast<uchar*>(header + 1));
+	qToBigEndian<quint32>(data.size(), reinterpret_cast<uchar*>(header + 9));
+
+	m_file.write(header, sizeof(header));
+	m_file.write(data);
+}
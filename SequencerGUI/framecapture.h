@@ -0,0 +1,150 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+/**
+ * \brief The class writing raw serial traffic to a binary file
+ *
+ * This is used to analyze offline the data exchanged with the hardware. The
+ * file starts with the characters "SQCAP" followed by the format version (1
+ * byte, currently 1). Then there is one record for each chunk of data sent or
+ * received: direction (1 byte, 'T' for data sent to the hardware, 'R' for data
+ * received from the hardware) - timestamp (8 bytes, microseconds since the
+ * capture started) - length (4 bytes) - data (length bytes). All numbers are
+ * stored with the most significant byte first. Records are written as they
+ * arrive, no conversion to text is performed. When the capture is not open,
+ * captureSent() and captureReceived() do nothing.
+ */
+class FrameCapture
+{
+public:
+	/**
+	 * \brief Constructor
+	 */
+	FrameCapture();
+
+	/**
+	 * \brief Destructor
+	 *
+	 * This closes the capture file
+	 */
+	~FrameCapture();
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	FrameCapture(const FrameCapture& other) = delete;
+
+	/**
+	 * \brief Move constructor is deleted
+	 *
+	 * \param other the object to move into this
+	 */
+	FrameCapture(FrameCapture&& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	FrameCapture& operator=(const FrameCapture& other) = delete;
+
+	/**
+	 * \brief Move operator is deleted
+	 */
+	FrameCapture& operator=(FrameCapture&& other) = delete;
+
+	/**
+	 * \brief Opens the capture file
+	 *
+	 * If a capture was already open, it is closed. The file is overwritten
+	 * \param filename the name of the file to write
+	 * \return false in case of error
+	 */
+	bool open(QString filename);
+
+	/**
+	 * \brief Closes the capture file
+	 */
+	void close();
+
+	/**
+	 * \brief Returns true if the capture file is open
+	 *
+	 * \return true if the capture file is open
+	 */
+	bool isOpen() const
+	{
+		return m_file.isOpen();
+	}
+
+	/**
+	 * \brief Writes a record for data sent to the hardware
+	 *
+	 * \param data the data that was sent
+	 */
+	void captureSent(const QByteArray& data)
+	{
+		if (isOpen()) {
+			writeRecord('T', data);
+		}
+	}
+
+	/**
+	 * \brief Writes a record for data received from the hardware
+	 *
+	 * \param data the data that was received
+	 */
+	void captureReceived(const QByteArray& data)
+	{
+		if (isOpen()) {
+			writeRecord('R', data);
+		}
+	}
+
+private:
+	/**
+	 * \brief Writes a record
+	 *
+	 * \param direction the direction of data
+	 * \param data the data
+	 */
+	void writeRecord(char direction, const QByteArray& data);
+
+	/**
+	 * \brief The capture file
+	 */
+	QFile m_file;
+
+	/**
+	 * \brief The timer used for timestamps
+	 */
+	QElapsedTimer m_timer;
+};
+
+#endif // FRAMECAPTURE_H
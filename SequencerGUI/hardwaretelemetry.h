@@ -0,0 +1,134 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef HARDWARETELEMETRY_H
+#define HARDWARETELEMETRY_H
+
+#include <QMetaType>
+
+/**
+ * \brief The counters received in the telemetry packet of the hardware
+ *
+ * Loop iterations and step() times refer to the period since the previous
+ * telemetry packet, the other counters are totals since the hardware was
+ * started (they saturate at 65535). All values are -1 if no telemetry packet
+ * has been received
+ */
+struct HardwareTelemetry
+{
+	/**
+	 * \brief Constructor
+	 *
+	 * All values are set to -1
+	 */
+	HardwareTelemetry()
+		: loopsPerSecond(-1)
+		, maxStepTime(-1)
+		, meanStepTime(-1)
+		, bufferedPoints(-1)
+		, underruns(-1)
+		, receiveOverruns(-1)
+		, droppedPoints(-1)
+		, receiveBufferPeak(-1)
+	{
+	}
+
+	/**
+	 * \brief Returns true if all values are equal to the ones of other
+	 *
+	 * \param other the object to compare
+	 * \return true if all values are equal
+	 */
+	bool operator==(const HardwareTelemetry& other) const
+	{
+		return (loopsPerSecond == other.loopsPerSecond) &&
+		       (maxStepTime == other.maxStepTime) &&
+		       (meanStepTime == other.meanStepTime) &&
+		       (bufferedPoints == other.bufferedPoints) &&
+		       (underruns == other.underruns) &&
+		       (receiveOverruns == other.receiveOverruns) &&
+		       (droppedPoints == other.droppedPoints) &&
+		       (receiveBufferPeak == other.receiveBufferPeak);
+	}
+
+	/**
+	 * \brief Returns true if any value is different from the ones of other
+	 *
+	 * \param other the object to compare
+	 * \return true if any value is different
+	 */
+	bool operator!=(const HardwareTelemetry& other) const
+	{
+		return !(*this == other);
+	}
+
+	/**
+	 * \brief The number of iterations of the main loop per second
+	 */
+	int loopsPerSecond;
+
+	/**
+	 * \brief The maximum time taken to move servos in microseconds
+	 */
+	int maxStepTime;
+
+	/**
+	 * \brief The mean time taken to move servos in microseconds
+	 */
+	int meanStepTime;
+
+	/**
+	 * \brief The number of points in the buffer of the hardware
+	 */
+	int bufferedPoints;
+
+	/**
+	 * \brief How many times the buffer of the hardware became empty while
+	 *        streaming
+	 */
+	int underruns;
+
+	/**
+	 * \brief How many times the receive buffer of the serial line of the
+	 *        hardware was full (bytes may have been lost)
+	 */
+	int receiveOverruns;
+
+	/**
+	 * \brief How many points the hardware dropped because its buffer was
+	 *        full
+	 */
+	int droppedPoints;
+
+	/**
+	 * \brief The maximum number of bytes in the receive buffer of the serial
+	 *        line of the hardware during the last second
+	 *
+	 * The buffer holds 63 bytes, values close to it mean that overruns are
+	 * about to happen
+	 */
+	int receiveBufferPeak;
+};
+
+// Telemetry is passed between threads with queued connections
+Q_DECLARE_METATYPE(HardwareTelemetry)
+
+#endif // HARDWARETELEMETRY_H
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+/**
+ * \file logging.h
+ *
+ * Logging categories. Debug messages of these categories are disabled by
+ * default because they are emitted in the hot path of serial communication.
+ * They can be enabled with the QT_LOGGING_RULES environment variable, e.g.
+ * QT_LOGGING_RULES="sequencer.serial.*.debug=true"
+ */
+
+/**
+ * \brief The category of events of the serial protocol (packets received,
+ *        flow control, ...)
+ */
+Q_DECLARE_LOGGING_CATEGORY(serialProtocol)
+
+/**
+ * \brief The category of raw data sent and received on the serial port
+ */
+Q_DECLARE_LOGGING_CATEGORY(serialData)
+
+/**
+ * \brief Sets the default logging rules of the application
+ *
+ * This disables debug messages of our categories. Call this at startup,
+ * rules in QT_LOGGING_RULES take precedence over these
+ */
+void setDefaultLoggingRules();
+
+#endif // LOGGING_H
@@ -26,15 +26,25 @@
 #include "sequencer.h"
 #include "sequence.h"
 #include "serialcommunication.h"
+#include "devicemanager.h"
+#include "logging.h"
 
 int main(int argc, char *argv[])
 {
 	QApplication app(argc, argv);
 
-	// Registering the Sequence and SerialCommunication types to QML. It is not possible to create
-	// these types directly from QML (but we don't need to)
+	// Tracing of serial communication is disabled unless explicitly requested
+	setDefaultLoggingRules();
+
+	// Registering the Sequence, QUndoStack, SequenceModel and SerialCommunication types to QML. It
+	// is not possible to create these types directly from QML (but we don't need to)
 	qmlRegisterType<Sequence>();
+	qmlRegisterType<QUndoStack>();
+	qmlRegisterType<SequenceModel>();
+	qmlRegisterType<MotionAnalysis>();
+	qmlRegisterType<PlaybackPreview>();
 	qmlRegisterType<SerialCommunication>();
+	qmlRegisterType<DeviceManager>();
 
 	// Creating the main class of the application
 	Sequencer sequencer;
@@ -103,6 +103,13 @@ ApplicationWindow {
 
 				onTriggered: saveSequenceDialog.open();
 			}
+			MenuSeparator {}
+			MenuItem {
+				text: qsTr("Load &calibration...")
+
+				onTriggered: calibrationDialog.open();
+			}
+			MenuSeparator {}
 			MenuItem {
 				text: qsTr("E&xit")
 				onTriggered: mainWindow.close();
@@ -110,10 +117,33 @@ ApplicationWindow {
 		}
 		Menu {
 			title: qsTr("&Edit")
+			MenuItem {
+				text: qsTr("&Undo")
+				shortcut: StandardKey.Undo
+				enabled: sequence.undoStack.canUndo
+				onTriggered: sequence.undoStack.undo();
+			}
+			MenuItem {
+				text: qsTr("&Redo")
+				shortcut: StandardKey.Redo
+				enabled: sequence.undoStack.canRedo
+				onTriggered: sequence.undoStack.redo();
+			}
+			MenuSeparator {}
+			MenuItem {
+				text: qsTr("&Slow down too fast steps") + " (" + sequence.motion.violations + ")"
+				enabled: sequence.motion.violations > 0
+				onTriggered: sequence.motion.stretchViolations();
+			}
+			MenuSeparator {}
 			MenuItem {
 				text: qsTr("O&ptions")
 				onTriggered: optionsDialog.show(qsTr("Option action triggered"));
 			}
+			MenuItem {
+				text: qsTr("&Devices")
+				onTriggered: devicesDialog.show();
+			}
 		}
 	}
 
@@ -136,6 +166,11 @@ ApplicationWindow {
 				id: sequenceControl
 				Layout.minimumHeight: implicitHeight
 			}
+
+			Timeline {
+				id: timeline
+				Layout.minimumHeight: implicitHeight
+			}
 		}
 
 		ServoControl {
@@ -182,7 +217,7 @@ ApplicationWindow {
 	FileDialog {
 		id: openSequenceDialog
 		title: "Open..."
-		nameFilters: ["Sequence files (*.seq)", "All files (*)"]
+		nameFilters: ["Sequence files (*.seq *.seqb)", "All files (*)"]
 		selectExisting: true
 
 		onAccepted: {
@@ -194,7 +229,7 @@ ApplicationWindow {
 	FileDialog {
 		id: saveSequenceDialog
 		title: "Save As..."
-		nameFilters: ["Sequence files (*.seq)"]
+		nameFilters: ["Sequence files (*.seq)", "Binary sequence files (*.seqb)"]
 		selectExisting: false
 
 		onAccepted: {
@@ -203,10 +238,24 @@ ApplicationWindow {
 		}
 	}
 
+	// The calibration profile is used for new sequences and sent to the hardware
+	FileDialog {
+		id: calibrationDialog
+		title: "Load calibration..."
+		nameFilters: ["Calibration files (*.json)", "All files (*)"]
+		selectExisting: true
+
+		onAccepted: loadCalibration(calibrationDialog.fileUrl);
+	}
+
 	OptionsDialog {
 		id: optionsDialog
 	}
 
+	DevicesDialog {
+		id: devicesDialog
+	}
+
 	onClosing: {
 		if (!internal.forceClose && sequence.isModified) {
 			close.accepted = false;
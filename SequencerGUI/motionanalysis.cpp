@@ -0,0 +1,456 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "motionanalysis.h"
+#include "sequence.h"
+#include <algorithm>
+#include <cmath>
+#include <QDebug>
+#include <limits>
+
+namespace {
+	/**
+	 * \brief The default maximum velocity of channels in units per second
+	 *
+	 * Positions span about 180 degrees with 255 units, this is about the
+	 * speed of common hobby servos (60 degrees in 0.13 seconds)
+	 */
+	const double defaultMaxVelocity = 800.0;
+
+	/**
+	 * \brief The default maximum acceleration of channels in units per
+	 *        second squared
+	 *
+	 * This reaches the default maximum velocity in 50 milliseconds
+	 */
+	const double defaultMaxAcceleration = 16000.0;
+
+	/**
+	 * \brief The maximum number of passes of stretchViolations()
+	 */
+	const int maxStretchPasses = 8;
+
+	/**
+	 * \brief Returns the reciprocal of a limit
+	 *
+	 * \param limit the limit
+	 * \return the reciprocal of the limit, 0 (i.e. no limit) if the limit is
+	 *         not positive
+	 */
+	double scaleForLimit(double limit)
+	{
+		return (limit > 0.0) ? (1.0 / limit) : 0.0;
+	}
+}
+
+MotionAnalysis::MotionAnalysis(Sequence* sequence)
+	: QObject(sequence)
+	, m_sequence(sequence)
+	, m_velocityLimits(m_sequence->pointDim(), defaultMaxVelocity)
+	, m_accelerationLimits(m_sequence->pointDim(), defaultMaxAcceleration)
+	, m_velocityScales(m_sequence->pointDim(), scaleForLimit(defaultMaxVelocity))
+	, m_accelerationScales(m_sequence->pointDim(), scaleForLimit(defaultMaxAcceleration))
+	, m_results()
+	, m_firstInvalid(-1)
+	, m_lastInvalid(-1)
+	, m_firstComputed(-1)
+	, m_lastComputed(-1)
+	, m_violations(0)
+	, m_notifiedViolations(0)
+{
+	connect(m_sequence, &Sequence::pointsValuesChanged, this, &MotionAnalysis::pointsValuesChanged);
+	connect(m_sequence->model(), &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) { pointsInserted(first, last); });
+	connect(m_sequence->model(), &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int last) { pointsRemoved(first, last); });
+}
+
+double MotionAnalysis::maxVelocity() const
+{
+	return m_velocityLimits.isEmpty() ? defaultMaxVelocity : m_velocityLimits[0];
+}
+
+void MotionAnalysis::setMaxVelocity(double velocity)
+{
+	if (std::all_of(m_velocityLimits.constBegin(), m_velocityLimits.constEnd(), [velocity](double v) { return v == velocity; })) {
+		return;
+	}
+
+	m_velocityLimits.fill(velocity);
+	m_velocityScales.fill(scaleForLimit(velocity));
+
+	invalidateAll();
+	refreshAndNotify();
+
+	emit limitsChanged();
+}
+
+double MotionAnalysis::maxAcceleration() const
+{
+	return m_accelerationLimits.isEmpty() ? defaultMaxAcceleration : m_accelerationLimits[0];
+}
+
+void MotionAnalysis::setMaxAcceleration(double acceleration)
+{
+	if (std::all_of(m_accelerationLimits.constBegin(), m_accelerationLimits.constEnd(), [acceleration](double a) { return a == acceleration; })) {
+		return;
+	}
+
+	m_accelerationLimits.fill(acceleration);
+	m_accelerationScales.fill(scaleForLimit(acceleration));
+
+	invalidateAll();
+	refreshAndNotify();
+
+	emit limitsChanged();
+}
+
+double MotionAnalysis::velocityLimit(int c) const
+{
+	return m_velocityLimits.value(c, 0.0);
+}
+
+double MotionAnalysis::accelerationLimit(int c) const
+{
+	return m_accelerationLimits.value(c, 0.0);
+}
+
+void MotionAnalysis::setChannelLimits(int c, double velocity, double acceleration)
+{
+	if ((c < 0) || (c >= m_velocityLimits.size())) {
+		qDebug() << "MotionAnalysis error: invalid channel" << c;
+		return;
+	}
+
+	if ((m_velocityLimits[c] == velocity) && (m_accelerationLimits[c] == acceleration)) {
+		return;
+	}
+
+	m_velocityLimits[c] = velocity;
+	m_accelerationLimits[c] = acceleration;
+	m_velocityScales[c] = scaleForLimit(velocity);
+	m_accelerationScales[c] = scaleForLimit(acceleration);
+
+	invalidateAll();
+	refreshAndNotify();
+
+	emit limitsChanged();
+}
+
+int MotionAnalysis::violations() const
+{
+	refresh();
+
+	// Changes from the value that has been read must be notified
+	m_notifiedViolations = m_violations;
+
+	return m_violations;
+}
+
+double MotionAnalysis::velocityRatio(int pos) const
+{
+	return result(pos).velocity;
+}
+
+double MotionAnalysis::accelerationRatio(int pos) const
+{
+	return result(pos).acceleration;
+}
+
+bool MotionAnalysis::isViolating(int pos) const
+{
+	return result(pos).isViolating();
+}
+
+int MotionAnalysis::requiredTimeToTarget(int pos) const
+{
+	if ((pos <= 0) || (pos >= m_sequence->numPoints())) {
+		return 0;
+	}
+
+	const int current = m_sequence->pointTimeToTarget(pos);
+	if (!result(pos).isViolating()) {
+		return current;
+	}
+
+	// Doubling the time until the point is within the limits, then bisecting. The velocity
+	// always decreases with time, the acceleration eventually does, so the time we find is
+	// within the limits but it could be not the shortest one
+	const int maxTimeToTarget = m_sequence->maxPointTimeToTarget();
+	int low = current;
+	int high = std::max(1, current);
+	while (compute(pos, high).isViolating()) {
+		if (high >= maxTimeToTarget) {
+			return maxTimeToTarget;
+		}
+
+		low = high;
+		high = std::min(maxTimeToTarget, 2 * high);
+	}
+
+	while ((high - low) > 1) {
+		const int middle = low + (high - low) / 2;
+		if (compute(pos, middle).isViolating()) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	return high;
+}
+
+int MotionAnalysis::stretchViolations()
+{
+	refresh();
+
+	const int numPoints = m_sequence->numPoints();
+	QVector<bool> stretched(numPoints, false);
+
+	// Stretching a point changes the acceleration at the ends of its neighbours, checking
+	// again a few times
+	m_sequence->beginUpdate();
+	for (int pass = 0; pass < maxStretchPasses; ++pass) {
+		bool changed = false;
+		for (int pos = 1; pos < numPoints; ++pos) {
+			if (!m_results[pos].isViolating()) {
+				continue;
+			}
+
+			const int timeToTarget = requiredTimeToTarget(pos);
+			if (timeToTarget == m_sequence->pointTimeToTarget(pos)) {
+				continue;
+			}
+
+			// The notification of the change is delayed, here we need results immediately
+			m_sequence->setTimeToTarget(pos, timeToTarget);
+			invalidate(pos, pos);
+			refresh();
+
+			stretched[pos] = true;
+			changed = true;
+		}
+
+		if (!changed) {
+			break;
+		}
+	}
+	m_sequence->endUpdate();
+
+	refreshAndNotify();
+
+	return stretched.count(true);
+}
+
+void MotionAnalysis::pointsValuesChanged(int first, int last)
+{
+	invalidate(first, last);
+	refreshAndNotify();
+}
+
+void MotionAnalysis::pointsInserted(int first, int last)
+{
+	// Results of points after the inserted ones move with them
+	if (m_results.size() == (m_sequence->numPoints() - (last - first + 1))) {
+		m_results.insert(first, last - first + 1, Result{0.0, 0.0});
+	}
+
+	invalidate(first, last);
+	refreshAndNotify();
+}
+
+void MotionAnalysis::pointsRemoved(int first, int last)
+{
+	if (m_results.size() == (m_sequence->numPoints() + (last - first + 1))) {
+		for (int pos = first; pos <= last; ++pos) {
+			if (m_results[pos].isViolating()) {
+				--m_violations;
+			}
+		}
+		m_results.remove(first, last - first + 1);
+	}
+
+	// The point now at first moves from a different position, this changes the point
+	// before it (the acceleration at its end), the point itself and the next one (the
+	// acceleration at its start)
+	markInvalid(first - 1, first + 1);
+	refreshAndNotify();
+}
+
+void MotionAnalysis::invalidate(int first, int last)
+{
+	// The result of point k depends on points from k - 2 to k + 1 (see compute())
+	markInvalid(first - 1, last + 2);
+}
+
+void MotionAnalysis::markInvalid(int first, int last) const
+{
+	first = std::max(first, 0);
+	last = std::min(last, m_results.size() - 1);
+	if (first > last) {
+		return;
+	}
+
+	if (m_firstInvalid == -1) {
+		m_firstInvalid = first;
+		m_lastInvalid = last;
+	} else {
+		m_firstInvalid = std::min(m_firstInvalid, first);
+		m_lastInvalid = std::max(m_lastInvalid, last);
+	}
+}
+
+void MotionAnalysis::invalidateAll() const
+{
+	m_results.fill(Result{0.0, 0.0}, m_sequence->numPoints());
+	m_violations = 0;
+	m_firstInvalid = -1;
+
+	markInvalid(0, m_results.size() - 1);
+}
+
+void MotionAnalysis::refresh() const
+{
+	if (m_results.size() != m_sequence->numPoints()) {
+		invalidateAll();
+	}
+
+	if (m_firstInvalid == -1) {
+		return;
+	}
+
+	for (int pos = m_firstInvalid; pos <= m_lastInvalid; ++pos) {
+		const bool wasViolating = m_results[pos].isViolating();
+		m_results[pos] = compute(pos, m_sequence->pointTimeToTarget(pos));
+		m_violations += int(m_results[pos].isViolating()) - int(wasViolating);
+	}
+
+	if (m_firstComputed == -1) {
+		m_firstComputed = m_firstInvalid;
+		m_lastComputed = m_lastInvalid;
+	} else {
+		m_firstComputed = std::min(m_firstComputed, m_firstInvalid);
+		m_lastComputed = std::max(m_lastComputed, m_lastInvalid);
+	}
+	m_firstInvalid = -1;
+}
+
+void MotionAnalysis::refreshAndNotify()
+{
+	refresh();
+
+	if (m_firstComputed != -1) {
+		const int first = m_firstComputed;
+		const int last = std::min(m_lastComputed, m_results.size() - 1);
+		m_firstComputed = -1;
+
+		if (first <= last) {
+			emit resultsChanged(first, last);
+		}
+	}
+
+	if (m_violations != m_notifiedViolations) {
+		m_notifiedViolations = m_violations;
+
+		emit violationsChanged();
+	}
+}
+
+MotionAnalysis::Result MotionAnalysis::compute(int pos, int timeToTarget) const
+{
+	Result r{0.0, 0.0};
+
+	// The first point moves from an unknown position
+	if (pos == 0) {
+		return r;
+	}
+
+	const PointStorage<SequenceValue>& points = m_sequence->m_sequence;
+	const int dim = m_sequence->pointDim();
+	const SequenceValue* const cur = points.values(pos);
+	const SequenceValue* const from = points.values(pos - 1);
+
+	// Moving in no time is only possible if no channel moves
+	if (timeToTarget <= 0) {
+		if (!std::equal(cur, cur + dim, from)) {
+			r.velocity = std::numeric_limits<double>::infinity();
+			r.acceleration = std::numeric_limits<double>::infinity();
+		}
+
+		return r;
+	}
+
+	// The adjacent intervals. If servos are still there, we use the same point twice and a
+	// zero reciprocal of time so that the velocity is 0 without branches in the loop below
+	const double time = timeToTarget / 1000.0;
+	const SequenceValue* before = from;
+	double beforeTime = 0.0;
+	double beforeScale = 0.0;
+	if (points.duration(pos - 1) > 0) {
+		beforeTime = points.duration(pos - 1) / 1000.0;
+	} else if ((pos >= 2) && (points.timeToTarget(pos - 1) > 0)) {
+		before = points.values(pos - 2);
+		beforeTime = points.timeToTarget(pos - 1) / 1000.0;
+		beforeScale = 1.0 / beforeTime;
+	}
+
+	const SequenceValue* after = cur;
+	double afterTime = 0.0;
+	double afterScale = 0.0;
+	if (points.duration(pos) > 0) {
+		afterTime = points.duration(pos) / 1000.0;
+	} else if (((pos + 1) < points.size()) && (points.timeToTarget(pos + 1) > 0)) {
+		after = points.values(pos + 1);
+		afterTime = points.timeToTarget(pos + 1) / 1000.0;
+		afterScale = 1.0 / afterTime;
+	}
+
+	const double scale = 1.0 / time;
+	const double startScale = 2.0 / (time + beforeTime);
+	const double endScale = 2.0 / (time + afterTime);
+	const double* const velocityScales = m_velocityScales.constData();
+	const double* const accelerationScales = m_accelerationScales.constData();
+	double velocity = 0.0;
+	double acceleration = 0.0;
+	for (int c = 0; c < dim; ++c) {
+		const double v = (double(cur[c]) - double(from[c])) * scale;
+		const double vBefore = (double(from[c]) - double(before[c])) * beforeScale;
+		const double vAfter = (double(after[c]) - double(cur[c])) * afterScale;
+		const double a = std::max(std::fabs(v - vBefore) * startScale, std::fabs(vAfter - v) * endScale);
+
+		velocity = std::max(velocity, std::fabs(v) * velocityScales[c]);
+		acceleration = std::max(acceleration, a * accelerationScales[c]);
+	}
+	r.velocity = velocity;
+	r.acceleration = acceleration;
+
+	return r;
+}
+
+const MotionAnalysis::Result& MotionAnalysis::result(int pos) const
+{
+	static const Result none{0.0, 0.0};
+
+	refresh();
+	if ((pos < 0) || (pos >= m_results.size())) {
+		return none;
+	}
+
+	return m_results[pos];
+}
@@ -0,0 +1,389 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef MOTIONANALYSIS_H
+#define MOTIONANALYSIS_H
+
+#include <QObject>
+#include <QVector>
+
+class Sequence;
+
+/**
+ * \brief The check of the velocity and acceleration of servos against the
+ *        limits of the hardware
+ *
+ * Sequence only clamps each value of a point independently, so nothing stops
+ * a point that moves servos faster than they can: servos then lag behind and
+ * the timing of the sequence collapses. This class computes, for each point,
+ * the velocity each channel needs to reach the point in its time to target and
+ * the acceleration needed at both ends of the motion, and compares them with
+ * the limits of channels (in units of positions per second and per second
+ * squared). The velocity of the motion towards point k is the distance from
+ * point k - 1 divided by the time to target; the acceleration at an end of the
+ * motion is the change of velocity with respect to the adjacent interval (0 if
+ * servos are still, i.e. the adjacent point has a duration, or at the ends of
+ * the sequence) divided by the mean length of the two intervals. The first
+ * point starts from an unknown position, so it is never checked.
+ * Results are cached per point: the first query computes all of them, then
+ * only the points whose result depends on a changed point (the changed points,
+ * one point before and two after) are computed again. Channels are processed
+ * in the inner loop over the contiguous positions of points, with the
+ * reciprocals of limits precomputed, so the loop has no branches or divisions
+ * and can be vectorized by the compiler. Offending points can be fixed with
+ * stretchViolations(), which lengthens their time to target. The object is
+ * created and owned by the sequence, get it with Sequence::motion()
+ */
+class MotionAnalysis : public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(double maxVelocity READ maxVelocity WRITE setMaxVelocity NOTIFY limitsChanged)
+	Q_PROPERTY(double maxAcceleration READ maxAcceleration WRITE setMaxAcceleration NOTIFY limitsChanged)
+	Q_PROPERTY(int violations READ violations NOTIFY violationsChanged)
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param sequence the sequence to check. It is also the parent of this
+	 *        object
+	 */
+	explicit MotionAnalysis(Sequence* sequence);
+
+	/**
+	 * \brief Returns the maximum velocity of the first channel
+	 *
+	 * \return the maximum velocity of the first channel in units per second
+	 */
+	double maxVelocity() const;
+
+	/**
+	 * \brief Sets the maximum velocity of all channels
+	 *
+	 * \param velocity the maximum velocity in units per second
+	 */
+	void setMaxVelocity(double velocity);
+
+	/**
+	 * \brief Returns the maximum acceleration of the first channel
+	 *
+	 * \return the maximum acceleration of the first channel in units per
+	 *         second squared
+	 */
+	double maxAcceleration() const;
+
+	/**
+	 * \brief Sets the maximum acceleration of all channels
+	 *
+	 * \param acceleration the maximum acceleration in units per second
+	 *        squared
+	 */
+	void setMaxAcceleration(double acceleration);
+
+	/**
+	 * \brief Returns the maximum velocity of a channel
+	 *
+	 * \param c the channel
+	 * \return the maximum velocity in units per second
+	 */
+	Q_INVOKABLE double velocityLimit(int c) const;
+
+	/**
+	 * \brief Returns the maximum acceleration of a channel
+	 *
+	 * \param c the channel
+	 * \return the maximum acceleration in units per second squared
+	 */
+	Q_INVOKABLE double accelerationLimit(int c) const;
+
+	/**
+	 * \brief Sets the limits of a channel
+	 *
+	 * \param c the channel
+	 * \param velocity the maximum velocity in units per second
+	 * \param acceleration the maximum acceleration in units per second
+	 *        squared
+	 */
+	Q_INVOKABLE void setChannelLimits(int c, double velocity, double acceleration);
+
+	/**
+	 * \brief Returns the number of points exceeding the limits
+	 *
+	 * \return the number of points exceeding the limits
+	 */
+	int violations() const;
+
+	/**
+	 * \brief Returns the ratio between the velocity needed by a point and
+	 *        the limit
+	 *
+	 * \param pos the position of the point
+	 * \return the maximum over channels of the ratio between the velocity
+	 *         and the limit. Values greater than 1 exceed the limits, the
+	 *         value is infinite if the point needs to move in no time
+	 */
+	Q_INVOKABLE double velocityRatio(int pos) const;
+
+	/**
+	 * \brief Returns the ratio between the acceleration needed by a point
+	 *        and the limit
+	 *
+	 * \param pos the position of the point
+	 * \return the maximum over channels of the ratio between the
+	 *         acceleration and the limit. Values greater than 1 exceed the
+	 *         limits
+	 */
+	Q_INVOKABLE double accelerationRatio(int pos) const;
+
+	/**
+	 * \brief Returns true if a point exceeds the limits
+	 *
+	 * \param pos the position of the point
+	 * \return true if a point exceeds the velocity or the acceleration
+	 *         limits
+	 */
+	Q_INVOKABLE bool isViolating(int pos) const;
+
+	/**
+	 * \brief Returns the shortest time to target a point needs to be within
+	 *        the limits
+	 *
+	 * Neighbour points are assumed not to change. This is never lower than
+	 * the current time to target and it is clamped to the maximum time to
+	 * target of the sequence
+	 * \param pos the position of the point
+	 * \return the time to target in milliseconds
+	 */
+	Q_INVOKABLE int requiredTimeToTarget(int pos) const;
+
+	/**
+	 * \brief Lengthens the time to target of all points exceeding the
+	 *        limits
+	 *
+	 * Stretching a point changes the acceleration of its neighbours, so
+	 * points are checked again a few times. The changes are undone as a
+	 * single step
+	 * \return the number of points that were changed
+	 */
+	Q_INVOKABLE int stretchViolations();
+
+signals:
+	/**
+	 * \brief The signal emitted when the limits change
+	 */
+	void limitsChanged();
+
+	/**
+	 * \brief The signal emitted when the number of points exceeding the
+	 *        limits changes
+	 */
+	void violationsChanged();
+
+	/**
+	 * \brief The signal emitted when the results of a range of points
+	 *        change
+	 *
+	 * \param first the position of the first point whose results changed
+	 * \param last the position of the last point whose results changed
+	 */
+	void resultsChanged(int first, int last);
+
+private slots:
+	/**
+	 * \brief The slot called when the values of a range of points change
+	 *
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void pointsValuesChanged(int first, int last);
+
+	/**
+	 * \brief The slot called when points are inserted in the sequence
+	 *
+	 * \param first the position of the first inserted point
+	 * \param last the position of the last inserted point
+	 */
+	void pointsInserted(int first, int last);
+
+	/**
+	 * \brief The slot called when points are removed from the sequence
+	 *
+	 * \param first the position of the first removed point
+	 * \param last the position of the last removed point
+	 */
+	void pointsRemoved(int first, int last);
+
+private:
+	/**
+	 * \brief The result of the check of a point
+	 */
+	struct Result
+	{
+		/**
+		 * \brief The ratio between the velocity and the limit
+		 */
+		double velocity;
+
+		/**
+		 * \brief The ratio between the acceleration and the limit
+		 */
+		double acceleration;
+
+		/**
+		 * \brief Returns true if the point exceeds the limits
+		 *
+		 * \return true if the point exceeds the limits
+		 */
+		bool isViolating() const
+		{
+			return (velocity > 1.0) || (acceleration > 1.0);
+		}
+	};
+
+	/**
+	 * \brief Marks the results of the points depending on a range of
+	 *        points as to be computed again
+	 *
+	 * \param first the position of the first changed point
+	 * \param last the position of the last changed point
+	 */
+	void invalidate(int first, int last);
+
+	/**
+	 * \brief Marks a range of results as to be computed again
+	 *
+	 * The range is clamped to the valid positions
+	 * \param first the position of the first result
+	 * \param last the position of the last result
+	 */
+	void markInvalid(int first, int last) const;
+
+	/**
+	 * \brief Marks all results as to be computed again
+	 */
+	void invalidateAll() const;
+
+	/**
+	 * \brief Computes the results that are not up to date
+	 *
+	 * This does not emit signals, it is called by all functions returning
+	 * results. If the number of results differs from the number of points
+	 * (points were added without notifications, e.g. when loading a file)
+	 * all results are computed
+	 */
+	void refresh() const;
+
+	/**
+	 * \brief Computes the results that are not up to date and emits
+	 *        signals
+	 *
+	 * This emits resultsChanged() for the computed results and
+	 * violationsChanged() if the number of violations changed
+	 */
+	void refreshAndNotify();
+
+	/**
+	 * \brief Computes the result of a point
+	 *
+	 * \param pos the position of the point
+	 * \param timeToTarget the time to target to use for the point, in
+	 *                     milliseconds
+	 * \return the result
+	 */
+	Result compute(int pos, int timeToTarget) const;
+
+	/**
+	 * \brief Returns the result of a point, computing it if needed
+	 *
+	 * \param pos the position of the point
+	 * \return the result of the point
+	 */
+	const Result& result(int pos) const;
+
+	/**
+	 * \brief The sequence to check
+	 */
+	Sequence* const m_sequence;
+
+	/**
+	 * \brief The maximum velocity of each channel
+	 */
+	QVector<double> m_velocityLimits;
+
+	/**
+	 * \brief The maximum acceleration of each channel
+	 */
+	QVector<double> m_accelerationLimits;
+
+	/**
+	 * \brief The reciprocals of m_velocityLimits
+	 */
+	QVector<double> m_velocityScales;
+
+	/**
+	 * \brief The reciprocals of m_accelerationLimits
+	 */
+	QVector<double> m_accelerationScales;
+
+	/**
+	 * \brief The cached results, one per point
+	 */
+	mutable QVector<Result> m_results;
+
+	/**
+	 * \brief The first point whose result is not up to date
+	 *
+	 * This is -1 if all results are up to date
+	 */
+	mutable int m_firstInvalid;
+
+	/**
+	 * \brief The last point whose result is not up to date
+	 */
+	mutable int m_lastInvalid;
+
+	/**
+	 * \brief The first point whose result was computed after the last
+	 *        notification
+	 *
+	 * This is -1 if no result was computed after the last notification
+	 */
+	mutable int m_firstComputed;
+
+	/**
+	 * \brief The last point whose result was computed after the last
+	 *        notification
+	 */
+	mutable int m_lastComputed;
+
+	/**
+	 * \brief The number of points exceeding the limits
+	 */
+	mutable int m_violations;
+
+	/**
+	 * \brief The number of points exceeding the limits the last time it
+	 *        was read or notified
+	 */
+	mutable int m_notifiedViolations;
+};
+
+#endif // MOTIONANALYSIS_H
@@ -0,0 +1,335 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "playbackpreview.h"
+#include "sequence.h"
+#include <algorithm>
+
+namespace {
+	/**
+	 * \brief Converts a value of the sequence to the position sent to the
+	 *        hardware
+	 *
+	 * This is the same conversion of SequenceSnapshot::setPoint()
+	 * \param v the value
+	 * \return the position, between 0 and 255
+	 */
+	int hardwarePosition(SequenceValue v)
+	{
+		return static_cast<unsigned int>(v) & 0xFF;
+	}
+}
+
+PlaybackPreview::PlaybackPreview(Sequence* sequence)
+	: QObject(sequence)
+	, m_sequence(sequence)
+	, m_samples()
+	, m_numCachedSamples(0)
+	, m_startTimes(1, 0)
+	, m_validStartTimes(1)
+	, m_isActive(false)
+	, m_position(0)
+	, m_timer(this)
+	, m_clock()
+	, m_playStartPosition(0)
+{
+	m_timer.setInterval(framePeriod);
+	m_timer.setTimerType(Qt::PreciseTimer);
+	connect(&m_timer, &QTimer::timeout, this, &PlaybackPreview::advance);
+
+	connect(m_sequence, &Sequence::pointsValuesChanged, this, &PlaybackPreview::pointsValuesChanged);
+	connect(m_sequence->model(), &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) { pointsInserted(first, last); });
+	connect(m_sequence->model(), &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int last) { pointsRemoved(first, last); });
+}
+
+void PlaybackPreview::setPosition(int position)
+{
+	m_position = std::max(0, std::min(position, duration()));
+
+	if (isPlaying()) {
+		m_playStartPosition = m_position;
+		m_clock.restart();
+	}
+
+	if (!m_isActive) {
+		m_isActive = true;
+		emit isActiveChanged();
+	}
+
+	// Also emitted if the position did not change, views start showing the preview when it
+	// is activated
+	emit positionChanged();
+}
+
+int PlaybackPreview::duration() const
+{
+	refresh();
+
+	return static_cast<int>(m_startTimes.last());
+}
+
+int PlaybackPreview::playingPoint() const
+{
+	refresh();
+
+	return pointAt(m_position);
+}
+
+double PlaybackPreview::value(int c) const
+{
+	return valueAt(m_position, c);
+}
+
+double PlaybackPreview::valueAt(int time, int c) const
+{
+	if ((c < 0) || (c >= int(m_sequence->pointDim()))) {
+		return 0.0;
+	}
+
+	refresh();
+
+	time = std::max(0, std::min(time, static_cast<int>(m_startTimes.last())));
+	const int pos = pointAt(time);
+	if (pos == -1) {
+		return 0.0;
+	}
+
+	// The last sample is the one at the time to target, it is held for the duration of the point
+	const int timeToTarget = m_sequence->m_sequence.timeToTarget(pos);
+	const int n = numSamples(timeToTarget);
+	const qint64 pointTime = time - m_startTimes[pos];
+	const int i = (pointTime >= timeToTarget) ? (n - 1) : static_cast<int>(pointTime / servoUpdatePeriod);
+
+	return samples(pos)[c * n + i];
+}
+
+void PlaybackPreview::play()
+{
+	if (isPlaying() || (duration() == 0)) {
+		return;
+	}
+
+	if (m_position >= duration()) {
+		m_position = 0;
+	}
+
+	if (!m_isActive) {
+		m_isActive = true;
+		emit isActiveChanged();
+	}
+
+	m_playStartPosition = m_position;
+	m_clock.start();
+	m_timer.start();
+
+	emit isPlayingChanged();
+	emit positionChanged();
+}
+
+void PlaybackPreview::pause()
+{
+	if (!isPlaying()) {
+		return;
+	}
+
+	m_timer.stop();
+
+	emit isPlayingChanged();
+}
+
+void PlaybackPreview::stop()
+{
+	pause();
+
+	m_position = 0;
+	if (m_isActive) {
+		m_isActive = false;
+		emit isActiveChanged();
+	}
+
+	emit positionChanged();
+}
+
+void PlaybackPreview::advance()
+{
+	// Using the elapsed time instead of counting timeouts, so that late timeouts do not slow
+	// down playback
+	const qint64 position = m_playStartPosition + m_clock.elapsed();
+	const int end = duration();
+	if (position >= end) {
+		m_position = end;
+		pause();
+	} else {
+		m_position = static_cast<int>(position);
+	}
+
+	emit positionChanged();
+}
+
+void PlaybackPreview::pointsValuesChanged(int first, int last)
+{
+	// The point after the last changed one moves from it
+	invalidate(first, last + 1);
+	notifySequenceChanged();
+}
+
+void PlaybackPreview::pointsInserted(int first, int last)
+{
+	// Samples of points after the inserted ones move with them
+	const int count = last - first + 1;
+	if (m_samples.size() == (m_sequence->numPoints() - count)) {
+		m_samples.insert(first, count, QVector<float>());
+		m_startTimes.insert(first + 1, count, 0);
+	}
+
+	invalidate(first, last + 1);
+	notifySequenceChanged();
+}
+
+void PlaybackPreview::pointsRemoved(int first, int last)
+{
+	const int count = last - first + 1;
+	if (m_samples.size() == (m_sequence->numPoints() + count)) {
+		for (int pos = first; pos <= last; ++pos) {
+			m_numCachedSamples -= m_samples[pos].size();
+		}
+		m_samples.remove(first, count);
+		m_startTimes.remove(first + 1, count);
+	}
+
+	// The point now at first moves from a different position
+	invalidate(first, first);
+	notifySequenceChanged();
+}
+
+void PlaybackPreview::invalidate(int first, int last)
+{
+	first = std::max(first, 0);
+	last = std::min(last, m_samples.size() - 1);
+	if (first > last) {
+		return;
+	}
+
+	for (int pos = first; pos <= last; ++pos) {
+		m_numCachedSamples -= m_samples[pos].size();
+		m_samples[pos].clear();
+	}
+
+	// The start time of first only depends on the points before it
+	m_validStartTimes = std::min(m_validStartTimes, first + 1);
+}
+
+void PlaybackPreview::invalidateAll() const
+{
+	const int numPoints = m_sequence->numPoints();
+
+	m_samples.fill(QVector<float>(), numPoints);
+	m_numCachedSamples = 0;
+	m_startTimes.fill(0, numPoints + 1);
+	m_validStartTimes = 1;
+}
+
+void PlaybackPreview::refresh() const
+{
+	const PointStorage<SequenceValue>& points = m_sequence->m_sequence;
+	if (m_samples.size() != points.size()) {
+		invalidateAll();
+	}
+
+	for (int pos = m_validStartTimes; pos <= points.size(); ++pos) {
+		m_startTimes[pos] = m_startTimes[pos - 1] + points.timeToTarget(pos - 1) + points.duration(pos - 1);
+	}
+	m_validStartTimes = points.size() + 1;
+}
+
+int PlaybackPreview::pointAt(int time) const
+{
+	const int numPoints = m_samples.size();
+	if (numPoints == 0) {
+		return -1;
+	}
+
+	// The last point starting not after time. Points taking no time are skipped, as the
+	// firmware moves past them in a single step
+	const auto it = std::upper_bound(m_startTimes.constBegin(), m_startTimes.constBegin() + numPoints, qint64(time));
+
+	return std::max(0, static_cast<int>(it - m_startTimes.constBegin()) - 1);
+}
+
+const QVector<float>& PlaybackPreview::samples(int pos) const
+{
+	if (!m_samples[pos].isEmpty()) {
+		return m_samples[pos];
+	}
+
+	const PointStorage<SequenceValue>& points = m_sequence->m_sequence;
+	const int dim = m_sequence->pointDim();
+	const int timeToTarget = points.timeToTarget(pos);
+	const int n = numSamples(timeToTarget);
+
+	if ((m_numCachedSamples + (dim * n)) > maxCachedSamples) {
+		for (auto& s: m_samples) {
+			s.clear();
+		}
+		m_numCachedSamples = 0;
+	}
+
+	// The covered fraction of each sample in Q16, computed with the reciprocal of the time to
+	// target as in SequencePlayer::currentFraction(). The last sample is at the time to target,
+	// where the point is reached (the rounding of the reciprocal could leave it a bit short)
+	const quint32 reciprocal = (timeToTarget == 0) ? 0 : (((1U << 24) + (timeToTarget / 2)) / timeToTarget);
+	QVector<quint32> fractions(n);
+	for (int i = 0; i < (n - 1); ++i) {
+		const quint32 t = i * servoUpdatePeriod;
+		fractions[i] = (reciprocal == 0) ? (1U << 16) : std::min((t * reciprocal) >> 8, 1U << 16);
+	}
+	fractions[n - 1] = 1U << 16;
+
+	// One row per channel. The first point moves from itself
+	const SequenceValue* const to = points.values(pos);
+	const SequenceValue* const from = points.values(std::max(0, pos - 1));
+	QVector<float>& s = m_samples[pos];
+	s.resize(dim * n);
+	for (int c = 0; c < dim; ++c) {
+		const int start = hardwarePosition(from[c]);
+		const float delta = hardwarePosition(to[c]) - start;
+		float* const row = s.data() + (c * n);
+		for (int i = 0; i < n; ++i) {
+			row[i] = start + ((delta * fractions[i]) / 65536.0f);
+		}
+	}
+	m_numCachedSamples += s.size();
+
+	return s;
+}
+
+void PlaybackPreview::notifySequenceChanged()
+{
+	emit durationChanged();
+
+	// The values at the current position may have changed too
+	const int end = duration();
+	if (m_position > end) {
+		m_position = end;
+	}
+	emit positionChanged();
+}
@@ -0,0 +1,371 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef PLAYBACKPREVIEW_H
+#define PLAYBACKPREVIEW_H
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class Sequence;
+
+/**
+ * \brief The playback of a sequence inside the program, without hardware
+ *
+ * This plays the sequence with the same interpolation of SequencePlayer in the
+ * firmware: each point is reached moving linearly from the previous one in
+ * its time to target (positions are rounded to 8 bits as when they are sent,
+ * the covered fraction of the motion is computed in Q16 fixed point with the
+ * reciprocal of the time to target), then it is held for its duration. The
+ * first point is held, as the position before it is unknown. Positions are
+ * sampled every servoUpdatePeriod milliseconds from the start of each point,
+ * as the firmware moves servos at that period, plus a last sample at the time
+ * to target, so that the point is always reached as on the hardware. The
+ * preview always shows this uncompiled, linear trajectory: when trajectory
+ * compilation is enabled (see SerialCommunication::setCompileTrajectory())
+ * the hardware plays the eased and simplified segments produced by
+ * TrajectoryCompiler instead. Those segments stay within the tolerance of
+ * the compiler from this trajectory, but their easing is not previewed.
+ * The trajectory is evaluated lazily: samples of the motion towards a point
+ * are computed the first time the point is played and kept in a per-point
+ * buffer (one row of samples per channel), so scrubbing back and forth over a
+ * long sequence does not compute them again. Only the samples of changed
+ * points and of the points after them (which move from the changed points) are
+ * dropped when the sequence changes; the start times of points are summed
+ * again from the first changed point. When the buffer grows larger than
+ * maxCachedSamples, the samples of all points but the playing one are
+ * dropped.
+ * While playing, position is advanced at display refresh rate (see
+ * framePeriod). The preview is active (see isActive) from the first call to
+ * play() or setPosition() to stop(), views show value() instead of the values
+ * of the current point while it is active. The object is created and owned by
+ * the sequence, get it with Sequence::preview()
+ */
+class PlaybackPreview : public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(bool isActive READ isActive NOTIFY isActiveChanged)
+	Q_PROPERTY(bool isPlaying READ isPlaying NOTIFY isPlayingChanged)
+	Q_PROPERTY(int position READ position WRITE setPosition NOTIFY positionChanged)
+	Q_PROPERTY(int duration READ duration NOTIFY durationChanged)
+	Q_PROPERTY(int playingPoint READ playingPoint NOTIFY positionChanged)
+
+public:
+	/**
+	 * \brief The period at which the firmware moves servos in milliseconds
+	 *
+	 * This is servoUpdatePeriod in Firmware.ino
+	 */
+	static const int servoUpdatePeriod = 10;
+
+	/**
+	 * \brief The period at which the position is advanced while playing in
+	 *        milliseconds
+	 */
+	static const int framePeriod = 16;
+
+	/**
+	 * \brief The maximum number of samples kept in the buffer
+	 */
+	static const int maxCachedSamples = 1 << 22;
+
+	/**
+	 * \brief Constructor
+	 *
+	 * \param sequence the sequence to play. It is also the parent of this
+	 *        object
+	 */
+	explicit PlaybackPreview(Sequence* sequence);
+
+	/**
+	 * \brief Returns true if the preview is active
+	 *
+	 * \return true if the preview has been started and not stopped
+	 */
+	bool isActive() const
+	{
+		return m_isActive;
+	}
+
+	/**
+	 * \brief Returns true if the preview is playing
+	 *
+	 * \return true if the position is advancing
+	 */
+	bool isPlaying() const
+	{
+		return m_timer.isActive();
+	}
+
+	/**
+	 * \brief Returns the position of the preview
+	 *
+	 * \return the time from the start of the sequence in milliseconds
+	 */
+	int position() const
+	{
+		return m_position;
+	}
+
+	/**
+	 * \brief Moves the preview to a time of the sequence
+	 *
+	 * This activates the preview. The position is clamped between 0 and
+	 * duration()
+	 * \param position the time from the start of the sequence in
+	 *                 milliseconds
+	 */
+	void setPosition(int position);
+
+	/**
+	 * \brief Returns the time needed to play the whole sequence
+	 *
+	 * \return the sum of the times to target and durations of all points in
+	 *         milliseconds
+	 */
+	int duration() const;
+
+	/**
+	 * \brief Returns the point played at the current position
+	 *
+	 * \return the position of the point in the sequence, -1 if the
+	 *         sequence is empty
+	 */
+	int playingPoint() const;
+
+	/**
+	 * \brief Returns the position of a channel at the current position
+	 *
+	 * \param c the channel
+	 * \return the position of the channel, 0 if the sequence is empty or c
+	 *         is not valid
+	 */
+	Q_INVOKABLE double value(int c) const;
+
+	/**
+	 * \brief Returns the position of a channel at the given time
+	 *
+	 * \param time the time from the start of the sequence in milliseconds.
+	 *             It is clamped between 0 and duration()
+	 * \param c the channel
+	 * \return the position of the channel, 0 if the sequence is empty or c
+	 *         is not valid
+	 */
+	Q_INVOKABLE double valueAt(int time, int c) const;
+
+public slots:
+	/**
+	 * \brief Starts playing from the current position
+	 *
+	 * This activates the preview. If the position is at the end of the
+	 * sequence, playing restarts from the beginning
+	 */
+	void play();
+
+	/**
+	 * \brief Stops advancing the position
+	 *
+	 * The preview stays active
+	 */
+	void pause();
+
+	/**
+	 * \brief Stops playing and deactivates the preview
+	 *
+	 * The position goes back to the start of the sequence
+	 */
+	void stop();
+
+signals:
+	/**
+	 * \brief The signal emitted when the preview is activated or
+	 *        deactivated
+	 */
+	void isActiveChanged();
+
+	/**
+	 * \brief The signal emitted when playing starts or stops
+	 */
+	void isPlayingChanged();
+
+	/**
+	 * \brief The signal emitted when the position changes
+	 *
+	 * This is also emitted when the points at the current position change
+	 */
+	void positionChanged();
+
+	/**
+	 * \brief The signal emitted when the duration of the sequence may have
+	 *        changed
+	 */
+	void durationChanged();
+
+private slots:
+	/**
+	 * \brief The slot called by the timer while playing
+	 */
+	void advance();
+
+	/**
+	 * \brief The slot called when the values of a range of points change
+	 *
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void pointsValuesChanged(int first, int last);
+
+	/**
+	 * \brief The slot called when points are inserted in the sequence
+	 *
+	 * \param first the position of the first inserted point
+	 * \param last the position of the last inserted point
+	 */
+	void pointsInserted(int first, int last);
+
+	/**
+	 * \brief The slot called when points are removed from the sequence
+	 *
+	 * \param first the position of the first removed point
+	 * \param last the position of the last removed point
+	 */
+	void pointsRemoved(int first, int last);
+
+private:
+	/**
+	 * \brief Drops the samples of a range of points and the start times
+	 *        from the first one
+	 *
+	 * The range is clamped to the valid positions
+	 * \param first the position of the first point
+	 * \param last the position of the last point
+	 */
+	void invalidate(int first, int last);
+
+	/**
+	 * \brief Drops all samples and start times
+	 */
+	void invalidateAll() const;
+
+	/**
+	 * \brief Computes the start times that are not up to date
+	 *
+	 * If the number of buffered points differs from the number of points
+	 * (points were added without notifications, e.g. when loading a file)
+	 * everything is dropped first
+	 */
+	void refresh() const;
+
+	/**
+	 * \brief Returns the point played at a time
+	 *
+	 * Start times must be up to date
+	 * \param time the time from the start of the sequence in milliseconds
+	 * \return the position of the point, -1 if the sequence is empty
+	 */
+	int pointAt(int time) const;
+
+	/**
+	 * \brief Returns the samples of the motion towards a point, computing
+	 *        them if needed
+	 *
+	 * \param pos the position of the point
+	 * \return the samples, one row of numSamples() samples per channel
+	 */
+	const QVector<float>& samples(int pos) const;
+
+	/**
+	 * \brief Returns the number of samples of the motion towards a point
+	 *
+	 * Samples are taken every servoUpdatePeriod milliseconds and at the
+	 * time to target
+	 * \param timeToTarget the time to target of the point in milliseconds
+	 * \return the number of samples
+	 */
+	static int numSamples(int timeToTarget)
+	{
+		return ((timeToTarget + servoUpdatePeriod - 1) / servoUpdatePeriod) + 1;
+	}
+
+	/**
+	 * \brief Emits the signals for a change of the sequence
+	 */
+	void notifySequenceChanged();
+
+	/**
+	 * \brief The sequence to play
+	 */
+	Sequence* const m_sequence;
+
+	/**
+	 * \brief The cached samples of the motion towards each point
+	 *
+	 * An empty vector means that samples have not been computed
+	 */
+	mutable QVector<QVector<float>> m_samples;
+
+	/**
+	 * \brief The total number of samples in m_samples
+	 */
+	mutable int m_numCachedSamples;
+
+	/**
+	 * \brief The start time of each point, plus the end of the sequence
+	 *
+	 * Only times up to m_validStartTimes - 1 are up to date
+	 */
+	mutable QVector<qint64> m_startTimes;
+
+	/**
+	 * \brief The number of start times that are up to date
+	 */
+	mutable int m_validStartTimes;
+
+	/**
+	 * \brief True if the preview is active
+	 */
+	bool m_isActive;
+
+	/**
+	 * \brief The current position in milliseconds
+	 */
+	int m_position;
+
+	/**
+	 * \brief The timer advancing the position while playing
+	 */
+	QTimer m_timer;
+
+	/**
+	 * \brief The clock measuring the time since playing started
+	 */
+	QElapsedTimer m_clock;
+
+	/**
+	 * \brief The position when playing started
+	 */
+	int m_playStartPosition;
+};
+
+#endif // PLAYBACKPREVIEW_H
@@ -0,0 +1,456 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef POINTSTORAGE_H
+#define POINTSTORAGE_H
+
+#include <QtGlobal>
+#include <QVarLengthArray>
+#include <QVector>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include "sequencepoint.h"
+
+/**
+ * \brief The contiguous storage of the points of a sequence
+ *
+ * Points are stored as a structure of arrays: the positions of all points are
+ * in a single array (the positions of point i are the elements from
+ * i * pointDim() to (i + 1) * pointDim() - 1), durations and times to target
+ * are in two other arrays. This way the number of allocations does not depend
+ * on the number of points and the positions of consecutive points are
+ * contiguous in memory.
+ * ValueT is the type used to store positions: it is either double or an 8 bits
+ * unsigned integer (positions are sent to the hardware as 8 bits values
+ * anyway). When an integer type is used, positions are rounded and clamped to
+ * the range of the type. Positions are always exchanged as double with the
+ * rest of the program. This class does not check indexes.
+ */
+template <class ValueT>
+class PointStorage
+{
+public:
+	/**
+	 * \brief The type used to store positions
+	 */
+	using Value = ValueT;
+
+	/**
+	 * \brief Constructor
+	 *
+	 * \param pointDim the dimension of each point
+	 */
+	explicit PointStorage(unsigned int pointDim = 0)
+		: m_pointDim(pointDim)
+		, m_values()
+		, m_durations()
+		, m_timesToTarget()
+	{
+	}
+
+	/**
+	 * \brief Returns the dimension of each point
+	 *
+	 * \return the dimension of each point
+	 */
+	unsigned int pointDim() const
+	{
+		return m_pointDim;
+	}
+
+	/**
+	 * \brief Returns the number of points
+	 *
+	 * \return the number of points
+	 */
+	int size() const
+	{
+		return m_durations.size();
+	}
+
+	/**
+	 * \brief Returns true if there are no points
+	 *
+	 * \return true if there are no points
+	 */
+	bool isEmpty() const
+	{
+		return m_durations.isEmpty();
+	}
+
+	/**
+	 * \brief Reserves space for the given number of points
+	 *
+	 * \param n the number of points
+	 */
+	void reserve(int n)
+	{
+		m_values.reserve(n * m_pointDim);
+		m_durations.reserve(n);
+		m_timesToTarget.reserve(n);
+	}
+
+	/**
+	 * \brief Changes the number of points
+	 *
+	 * Points added at the end have all values set to 0
+	 * \param n the new number of points
+	 */
+	void resize(int n)
+	{
+		m_values.resize(n * m_pointDim);
+		m_durations.resize(n);
+		m_timesToTarget.resize(n);
+	}
+
+	/**
+	 * \brief Returns the positions of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \return a pointer to the first of the pointDim() positions of the
+	 *         point
+	 */
+	const ValueT* values(int pos) const
+	{
+		return m_values.constData() + pos * m_pointDim;
+	}
+
+	/**
+	 * \brief Returns a position of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \param c the index of the position
+	 * \return the value of the position
+	 */
+	double coordinate(int pos, int c) const
+	{
+		return double(values(pos)[c]);
+	}
+
+	/**
+	 * \brief Sets a position of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \param c the index of the position
+	 * \param v the new value
+	 */
+	void setCoordinate(int pos, int c, double v)
+	{
+		m_values[pos * m_pointDim + c] = fromDouble(v);
+	}
+
+	/**
+	 * \brief Returns the duration of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \return the duration of the point
+	 */
+	int duration(int pos) const
+	{
+		return m_durations[pos];
+	}
+
+	/**
+	 * \brief Sets the duration of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \param d the new duration
+	 */
+	void setDuration(int pos, int d)
+	{
+		m_durations[pos] = d;
+	}
+
+	/**
+	 * \brief Returns the time to target of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \return the time to target of the point
+	 */
+	int timeToTarget(int pos) const
+	{
+		return m_timesToTarget[pos];
+	}
+
+	/**
+	 * \brief Sets the time to target of a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \param t the new time to target
+	 */
+	void setTimeToTarget(int pos, int t)
+	{
+		m_timesToTarget[pos] = t;
+	}
+
+	/**
+	 * \brief Returns a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \return the point
+	 */
+	SequencePoint point(int pos) const
+	{
+		QVector<double> p(m_pointDim);
+		const ValueT* const v = values(pos);
+		for (unsigned int c = 0; c < m_pointDim; ++c) {
+			p[c] = double(v[c]);
+		}
+
+		return SequencePoint(p, duration(pos), timeToTarget(pos));
+	}
+
+	/**
+	 * \brief Sets a point
+	 *
+	 * \param pos the position of the point in the sequence
+	 * \param p the new point. It must have pointDim() positions
+	 */
+	void setPoint(int pos, const SequencePoint& p)
+	{
+		ValueT* const v = m_values.data() + pos * m_pointDim;
+		for (unsigned int c = 0; c < m_pointDim; ++c) {
+			v[c] = fromDouble(p.point[c]);
+		}
+		m_durations[pos] = p.duration;
+		m_timesToTarget[pos] = p.timeToTarget;
+	}
+
+	/**
+	 * \brief Returns a position as it would be stored
+	 *
+	 * This is v converted to the storage type and back to double, so that it
+	 * can be compared with the values returned by coordinate()
+	 * \param v the position
+	 * \return the stored value of the position
+	 */
+	static double storedValue(double v)
+	{
+		return double(fromDouble(v));
+	}
+
+	/**
+	 * \brief Returns true if a point is equal to the given one
+	 *
+	 * The comparison is performed after converting positions to the
+	 * storage type
+	 * \param pos the position of the point in the sequence
+	 * \param p the point to compare. It must have pointDim() positions
+	 * \return true if the point at pos is equal to p
+	 */
+	bool isEqual(int pos, const SequencePoint& p) const
+	{
+		if ((duration(pos) != p.duration) || (timeToTarget(pos) != p.timeToTarget)) {
+			return false;
+		}
+
+		const ValueT* const v = values(pos);
+		for (unsigned int c = 0; c < m_pointDim; ++c) {
+			if (v[c] != fromDouble(p.point[c])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief Clamps a range of points within the given limits
+	 *
+	 * \param first the position of the first point to clamp
+	 * \param last the position of the last point to clamp
+	 * \param min the minimum values. It must have pointDim() positions
+	 * \param max the maximum values. It must have pointDim() positions
+	 */
+	void clamp(int first, int last, const SequencePoint& min, const SequencePoint& max)
+	{
+		// Converting limits once, so that the loops below only work on ValueT
+		QVarLengthArray<ValueT, 32> minValues(m_pointDim);
+		QVarLengthArray<ValueT, 32> maxValues(m_pointDim);
+		for (unsigned int c = 0; c < m_pointDim; ++c) {
+			minValues[c] = fromDouble(min.point[c]);
+			maxValues[c] = fromDouble(max.point[c]);
+		}
+
+		ValueT* v = m_values.data() + first * m_pointDim;
+		for (int i = first; i <= last; ++i, v += m_pointDim) {
+			for (unsigned int c = 0; c < m_pointDim; ++c) {
+				v[c] = std::min(maxValues[c], std::max(minValues[c], v[c]));
+			}
+		}
+
+		int* const d = m_durations.data();
+		int* const t = m_timesToTarget.data();
+		for (int i = first; i <= last; ++i) {
+			d[i] = std::min(max.duration, std::max(min.duration, d[i]));
+			t[i] = std::min(max.timeToTarget, std::max(min.timeToTarget, t[i]));
+		}
+	}
+
+	/**
+	 * \brief Multiplies durations and times to target of a range of points
+	 *        by a factor
+	 *
+	 * Results are rounded to the nearest integer, they are not clamped
+	 * \param first the position of the first point to change
+	 * \param last the position of the last point to change
+	 * \param factor the factor
+	 */
+	void scaleTimings(int first, int last, double factor)
+	{
+		int* const d = m_durations.data();
+		int* const t = m_timesToTarget.data();
+		for (int i = first; i <= last; ++i) {
+			d[i] = qRound(d[i] * factor);
+			t[i] = qRound(t[i] * factor);
+		}
+	}
+
+	/**
+	 * \brief Inserts a point
+	 *
+	 * \param pos the position where the point is inserted
+	 * \param p the point to insert. It must have pointDim() positions
+	 */
+	void insert(int pos, const SequencePoint& p)
+	{
+		m_values.insert(pos * m_pointDim, m_pointDim, ValueT());
+		m_durations.insert(pos, 0);
+		m_timesToTarget.insert(pos, 0);
+
+		setPoint(pos, p);
+	}
+
+	/**
+	 * \brief Appends a point
+	 *
+	 * \param p the point to append. It must have pointDim() positions
+	 */
+	void append(const SequencePoint& p)
+	{
+		insert(size(), p);
+	}
+
+	/**
+	 * \brief Removes a point
+	 *
+	 * \param pos the position of the point to remove
+	 */
+	void removeAt(int pos)
+	{
+		m_values.remove(pos * m_pointDim, m_pointDim);
+		m_durations.remove(pos);
+		m_timesToTarget.remove(pos);
+	}
+
+	/**
+	 * \brief Inserts points with all values set to 0
+	 *
+	 * \param pos the position where the first point is inserted
+	 * \param count the number of points to insert
+	 */
+	void insertEmpty(int pos, int count)
+	{
+		m_values.insert(pos * m_pointDim, count * m_pointDim, ValueT());
+		m_durations.insert(pos, count, 0);
+		m_timesToTarget.insert(pos, count, 0);
+	}
+
+	/**
+	 * \brief Removes a range of points
+	 *
+	 * \param pos the position of the first point to remove
+	 * \param count the number of points to remove
+	 */
+	void remove(int pos, int count)
+	{
+		m_values.remove(pos * m_pointDim, count * m_pointDim);
+		m_durations.remove(pos, count);
+		m_timesToTarget.remove(pos, count);
+	}
+
+	/**
+	 * \brief Removes all points
+	 */
+	void clear()
+	{
+		m_values.clear();
+		m_durations.clear();
+		m_timesToTarget.clear();
+	}
+
+private:
+	/**
+	 * \brief Converts a position to the storage type
+	 *
+	 * \param v the position to convert
+	 * \return the converted position
+	 */
+	static ValueT fromDouble(double v)
+	{
+		return convert(v, std::is_integral<ValueT>());
+	}
+
+	/**
+	 * \brief Converts a position to an integer storage type
+	 *
+	 * \param v the position to convert
+	 * \return the position rounded and clamped to the range of ValueT
+	 */
+	static ValueT convert(double v, std::true_type)
+	{
+		return ValueT(qBound(double(std::numeric_limits<ValueT>::min()), double(qRound(v)), double(std::numeric_limits<ValueT>::max())));
+	}
+
+	/**
+	 * \brief Converts a position to a floating point storage type
+	 *
+	 * \param v the position to convert
+	 * \return the position
+	 */
+	static ValueT convert(double v, std::false_type)
+	{
+		return ValueT(v);
+	}
+
+	/**
+	 * \brief The dimension of each point
+	 */
+	unsigned int m_pointDim;
+
+	/**
+	 * \brief The positions of all points
+	 */
+	QVector<ValueT> m_values;
+
+	/**
+	 * \brief The durations of all points
+	 */
+	QVector<int> m_durations;
+
+	/**
+	 * \brief The times to target of all points
+	 */
+	QVector<int> m_timesToTarget;
+};
+
+#endif // POINTSTORAGE_H
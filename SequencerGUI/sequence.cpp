@@ -20,10 +20,26 @@
  ******************************************************************************/
 
 #include "sequence.h"
+#include "sequencefile.h"
+#include "sequencecommand.h"
+#include "sequencejournal.h"
 #include <QFile>
 #include <QJsonArray>
 
 namespace {
+	/**
+	 * \brief The maximum number of modifications that can be undone
+	 */
+	const int undoLimit = 1000;
+
+	/**
+	 * \brief The interval between notifications of changes in milliseconds
+	 *
+	 * This is about the refresh rate of the display, notifying more often
+	 * would only cause useless updates of the GUI
+	 */
+	const int notificationIntervalMs = 16;
+
 	/**
 	 * \brief returns a default-constructed sequence point
 	 *
@@ -42,16 +58,53 @@ namespace {
 
 		return p;
 	}
+
+	/**
+	 * \brief Returns a point with the given dimension
+	 *
+	 * \param p the point to resize. Missing dimensions are filled with 0.0
+	 * \param pointDim the dimension of the point
+	 * \return the resized point
+	 */
+	SequencePoint resizedPoint(SequencePoint p, unsigned int pointDim)
+	{
+		p.point.resize(pointDim);
+
+		return p;
+	}
 }
 
 Sequence::Sequence(unsigned int pointDim, SequencePoint minVals, SequencePoint maxVals, QObject* parent)
 	: QObject(parent)
 	, m_pointDim(pointDim)
-	, m_min(validatePoint(minVals, true))
-	, m_max(validatePoint(maxVals, true))
-	, m_sequence()
+	, m_min(resizedPoint(minVals, pointDim))
+	, m_max(resizedPoint(maxVals, pointDim))
+	, m_sequence(pointDim)
 	, m_curPoint(-1)
+	, m_updateDepth(0)
+	, m_batchMacroStarted(false)
+	, m_batchPos(-1)
+	, m_batchRemoved(0)
+	, m_batchInserted(0)
+	, m_batchCurPointBefore(-1)
+	, m_firstChangedPoint(-1)
+	, m_lastChangedPoint(-1)
+	, m_notificationTimer(this)
 	, m_isModified(false)
+	, m_undoStack(this)
+	, m_model(this)
+	, m_motion(this)
+	, m_preview(this)
+	, m_journal()
+{
+	m_undoStack.setUndoLimit(undoLimit);
+
+	m_notificationTimer.setSingleShot(true);
+	connect(&m_notificationTimer, &QTimer::timeout, this, &Sequence::flushNotifications);
+	connect(&m_motion, &MotionAnalysis::resultsChanged, &m_model, &SequenceModel::motionResultsChanged);
+}
+
+Sequence::~Sequence()
 {
 }
 
@@ -63,8 +116,8 @@ void Sequence::setCurPoint(int p)
 
 	if (p < 0) {
 		p = 0;
-	} else if (p >= m_sequence.length()) {
-		p = m_sequence.length() - 1;
+	} else if (p >= m_sequence.size()) {
+		p = m_sequence.size() - 1;
 	}
 
 	if (p != m_curPoint) {
@@ -78,11 +131,26 @@ std::unique_ptr<Sequence> Sequence::load(QString filename)
 {
 	QFile f(filename);
 
-	if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+	if (!f.open(QIODevice::ReadOnly)) {
 		return std::make_unique<Sequence>();
 	}
 
-	return load(QJsonDocument::fromJson(f.readAll()));
+	// Mapping the file to avoid copying it. If mapping fails (e.g. this is
+	// not a regular file) we read it. The file is unmapped when closed
+	qint64 size = f.size();
+	const uchar* data = (size > 0) ? f.map(0, size) : nullptr;
+	QByteArray content;
+	if (data == nullptr) {
+		content = f.readAll();
+		data = reinterpret_cast<const uchar*>(content.constData());
+		size = content.size();
+	}
+
+	if (SequenceFile::isBinary(data, size)) {
+		return SequenceFile::readBinary(data, size);
+	} else {
+		return SequenceFile::readJson(reinterpret_cast<const char*>(data), size);
+	}
 }
 
 std::unique_ptr<Sequence> Sequence::load(const QJsonDocument& json)
@@ -140,8 +208,10 @@ std::unique_ptr<Sequence> Sequence::load(const QJsonDocument& json)
 	// object
 	std::unique_ptr<Sequence> s = std::make_unique<Sequence>(dim, minPoint, maxPoint);
 	// Inserting one element at a time to be able to validate them
-	for (auto sp: list) {
-		s->m_sequence.append(s->validatePoint(sp));
+	s->m_sequence.reserve(list.size());
+	for (auto& sp: list) {
+		s->validatePoint(sp);
+		s->m_sequence.append(sp);
 	}
 	if (!list.isEmpty()) {
 		s->m_curPoint = 0;
@@ -183,6 +253,27 @@ bool Sequence::save(QString filename) const
 	return true;
 }
 
+bool Sequence::saveBinary(QString filename) const
+{
+	if (!isValid()) {
+		return false;
+	}
+
+	QFile f(filename);
+
+	if (!f.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	if (!SequenceFile::writeBinary(*this, f)) {
+		return false;
+	}
+
+	m_isModified = false;
+
+	return true;
+}
+
 QJsonDocument Sequence::save() const
 {
 	if (!isValid()) {
@@ -194,8 +285,8 @@ QJsonDocument Sequence::save() const
 	// The first two elements are the min and max of points
 	s.append(m_min.toJson());
 	s.append(m_max.toJson());
-	for (auto sp: m_sequence) {
-		s.append(sp.toJson());
+	for (int i = 0; i < m_sequence.size(); ++i) {
+		s.append(m_sequence.point(i).toJson());
 	}
 
 	m_isModified = false;
@@ -209,17 +300,26 @@ void Sequence::insertAfterCurrent()
 		return;
 	}
 
+	const int oldCurPoint = m_curPoint;
+
+	// Points already in the sequence are valid, only the default one is validated
+	m_model.beginInsertPoints(m_curPoint + 1, m_curPoint + 1);
 	if (m_curPoint == -1) {
-		m_sequence.append(validatePoint(defaultSequencePoint(*this)));
+		SequencePoint p = defaultSequencePoint(*this);
+		validatePoint(p);
+		m_sequence.append(p);
 	} else {
-		m_sequence.insert(m_curPoint + 1, validatePoint(m_sequence[m_curPoint]));
+		m_sequence.insert(m_curPoint + 1, m_sequence.point(m_curPoint));
 	}
+	m_model.endInsertPoints();
 
 	emit numPointsChanged();
 
 	++m_curPoint;
 	emit curPointChanged();
 
+	recordEdit(tr("Insert point"), m_curPoint, QList<SequencePoint>(), 1, oldCurPoint);
+
 	// The sequence has been modified
 	sequenceModified();
 }
@@ -230,13 +330,24 @@ void Sequence::insertBeforeCurrent()
 		return;
 	}
 
+	const int oldCurPoint = m_curPoint;
+	const int pos = std::max(m_curPoint, 0);
+
+	// Points already in the sequence are valid, only the default one is validated
+	m_model.beginInsertPoints(pos, pos);
 	if (m_curPoint == -1) {
-		m_sequence.append(validatePoint(defaultSequencePoint(*this)));
+		SequencePoint p = defaultSequencePoint(*this);
+		validatePoint(p);
+		m_sequence.append(p);
 
 		m_curPoint = 0;
-		emit curPointChanged();
 	} else {
-		m_sequence.insert(m_curPoint, validatePoint(m_sequence[m_curPoint]));
+		m_sequence.insert(m_curPoint, m_sequence.point(m_curPoint));
+	}
+	m_model.endInsertPoints();
+
+	if (oldCurPoint == -1) {
+		emit curPointChanged();
 	}
 
 	emit numPointsChanged();
@@ -246,6 +357,8 @@ void Sequence::insertBeforeCurrent()
 	// didn't change but the current point did change
 	emit curPointValuesChanged();
 
+	recordEdit(tr("Insert point"), m_curPoint, QList<SequencePoint>(), 1, oldCurPoint);
+
 	// The sequence has been modified
 	sequenceModified();
 }
@@ -256,14 +369,21 @@ void Sequence::append()
 		return;
 	}
 
-	SequencePoint p = (m_curPoint == -1) ? defaultSequencePoint(*this) : m_sequence[m_curPoint];
-	m_sequence.append(validatePoint(p));
+	const int oldCurPoint = m_curPoint;
+
+	SequencePoint p = (m_curPoint == -1) ? defaultSequencePoint(*this) : m_sequence.point(m_curPoint);
+	validatePoint(p);
+	m_model.beginInsertPoints(m_sequence.size(), m_sequence.size());
+	m_sequence.append(p);
+	m_model.endInsertPoints();
 
 	emit numPointsChanged();
 
-	m_curPoint = m_sequence.length() - 1;
+	m_curPoint = m_sequence.size() - 1;
 	emit curPointChanged();
 
+	recordEdit(tr("Append point"), m_curPoint, QList<SequencePoint>(), 1, oldCurPoint);
+
 	// The sequence has been modified
 	sequenceModified();
 }
@@ -274,13 +394,18 @@ void Sequence::removeCurrent()
 		return;
 	}
 
+	const int oldCurPoint = m_curPoint;
+	const SequencePoint removed = m_sequence.point(m_curPoint);
+
+	m_model.beginRemovePoints(m_curPoint, m_curPoint);
 	m_sequence.removeAt(m_curPoint);
+	m_model.endRemovePoints();
 
 	emit numPointsChanged();
 
-	if (m_curPoint >= m_sequence.length()) {
+	if (m_curPoint >= m_sequence.size()) {
 		// This will set cur point to -1 if the sequence is empty
-		m_curPoint = m_sequence.length() - 1;
+		m_curPoint = m_sequence.size() - 1;
 
 		emit curPointChanged();
 	} else {
@@ -289,6 +414,8 @@ void Sequence::removeCurrent()
 		emit curPointValuesChanged();
 	}
 
+	recordEdit(tr("Remove point"), oldCurPoint, QList<SequencePoint>() << removed, 0, oldCurPoint);
+
 	// The sequence has been modified
 	sequenceModified();
 }
@@ -300,12 +427,19 @@ void Sequence::clear()
 	}
 
 	if (!m_sequence.isEmpty()) {
+		const int oldCurPoint = m_curPoint;
+		const QList<SequencePoint> removed = storedPoints(0, m_sequence.size());
+
+		m_model.beginRemovePoints(0, m_sequence.size() - 1);
 		m_sequence.clear();
+		m_model.endRemovePoints();
 
 		emit numPointsChanged();
 
 		m_curPoint = -1;
 		emit curPointChanged();
+
+		recordEdit(tr("Clear sequence"), 0, removed, 0, oldCurPoint);
 	}
 
 	// The sequence has been modified
@@ -352,19 +486,29 @@ int Sequence::maxPointTimeToTarget() const
 	return m_max.timeToTarget;
 }
 
-const SequencePoint& Sequence::operator[](int pos) const
+SequencePoint Sequence::operator[](int pos) const
 {
-	return m_sequence[pos];
+	return m_sequence.point(pos);
 }
 
-const SequencePoint& Sequence::point() const
+SequenceSnapshot Sequence::snapshot() const
 {
-	return m_sequence[m_curPoint];
+	SequenceSnapshot s(m_pointDim, m_sequence.size());
+	for (int i = 0; i < m_sequence.size(); ++i) {
+		s.setPoint(i, m_sequence.duration(i), m_sequence.timeToTarget(i), m_sequence.values(i));
+	}
+
+	return s;
+}
+
+SequencePoint Sequence::point() const
+{
+	return m_sequence.point(m_curPoint);
 }
 
 double Sequence::pointCoordinate(int pos, int c) const
 {
-	return m_sequence[pos].point[c];
+	return m_sequence.coordinate(pos, c);
 }
 
 double Sequence::pointCoordinate(int c) const
@@ -378,7 +522,7 @@ double Sequence::pointCoordinate(int c) const
 
 int Sequence::pointDuration(int pos) const
 {
-	return m_sequence[pos].duration;
+	return m_sequence.duration(pos);
 }
 
 int Sequence::pointDuration() const
@@ -392,7 +536,7 @@ int Sequence::pointDuration() const
 
 int Sequence::pointTimeToTarget(int pos) const
 {
-	return m_sequence[pos].timeToTarget;
+	return m_sequence.timeToTarget(pos);
 }
 
 int Sequence::pointTimeToTarget() const
@@ -411,24 +555,18 @@ void Sequence::setPoint(int pos, SequencePoint p)
 	}
 
 	// Forcing point to be compliant with the set dimension and limits
-	const SequencePoint old = m_sequence[pos];
-	m_sequence[pos] = validatePoint(p);
+	validatePoint(p);
 
-	// If the point didn't actually changed, not emitting signals
-	if (old == m_sequence[pos]) {
+	// If the point doesn't actually change, not emitting signals
+	if (m_sequence.isEqual(pos, p)) {
 		return;
 	}
+	const SequencePoint old = m_sequence.point(pos);
+	m_sequence.setPoint(pos, p);
 
-	emit pointValuesChanged(pos);
+	recordEdit(tr("Change point"), pos, QList<SequencePoint>() << old, 1, m_curPoint);
 
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
-
-	// The sequence has been modified
-	sequenceModified();
+	pointValuesModified(pos, pos);
 }
 
 void Sequence::setPoint(SequencePoint p)
@@ -446,24 +584,18 @@ void Sequence::setPointCoordinate(int pos, int c, double v)
 		return;
 	}
 
-	const double old = m_sequence[pos].point[c];
-	m_sequence[pos].point[c] = std::min(m_max.point[c], std::max(m_min.point[c], v));
-
-	// If the point didn't actually changed, not emitting signals
-	if (old == m_sequence[pos].point[c]) {
+	// If the point doesn't actually change, not emitting signals. Only the changed value is
+	// recorded, so changes don't allocate besides the undo command
+	const double value = std::min(m_max.point[c], std::max(m_min.point[c], v));
+	const double old = m_sequence.coordinate(pos, c);
+	if (old == PointStorage<SequenceValue>::storedValue(value)) {
 		return;
 	}
+	m_sequence.setCoordinate(pos, c, value);
 
-	emit pointValuesChanged(pos);
-
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
+	recordEdit(tr("Change position"), SequenceEdit::value(pos, c, old, m_sequence.coordinate(pos, c), m_curPoint, m_curPoint));
 
-	// The sequence has been modified
-	sequenceModified();
+	pointValuesModified(pos, pos);
 }
 
 void Sequence::setPointCoordinate(int c, double v)
@@ -481,24 +613,17 @@ void Sequence::setDuration(int pos, int d)
 		return;
 	}
 
-	const int old = m_sequence[pos].duration;
-	m_sequence[pos].duration = std::min(m_max.duration, std::max(m_min.duration, d));
-
-	// If the point didn't actually changed, not emitting signals
-	if (old == m_sequence[pos].duration) {
+	// If the point doesn't actually change, not emitting signals
+	const int value = std::min(m_max.duration, std::max(m_min.duration, d));
+	const int old = m_sequence.duration(pos);
+	if (old == value) {
 		return;
 	}
+	m_sequence.setDuration(pos, value);
 
-	emit pointValuesChanged(pos);
+	recordEdit(tr("Change duration"), SequenceEdit::value(pos, SequenceEdit::durationField, old, value, m_curPoint, m_curPoint));
 
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
-
-	// The sequence has been modified
-	sequenceModified();
+	pointValuesModified(pos, pos);
 }
 
 void Sequence::setDuration(int d)
@@ -516,59 +641,178 @@ void Sequence::setTimeToTarget(int pos, int t)
 		return;
 	}
 
-	const int old = m_sequence[pos].timeToTarget;
-	m_sequence[pos].timeToTarget = std::min(m_max.timeToTarget, std::max(m_min.timeToTarget, t));
+	// If the point doesn't actually change, not emitting signals
+	const int value = std::min(m_max.timeToTarget, std::max(m_min.timeToTarget, t));
+	const int old = m_sequence.timeToTarget(pos);
+	if (old == value) {
+		return;
+	}
+	m_sequence.setTimeToTarget(pos, value);
+
+	recordEdit(tr("Change time to target"), SequenceEdit::value(pos, SequenceEdit::timeToTargetField, old, value, m_curPoint, m_curPoint));
+
+	pointValuesModified(pos, pos);
+}
+
+void Sequence::setTimeToTarget(int t)
+{
+	if (m_curPoint < 0) {
+		return;
+	}
+
+	setTimeToTarget(m_curPoint, t);
+}
 
-	// If the point didn't actually changed, not emitting signals
-	if (old == m_sequence[pos].timeToTarget) {
+void Sequence::setPoints(int pos, const QList<SequencePoint>& points)
+{
+	if (!isValid() || points.isEmpty()) {
 		return;
 	}
 
-	emit pointValuesChanged(pos);
+	// Copying points, only those with the wrong dimension need to be resized, then clamping
+	// all of them in a single pass
+	const int last = pos + points.size() - 1;
+	const QList<SequencePoint> old = storedPoints(pos, points.size());
+	for (int i = 0; i < points.size(); ++i) {
+		if (points[i].point.size() == int(m_pointDim)) {
+			m_sequence.setPoint(pos + i, points[i]);
+		} else {
+			m_sequence.setPoint(pos + i, resizedPoint(points[i], m_pointDim));
+		}
+	}
+	m_sequence.clamp(pos, last, m_min, m_max);
+
+	recordEdit(tr("Change points"), pos, old, points.size(), m_curPoint);
 
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
+	pointValuesModified(pos, last);
+}
+
+void Sequence::scaleTimings(double factor)
+{
+	if (!isValid() || m_sequence.isEmpty()) {
+		return;
+	}
+
+	// Only durations and times to target are recorded, positions don't change
+	const int last = m_sequence.size() - 1;
+	QVector<int> old = storedTimings(0, m_sequence.size());
+	m_sequence.scaleTimings(0, last, factor);
+	m_sequence.clamp(0, last, m_min, m_max);
+
+	recordEdit(tr("Scale timings"), SequenceEdit::timings(0, std::move(old), storedTimings(0, m_sequence.size()), m_curPoint, m_curPoint));
+
+	pointValuesModified(0, last);
+}
+
+void Sequence::beginUpdate()
+{
+	// The undo macro and the journal record are only started by the first modification, so that
+	// empty batches leave no trace
+	++m_updateDepth;
+}
+
+void Sequence::endUpdate()
+{
+	if (m_updateDepth == 0) {
+		return;
+	}
+
+	--m_updateDepth;
+	if (m_updateDepth != 0) {
+		return;
+	}
+
+	if (m_batchMacroStarted) {
+		m_batchMacroStarted = false;
+		m_undoStack.endMacro();
+	}
+
+	// All modifications of the batch are written as a single edit
+	if (m_batchPos != -1) {
+		const int pos = m_batchPos;
+		m_batchPos = -1;
+		if (m_journal) {
+			m_journal->appendPoints(pos, m_batchRemoved, storedPoints(pos, m_batchInserted), m_batchCurPointBefore, m_curPoint);
+		}
+	}
+
+	if (m_firstChangedPoint == -1) {
+		return;
 	}
 
 	// The sequence has been modified
 	sequenceModified();
+
+	if (!m_notificationTimer.isActive()) {
+		m_notificationTimer.start(notificationIntervalMs);
+	}
 }
 
-void Sequence::setTimeToTarget(int t)
+void Sequence::flushNotifications()
 {
-	if (m_curPoint < 0) {
+	if ((m_updateDepth != 0) || (m_firstChangedPoint == -1)) {
 		return;
 	}
 
-	setTimeToTarget(m_curPoint, t);
+	m_notificationTimer.stop();
+
+	// Points could have been removed after they changed
+	const int first = m_firstChangedPoint;
+	const int last = std::min(m_lastChangedPoint, m_sequence.size() - 1);
+	m_firstChangedPoint = -1;
+	m_lastChangedPoint = -1;
+
+	if (first > last) {
+		return;
+	}
+
+	if (first == last) {
+		emit pointValuesChanged(first);
+	}
+	emit pointsValuesChanged(first, last);
+
+	// Also checking if we have to emit the signal for changes in the
+	// current point
+	if ((m_curPoint >= first) && (m_curPoint <= last)) {
+		emit curPointValuesChanged();
+	}
 }
 
-SequencePoint Sequence::validatePoint(SequencePoint p, bool skipLimits) const
+void Sequence::validatePoint(SequencePoint& p) const
 {
-	// Resizing to the correct size
-	if (p.point.length() < int(m_pointDim)) {
-		// Filling the missing dimensions with 0.0
-		while (p.point.length() < int(m_pointDim)) {
-			p.point.append(0.0);
-		};
-	} else if (p.point.length() > int(m_pointDim)) {
+	// Resizing to the correct size, missing dimensions are filled with 0.0
+	if (p.point.size() != int(m_pointDim)) {
 		p.point.resize(m_pointDim);
 	}
 
-	if (skipLimits) {
-		return p;
-	}
-
 	// Now checking all limits
-	for (int i = 0; i < p.point.length(); ++i) {
-		p.point[i] = std::min(m_max.point[i], std::max(m_min.point[i], p.point[i]));
+	double* const v = p.point.data();
+	const double* const minV = m_min.point.constData();
+	const double* const maxV = m_max.point.constData();
+	for (unsigned int i = 0; i < m_pointDim; ++i) {
+		v[i] = std::min(maxV[i], std::max(minV[i], v[i]));
 	}
 	p.duration = std::min(m_max.duration, std::max(m_min.duration, p.duration));
 	p.timeToTarget = std::min(m_max.timeToTarget, std::max(m_min.timeToTarget, p.timeToTarget));
+}
+
+void Sequence::pointValuesModified(int first, int last)
+{
+	// Remembering which points changed, they are notified together
+	m_firstChangedPoint = (m_firstChangedPoint == -1) ? first : std::min(m_firstChangedPoint, first);
+	m_lastChangedPoint = std::max(m_lastChangedPoint, last);
+
+	// In a batch everything is done by endUpdate()
+	if (m_updateDepth > 0) {
+		return;
+	}
 
-	return p;
+	// The sequence has been modified
+	sequenceModified();
+
+	if (!m_notificationTimer.isActive()) {
+		m_notificationTimer.start(notificationIntervalMs);
+	}
 }
 
 void Sequence::sequenceModified()
@@ -579,3 +823,219 @@ void Sequence::sequenceModified()
 		emit isModifiedChanged();
 	}
 }
+
+bool Sequence::isApplicable(const SequenceEdit& edit) const
+{
+	if (!isValid() || (edit.pos < 0) || ((edit.pos + edit.numRemoved()) > m_sequence.size())) {
+		return false;
+	}
+
+	switch (edit.type) {
+		case SequenceEdit::Points:
+			for (const auto& p: edit.inserted) {
+				if (p.point.size() != int(m_pointDim)) {
+					return false;
+				}
+			}
+
+			return true;
+		case SequenceEdit::Value:
+			return (edit.field == SequenceEdit::durationField) || (edit.field == SequenceEdit::timeToTargetField) || ((edit.field >= 0) && (edit.field < int(m_pointDim)));
+		case SequenceEdit::Timings:
+			return ((edit.oldTimings.size() % 2) == 0) && (edit.newTimings.size() == edit.oldTimings.size());
+	}
+
+	return false;
+}
+
+void Sequence::apply(const SequenceEdit& edit)
+{
+	if (!isValid()) {
+		return;
+	}
+
+	// Pushing the command applies the edit
+	pushCommand(new SequenceCommand(this, tr("Apply edit"), edit, false));
+}
+
+bool Sequence::startJournal(QString filename, QString sequenceFile)
+{
+	m_journal.reset();
+
+	if (!isValid()) {
+		return false;
+	}
+
+	std::unique_ptr<SequenceJournal> journal = std::make_unique<SequenceJournal>(filename);
+	if (!journal->start(*this, sequenceFile)) {
+		return false;
+	}
+	m_journal = std::move(journal);
+
+	return true;
+}
+
+void Sequence::stopJournal()
+{
+	m_journal.reset();
+}
+
+QList<SequencePoint> Sequence::storedPoints(int pos, int count) const
+{
+	QList<SequencePoint> points;
+
+	points.reserve(count);
+	for (int i = pos; i < (pos + count); ++i) {
+		points.append(m_sequence.point(i));
+	}
+
+	return points;
+}
+
+QVector<int> Sequence::storedTimings(int pos, int count) const
+{
+	QVector<int> timings(2 * count);
+
+	int* t = timings.data();
+	for (int i = pos; i < (pos + count); ++i) {
+		*t++ = m_sequence.duration(i);
+		*t++ = m_sequence.timeToTarget(i);
+	}
+
+	return timings;
+}
+
+void Sequence::recordEdit(const QString& text, int pos, QList<SequencePoint> removed, int numInserted, int curPointBefore)
+{
+	recordEdit(text, SequenceEdit::points(pos, std::move(removed), storedPoints(pos, numInserted), curPointBefore, m_curPoint));
+}
+
+void Sequence::recordEdit(const QString& text, SequenceEdit edit)
+{
+	journalEdit(edit);
+
+	// The sequence has already been modified, so the command does nothing the first time redo() is called
+	pushCommand(new SequenceCommand(this, text, std::move(edit), true));
+}
+
+void Sequence::pushCommand(QUndoCommand* command)
+{
+	if ((m_updateDepth > 0) && !m_batchMacroStarted) {
+		m_batchMacroStarted = true;
+		m_undoStack.beginMacro(tr("Edit points"));
+	}
+
+	m_undoStack.push(command);
+}
+
+void Sequence::journalEdit(const SequenceEdit& edit)
+{
+	if (!m_journal) {
+		return;
+	}
+
+	if (m_updateDepth == 0) {
+		switch (edit.type) {
+			case SequenceEdit::Points:
+				m_journal->appendPoints(edit.pos, edit.numRemoved(), edit.inserted, edit.curPointBefore, m_curPoint);
+				break;
+			case SequenceEdit::Value:
+				m_journal->appendValue(edit.pos, edit.field, edit.newValue, edit.curPointBefore, m_curPoint);
+				break;
+			case SequenceEdit::Timings:
+				m_journal->appendTimings(edit.pos, edit.newTimings, edit.curPointBefore, m_curPoint);
+				break;
+		}
+
+		return;
+	}
+
+	const int pos = edit.pos;
+	const int numRemoved = edit.numRemoved();
+	const int numInserted = edit.numInserted();
+	if (m_batchPos == -1) {
+		m_batchPos = pos;
+		m_batchRemoved = numRemoved;
+		m_batchInserted = numInserted;
+		m_batchCurPointBefore = edit.curPointBefore;
+
+		return;
+	}
+
+	// Merging with the range modified so far by the batch. Before this modification, the merged
+	// range goes from first to end: the points in it that are outside both ranges were not
+	// modified, so each of them replaces itself
+	const int first = std::min(m_batchPos, pos);
+	const int end = std::max(m_batchPos + m_batchInserted, pos + numRemoved);
+	m_batchRemoved += (end - first) - m_batchInserted;
+	m_batchInserted = (end - first) + numInserted - numRemoved;
+	m_batchPos = first;
+}
+
+void Sequence::applyEdit(const SequenceEdit& edit)
+{
+	// Values come from the sequence, but we clamp them anyway in case they were read from a
+	// journal
+	const int numRemoved = edit.numRemoved();
+	const int numInserted = edit.numInserted();
+	switch (edit.type) {
+		case SequenceEdit::Points:
+			// Making room for inserted points or removing the points in excess, then copying
+			// the inserted points
+			if (numInserted > numRemoved) {
+				m_model.beginInsertPoints(edit.pos + numRemoved, edit.pos + numInserted - 1);
+				m_sequence.insertEmpty(edit.pos + numRemoved, numInserted - numRemoved);
+			} else if (numRemoved > numInserted) {
+				m_model.beginRemovePoints(edit.pos + numInserted, edit.pos + numRemoved - 1);
+				m_sequence.remove(edit.pos + numInserted, numRemoved - numInserted);
+			}
+			for (int i = 0; i < numInserted; ++i) {
+				m_sequence.setPoint(edit.pos + i, edit.inserted[i]);
+			}
+			break;
+		case SequenceEdit::Value:
+			if (edit.field == SequenceEdit::durationField) {
+				m_sequence.setDuration(edit.pos, int(edit.newValue));
+			} else if (edit.field == SequenceEdit::timeToTargetField) {
+				m_sequence.setTimeToTarget(edit.pos, int(edit.newValue));
+			} else {
+				m_sequence.setCoordinate(edit.pos, edit.field, edit.newValue);
+			}
+			break;
+		case SequenceEdit::Timings:
+			for (int i = 0; i < numInserted; ++i) {
+				m_sequence.setDuration(edit.pos + i, edit.newTimings[2 * i]);
+				m_sequence.setTimeToTarget(edit.pos + i, edit.newTimings[2 * i + 1]);
+			}
+			break;
+	}
+	if (numInserted != 0) {
+		m_sequence.clamp(edit.pos, edit.pos + numInserted - 1, m_min, m_max);
+	}
+	if (numInserted > numRemoved) {
+		m_model.endInsertPoints();
+	} else if (numRemoved > numInserted) {
+		m_model.endRemovePoints();
+	}
+
+	if (numInserted != numRemoved) {
+		emit numPointsChanged();
+	}
+
+	const int curPoint = m_sequence.isEmpty() ? -1 : qBound(0, edit.curPointAfter, m_sequence.size() - 1);
+	if (curPoint != m_curPoint) {
+		m_curPoint = curPoint;
+
+		emit curPointChanged();
+	}
+
+	journalEdit(edit);
+
+	// If the number of points changed, all points after pos have moved
+	const int last = (numInserted != numRemoved) ? (m_sequence.size() - 1) : (edit.pos + numInserted - 1);
+	if (edit.pos <= last) {
+		pointValuesModified(edit.pos, last);
+	} else {
+		sequenceModified();
+	}
+}
@@ -25,14 +25,39 @@
 #include <QObject>
 #include <QList>
 #include <QJsonDocument>
+#include <QUndoStack>
+#include <QTimer>
 #include "utils.h"
 #include "sequencepoint.h"
+#include "sequenceedit.h"
+#include "sequencemodel.h"
+#include "motionanalysis.h"
+#include "playbackpreview.h"
+#include "sequencesnapshot.h"
+#include "pointstorage.h"
+
+/**
+ * \brief The type used to store the positions of points in a sequence
+ *
+ * Positions are stored as double unless the program is compiled with
+ * SEQUENCE_8BIT_VALUES defined (use CONFIG+=sequence_8bit with qmake). In that
+ * case they are stored as 8 bits integers, which uses an eighth of the memory
+ * but rounds positions to integers (this is what is sent to the hardware)
+ */
+#ifdef SEQUENCE_8BIT_VALUES
+using SequenceValue = quint8;
+#else
+using SequenceValue = double;
+#endif
+
+class SequenceJournal;
 
 /**
  * \brief The class modelling a sequence of points
  *
- * This class stores a list of SequencePoints. It has methods to manage the
- * list, store to file and read it back. When constructed, you must specify the
+ * This class stores a list of SequencePoints (in a PointStorage, so points
+ * returned by functions are copies). It has methods to manage the list, store
+ * to file and read it back. When constructed, you must specify the
  * dimensionality of points (i.e. how many values are there in a point) and the
  * minimum and maximum limit of values. These values cannot be changed. If a
  * SequencePoint having the wrong number of elements is passed to any function,
@@ -44,6 +69,16 @@
  * the JSON document is a list, with the first two points that are respectively
  * the min and max values, and the remaining points the elements of the
  * sequence.
+ * All modifications are recorded in an undo stack (see undoStack()) and, if a
+ * journal has been started (see startJournal()), appended to a file so that
+ * the sequence can be recovered if the program does not terminate normally.
+ * Notifications of changes to the values of points are coalesced: they are
+ * emitted at most once per display frame (about 16 milliseconds), for all the
+ * points that changed in the meantime. Values are always updated immediately,
+ * only signals are delayed (see flushNotifications()). Points are also exposed
+ * as a list model for views (see model()) and checked against the velocity
+ * and acceleration limits of servos (see motion()). The sequence can be played
+ * without hardware with the interpolation of the firmware (see preview()).
  * \note This class makes little checks on the validity of point positions, make
  *       sure you always use valid positions. The current point, instead, always
  *       have a valid value (if the sequence is empty, its value is -1) and is
@@ -59,6 +94,10 @@ class Sequence : public QObject
 	Q_PROPERTY(int numPoints READ numPoints NOTIFY numPointsChanged)
 	Q_PROPERTY(int curPoint READ curPoint WRITE setCurPoint NOTIFY curPointChanged)
 	Q_PROPERTY(bool isModified READ isModified NOTIFY isModifiedChanged)
+	Q_PROPERTY(QUndoStack* undoStack READ undoStack CONSTANT)
+	Q_PROPERTY(SequenceModel* model READ model CONSTANT)
+	Q_PROPERTY(MotionAnalysis* motion READ motion CONSTANT)
+	Q_PROPERTY(PlaybackPreview* preview READ preview CONSTANT)
 
 public:
 	/**
@@ -98,6 +137,13 @@ public:
 	 */
 	Sequence& operator=(Sequence&& other) = delete;
 
+	/**
+	 * \brief Destructor
+	 *
+	 * If a journal was started, it is removed
+	 */
+	virtual ~Sequence();
+
 	/**
 	 * \brief Returns true if the sequence is valid
 	 *
@@ -125,7 +171,7 @@ public:
 	 */
 	int numPoints() const
 	{
-		return m_sequence.length();
+		return m_sequence.size();
 	}
 
 	/**
@@ -163,6 +209,8 @@ public:
 	 *
 	 * This returns a unique_ptr (we cannot retutrn by value because we have
 	 * no copy nor move constructor). The sequence is marked as unmodified.
+	 * The file can be either in JSON or in the binary format (see
+	 * SequenceFile), the format is detected from the content of the file.
 	 * \param filename the name of the file to read
 	 * \return the loaded sequence. The sequence is not valid in case of
 	 *         errors
@@ -189,6 +237,16 @@ public:
 	 */
 	bool save(QString filename) const;
 
+	/**
+	 * \brief Saves the sequence to file in the binary format
+	 *
+	 * See SequenceFile for a description of the format. If successuful, this
+	 * resets the isModified flag to false
+	 * \param filename the name of the file to which the sequence is saved
+	 * \return false in case of error, true otherwise
+	 */
+	bool saveBinary(QString filename) const;
+
 	/**
 	 * \brief Saves the sequence to a JSON document
 	 *
@@ -197,6 +255,88 @@ public:
 	 */
 	QJsonDocument save() const;
 
+	/**
+	 * \brief Returns the stack with the modifications of the sequence
+	 *
+	 * Use it to undo and redo modifications. Commands are pushed by the
+	 * functions modifying the sequence, do not push commands directly
+	 * \return the undo stack of the sequence
+	 */
+	QUndoStack* undoStack()
+	{
+		return &m_undoStack;
+	}
+
+	/**
+	 * \brief Returns the list model of the points of the sequence
+	 *
+	 * \return the list model of the points
+	 */
+	SequenceModel* model()
+	{
+		return &m_model;
+	}
+
+	/**
+	 * \brief Returns the analysis of the motion of the sequence
+	 *
+	 * \return the object checking points against servo limits
+	 */
+	MotionAnalysis* motion()
+	{
+		return &m_motion;
+	}
+
+	/**
+	 * \brief Returns the playback preview of the sequence
+	 *
+	 * \return the object playing the sequence without hardware
+	 */
+	PlaybackPreview* preview()
+	{
+		return &m_preview;
+	}
+
+	/**
+	 * \brief Returns true if an edit can be applied to this sequence
+	 *
+	 * \param edit the edit to check
+	 * \return true if the replaced points are in the sequence and the
+	 *         inserted points have the correct dimension
+	 */
+	bool isApplicable(const SequenceEdit& edit) const;
+
+	/**
+	 * \brief Applies an edit to the sequence
+	 *
+	 * The edit is recorded like all other modifications, so it can be undone.
+	 * Use isApplicable() before calling this if the edit doesn't come from
+	 * this sequence
+	 * \param edit the edit to apply
+	 */
+	void apply(const SequenceEdit& edit);
+
+	/**
+	 * \brief Starts writing the journal of modifications to file
+	 *
+	 * If the sequence is not modified and sequenceFile is not empty, the
+	 * sequence is the content of that file and the journal only refers to
+	 * it, otherwise the journal begins with a snapshot of the current state
+	 * of the sequence (see SequenceJournal::start()). If another journal had
+	 * been started, it is removed. Use SequenceJournal::recover() to read the
+	 * journal back
+	 * \param filename the name of the journal file
+	 * \param sequenceFile the file the sequence was loaded from or saved
+	 *        to, empty if the sequence has never been saved
+	 * \return false in case of error
+	 */
+	bool startJournal(QString filename, QString sequenceFile = QString());
+
+	/**
+	 * \brief Stops writing the journal and removes the journal file
+	 */
+	void stopJournal();
+
 	/**
 	 * \brief Inserts a new point after the current position, equal to the
 	 *        current point
@@ -297,7 +437,15 @@ public:
 	 * \param pos the position in the sequence of the point
 	 * \return the point at the given position
 	 */
-	const SequencePoint& operator[](int pos) const;
+	SequencePoint operator[](int pos) const;
+
+	/**
+	 * \brief Returns a snapshot of the points of the sequence
+	 *
+	 * The snapshot is not affected by later changes to the sequence
+	 * \return a snapshot of the points of the sequence
+	 */
+	SequenceSnapshot snapshot() const;
 
 	/**
 	 * \brief Returns the current point
@@ -306,7 +454,7 @@ public:
 	 * \warning This function does not check if the current point is -1,
 	 *          only use it on a non-empty sequence!
 	 */
-	const SequencePoint& point() const;
+	SequencePoint point() const;
 
 	/**
 	 * \brief Returns a coordinate of a point
@@ -417,6 +565,60 @@ public:
 	 */
 	Q_INVOKABLE void setTimeToTarget(int t);
 
+	/**
+	 * \brief Sets a range of points
+	 *
+	 * Points are validated in a single pass and change signals are emitted
+	 * once (as in a beginUpdate()/endUpdate() block)
+	 * \param pos the position in the sequence of the first point to change.
+	 *            pos + points.size() must not be greater than numPoints()
+	 * \param points the new points
+	 */
+	void setPoints(int pos, const QList<SequencePoint>& points);
+
+	/**
+	 * \brief Multiplies durations and times to target of all points by a
+	 *        factor
+	 *
+	 * Results are clamped within the limits. Change signals are emitted
+	 * once (as in a beginUpdate()/endUpdate() block)
+	 * \param factor the factor to apply
+	 */
+	Q_INVOKABLE void scaleTimings(double factor);
+
+	/**
+	 * \brief Starts a batch of changes
+	 *
+	 * Until the matching endUpdate() is called, changes to the values of
+	 * points do not emit signals: isModifiedChanged() is emitted by
+	 * endUpdate() and the notifications of changes to point values are
+	 * scheduled by it for all changes. Calls can be nested, only the
+	 * outermost endUpdate() has effect. Changes to the number of points or to the current point
+	 * are not delayed. All modifications in the batch are undone as a single
+	 * step and written to the journal as a single edit when the batch ends.
+	 * A batch without modifications leaves nothing on the undo stack
+	 */
+	Q_INVOKABLE void beginUpdate();
+
+	/**
+	 * \brief Ends a batch of changes
+	 *
+	 * See beginUpdate()
+	 */
+	Q_INVOKABLE void endUpdate();
+
+	/**
+	 * \brief Emits now the pending notifications of changes to point
+	 *        values
+	 *
+	 * This emits pointValuesChanged(), pointsValuesChanged() and
+	 * curPointValuesChanged() for all changes made since the last
+	 * notification. It does nothing if there are no pending changes or in a
+	 * batch. It is called automatically by a timer, call it only if you need
+	 * the notifications synchronously
+	 */
+	void flushNotifications();
+
 signals:
 	/**
 	 * \brief The signal emitted when the number of points in the sequence
@@ -432,12 +634,24 @@ signals:
 	/**
 	 * \brief The signal emitted when a point changes
 	 *
-	 * This is emitted whenever the point position, duration or time to
-	 * target changes
+	 * This is emitted when the point position, duration or time to target
+	 * changes, if it is the only point that changed since the last
+	 * notification (see flushNotifications())
 	 * \param pos the position in the sequence of the point that changed
 	 */
 	void pointValuesChanged(int pos);
 
+	/**
+	 * \brief The signal emitted when a range of points changes
+	 *
+	 * This is emitted for all changes to the values of points, once for all
+	 * the changes made since the last notification (see
+	 * flushNotifications())
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void pointsValuesChanged(int first, int last);
+
 	/**
 	 * \brief The signal emitted when one of the values of the current point
 	 *        changes
@@ -454,16 +668,37 @@ signals:
 	void isModifiedChanged();
 
 private:
+	// Sequence files are read directly into the storage of points
+	friend class SequenceFile;
+	// Undo commands apply edits
+	friend class SequenceCommand;
+	// The journal reads the points replaced by recovered edits
+	friend class SequenceJournal;
+	// The motion analysis reads positions directly from the storage
+	friend class MotionAnalysis;
+	// The playback preview too
+	friend class PlaybackPreview;
+
 	/**
 	 * \brief Validates a point eventually changing it so that it has the
 	 *        correct number of coordinates and all values are within the
 	 *        limits
 	 *
+	 * The point is changed in place. The vector of positions is reallocated
+	 * only if it has the wrong size
 	 * \param p the point to validate
-	 * \param skipLimits if true values are not checked to be within limits
-	 * \return the validated point
 	 */
-	SequencePoint validatePoint(SequencePoint p, bool skipLimits = false) const;
+	void validatePoint(SequencePoint& p) const;
+
+	/**
+	 * \brief Records a change to the values of a range of points and
+	 *        schedules its notification
+	 *
+	 * The notification is delayed until the end of the batch if in one
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void pointValuesModified(int first, int last);
 
 	/**
 	 * \brief Sets the sequence as modified and emites the signal if this is
@@ -471,6 +706,78 @@ private:
 	 */
 	void sequenceModified();
 
+	/**
+	 * \brief Returns copies of a range of points
+	 *
+	 * \param pos the position of the first point
+	 * \param count the number of points
+	 * \return the points
+	 */
+	QList<SequencePoint> storedPoints(int pos, int count) const;
+
+	/**
+	 * \brief Returns copies of the durations and times to target of a
+	 *        range of points
+	 *
+	 * \param pos the position of the first point
+	 * \param count the number of points
+	 * \return the timings, with the layout of SequenceEdit::oldTimings
+	 */
+	QVector<int> storedTimings(int pos, int count) const;
+
+	/**
+	 * \brief Records a replacement of points that has already been made
+	 *
+	 * This records a Points edit (see the other overload). The inserted
+	 * points and the current point after the modification are taken from
+	 * the sequence
+	 * \param text the description of the modification
+	 * \param pos the position of the first replaced point
+	 * \param removed the points that were replaced
+	 * \param numInserted the number of points that replaced them
+	 * \param curPointBefore the current point before the modification
+	 */
+	void recordEdit(const QString& text, int pos, QList<SequencePoint> removed, int numInserted, int curPointBefore);
+
+	/**
+	 * \brief Records a modification that has already been made
+	 *
+	 * The edit is written to the journal and pushed on the undo stack
+	 * \param text the description of the modification
+	 * \param edit the modification
+	 */
+	void recordEdit(const QString& text, SequenceEdit edit);
+
+	/**
+	 * \brief Modifies the sequence as described by an edit
+	 *
+	 * This is used to undo and redo modifications. The edit is written to
+	 * the journal but not pushed on the undo stack
+	 * \param edit the edit to apply
+	 */
+	void applyEdit(const SequenceEdit& edit);
+
+	/**
+	 * \brief Pushes a command on the undo stack
+	 *
+	 * In a batch, the macro grouping the commands of the batch is started
+	 * with the first command
+	 * \param command the command to push
+	 */
+	void pushCommand(QUndoCommand* command);
+
+	/**
+	 * \brief Writes a modification that has already been made to the
+	 *        journal
+	 *
+	 * Value and Timings edits are written as such, only with the new values.
+	 * In a batch, the modification is merged with the previous ones of the
+	 * batch and the result is written by endUpdate() as a replacement of
+	 * points
+	 * \param edit the modification
+	 */
+	void journalEdit(const SequenceEdit& edit);
+
 	/**
 	 * \brief The dimensionality of points
 	 *
@@ -493,7 +800,7 @@ private:
 	/**
 	 * \brief The sequence
 	 */
-	QList<SequencePoint> m_sequence;
+	PointStorage<SequenceValue> m_sequence;
 
 	/**
 	 * \brief The current point in the sequence
@@ -502,11 +809,91 @@ private:
 	 */
 	int m_curPoint;
 
+	/**
+	 * \brief The nesting level of beginUpdate() calls
+	 */
+	int m_updateDepth;
+
+	/**
+	 * \brief True if the undo macro of the current batch has been started
+	 */
+	bool m_batchMacroStarted;
+
+	/**
+	 * \brief The position of the first point modified in the current
+	 *        batch, -1 if nothing has been modified
+	 *
+	 * The batch replaced m_batchRemoved points starting here with the
+	 * m_batchInserted points now at this position
+	 */
+	int m_batchPos;
+
+	/**
+	 * \brief The number of points replaced in the current batch
+	 */
+	int m_batchRemoved;
+
+	/**
+	 * \brief The number of points that replaced them
+	 */
+	int m_batchInserted;
+
+	/**
+	 * \brief The current point before the current batch
+	 */
+	int m_batchCurPointBefore;
+
+	/**
+	 * \brief The position of the first point changed since the last
+	 *        notification, -1 if no point changed
+	 */
+	int m_firstChangedPoint;
+
+	/**
+	 * \brief The position of the last point changed since the last
+	 *        notification, -1 if no point changed
+	 */
+	int m_lastChangedPoint;
+
+	/**
+	 * \brief The timer used to coalesce notifications of changes
+	 */
+	QTimer m_notificationTimer;
+
 	/**
 	 * \brief True if this sequence has been modified after construction or
 	 *        after the last time it was saved
 	 */
 	mutable bool m_isModified;
+
+	/**
+	 * \brief The stack with the modifications of the sequence
+	 */
+	QUndoStack m_undoStack;
+
+	/**
+	 * \brief The list model of the points
+	 */
+	SequenceModel m_model;
+
+	/**
+	 * \brief The analysis of velocity and acceleration of points
+	 *
+	 * This must be declared after m_model, it connects to its signals
+	 */
+	MotionAnalysis m_motion;
+
+	/**
+	 * \brief The playback preview of the sequence
+	 *
+	 * This must be declared after m_model, it connects to its signals
+	 */
+	PlaybackPreview m_preview;
+
+	/**
+	 * \brief The journal of modifications, nullptr if not started
+	 */
+	std::unique_ptr<SequenceJournal> m_journal;
 };
 
 #endif // SEQUENCE_H
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencecommand.h"
+#include "sequence.h"
+
+namespace {
+	/**
+	 * \brief The id of commands that can be merged (those with a Value edit)
+	 */
+	const int mergeableCommandId = 1;
+}
+
+SequenceCommand::SequenceCommand(Sequence* sequence, const QString& text, SequenceEdit edit, bool applied)
+	: QUndoCommand(text)
+	, m_sequence(sequence)
+	, m_edit(std::move(edit))
+	, m_skipRedo(applied)
+{
+}
+
+void SequenceCommand::undo()
+{
+	m_sequence->applyEdit(m_edit.inverse());
+}
+
+void SequenceCommand::redo()
+{
+	if (m_skipRedo) {
+		m_skipRedo = false;
+
+		return;
+	}
+
+	m_sequence->applyEdit(m_edit);
+}
+
+int SequenceCommand::id() const
+{
+	return (m_edit.type == SequenceEdit::Value) ? mergeableCommandId : -1;
+}
+
+bool SequenceCommand::mergeWith(const QUndoCommand* other)
+{
+	// Both commands have mergeableCommandId, so other is a SequenceCommand
+	const SequenceCommand* const o = static_cast<const SequenceCommand*>(other);
+
+	if ((o->m_edit.pos != m_edit.pos) || (o->m_edit.field != m_edit.field)) {
+		return false;
+	}
+
+	// The value before this command is kept, the one after is taken from the other command
+	m_edit.newValue = o->m_edit.newValue;
+	m_edit.curPointAfter = o->m_edit.curPointAfter;
+
+	return true;
+}
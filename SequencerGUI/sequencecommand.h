@@ -0,0 +1,96 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCECOMMAND_H
+#define SEQUENCECOMMAND_H
+
+#include <QUndoCommand>
+#include "sequenceedit.h"
+
+class Sequence;
+
+/**
+ * \brief The undo command for a modification of a sequence
+ *
+ * This wraps a SequenceEdit so that it can be pushed on the QUndoStack of the
+ * sequence. Functions of Sequence modify the points directly and then push
+ * the command with applied set to true, so that the first call to redo()
+ * (made by QUndoStack::push()) does nothing. Consecutive Value edits changing
+ * the same value of the same point (e.g. when a slider is dragged) are merged
+ */
+class SequenceCommand : public QUndoCommand
+{
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param sequence the sequence that is modified
+	 * \param text the description of the command
+	 * \param edit the modification of the sequence
+	 * \param applied if true the modification has already been applied to
+	 *        the sequence
+	 */
+	SequenceCommand(Sequence* sequence, const QString& text, SequenceEdit edit, bool applied);
+
+	/**
+	 * \brief Reverts the modification
+	 */
+	virtual void undo() override;
+
+	/**
+	 * \brief Applies the modification
+	 */
+	virtual void redo() override;
+
+	/**
+	 * \brief Returns the id of the command, used by QUndoStack to try
+	 *        merging commands
+	 *
+	 * \return the id of the command, -1 if the command cannot be merged
+	 */
+	virtual int id() const override;
+
+	/**
+	 * \brief Merges a command that follows this one
+	 *
+	 * \param other the command to merge
+	 * \return true if the commands have been merged
+	 */
+	virtual bool mergeWith(const QUndoCommand* other) override;
+
+private:
+	/**
+	 * \brief The sequence that is modified
+	 */
+	Sequence* const m_sequence;
+
+	/**
+	 * \brief The modification of the sequence
+	 */
+	SequenceEdit m_edit;
+
+	/**
+	 * \brief If true the next call to redo() does nothing
+	 */
+	bool m_skipRedo;
+};
+
+#endif // SEQUENCECOMMAND_H
@@ -0,0 +1,103 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequenceedit.h"
+#include <utility>
+
+SequenceEdit SequenceEdit::points(int pos, QList<SequencePoint> removed, QList<SequencePoint> inserted, int curPointBefore, int curPointAfter)
+{
+	SequenceEdit e;
+
+	e.type = Points;
+	e.pos = pos;
+	e.removed = std::move(removed);
+	e.inserted = std::move(inserted);
+	e.field = 0;
+	e.oldValue = 0.0;
+	e.newValue = 0.0;
+	e.curPointBefore = curPointBefore;
+	e.curPointAfter = curPointAfter;
+
+	return e;
+}
+
+SequenceEdit SequenceEdit::value(int pos, int field, double oldValue, double newValue, int curPointBefore, int curPointAfter)
+{
+	SequenceEdit e = points(pos, QList<SequencePoint>(), QList<SequencePoint>(), curPointBefore, curPointAfter);
+
+	e.type = Value;
+	e.field = field;
+	e.oldValue = oldValue;
+	e.newValue = newValue;
+
+	return e;
+}
+
+SequenceEdit SequenceEdit::timings(int pos, QVector<int> oldTimings, QVector<int> newTimings, int curPointBefore, int curPointAfter)
+{
+	SequenceEdit e = points(pos, QList<SequencePoint>(), QList<SequencePoint>(), curPointBefore, curPointAfter);
+
+	e.type = Timings;
+	e.oldTimings = std::move(oldTimings);
+	e.newTimings = std::move(newTimings);
+
+	return e;
+}
+
+SequenceEdit SequenceEdit::inverse() const
+{
+	SequenceEdit e = *this;
+
+	std::swap(e.removed, e.inserted);
+	std::swap(e.oldValue, e.newValue);
+	std::swap(e.oldTimings, e.newTimings);
+	std::swap(e.curPointBefore, e.curPointAfter);
+
+	return e;
+}
+
+int SequenceEdit::numRemoved() const
+{
+	switch (type) {
+		case Points:
+			return removed.size();
+		case Value:
+			return 1;
+		case Timings:
+			return oldTimings.size() / 2;
+	}
+
+	return 0;
+}
+
+int SequenceEdit::numInserted() const
+{
+	switch (type) {
+		case Points:
+			return inserted.size();
+		case Value:
+			return 1;
+		case Timings:
+			return newTimings.size() / 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCEEDIT_H
+#define SEQUENCEEDIT_H
+
+#include <QList>
+#include <QVector>
+#include "sequencepoint.h"
+
+/**
+ * \brief A single modification of a sequence
+ *
+ * Every modification of a sequence is one of three types. A Points edit
+ * replaces a range of points with another one: the points in removed,
+ * starting at pos, are replaced by the points in inserted. Insertions have no
+ * removed point, removals have no inserted point and changes of whole points
+ * have the same number of removed and inserted points. A Value edit changes a
+ * single value of the point at pos (a position, the duration or the time to
+ * target, see field) from oldValue to newValue. A Timings edit changes the
+ * durations and times to target of a range of points starting at pos, from
+ * oldTimings to newTimings. Value and Timings edits only store the values
+ * that change, so that small changes of big sequences stay small. The current
+ * point before and after the modification is also stored. Edits are stored in
+ * the undo stack of the sequence (see SequenceCommand) and in the journal (see
+ * SequenceJournal)
+ */
+struct SequenceEdit
+{
+	/**
+	 * \brief The types of edits
+	 */
+	enum Type {
+		Points,
+		Value,
+		Timings
+	};
+
+	/**
+	 * \brief The field of Value edits changing the duration
+	 */
+	static const int durationField = -2;
+
+	/**
+	 * \brief The field of Value edits changing the time to target
+	 */
+	static const int timeToTargetField = -3;
+
+	/**
+	 * \brief Creates a Points edit
+	 *
+	 * \param pos the position of the first replaced point
+	 * \param removed the points that are removed
+	 * \param inserted the points that are inserted in place of removed ones
+	 * \param curPointBefore the current point before the modification
+	 * \param curPointAfter the current point after the modification
+	 * \return the edit
+	 */
+	static SequenceEdit points(int pos, QList<SequencePoint> removed, QList<SequencePoint> inserted, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Creates a Value edit
+	 *
+	 * \param pos the position of the changed point
+	 * \param field the index of the changed position, durationField or
+	 *        timeToTargetField
+	 * \param oldValue the value before the modification
+	 * \param newValue the value after the modification
+	 * \param curPointBefore the current point before the modification
+	 * \param curPointAfter the current point after the modification
+	 * \return the edit
+	 */
+	static SequenceEdit value(int pos, int field, double oldValue, double newValue, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Creates a Timings edit
+	 *
+	 * \param pos the position of the first changed point
+	 * \param oldTimings the timings before the modification (see
+	 *        oldTimings)
+	 * \param newTimings the timings after the modification. It must have
+	 *        the size of oldTimings
+	 * \param curPointBefore the current point before the modification
+	 * \param curPointAfter the current point after the modification
+	 * \return the edit
+	 */
+	static SequenceEdit timings(int pos, QVector<int> oldTimings, QVector<int> newTimings, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Returns the edit that reverts this one
+	 *
+	 * \return the edit that reverts this one
+	 */
+	SequenceEdit inverse() const;
+
+	/**
+	 * \brief Returns the number of points replaced by the edit
+	 *
+	 * Value and Timings edits replace the points they change
+	 * \return the number of points replaced by the edit
+	 */
+	int numRemoved() const;
+
+	/**
+	 * \brief Returns the number of points that the edit puts in place of
+	 *        the replaced ones
+	 *
+	 * \return the number of points inserted by the edit
+	 */
+	int numInserted() const;
+
+	/**
+	 * \brief The type of the edit
+	 */
+	Type type;
+
+	/**
+	 * \brief The position of the first replaced or changed point
+	 */
+	int pos;
+
+	/**
+	 * \brief The points that are removed (Points edits)
+	 */
+	QList<SequencePoint> removed;
+
+	/**
+	 * \brief The points that are inserted in place of removed ones (Points
+	 *        edits)
+	 */
+	QList<SequencePoint> inserted;
+
+	/**
+	 * \brief The changed value (Value edits)
+	 *
+	 * This is the index of the position, durationField or timeToTargetField
+	 */
+	int field;
+
+	/**
+	 * \brief The value before the modification (Value edits)
+	 */
+	double oldValue;
+
+	/**
+	 * \brief The value after the modification (Value edits)
+	 */
+	double newValue;
+
+	/**
+	 * \brief The timings before the modification (Timings edits)
+	 *
+	 * For each point the duration is followed by the time to target
+	 */
+	QVector<int> oldTimings;
+
+	/**
+	 * \brief The timings after the modification (Timings edits)
+	 *
+	 * For each point the duration is followed by the time to target
+	 */
+	QVector<int> newTimings;
+
+	/**
+	 * \brief The current point before the modification
+	 */
+	int curPointBefore;
+
+	/**
+	 * \brief The current point after the modification
+	 */
+	int curPointAfter;
+};
+
+#endif // SEQUENCEEDIT_H
@@ -0,0 +1,627 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencefile.h"
+#include "sequence.h"
+#include <QByteArray>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+const char* const SequenceFile::binarySuffix = "seqb";
+
+namespace {
+	/**
+	 * \brief The magic string at the beginning of binary files
+	 */
+	const char binaryMagic[] = "SQSEQ";
+
+	/**
+	 * \brief The length of binaryMagic, without the final NUL
+	 */
+	const int binaryMagicSize = 5;
+
+	/**
+	 * \brief The version of the binary format that we read and write
+	 */
+	const quint8 binaryVersion = 1;
+
+	/**
+	 * \brief The size of the header of binary files
+	 */
+	const int binaryHeaderSize = 12;
+
+	/**
+	 * \brief The size of the part of a record before positions
+	 */
+	const int binaryRecordHeaderSize = 8;
+
+	/**
+	 * \brief The size of the buffer used to write the records of binary
+	 *        files
+	 *
+	 * Records are encoded in chunks of this size (or of one record, if
+	 * bigger) and written one chunk at a time, so that the file is never
+	 * entirely in memory
+	 */
+	const int binaryChunkSize = 64 * 1024;
+
+	/**
+	 * \brief The maximum nesting level of JSON values we accept
+	 */
+	const int maxJsonDepth = 64;
+
+	/**
+	 * \brief Returns the size of a record in binary files
+	 *
+	 * \param pointDim the dimension of points
+	 * \return the size of a record
+	 */
+	qint64 binaryRecordSize(int pointDim)
+	{
+		return binaryRecordHeaderSize + pointDim * qint64(sizeof(quint64));
+	}
+
+	/**
+	 * \brief Reads a big endian double
+	 *
+	 * \param data the data to read
+	 * \return the value read
+	 */
+	double readDouble(const uchar* data)
+	{
+		const quint64 bits = qFromBigEndian<quint64>(data);
+		double v;
+		std::memcpy(&v, &bits, sizeof(v));
+
+		return v;
+	}
+
+	/**
+	 * \brief Writes a big endian double
+	 *
+	 * \param v the value to write
+	 * \param data the buffer where the value is written
+	 */
+	void writeDouble(double v, uchar* data)
+	{
+		quint64 bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+
+		qToBigEndian<quint64>(bits, data);
+	}
+
+	/**
+	 * \brief Reads a record of a binary file as a SequencePoint
+	 *
+	 * This is only used for the min and max points
+	 * \param data the record
+	 * \param pointDim the dimension of the point
+	 * \return the point
+	 */
+	SequencePoint readBinaryPoint(const uchar* data, int pointDim)
+	{
+		SequencePoint p(QVector<double>(pointDim), qFromBigEndian<qint32>(data), qFromBigEndian<qint32>(data + 4));
+
+		const uchar* v = data + binaryRecordHeaderSize;
+		for (int c = 0; c < pointDim; ++c, v += sizeof(quint64)) {
+			p.point[c] = readDouble(v);
+		}
+
+		return p;
+	}
+
+	/**
+	 * \brief Writes a SequencePoint as a record of a binary file
+	 *
+	 * \param p the point to write
+	 * \param data the buffer where the record is written
+	 */
+	void writeBinaryPoint(const SequencePoint& p, uchar* data)
+	{
+		qToBigEndian<qint32>(p.duration, data);
+		qToBigEndian<qint32>(p.timeToTarget, data + 4);
+
+		uchar* v = data + binaryRecordHeaderSize;
+		for (int c = 0; c < p.point.size(); ++c, v += sizeof(quint64)) {
+			writeDouble(p.point[c], v);
+		}
+	}
+
+	/**
+	 * \brief An incremental reader of JSON sequence files
+	 *
+	 * This reads values directly from the buffer with the content of the
+	 * file, without building a QJsonDocument. It only knows how to read the
+	 * objects of sequence points, everything else can only be skipped. All
+	 * functions skip whitespaces before reading and return false in case of
+	 * errors, leaving the reader in an unspecified position
+	 */
+	class JsonReader
+	{
+	public:
+		/**
+		 * \brief Constructor
+		 *
+		 * \param data the JSON text. It does not need to be NUL
+		 *        terminated
+		 * \param size the size of data
+		 */
+		JsonReader(const char* data, qint64 size)
+			: m_cur(data)
+			, m_end(data + size)
+		{
+		}
+
+		/**
+		 * \brief Returns true if there is nothing but whitespaces left
+		 *
+		 * \return true if there is nothing but whitespaces left
+		 */
+		bool atEnd()
+		{
+			skipWhitespaces();
+
+			return m_cur == m_end;
+		}
+
+		/**
+		 * \brief Consumes a character if it is the next one
+		 *
+		 * \param c the expected character
+		 * \return true if the next character was c
+		 */
+		bool consume(char c)
+		{
+			skipWhitespaces();
+
+			if ((m_cur == m_end) || (*m_cur != c)) {
+				return false;
+			}
+			++m_cur;
+
+			return true;
+		}
+
+		/**
+		 * \brief Reads a sequence point
+		 *
+		 * This accepts the same objects as SequencePoint::fromJson(): the
+		 * keys can be in any order and unknown keys are ignored
+		 * \param p the point that is filled. Its vector of positions is
+		 *        reused
+		 * \return false in case of error
+		 */
+		bool readPoint(SequencePoint& p)
+		{
+			bool hasPoint = false;
+			bool hasDuration = false;
+			bool hasTimeToTarget = false;
+
+			if (!consume('{')) {
+				return false;
+			}
+			if (consume('}')) {
+				return false;
+			}
+
+			do {
+				if (!readString(m_key) || !consume(':')) {
+					return false;
+				}
+
+				double v;
+				if (m_key == "point") {
+					if (!readNumberArray(p.point)) {
+						return false;
+					}
+					hasPoint = true;
+				} else if (m_key == "duration") {
+					if (!readNumber(v)) {
+						return false;
+					}
+					p.duration = static_cast<int>(v);
+					hasDuration = true;
+				} else if (m_key == "timeToTarget") {
+					if (!readNumber(v)) {
+						return false;
+					}
+					p.timeToTarget = static_cast<int>(v);
+					hasTimeToTarget = true;
+				} else if (!skipValue(0)) {
+					return false;
+				}
+			} while (consume(','));
+
+			return consume('}') && hasPoint && hasDuration && hasTimeToTarget;
+		}
+
+	private:
+		/**
+		 * \brief Moves past whitespaces
+		 */
+		void skipWhitespaces()
+		{
+			while ((m_cur != m_end) && ((*m_cur == ' ') || (*m_cur == '\t') || (*m_cur == '\n') || (*m_cur == '\r'))) {
+				++m_cur;
+			}
+		}
+
+		/**
+		 * \brief Reads a string
+		 *
+		 * Escape sequences are not translated, this is only used for keys
+		 * and we only look for keys without special characters
+		 * \param s the string that is filled
+		 * \return false in case of error
+		 */
+		bool readString(QByteArray& s)
+		{
+			if (!consume('"')) {
+				return false;
+			}
+
+			const char* const start = m_cur;
+			while (m_cur != m_end) {
+				if (*m_cur == '"') {
+					s = QByteArray(start, m_cur - start);
+					++m_cur;
+
+					return true;
+				} else if (*m_cur == '\\') {
+					// Skipping the escaped character, \u is followed by
+					// hexadecimal digits that cannot be a quote
+					++m_cur;
+					if (m_cur == m_end) {
+						return false;
+					}
+				}
+				++m_cur;
+			}
+
+			return false;
+		}
+
+		/**
+		 * \brief Reads a number
+		 *
+		 * \param v the value that is set
+		 * \return false in case of error
+		 */
+		bool readNumber(double& v)
+		{
+			skipWhitespaces();
+
+			const char* const start = m_cur;
+			while ((m_cur != m_end) && (((*m_cur >= '0') && (*m_cur <= '9')) || (*m_cur == '-') || (*m_cur == '+') || (*m_cur == '.') || (*m_cur == 'e') || (*m_cur == 'E'))) {
+				++m_cur;
+			}
+			if (m_cur == start) {
+				return false;
+			}
+
+			// The conversion is always done in the C locale
+			bool ok;
+			v = QByteArray::fromRawData(start, m_cur - start).toDouble(&ok);
+
+			return ok;
+		}
+
+		/**
+		 * \brief Reads an array of numbers
+		 *
+		 * \param a the vector that is filled. Its memory is reused
+		 * \return false in case of error
+		 */
+		bool readNumberArray(QVector<double>& a)
+		{
+			a.resize(0);
+
+			if (!consume('[')) {
+				return false;
+			}
+			if (consume(']')) {
+				return true;
+			}
+
+			do {
+				double v;
+				if (!readNumber(v)) {
+					return false;
+				}
+				a.append(v);
+			} while (consume(','));
+
+			return consume(']');
+		}
+
+		/**
+		 * \brief Moves past a literal
+		 *
+		 * \param literal the literal to skip
+		 * \return false if the next characters are not literal
+		 */
+		bool skipLiteral(const char* literal)
+		{
+			const qint64 len = qint64(std::strlen(literal));
+			if (((m_end - m_cur) < len) || (std::memcmp(m_cur, literal, len) != 0)) {
+				return false;
+			}
+			m_cur += len;
+
+			return true;
+		}
+
+		/**
+		 * \brief Moves past a value of any type
+		 *
+		 * \param depth the nesting level of the value
+		 * \return false in case of error
+		 */
+		bool skipValue(int depth)
+		{
+			if (depth > maxJsonDepth) {
+				return false;
+			}
+
+			skipWhitespaces();
+			if (m_cur == m_end) {
+				return false;
+			}
+
+			QByteArray s;
+			double v;
+			switch (*m_cur) {
+				case '"':
+					return readString(s);
+				case 't':
+					return skipLiteral("true");
+				case 'f':
+					return skipLiteral("false");
+				case 'n':
+					return skipLiteral("null");
+				case '[':
+					++m_cur;
+					if (consume(']')) {
+						return true;
+					}
+					do {
+						if (!skipValue(depth + 1)) {
+							return false;
+						}
+					} while (consume(','));
+
+					return consume(']');
+				case '{':
+					++m_cur;
+					if (consume('}')) {
+						return true;
+					}
+					do {
+						if (!readString(s) || !consume(':') || !skipValue(depth + 1)) {
+							return false;
+						}
+					} while (consume(','));
+
+					return consume('}');
+				default:
+					return readNumber(v);
+			}
+		}
+
+		/**
+		 * \brief The next character to read
+		 */
+		const char* m_cur;
+
+		/**
+		 * \brief The end of the JSON text
+		 */
+		const char* const m_end;
+
+		/**
+		 * \brief The buffer for keys, reused for all objects
+		 */
+		QByteArray m_key;
+	};
+}
+
+bool SequenceFile::isBinary(const uchar* data, qint64 size)
+{
+	return (size >= binaryMagicSize) && (std::memcmp(data, binaryMagic, binaryMagicSize) == 0);
+}
+
+qint64 SequenceFile::binarySize(const uchar* data, qint64 size)
+{
+	if (!isBinary(data, size) || (size < binaryHeaderSize) || (data[binaryMagicSize] != binaryVersion)) {
+		return -1;
+	}
+
+	const int pointDim = qFromBigEndian<quint16>(data + 6);
+	const quint32 numPoints = qFromBigEndian<quint32>(data + 8);
+	if (numPoints > quint32(std::numeric_limits<int>::max())) {
+		return -1;
+	}
+
+	return binaryHeaderSize + (qint64(numPoints) + 2) * binaryRecordSize(pointDim);
+}
+
+std::unique_ptr<Sequence> SequenceFile::readBinary(const uchar* data, qint64 size)
+{
+	// The size of the file must match exactly the one in the header
+	const qint64 fileSize = binarySize(data, size);
+	if ((fileSize == -1) || (size != fileSize)) {
+		return std::make_unique<Sequence>();
+	}
+
+	const int pointDim = qFromBigEndian<quint16>(data + 6);
+	const int n = int(qFromBigEndian<quint32>(data + 8));
+	const qint64 recordSize = binaryRecordSize(pointDim);
+
+	const uchar* record = data + binaryHeaderSize;
+	const SequencePoint minPoint = readBinaryPoint(record, pointDim);
+	record += recordSize;
+	const SequencePoint maxPoint = readBinaryPoint(record, pointDim);
+	record += recordSize;
+
+	std::unique_ptr<Sequence> s = std::make_unique<Sequence>(pointDim, minPoint, maxPoint);
+
+	// Decoding records directly into the storage, then validating all points
+	// in a single pass
+	PointStorage<SequenceValue>& storage = s->m_sequence;
+	storage.resize(n);
+	for (int i = 0; i < n; ++i, record += recordSize) {
+		storage.setDuration(i, qFromBigEndian<qint32>(record));
+		storage.setTimeToTarget(i, qFromBigEndian<qint32>(record + 4));
+
+		const uchar* v = record + binaryRecordHeaderSize;
+		for (int c = 0; c < pointDim; ++c, v += sizeof(quint64)) {
+			storage.setCoordinate(i, c, readDouble(v));
+		}
+	}
+	if (n != 0) {
+		storage.clamp(0, n - 1, s->m_min, s->m_max);
+		s->m_curPoint = 0;
+	}
+
+	// m_isModified remains false
+
+	return s;
+}
+
+std::unique_ptr<Sequence> SequenceFile::readJson(const char* data, qint64 size)
+{
+	// Here we expect an array of SequencePoints, the first two are the min
+	// and the max. The sequence is created as soon as we have both, the
+	// other points are appended directly to its storage
+	JsonReader reader(data, size);
+	if (!reader.consume('[')) {
+		return std::make_unique<Sequence>();
+	}
+
+	std::unique_ptr<Sequence> s;
+	SequencePoint sp;
+	SequencePoint minPoint;
+	int index = 0;
+	if (!reader.consume(']')) {
+		do {
+			if (!reader.readPoint(sp)) {
+				return std::make_unique<Sequence>();
+			}
+
+			// Checking all points have the same dimension
+			if ((index != 0) && (sp.point.size() != minPoint.point.size())) {
+				return std::make_unique<Sequence>();
+			}
+
+			if (index == 0) {
+				minPoint = sp;
+			} else if (index == 1) {
+				s = std::make_unique<Sequence>(minPoint.point.size(), minPoint, sp);
+			} else {
+				s->m_sequence.append(sp);
+			}
+			++index;
+		} while (reader.consume(','));
+
+		if (!reader.consume(']')) {
+			return std::make_unique<Sequence>();
+		}
+	}
+
+	if (!reader.atEnd() || (index < 1)) {
+		return std::make_unique<Sequence>();
+	}
+
+	// If there is only the min, the max has all values set to 0
+	if (index == 1) {
+		return std::make_unique<Sequence>(minPoint.point.size(), minPoint, SequencePoint(QVector<double>(minPoint.point.size()), 0, 0));
+	}
+
+	// Validating all points in a single pass
+	const int n = s->m_sequence.size();
+	if (n != 0) {
+		s->m_sequence.clamp(0, n - 1, s->m_min, s->m_max);
+		s->m_curPoint = 0;
+	}
+
+	// m_isModified remains false
+
+	return s;
+}
+
+bool SequenceFile::writeBinary(const Sequence& sequence, QIODevice& device)
+{
+	const int pointDim = sequence.pointDim();
+	if (pointDim > std::numeric_limits<quint16>::max()) {
+		return false;
+	}
+
+	// With at most 65535 positions a record is smaller than 512 KiB, so chunks are int-sized
+	const PointStorage<SequenceValue>& storage = sequence.m_sequence;
+	const int recordSize = int(binaryRecordSize(pointDim));
+	const int recordsPerChunk = std::max(1, binaryChunkSize / recordSize);
+	QByteArray chunk(std::max(binaryHeaderSize + 2 * recordSize, recordsPerChunk * recordSize), '\0');
+	uchar* const data = reinterpret_cast<uchar*>(chunk.data());
+
+	// The header, followed by the min and max records
+	std::memcpy(data, binaryMagic, binaryMagicSize);
+	data[binaryMagicSize] = binaryVersion;
+	qToBigEndian<quint16>(pointDim, data + 6);
+	qToBigEndian<quint32>(storage.size(), data + 8);
+	writeBinaryPoint(sequence.min(), data + binaryHeaderSize);
+	writeBinaryPoint(sequence.max(), data + binaryHeaderSize + recordSize);
+
+	qint64 chunkSize = binaryHeaderSize + 2 * recordSize;
+	if (device.write(chunk.constData(), chunkSize) != chunkSize) {
+		return false;
+	}
+
+	for (int first = 0; first < storage.size(); first += recordsPerChunk) {
+		const int last = std::min(first + recordsPerChunk, storage.size());
+
+		uchar* record = data;
+		for (int i = first; i < last; ++i, record += recordSize) {
+			qToBigEndian<qint32>(storage.duration(i), record);
+			qToBigEndian<qint32>(storage.timeToTarget(i), record + 4);
+
+			uchar* v = record + binaryRecordHeaderSize;
+			for (int c = 0; c < pointDim; ++c, v += sizeof(quint64)) {
+				writeDouble(storage.coordinate(i, c), v);
+			}
+		}
+
+		chunkSize = qint64(last - first) * recordSize;
+		if (device.write(chunk.constData(), chunkSize) != chunkSize) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SequenceFile::hasBinarySuffix(const QString& filename)
+{
+	return QFileInfo(filename).suffix() == QLatin1String(binarySuffix);
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCEFILE_H
+#define SEQUENCEFILE_H
+
+#include <QtGlobal>
+#include <memory>
+
+class QIODevice;
+class QString;
+class Sequence;
+
+/**
+ * \brief Functions to read and write sequence files
+ *
+ * Sequences can be stored in two formats. The JSON format is the one used for
+ * interchange: it is an array of points where the first two elements are the
+ * min and max of points (see Sequence::save()). The binary format is compact
+ * and can be read without parsing: all numbers are big endian and the file is
+ * made up of a header followed by an array of fixed-size records. The header
+ * is:
+ *	- the magic string "SQSEQ" (5 bytes);
+ *	- the version of the format, currently 1 (1 byte);
+ *	- the dimension of points (2 bytes);
+ *	- the number of points, not counting min and max (4 bytes).
+ * Then follow the records of the min point, of the max point and of all
+ * points of the sequence. Each record is:
+ *	- the duration (4 bytes, signed);
+ *	- the time to target (4 bytes, signed);
+ *	- the positions as IEEE 754 doubles (8 bytes each).
+ * Binary files are memory mapped and points are decoded directly into the
+ * storage of the sequence, they are written in chunks of records so that a
+ * copy of the whole file is never built in memory. JSON files are read with an incremental parser
+ * that does not build a QJsonDocument.
+ * All functions here report errors by returning an invalid sequence or false
+ */
+class SequenceFile
+{
+public:
+	/**
+	 * \brief The suffix of binary sequence files
+	 */
+	static const char* const binarySuffix;
+
+	/**
+	 * \brief Returns true if data is the beginning of a binary sequence file
+	 *
+	 * \param data the data to check
+	 * \param size the size of data
+	 * \return true if data starts with the magic string of binary files
+	 */
+	static bool isBinary(const uchar* data, qint64 size);
+
+	/**
+	 * \brief Returns the size of a binary file as written in its header
+	 *
+	 * \param data the beginning of the file. It can be followed by other
+	 *        data
+	 * \param size the size of data
+	 * \return the size of the file, -1 if data does not start with the
+	 *         header of a binary file that we can read
+	 */
+	static qint64 binarySize(const uchar* data, qint64 size);
+
+	/**
+	 * \brief Reads a sequence from a binary file
+	 *
+	 * \param data the content of the file
+	 * \param size the size of data
+	 * \return the loaded sequence. The sequence is not valid in case of
+	 *         errors
+	 */
+	static std::unique_ptr<Sequence> readBinary(const uchar* data, qint64 size);
+
+	/**
+	 * \brief Reads a sequence from a JSON file
+	 *
+	 * \param data the content of the file. It does not need to be NUL
+	 *        terminated
+	 * \param size the size of data
+	 * \return the loaded sequence. The sequence is not valid in case of
+	 *         errors
+	 */
+	static std::unique_ptr<Sequence> readJson(const char* data, qint64 size);
+
+	/**
+	 * \brief Writes a sequence in the binary format
+	 *
+	 * \param sequence the sequence to write. It must be valid
+	 * \param device the device where the sequence is written
+	 * \return false in case of error
+	 */
+	static bool writeBinary(const Sequence& sequence, QIODevice& device);
+
+	/**
+	 * \brief Returns true if the file should be saved in the binary format
+	 *
+	 * This only checks the suffix of the file name
+	 * \param filename the name of the file
+	 * \return true if filename has the suffix of binary files
+	 */
+	static bool hasBinarySuffix(const QString& filename);
+
+	/**
+	 * \brief Deleted constructor, this class only has static functions
+	 */
+	SequenceFile() = delete;
+};
+
+#endif // SEQUENCEFILE_H
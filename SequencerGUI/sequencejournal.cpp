@@ -0,0 +1,280 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencejournal.h"
+#include "sequence.h"
+#include "sequencefile.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+namespace {
+	/**
+	 * \brief The magic number at the beginning of journal files
+	 */
+	const quint32 journalMagic = 0x53514A52;
+
+	/**
+	 * \brief The version of the journal format that we read and write
+	 */
+	const quint8 journalVersion = 3;
+
+	/**
+	 * \brief The version of QDataStream used for journals
+	 */
+	const QDataStream::Version journalStreamVersion = QDataStream::Qt_5_0;
+
+	/**
+	 * \brief The type of the saved state of journals with a snapshot
+	 */
+	const quint8 snapshotState = 0;
+
+	/**
+	 * \brief The type of the saved state of journals referring to a file
+	 */
+	const quint8 fileState = 1;
+
+	/**
+	 * \brief Reads the snapshot of a journal
+	 *
+	 * The snapshot starts at the current position of the file, which is
+	 * moved after the snapshot
+	 * \param f the journal file
+	 * \return the sequence in the snapshot. The sequence is not valid in
+	 *         case of errors
+	 */
+	std::unique_ptr<Sequence> readSnapshot(QFile& f)
+	{
+		// Mapping the rest of the file to avoid copying the snapshot, as in Sequence::load()
+		const qint64 start = f.pos();
+		qint64 available = f.size() - start;
+		const uchar* data = (available > 0) ? f.map(start, available) : nullptr;
+		QByteArray content;
+		if (data == nullptr) {
+			content = f.read(available);
+			data = reinterpret_cast<const uchar*>(content.constData());
+			available = content.size();
+		}
+
+		const qint64 size = SequenceFile::binarySize(data, available);
+		if ((size < 0) || (size > available)) {
+			return std::make_unique<Sequence>();
+		}
+
+		std::unique_ptr<Sequence> s = SequenceFile::readBinary(data, size);
+		f.seek(start + size);
+
+		return s;
+	}
+
+	/**
+	 * \brief Reads the file a journal refers to
+	 *
+	 * \param in the stream of the journal, at the beginning of the reference
+	 * \return the sequence in the file. The sequence is not valid in case of
+	 *         errors or if the file changed after the journal was started
+	 */
+	std::unique_ptr<Sequence> readReferencedFile(QDataStream& in)
+	{
+		QString filename;
+		qint64 size;
+		qint64 modificationTime;
+		in >> filename >> size >> modificationTime;
+		if (in.status() != QDataStream::Ok) {
+			return std::make_unique<Sequence>();
+		}
+
+		const QFileInfo info(filename);
+		if (!info.exists() || (info.size() != size) || (info.lastModified().toMSecsSinceEpoch() != modificationTime)) {
+			qDebug() << "SequenceJournal: the file" << filename << "changed after the journal was started";
+			return std::make_unique<Sequence>();
+		}
+
+		return Sequence::load(filename);
+	}
+}
+
+SequenceJournal::SequenceJournal(QString filename)
+	: m_file(filename)
+	, m_stream()
+{
+	m_stream.setVersion(journalStreamVersion);
+}
+
+SequenceJournal::~SequenceJournal()
+{
+	if (m_file.isOpen()) {
+		m_file.close();
+		m_file.remove();
+	}
+}
+
+bool SequenceJournal::start(const Sequence& sequence, QString sequenceFile)
+{
+	m_stream.setDevice(nullptr);
+	m_file.close();
+
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qDebug() << "SequenceJournal error: cannot start the journal" << m_file.fileName();
+
+		return false;
+	}
+
+	m_stream.setDevice(&m_file);
+	m_stream << journalMagic << journalVersion;
+
+	// The snapshot is written directly to the file, after the header
+	const QFileInfo info(sequenceFile);
+	if (!sequenceFile.isEmpty() && !sequence.isModified() && info.exists()) {
+		m_stream << fileState << info.absoluteFilePath() << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch());
+	} else {
+		m_stream << snapshotState;
+		if (!SequenceFile::writeBinary(sequence, m_file)) {
+			qDebug() << "SequenceJournal error: cannot write the snapshot to the journal" << m_file.fileName();
+
+			return false;
+		}
+	}
+
+	return m_file.flush() && (m_stream.status() == QDataStream::Ok);
+}
+
+bool SequenceJournal::appendPoints(int pos, int numRemoved, const QList<SequencePoint>& inserted, int curPointBefore, int curPointAfter)
+{
+	if (!m_file.isOpen()) {
+		return false;
+	}
+
+	m_stream << quint8(SequenceEdit::Points) << qint32(pos) << qint32(numRemoved) << inserted;
+
+	return endEdit(curPointBefore, curPointAfter);
+}
+
+bool SequenceJournal::appendValue(int pos, int field, double value, int curPointBefore, int curPointAfter)
+{
+	if (!m_file.isOpen()) {
+		return false;
+	}
+
+	m_stream << quint8(SequenceEdit::Value) << qint32(pos) << qint32(field) << value;
+
+	return endEdit(curPointBefore, curPointAfter);
+}
+
+bool SequenceJournal::appendTimings(int pos, const QVector<int>& timings, int curPointBefore, int curPointAfter)
+{
+	if (!m_file.isOpen()) {
+		return false;
+	}
+
+	m_stream << quint8(SequenceEdit::Timings) << qint32(pos) << timings;
+
+	return endEdit(curPointBefore, curPointAfter);
+}
+
+std::unique_ptr<Sequence> SequenceJournal::recover(QString filename)
+{
+	QFile f(filename);
+
+	if (!f.open(QIODevice::ReadOnly)) {
+		return std::make_unique<Sequence>();
+	}
+
+	QDataStream in(&f);
+	in.setVersion(journalStreamVersion);
+
+	quint32 magic;
+	quint8 version;
+	quint8 state;
+	in >> magic >> version >> state;
+	if ((in.status() != QDataStream::Ok) || (magic != journalMagic) || (version != journalVersion) || ((state != snapshotState) && (state != fileState))) {
+		return std::make_unique<Sequence>();
+	}
+
+	std::unique_ptr<Sequence> s = (state == snapshotState) ? readSnapshot(f) : readReferencedFile(in);
+	if (!s->isValid()) {
+		return s;
+	}
+
+	// Replaying edits, stopping at the first one that is truncated or that
+	// doesn't fit the sequence
+	while (!in.atEnd()) {
+		quint8 type;
+		qint32 pos;
+		qint32 numRemoved = 0;
+		QList<SequencePoint> inserted;
+		qint32 field = 0;
+		double value = 0.0;
+		QVector<qint32> timings;
+		qint32 curPointBefore;
+		qint32 curPointAfter;
+		in >> type >> pos;
+		if (type == SequenceEdit::Points) {
+			in >> numRemoved >> inserted;
+		} else if (type == SequenceEdit::Value) {
+			in >> field >> value;
+		} else if (type == SequenceEdit::Timings) {
+			in >> timings;
+		} else {
+			qDebug() << "SequenceJournal: ignoring an edit of unknown type in" << filename;
+			break;
+		}
+		in >> curPointBefore >> curPointAfter;
+		if (in.status() != QDataStream::Ok) {
+			qDebug() << "SequenceJournal: ignoring a truncated edit at the end of" << filename;
+			break;
+		}
+
+		// The old values are the ones the edit replaces now, they are only read once the
+		// range of the edit is known to be inside the sequence
+		const int numChanged = (type == SequenceEdit::Points) ? numRemoved : ((type == SequenceEdit::Value) ? 1 : (timings.size() / 2));
+		if ((pos < 0) || (numChanged < 0) || (pos > (s->numPoints() - numChanged))) {
+			qDebug() << "SequenceJournal: ignoring an edit that does not match the sequence in" << filename;
+			break;
+		}
+		SequenceEdit e;
+		if (type == SequenceEdit::Points) {
+			e = SequenceEdit::points(pos, s->storedPoints(pos, numRemoved), inserted, curPointBefore, curPointAfter);
+		} else if (type == SequenceEdit::Value) {
+			e = SequenceEdit::value(pos, field, 0.0, value, curPointBefore, curPointAfter);
+		} else {
+			e = SequenceEdit::timings(pos, s->storedTimings(pos, numChanged), timings, curPointBefore, curPointAfter);
+		}
+		if (!s->isApplicable(e)) {
+			qDebug() << "SequenceJournal: ignoring an edit that does not match the sequence in" << filename;
+			break;
+		}
+		if (type == SequenceEdit::Value) {
+			e.oldValue = (field == SequenceEdit::durationField) ? s->pointDuration(pos) : ((field == SequenceEdit::timeToTargetField) ? s->pointTimeToTarget(pos) : s->pointCoordinate(pos, field));
+		}
+
+		s->apply(e);
+	}
+
+	return s;
+}
+
+bool SequenceJournal::endEdit(int curPointBefore, int curPointAfter)
+{
+	m_stream << qint32(curPointBefore) << qint32(curPointAfter);
+
+	return m_file.flush() && (m_stream.status() == QDataStream::Ok);
+}
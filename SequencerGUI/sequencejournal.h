@@ -0,0 +1,192 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCEJOURNAL_H
+#define SEQUENCEJOURNAL_H
+
+#include <QFile>
+#include <QDataStream>
+#include <QString>
+#include <memory>
+#include "sequenceedit.h"
+
+class Sequence;
+
+/**
+ * \brief The on-disk journal of the modifications of a sequence
+ *
+ * The journal starts with the state of the sequence, followed by all the
+ * edits made to the sequence afterwards, undo and redo included (a batch of
+ * changes, see Sequence::beginUpdate(), is a single edit). When the sequence
+ * is the content of a saved file, the journal only refers to the file (its
+ * name, size and modification time), otherwise it contains a snapshot of the
+ * sequence in the binary format of SequenceFile. Starting the journal after a
+ * sequence is loaded or saved is then a constant time operation. Each edit is
+ * appended and flushed as soon as it is made, so the cost does not depend on
+ * the size of the sequence and, if the program crashes, the sequence can be
+ * recovered by replaying the edits onto the saved state (see recover()).
+ * Edits only store the new values: the old ones are those of the sequence
+ * when the edit is replayed. A journal that is written to a file until its
+ * end without errors is a QDataStream with:
+ *	- the magic number 0x53514A52 (quint32);
+ *	- the version of the format, currently 3 (quint8);
+ *	- the type of the saved state (quint8), 0 for a snapshot and 1 for a
+ *	  reference to a file;
+ *	- for snapshots, the sequence in the binary format of SequenceFile (not
+ *	  as a QByteArray, its size is in its header). For references, the
+ *	  absolute name of the file (QString), its size in bytes (qint64) and
+ *	  its modification time in milliseconds since the epoch (qint64);
+ *	- the edits, until the end of the file. Each edit has a type (quint8,
+ *	  the value of SequenceEdit::Type) and the position of the first changed
+ *	  point (qint32). Then Points edits have the number of replaced points
+ *	  (qint32) and the inserted points (QList<SequencePoint>), Value edits
+ *	  have the changed field (qint32, see SequenceEdit::field) and the new
+ *	  value (double), Timings edits have the new timings (QVector<qint32>,
+ *	  see SequenceEdit::newTimings). All edits end with the current point
+ *	  before and after the edit (qint32).
+ * The journal cannot be recovered if the referenced file has been changed.
+ * The file is removed when the journal is destroyed, so it only survives if
+ * the program does not terminate normally
+ */
+class SequenceJournal
+{
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param filename the name of the journal file
+	 */
+	explicit SequenceJournal(QString filename);
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	SequenceJournal(const SequenceJournal& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	SequenceJournal& operator=(const SequenceJournal& other) = delete;
+
+	/**
+	 * \brief Destructor
+	 *
+	 * Closes and removes the journal file
+	 */
+	~SequenceJournal();
+
+	/**
+	 * \brief Returns the name of the journal file
+	 *
+	 * \return the name of the journal file
+	 */
+	QString filename() const
+	{
+		return m_file.fileName();
+	}
+
+	/**
+	 * \brief Starts the journal with the state of the sequence
+	 *
+	 * If the file exists it is overwritten
+	 * \param sequence the sequence. It must be valid
+	 * \param sequenceFile the file with the content of the sequence. If
+	 *        empty or if the sequence is modified, a snapshot of the
+	 *        sequence is written instead
+	 * \return false in case of error
+	 */
+	bool start(const Sequence& sequence, QString sequenceFile = QString());
+
+	/**
+	 * \brief Appends a Points edit to the journal
+	 *
+	 * \param pos the position of the first replaced point
+	 * \param numRemoved the number of replaced points
+	 * \param inserted the points that replace them
+	 * \param curPointBefore the current point before the edit
+	 * \param curPointAfter the current point after the edit
+	 * \return false in case of error or if the journal has not been
+	 *         started
+	 */
+	bool appendPoints(int pos, int numRemoved, const QList<SequencePoint>& inserted, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Appends a Value edit to the journal
+	 *
+	 * \param pos the position of the changed point
+	 * \param field the changed value (see SequenceEdit::field)
+	 * \param value the new value
+	 * \param curPointBefore the current point before the edit
+	 * \param curPointAfter the current point after the edit
+	 * \return false in case of error or if the journal has not been
+	 *         started
+	 */
+	bool appendValue(int pos, int field, double value, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Appends a Timings edit to the journal
+	 *
+	 * \param pos the position of the first changed point
+	 * \param timings the new timings (see SequenceEdit::newTimings)
+	 * \param curPointBefore the current point before the edit
+	 * \param curPointAfter the current point after the edit
+	 * \return false in case of error or if the journal has not been
+	 *         started
+	 */
+	bool appendTimings(int pos, const QVector<int>& timings, int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief Recovers a sequence from a journal file
+	 *
+	 * The edits are applied to the saved state with Sequence::apply(), so
+	 * they can be undone and the recovered sequence is marked as modified if
+	 * there is at least one edit. An edit that was only partially written
+	 * and everything after it are ignored
+	 * \param filename the name of the journal file
+	 * \return the recovered sequence. The sequence is not valid in case of
+	 *         errors or if the file the journal refers to has changed
+	 */
+	static std::unique_ptr<Sequence> recover(QString filename);
+
+private:
+	/**
+	 * \brief Writes the end of an edit and flushes the file
+	 *
+	 * \param curPointBefore the current point before the edit
+	 * \param curPointAfter the current point after the edit
+	 * \return false in case of error
+	 */
+	bool endEdit(int curPointBefore, int curPointAfter);
+
+	/**
+	 * \brief The journal file
+	 */
+	QFile m_file;
+
+	/**
+	 * \brief The stream used to write to m_file
+	 */
+	QDataStream m_stream;
+};
+
+#endif // SEQUENCEJOURNAL_H
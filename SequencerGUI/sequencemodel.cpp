@@ -0,0 +1,160 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencemodel.h"
+#include "sequence.h"
+
+SequenceModel::SequenceModel(Sequence* sequence)
+	: QAbstractListModel(sequence)
+	, m_sequence(sequence)
+{
+	connect(m_sequence, &Sequence::pointsValuesChanged, this, &SequenceModel::pointsValuesChanged);
+}
+
+int SequenceModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.isValid()) {
+		return 0;
+	}
+
+	return m_sequence->numPoints();
+}
+
+QVariant SequenceModel::data(const QModelIndex& index, int role) const
+{
+	if (!isValidRow(index)) {
+		return QVariant();
+	}
+
+	const int pos = index.row();
+	switch (role) {
+		case ChannelsRole:
+			{
+				QVariantList channels;
+				channels.reserve(m_sequence->pointDim());
+				for (unsigned int c = 0; c < m_sequence->pointDim(); ++c) {
+					channels.append(m_sequence->pointCoordinate(pos, c));
+				}
+
+				return channels;
+			}
+		case DurationRole:
+			return m_sequence->pointDuration(pos);
+		case TimeToTargetRole:
+			return m_sequence->pointTimeToTarget(pos);
+		case TooFastRole:
+			return m_sequence->motion()->isViolating(pos);
+		default:
+			return QVariant();
+	}
+}
+
+bool SequenceModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+	if (!isValidRow(index)) {
+		return false;
+	}
+
+	const int pos = index.row();
+	switch (role) {
+		case ChannelsRole:
+			{
+				const QVariantList channels = value.toList();
+
+				// All positions are changed in a batch, so that the change is notified once
+				m_sequence->beginUpdate();
+				for (int c = 0; (c < channels.size()) && (c < int(m_sequence->pointDim())); ++c) {
+					m_sequence->setPointCoordinate(pos, c, channels[c].toDouble());
+				}
+				m_sequence->endUpdate();
+			}
+			break;
+		case DurationRole:
+			m_sequence->setDuration(pos, value.toInt());
+			break;
+		case TimeToTargetRole:
+			m_sequence->setTimeToTarget(pos, value.toInt());
+			break;
+		default:
+			return false;
+	}
+
+	// Views expect dataChanged() to be emitted before setData() returns
+	m_sequence->flushNotifications();
+
+	return true;
+}
+
+Qt::ItemFlags SequenceModel::flags(const QModelIndex& index) const
+{
+	if (!isValidRow(index)) {
+		return Qt::NoItemFlags;
+	}
+
+	return QAbstractListModel::flags(index) | Qt::ItemIsEditable;
+}
+
+QHash<int, QByteArray> SequenceModel::roleNames() const
+{
+	QHash<int, QByteArray> names;
+
+	names[ChannelsRole] = "channels";
+	names[DurationRole] = "duration";
+	names[TimeToTargetRole] = "timeToTarget";
+	names[TooFastRole] = "tooFast";
+
+	return names;
+}
+
+void SequenceModel::beginInsertPoints(int first, int last)
+{
+	beginInsertRows(QModelIndex(), first, last);
+}
+
+void SequenceModel::endInsertPoints()
+{
+	endInsertRows();
+}
+
+void SequenceModel::beginRemovePoints(int first, int last)
+{
+	beginRemoveRows(QModelIndex(), first, last);
+}
+
+void SequenceModel::endRemovePoints()
+{
+	endRemoveRows();
+}
+
+void SequenceModel::pointsValuesChanged(int first, int last)
+{
+	emit dataChanged(index(first), index(last), QVector<int>() << ChannelsRole << DurationRole << TimeToTargetRole);
+}
+
+void SequenceModel::motionResultsChanged(int first, int last)
+{
+	emit dataChanged(index(first), index(last), QVector<int>() << TooFastRole);
+}
+
+bool SequenceModel::isValidRow(const QModelIndex& index) const
+{
+	return index.isValid() && !index.parent().isValid() && (index.row() < m_sequence->numPoints());
+}
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCEMODEL_H
+#define SEQUENCEMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QByteArray>
+
+class Sequence;
+
+/**
+ * \brief The list model of the points of a sequence
+ *
+ * This exposes the points of a Sequence to views (e.g. a QML ListView): there
+ * is one row per point and the values of points are accessed through roles.
+ * The model has no data of its own, everything is read from the sequence when
+ * requested, so only visible rows cost memory. The sequence notifies the model
+ * when points are inserted or removed, changes to the values of points are
+ * notified with dataChanged() for the range of points that changed (see
+ * Sequence::pointsValuesChanged()). The model is created and owned by the
+ * sequence, get it with Sequence::model()
+ */
+class SequenceModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * \brief The roles of the model
+	 */
+	enum Roles {
+		/// The positions of the point (a list of numbers)
+		ChannelsRole = Qt::UserRole + 1,
+		/// The duration of the point in milliseconds
+		DurationRole,
+		/// The time to reach the point in milliseconds
+		TimeToTargetRole,
+		/// True if reaching the point exceeds the limits of servos (see
+		/// MotionAnalysis)
+		TooFastRole
+	};
+
+	/**
+	 * \brief Constructor
+	 *
+	 * \param sequence the sequence whose points are exposed. It is also the
+	 *        parent of this object
+	 */
+	explicit SequenceModel(Sequence* sequence);
+
+	/**
+	 * \brief Returns the number of rows
+	 *
+	 * \param parent the parent index, this is a list so it has no children
+	 *        if valid
+	 * \return the number of points in the sequence
+	 */
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+	/**
+	 * \brief Returns the data of a point
+	 *
+	 * \param index the index of the point
+	 * \param role one of the Roles
+	 * \return the requested value or an invalid QVariant in case of errors
+	 */
+	virtual QVariant data(const QModelIndex& index, int role) const override;
+
+	/**
+	 * \brief Changes the data of a point
+	 *
+	 * Values are clamped by the sequence as all other changes
+	 * \param index the index of the point
+	 * \param value the new value
+	 * \param role one of the Roles
+	 * \return false in case of errors
+	 */
+	virtual bool setData(const QModelIndex& index, const QVariant& value, int role) override;
+
+	/**
+	 * \brief Returns the flags of an item
+	 *
+	 * \param index the index of the point
+	 * \return the flags of the item, all points are editable
+	 */
+	virtual Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+	/**
+	 * \brief Returns the names of the roles
+	 *
+	 * These are the names to use in QML delegates: channels, duration,
+	 * timeToTarget and tooFast
+	 * \return the names of the roles
+	 */
+	virtual QHash<int, QByteArray> roleNames() const override;
+
+private:
+	// The sequence notifies insertions and removals
+	friend class Sequence;
+
+	/**
+	 * \brief Must be called by the sequence before points are inserted
+	 *
+	 * \param first the position of the first inserted point
+	 * \param last the position of the last inserted point
+	 */
+	void beginInsertPoints(int first, int last);
+
+	/**
+	 * \brief Must be called by the sequence after points are inserted
+	 */
+	void endInsertPoints();
+
+	/**
+	 * \brief Must be called by the sequence before points are removed
+	 *
+	 * \param first the position of the first removed point
+	 * \param last the position of the last removed point
+	 */
+	void beginRemovePoints(int first, int last);
+
+	/**
+	 * \brief Must be called by the sequence after points are removed
+	 */
+	void endRemovePoints();
+
+	/**
+	 * \brief The slot called when the values of a range of points change
+	 *
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void pointsValuesChanged(int first, int last);
+
+	/**
+	 * \brief The slot called when the motion analysis of a range of points
+	 *        changes
+	 *
+	 * \param first the position of the first point that changed
+	 * \param last the position of the last point that changed
+	 */
+	void motionResultsChanged(int first, int last);
+
+	/**
+	 * \brief Returns true if index refers to a point in the sequence
+	 *
+	 * \param index the index to check
+	 * \return true if index is a valid row
+	 */
+	bool isValidRow(const QModelIndex& index) const;
+
+	/**
+	 * \brief The sequence whose points are exposed
+	 */
+	Sequence* const m_sequence;
+};
+
+#endif // SEQUENCEMODEL_H
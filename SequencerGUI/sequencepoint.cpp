@@ -91,3 +91,20 @@ bool SequencePoint::operator==(const SequencePoint& other) const
 	       (other.timeToTarget == timeToTarget) &&
 	       (other.point == point);
 }
+
+QDataStream& operator<<(QDataStream& stream, const SequencePoint& p)
+{
+	return stream << p.point << qint32(p.duration) << qint32(p.timeToTarget);
+}
+
+QDataStream& operator>>(QDataStream& stream, SequencePoint& p)
+{
+	qint32 d;
+	qint32 t;
+	stream >> p.point >> d >> t;
+
+	p.duration = d;
+	p.timeToTarget = t;
+
+	return stream;
+}
@@ -23,7 +23,9 @@
 #define SEQUENCEPOINT_H
 
 #include <QVector>
+#include <QDataStream>
 #include <QJsonObject>
+#include <QMetaType>
 #include "utils.h"
 
 /**
@@ -89,5 +91,26 @@ struct SequencePoint
 	int timeToTarget;
 };
 
+/**
+ * \brief Writes a point to a data stream
+ *
+ * \param stream the stream
+ * \param p the point to write
+ * \return the stream
+ */
+QDataStream& operator<<(QDataStream& stream, const SequencePoint& p);
+
+/**
+ * \brief Reads a point from a data stream
+ *
+ * \param stream the stream
+ * \param p the point that is read
+ * \return the stream
+ */
+QDataStream& operator>>(QDataStream& stream, SequencePoint& p);
+
+// Points are passed between threads with queued connections
+Q_DECLARE_METATYPE(SequencePoint)
+
 #endif // SEQUENCEPOINT_H
 
@@ -20,41 +20,191 @@
  ******************************************************************************/
 
 #include "sequencer.h"
+#include "sequencefile.h"
+#include "sequencejournal.h"
+#include <QDir>
 #include <QFile>
+#include <QStandardPaths>
 #include <QUrl>
 #include <QDebug>
 
-// ONLY FOR TESTING, CHANGE!!!
 namespace {
-	const unsigned int pointDim = 16;
-	const SequencePoint minPoint(QVector<double>(pointDim, 0), 3, 1);
-	const SequencePoint maxPoint(QVector<double>(pointDim, 255), 3000, 10000);
+	/**
+	 * \brief Returns the name of the file where the calibration profile is
+	 *        kept
+	 *
+	 * \return the name of the file of the calibration profile
+	 */
+	QString calibrationFilename()
+	{
+		const QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+		QDir().mkpath(dir);
+
+		return dir + "/calibration.json";
+	}
+
+	/**
+	 * \brief Returns the calibration profile kept in the data directory
+	 *
+	 * \return the calibration profile or the default one if there is no
+	 *         valid profile in the data directory
+	 */
+	CalibrationProfile storedCalibration()
+	{
+		const QString filename = calibrationFilename();
+		if (!QFile::exists(filename)) {
+			return CalibrationProfile::defaultProfile();
+		}
+
+		const CalibrationProfile p = CalibrationProfile::load(filename);
+		if (!p.isValid()) {
+			qDebug() << "Sequencer error: invalid calibration profile" << filename << "using the default one";
+
+			return CalibrationProfile::defaultProfile();
+		}
+
+		return p;
+	}
+
+	/**
+	 * \brief Returns the name of the journal of a sequence file
+	 *
+	 * \param filename the name of the sequence file, empty if the sequence
+	 *        has never been saved
+	 * \return the name of the journal file
+	 */
+	QString journalFilename(const QString& filename)
+	{
+		if (!filename.isEmpty()) {
+			return filename + ".journal";
+		}
+
+		const QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+		QDir().mkpath(dir);
+
+		return dir + "/untitled.journal";
+	}
+
+	/**
+	 * \brief Recovers a sequence from its journal, if present
+	 *
+	 * \param filename the name of the sequence file, empty if the sequence
+	 *        has never been saved
+	 * \return the recovered sequence or nullptr if there is no valid journal
+	 */
+	std::unique_ptr<Sequence> recoverSequence(const QString& filename)
+	{
+		const QString journal = journalFilename(filename);
+
+		if (!QFile::exists(journal)) {
+			return nullptr;
+		}
+
+		std::unique_ptr<Sequence> s = SequenceJournal::recover(journal);
+		if (!s->isValid()) {
+			qDebug() << "Sequencer error: cannot recover the sequence from the journal" << journal;
+
+			return nullptr;
+		}
+		qDebug() << "Sequencer: recovered unsaved modifications from the journal" << journal;
+
+		return s;
+	}
 }
 
 Sequencer::Sequencer(QObject *parent)
 	: QObject(parent)
-	, m_sequence(std::make_unique<Sequence>(pointDim, minPoint, maxPoint))
-	, m_serialCommunication(std::make_unique<SerialCommunication>())
+	, m_sequence()
+	, m_filename()
+	, m_deviceManager(std::make_unique<DeviceManager>())
+	, m_calibration(storedCalibration())
 {
+	// If the program didn't terminate normally, the last unsaved sequence can be recovered
+	std::unique_ptr<Sequence> s = recoverSequence(QString());
+	if (!s) {
+		s = std::make_unique<Sequence>(m_calibration.numChannels(), m_calibration.minPoint(), m_calibration.maxPoint());
+	}
+
+	setSequence(std::move(s), QString());
 }
 
 void Sequencer::newSequence()
 {
-	m_sequence = std::make_unique<Sequence>(pointDim, minPoint, maxPoint);
+	setSequence(std::make_unique<Sequence>(m_calibration.numChannels(), m_calibration.minPoint(), m_calibration.maxPoint()), QString());
 
 	emit sequenceChanged();
 }
 
 bool Sequencer::saveSequence(QString filename)
 {
-	return m_sequence->save(QUrl(filename).toLocalFile());
+	const QString localFile = QUrl(filename).toLocalFile();
+
+	const bool saved = SequenceFile::hasBinarySuffix(localFile) ? m_sequence->saveBinary(localFile) : m_sequence->save(localFile);
+	if (!saved) {
+		return false;
+	}
+
+	// The journal restarts from the saved file, it only refers to it
+	m_filename = localFile;
+	m_sequence->startJournal(journalFilename(m_filename), m_filename);
+
+	return true;
 }
 
 bool Sequencer::loadSequence(QString filename)
 {
-	m_sequence = Sequence::load(QUrl(filename).toLocalFile());
+	const QString localFile = QUrl(filename).toLocalFile();
+
+	// Removing the journal of the current sequence first, it could be the journal of the file
+	// we are about to open
+	m_sequence->stopJournal();
+
+	// If the file has a journal, the program didn't terminate normally while the file was open
+	std::unique_ptr<Sequence> s = recoverSequence(localFile);
+	if (!s) {
+		s = Sequence::load(localFile);
+	}
+	setSequence(std::move(s), localFile);
 
 	emit sequenceChanged();
 
 	return m_sequence->isValid();
 }
+
+bool Sequencer::loadCalibration(QString filename)
+{
+	const QString localFile = QUrl(filename).toLocalFile();
+
+	const CalibrationProfile p = CalibrationProfile::load(localFile);
+	if (!p.isValid()) {
+		return false;
+	}
+	m_calibration = p;
+
+	// Keeping a copy, so that the profile is used again at the next start
+	if (!m_calibration.save(calibrationFilename())) {
+		qDebug() << "Sequencer error: cannot save the calibration profile in the data directory";
+	}
+
+	if (serialCommunication()->isConnected()) {
+		serialCommunication()->sendCalibration(m_calibration);
+	}
+
+	return true;
+}
+
+void Sequencer::setSequence(std::unique_ptr<Sequence> sequence, QString filename)
+{
+	// The journal of the old sequence must be removed before the new one is started, they could
+	// have the same name
+	if (m_sequence) {
+		m_sequence->stopJournal();
+	}
+
+	m_sequence = std::move(sequence);
+	m_filename = filename;
+
+	if (m_sequence->isValid() && !m_sequence->startJournal(journalFilename(m_filename), m_filename)) {
+		qDebug() << "Sequencer error: cannot write the journal of the sequence, modifications will not be recoverable";
+	}
+}
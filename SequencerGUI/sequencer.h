@@ -26,20 +26,31 @@
 #include "utils.h"
 #include "sequence.h"
 #include "serialcommunication.h"
+#include "devicemanager.h"
+#include "calibrationprofile.h"
 
 /**
  * \brief The main class of the applications
  *
  * This class is meant to be instantiated only once and to be used as the QML
- * context object. It contanins the instances of the current sequence and the
- * object used for serial communication (exposed as read-only properties). It
- * also has methods to load and save sequence files.
+ * context object. It contanins the instances of the current sequence, the
+ * object used for serial communication and the object handling more hardware
+ * (exposed as read-only properties). It
+ * also has methods to load and save sequence files. The modifications of the
+ * current sequence are written to a journal (see SequenceJournal) next to the
+ * sequence file, or in the data directory of the application for sequences
+ * that have never been saved. If the journal is found when a sequence is
+ * opened, the modifications that were not saved are recovered. New sequences
+ * have the number of channels and the limits of the calibration profile of the
+ * robot (see CalibrationProfile), which is kept in the data directory of the
+ * application so that it is used again the next time the program starts.
  */
 class Sequencer : public QObject
 {
 	Q_OBJECT
 	Q_PROPERTY(Sequence* sequence READ sequence NOTIFY sequenceChanged)
 	Q_PROPERTY(SerialCommunication* serialCommunication READ serialCommunication NOTIFY serialCommunicationChanged)
+	Q_PROPERTY(DeviceManager* deviceManager READ deviceManager NOTIFY deviceManagerChanged)
 
 public:
 	/**
@@ -93,11 +104,22 @@ public:
 	/**
 	 * \brief Returns the object to use for serial communication
 	 *
+	 * This is the first device of the device manager
 	 * \return the object to use for serial communication
 	 */
 	SerialCommunication* serialCommunication()
 	{
-		return m_serialCommunication.get();
+		return m_deviceManager->device(0);
+	}
+
+	/**
+	 * \brief Returns the object handling more hardware
+	 *
+	 * \return the object handling more hardware
+	 */
+	DeviceManager* deviceManager()
+	{
+		return m_deviceManager.get();
 	}
 
 signals:
@@ -115,6 +137,14 @@ signals:
 	 */
 	void serialCommunicationChanged();
 
+	/**
+	 * \brief The signal emitted when the device manager changes
+	 *
+	 * This is never emitted, it is here for the same reason of
+	 * serialCommunicationChanged()
+	 */
+	void deviceManagerChanged();
+
 public slots:
 	/**
 	 * \brief Creates a new sequence, discarding the old one
@@ -124,6 +154,8 @@ public slots:
 	/**
 	 * \brief Saves the sequence to file
 	 *
+	 * The sequence is saved in the binary format if the file has the suffix
+	 * of binary sequence files, in JSON otherwise
 	 * \param filename the name of the file where the sequence is to be
 	 *        saved
 	 * \return true if saving was successful
@@ -133,21 +165,55 @@ public slots:
 	/**
 	 * \brief Loads a sequence file
 	 *
+	 * Both JSON and binary files can be loaded
 	 * \param filename the name of the file to load
 	 * \return true if loading was successful
 	 */
 	bool loadSequence(QString filename);
 
+	/**
+	 * \brief Loads the calibration profile of the robot
+	 *
+	 * The profile is used for new sequences (the current one keeps its
+	 * limits) and is sent to the hardware if the serial port is open
+	 * \param filename the name of the file to load
+	 * \return true if loading was successful
+	 */
+	bool loadCalibration(QString filename);
+
 private:
+	/**
+	 * \brief Replaces the current sequence and starts its journal
+	 *
+	 * \param sequence the new sequence
+	 * \param filename the name of the file of the sequence, empty if the
+	 *        sequence has never been saved
+	 */
+	void setSequence(std::unique_ptr<Sequence> sequence, QString filename);
+
 	/**
 	 * \brief The current sequence
 	 */
 	std::unique_ptr<Sequence> m_sequence;
 
 	/**
-	 * \brief The object for serial communication
+	 * \brief The name of the file of the current sequence
+	 *
+	 * This is empty if the sequence has never been saved
+	 */
+	QString m_filename;
+
+	/**
+	 * \brief The object handling the hardware
+	 *
+	 * Its first device is the object for serial communication
+	 */
+	std::unique_ptr<DeviceManager> m_deviceManager;
+
+	/**
+	 * \brief The calibration profile used for new sequences
 	 */
-	std::unique_ptr<SerialCommunication> m_serialCommunication;
+	CalibrationProfile m_calibration;
 };
 
 #endif // SEQUENCER_H
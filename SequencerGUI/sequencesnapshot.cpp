@@ -0,0 +1,112 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "sequencesnapshot.h"
+#include <algorithm>
+
+SequenceSnapshot::SequenceSnapshot()
+	: m_pointDim(0)
+	, m_numPoints(0)
+	, m_data()
+	, m_profiles()
+	, m_sourcePoints()
+{
+}
+
+SequenceSnapshot::SequenceSnapshot(int pointDim, int numPoints)
+	: m_pointDim(pointDim)
+	, m_numPoints(numPoints)
+	, m_data(numPoints * (recordHeaderSize + pointDim), '\0')
+	, m_profiles()
+	, m_sourcePoints()
+{
+}
+
+int SequenceSnapshot::duration(int pos) const
+{
+	const unsigned char* const r = reinterpret_cast<const unsigned char*>(record(pos));
+
+	return (r[0] << 8) | r[1];
+}
+
+int SequenceSnapshot::timeToTarget(int pos) const
+{
+	const unsigned char* const r = reinterpret_cast<const unsigned char*>(record(pos));
+
+	return (r[2] << 8) | r[3];
+}
+
+int SequenceSnapshot::value(int pos, int c) const
+{
+	return static_cast<unsigned char>(record(pos)[recordHeaderSize + c]);
+}
+
+void SequenceSnapshot::setProfile(int pos, int startSlope, int endSlope)
+{
+	// Profiles are only allocated the first time one is set
+	if (m_profiles.isEmpty()) {
+		m_profiles.fill(char(linearSlope), 2 * m_numPoints);
+	}
+
+	m_profiles[2 * pos] = char(qBound(0, startSlope, int(maxSlope)));
+	m_profiles[2 * pos + 1] = char(qBound(0, endSlope, int(maxSlope)));
+}
+
+void SequenceSnapshot::setSourcePoint(int pos, int source)
+{
+	// Source points are only allocated the first time one is set
+	if (m_sourcePoints.isEmpty()) {
+		m_sourcePoints.resize(m_numPoints);
+		for (int i = 0; i < m_numPoints; ++i) {
+			m_sourcePoints[i] = i;
+		}
+	}
+
+	m_sourcePoints[pos] = source;
+}
+
+int SequenceSnapshot::pointForSource(int source) const
+{
+	if (m_sourcePoints.isEmpty()) {
+		return qMin(source, m_numPoints - 1);
+	}
+
+	// Source points are increasing
+	const auto it = std::lower_bound(m_sourcePoints.constBegin(), m_sourcePoints.constEnd(), source);
+
+	return qMin(int(it - m_sourcePoints.constBegin()), m_numPoints - 1);
+}
+
+void SequenceSnapshot::packPoint(const SequencePoint& p, char* record)
+{
+	// Point duration
+	record[0] = (p.duration >> 8) & 0xFF;
+	record[1] = p.duration & 0xFF;
+
+	// Point time to target
+	record[2] = (p.timeToTarget >> 8) & 0xFF;
+	record[3] = p.timeToTarget & 0xFF;
+
+	// Values
+	for (int c = 0; c < p.point.size(); ++c) {
+		record[recordHeaderSize + c] = static_cast<unsigned int>(p.point[c]) & 0xFF;
+	}
+}
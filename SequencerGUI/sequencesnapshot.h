@@ -0,0 +1,306 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef SEQUENCESNAPSHOT_H
+#define SEQUENCESNAPSHOT_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QMetaType>
+#include "sequencepoint.h"
+
+/**
+ * \brief An immutable copy of the points of a sequence, packed as they are
+ *        sent to the hardware
+ *
+ * All points are stored in a single contiguous buffer, one record per point.
+ * Each record has the layout of the content of a sequence packet (see
+ * StreamEngine): duration (2 bytes, most significant byte first) - time to
+ * target (2 bytes, most significant byte first) - positions (one byte per
+ * point dimension). The buffer is implicitly shared, so copying a snapshot
+ * (e.g. to pass it to another thread) is cheap, and records can be sent or
+ * compared without converting them.
+ * Snapshots produced by TrajectoryCompiler also have an easing profile for
+ * each point (the slopes at the start and at the end of the motion, in Q6
+ * fixed point as in the firmware) and the position of the point of the
+ * original sequence each point ends at. Both are stored apart from records
+ * and only allocated when set, other snapshots have linear profiles and each
+ * point is its own source point.
+ */
+class SequenceSnapshot
+{
+public:
+	/**
+	 * \brief The size in bytes of the part of a record before positions
+	 */
+	static const int recordHeaderSize = 4;
+
+	/**
+	 * \brief The slope of the linear easing profile
+	 */
+	static const int linearSlope = 64;
+
+	/**
+	 * \brief The maximum slope of easing profiles
+	 */
+	static const int maxSlope = 192;
+
+	/**
+	 * \brief Constructor
+	 *
+	 * Creates an empty snapshot
+	 */
+	SequenceSnapshot();
+
+	/**
+	 * \brief Constructor
+	 *
+	 * Creates a snapshot with the given number of points, all with zero
+	 * values. Use setPoint() to fill it
+	 * \param pointDim the dimension of each point
+	 * \param numPoints the number of points
+	 */
+	SequenceSnapshot(int pointDim, int numPoints);
+
+	/**
+	 * \brief Returns the dimension of each point
+	 *
+	 * \return the dimension of each point
+	 */
+	int pointDim() const
+	{
+		return m_pointDim;
+	}
+
+	/**
+	 * \brief Returns the number of points
+	 *
+	 * \return the number of points
+	 */
+	int numPoints() const
+	{
+		return m_numPoints;
+	}
+
+	/**
+	 * \brief Returns true if there are no points
+	 *
+	 * \return true if there are no points
+	 */
+	bool isEmpty() const
+	{
+		return m_numPoints == 0;
+	}
+
+	/**
+	 * \brief Returns the size in bytes of the record of a point
+	 *
+	 * \return the size in bytes of the record of a point
+	 */
+	int recordSize() const
+	{
+		return recordHeaderSize + m_pointDim;
+	}
+
+	/**
+	 * \brief Returns the record of a point
+	 *
+	 * \param pos the position of the point
+	 * \return a pointer to the first byte of the record of the point
+	 */
+	const char* record(int pos) const
+	{
+		return m_data.constData() + pos * recordSize();
+	}
+
+	/**
+	 * \brief Returns the duration of a point
+	 *
+	 * \param pos the position of the point
+	 * \return the duration of the point in milliseconds
+	 */
+	int duration(int pos) const;
+
+	/**
+	 * \brief Returns the time to target of a point
+	 *
+	 * \param pos the position of the point
+	 * \return the time to target of the point in milliseconds
+	 */
+	int timeToTarget(int pos) const;
+
+	/**
+	 * \brief Returns a position of a point
+	 *
+	 * \param pos the position of the point
+	 * \param c the index of the position
+	 * \return the value of the position
+	 */
+	int value(int pos, int c) const;
+
+	/**
+	 * \brief Sets a point
+	 *
+	 * Positions are converted to 8 bits as in sequence packets. Only call
+	 * this while filling a new snapshot, before it is copied
+	 * \param pos the position of the point
+	 * \param d the duration of the point in milliseconds
+	 * \param t the time to target of the point in milliseconds
+	 * \param values the pointDim() positions of the point
+	 */
+	template <class ValueT>
+	void setPoint(int pos, int d, int t, const ValueT* values)
+	{
+		char* const r = m_data.data() + pos * recordSize();
+
+		r[0] = (d >> 8) & 0xFF;
+		r[1] = d & 0xFF;
+		r[2] = (t >> 8) & 0xFF;
+		r[3] = t & 0xFF;
+		for (int c = 0; c < m_pointDim; ++c) {
+			r[recordHeaderSize + c] = static_cast<unsigned int>(values[c]) & 0xFF;
+		}
+	}
+
+	/**
+	 * \brief Returns true if the point has the linear easing profile
+	 *
+	 * \param pos the position of the point
+	 * \return true if the point has the linear easing profile
+	 */
+	bool isLinear(int pos) const
+	{
+		return (startSlope(pos) == linearSlope) && (endSlope(pos) == linearSlope);
+	}
+
+	/**
+	 * \brief Returns the slope of the easing profile at the start of the
+	 *        motion of a point
+	 *
+	 * \param pos the position of the point
+	 * \return the slope in Q6 fixed point
+	 */
+	int startSlope(int pos) const
+	{
+		return m_profiles.isEmpty() ? linearSlope : static_cast<unsigned char>(m_profiles[2 * pos]);
+	}
+
+	/**
+	 * \brief Returns the slope of the easing profile at the end of the
+	 *        motion of a point
+	 *
+	 * \param pos the position of the point
+	 * \return the slope in Q6 fixed point
+	 */
+	int endSlope(int pos) const
+	{
+		return m_profiles.isEmpty() ? linearSlope : static_cast<unsigned char>(m_profiles[2 * pos + 1]);
+	}
+
+	/**
+	 * \brief Sets the easing profile of a point
+	 *
+	 * Slopes are clamped between 0 and maxSlope. Only call this while
+	 * filling a new snapshot, before it is copied
+	 * \param pos the position of the point
+	 * \param startSlope the slope at the start of the motion in Q6 fixed
+	 *                   point
+	 * \param endSlope the slope at the end of the motion in Q6 fixed point
+	 */
+	void setProfile(int pos, int startSlope, int endSlope);
+
+	/**
+	 * \brief Returns the position of the point of the original sequence a
+	 *        point ends at
+	 *
+	 * \param pos the position of the point
+	 * \return the position of the source point
+	 */
+	int sourcePoint(int pos) const
+	{
+		return m_sourcePoints.isEmpty() ? pos : m_sourcePoints[pos];
+	}
+
+	/**
+	 * \brief Sets the position of the point of the original sequence a
+	 *        point ends at
+	 *
+	 * Source points must be increasing. Only call this while filling a new
+	 * snapshot, before it is copied
+	 * \param pos the position of the point
+	 * \param source the position of the source point
+	 */
+	void setSourcePoint(int pos, int source);
+
+	/**
+	 * \brief Returns the position of the first point whose source point is
+	 *        not before the given one
+	 *
+	 * \param source the position of the point in the original sequence
+	 * \return the position of the point, numPoints() - 1 if source is
+	 *         after all source points
+	 */
+	int pointForSource(int source) const;
+
+	/**
+	 * \brief Writes the record for a point
+	 *
+	 * \param p the point to pack
+	 * \param record the buffer where the record is written. It must have
+	 *               room for recordHeaderSize + p.point.size() bytes
+	 */
+	static void packPoint(const SequencePoint& p, char* record);
+
+private:
+	/**
+	 * \brief The dimension of each point
+	 */
+	int m_pointDim;
+
+	/**
+	 * \brief The number of points
+	 */
+	int m_numPoints;
+
+	/**
+	 * \brief The records of all points
+	 */
+	QByteArray m_data;
+
+	/**
+	 * \brief The slopes of the easing profiles of all points
+	 *
+	 * Two bytes per point, empty if all points are linear
+	 */
+	QByteArray m_profiles;
+
+	/**
+	 * \brief The source points of all points
+	 *
+	 * Empty if each point is its own source point
+	 */
+	QVector<int> m_sourcePoints;
+};
+
+// Snapshots are passed between threads with queued connections
+Q_DECLARE_METATYPE(SequenceSnapshot)
+
+#endif // SEQUENCESNAPSHOT_H
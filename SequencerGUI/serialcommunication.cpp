@@ -26,32 +26,72 @@ SerialCommunication::SerialCommunication(QObject* parent)
 	: QObject(parent)
 	, m_serialPortName("/dev/ttyUSB4")
 	, m_baudRate(115200)
+	, m_streamBaudRate(500000)
+	, m_linkBaudRate(-1)
 	, m_oneShotSequence(true)
-	, m_serialPort()
+	, m_compileTrajectory(false)
+	, m_trajectoryTolerance(1.0)
+	, m_trajectoryEasing(true)
+	, m_clockSync(false)
+	, m_isClockSynced(false)
+	, m_clockRoundTrip(-1)
+	, m_clockDrift(0.0)
+	, m_thread()
+	, m_engine(new StreamEngine())
+	, m_isConnected(false)
+	, m_isCapturing(false)
+	, m_mode(StreamEngine::NoMode)
 	, m_sequence(nullptr)
-	, m_isStreamMode(false)
-	, m_isImmediateMode(false)
-	, m_arduinoBoot()
-	, m_incomingData()
-	, m_indexToProcess(0)
 	, m_paused(false)
-	, m_hardwareQueueFull(false)
+	, m_uploadedPoints(0)
+	, m_playhead(-1)
+	, m_hardwareBufferSize(-1)
 	, m_batteryCharge(-1.0)
-	, m_stopping(false)
+	, m_taskOverruns()
+	, m_telemetry()
+	, m_statistics()
 {
-	// Connecting signals from the serial port
-	connect(&m_serialPort, &QSerialPort::readyRead, this, &SerialCommunication::handleReadyRead);
-	connect(&m_serialPort, static_cast<void (QSerialPort::*)(QSerialPort::SerialPortError)>(&QSerialPort::error), this, &SerialCommunication::handleError);
-
-	// Connecting the signal for the Arduino boot timer. Also setting the timer to be singleShot
-	m_arduinoBoot.setSingleShot(true);
-	connect(&m_arduinoBoot, &QTimer::timeout, this, &SerialCommunication::arduinoBootFinished);
+	// Points are passed to the stream engine through queued connections
+	qRegisterMetaType<SequencePoint>();
+	qRegisterMetaType<SequenceSnapshot>();
+	qRegisterMetaType<CalibrationProfile>();
+	qRegisterMetaType<HardwareTelemetry>();
+	qRegisterMetaType<StreamStatistics>();
+
+	// Moving the engine to its thread. It is deleted by the thread when it finishes
+	m_engine->moveToThread(&m_thread);
+	connect(&m_thread, &QThread::finished, m_engine, &QObject::deleteLater);
+
+	// Connecting the signals of the engine. They are queued, because the engine lives in
+	// another thread
+	connect(m_engine, &StreamEngine::connectedChanged, this, &SerialCommunication::setIsConnected);
+	connect(m_engine, &StreamEngine::capturingChanged, this, &SerialCommunication::setIsCapturing);
+	connect(m_engine, &StreamEngine::modeChanged, this, &SerialCommunication::setMode);
+	connect(m_engine, &StreamEngine::pausedChanged, this, &SerialCommunication::setIsPaused);
+	connect(m_engine, &StreamEngine::playheadChanged, this, &SerialCommunication::setPlayhead);
+	connect(m_engine, &StreamEngine::uploadedPointsChanged, this, &SerialCommunication::setUploadedPoints);
+	connect(m_engine, &StreamEngine::uploadFinished, this, &SerialCommunication::uploadFinished);
+	connect(m_engine, &StreamEngine::calibrationSet, this, &SerialCommunication::calibrationSet);
+	connect(m_engine, &StreamEngine::streamError, this, &SerialCommunication::streamError);
+	connect(m_engine, &StreamEngine::debugMessage, this, &SerialCommunication::debugMessage);
+	connect(m_engine, &StreamEngine::batteryChargeChanged, this, &SerialCommunication::setBatteryCharge);
+	connect(m_engine, &StreamEngine::taskOverrunsChanged, this, &SerialCommunication::setTaskOverruns);
+	connect(m_engine, &StreamEngine::telemetryChanged, this, &SerialCommunication::setTelemetry);
+	connect(m_engine, &StreamEngine::hardwareBufferSizeChanged, this, &SerialCommunication::setHardwareBufferSize);
+	connect(m_engine, &StreamEngine::linkBaudRateChanged, this, &SerialCommunication::setLinkBaudRate);
+	connect(m_engine, &StreamEngine::statisticsChanged, this, &SerialCommunication::setStatistics);
+	connect(m_engine, &StreamEngine::clockSyncChanged, this, &SerialCommunication::setClockSyncState);
+
+	m_thread.start();
 }
 
 SerialCommunication::~SerialCommunication()
 {
-	stop();
-	closeSerial();
+	callEngine("stop");
+	callEngine("closeSerial");
+
+	m_thread.quit();
+	m_thread.wait();
 }
 
 void SerialCommunication::setSerialPortName(QString serialPortName)
@@ -72,304 +112,160 @@ void SerialCommunication::SerialCommunication::setBaudRate(int baudRate)
 	}
 }
 
+void SerialCommunication::setStreamBaudRate(int streamBaudRate)
+{
+	if (streamBaudRate != m_streamBaudRate) {
+		m_streamBaudRate = streamBaudRate;
+
+		emit streamBaudRateChanged();
+	}
+}
+
 void SerialCommunication::setOneShotSequence(bool oneShot)
 {
 	if (oneShot != m_oneShotSequence) {
 		m_oneShotSequence  = oneShot;
 
+		QMetaObject::invokeMethod(m_engine, "setOneShotSequence", Qt::QueuedConnection, Q_ARG(bool, m_oneShotSequence));
+
 		emit oneShotSequenceChanged();
 	}
 }
 
-bool SerialCommunication::openSerial()
+void SerialCommunication::setCompileTrajectory(bool compile)
 {
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot open port while a sequence is being streamed";
-		return false;
-	}
-
-	// Closing the old port
-	closeSerial();
+	if (compile != m_compileTrajectory) {
+		m_compileTrajectory = compile;
+		updateTrajectoryCompilation();
 
-	// Setting the name and baud rate of the port
-	m_serialPort.setPortName(m_serialPortName);
-	m_serialPort.setBaudRate(m_baudRate);
-
-	// Trying to open the port
-	if (!m_serialPort.open(QIODevice::ReadWrite)) {
-		return false;
+		emit compileTrajectoryChanged();
 	}
-
-	// Signalling that the port is open
-	emit isConnectedChanged();
-
-	// This is necessary to give time to Arduino to "boot" (the board reboots every time the serial port
-	// is opened, and then there are 0.5 seconds taken by the bootloader)
-	m_arduinoBoot.start(1000);
-
-	return true;
 }
 
-bool SerialCommunication::closeSerial()
+void SerialCommunication::setTrajectoryTolerance(double tolerance)
 {
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot close port while a sequence is being streamed";
-		return false;
-	}
+	if (tolerance != m_trajectoryTolerance) {
+		m_trajectoryTolerance = tolerance;
+		updateTrajectoryCompilation();
 
-	// Closing the port
-	if (m_serialPort.isOpen()) {
-		m_serialPort.close();
-		m_serialPort.clearError();
-
-		// Signalling that the port is closed
-		emit isConnectedChanged();
-
-		// Setting the battery charge to -1.0
-		setBatteryCharge(-1.0);
+		emit trajectoryToleranceChanged();
 	}
-
-	return true;
 }
 
-bool SerialCommunication::startStream(Sequence* sequence, bool startFromCurrent)
+void SerialCommunication::setTrajectoryEasing(bool easing)
 {
-	if (!m_serialPort.isOpen()) {
-		qDebug() << "SerialCommunication error: cannot start streaming with a closed serial port";
-		return false;
-	}
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot start a new stream while a sequence is already being streamed";
-		return false;
+	if (easing != m_trajectoryEasing) {
+		m_trajectoryEasing = easing;
+		updateTrajectoryCompilation();
+
+		emit trajectoryEasingChanged();
 	}
+}
 
-	m_incomingData.clear();
-	m_indexToProcess = 0;
+void SerialCommunication::setClockSync(bool enabled)
+{
+	if (enabled != m_clockSync) {
+		m_clockSync = enabled;
 
-	// Resetting the pause flag and setting the m_is*Mode flags
-	m_paused = false;
-	m_hardwareQueueFull = false;
-	m_stopping = false;
-	setIsStreamMode(true);
-	setIsImmediateMode(false);
+		QMetaObject::invokeMethod(m_engine, "setClockSync", Qt::QueuedConnection, Q_ARG(bool, m_clockSync));
 
-	// Saving the sequence and resetting the current point if needed
-	m_sequence = sequence;
-	if (!startFromCurrent) {
-		m_sequence->setCurPoint(0);
+		emit clockSyncChanged();
 	}
+}
 
-	// Emitting the signal telling that we started streaming
-	emit isStreamingChanged();
+bool SerialCommunication::openSerial()
+{
+	return callEngine("openSerial", Q_ARG(QString, m_serialPortName), Q_ARG(int, m_baudRate));
+}
 
-	// If the m_arduinoBoot timer is running, we have to wait, otherwise we explicitly call
-	// the arduinoBootFinished() function to start sending the sequence
-	if (!m_arduinoBoot.isActive()) {
-		arduinoBootFinished();
-	}
+bool SerialCommunication::closeSerial()
+{
+	return callEngine("closeSerial");
+}
 
-	return true;
+bool SerialCommunication::startCapture(QString filename)
+{
+	return callEngine("startCapture", Q_ARG(QString, filename));
 }
 
-bool SerialCommunication::pauseStream()
+void SerialCommunication::stopCapture()
 {
-	if (!isStreamMode()) {
-		qDebug() << "SerialCommunication error: cannot pause when no sequence is being streamed";
-		return false;
-	}
+	QMetaObject::invokeMethod(m_engine, "stopCapture", Qt::QueuedConnection);
+}
 
-	if (m_paused) {
-		return false;
-	}
+bool SerialCommunication::startStream(Sequence* sequence, bool startFromCurrent)
+{
+	return startStreamAt(sequence, startFromCurrent, -1);
+}
 
-	m_paused = true;
+bool SerialCommunication::startStreamAt(Sequence* sequence, bool startFromCurrent, qint64 startTime)
+{
+	// The engine streams a snapshot of the sequence, progress is notified through the playhead.
+	// The snapshot is compiled by the engine, in its thread
+	const int startPoint = startFromCurrent ? sequence->curPoint() : 0;
+	const SequenceSnapshot snapshot = sequence->snapshot();
 
-	emit isPausedChanged();
+	return callEngine("startStream", Q_ARG(SequenceSnapshot, snapshot), Q_ARG(int, startPoint), Q_ARG(int, m_streamBaudRate), Q_ARG(qint64, startTime));
+}
 
-	return true;
+bool SerialCommunication::pauseStream()
+{
+	return callEngine("pauseStream");
 }
 
 bool SerialCommunication::resumeStream()
 {
-	if (!isStreamMode()) {
-		qDebug() << "SerialCommunication error: cannot pause when no sequence is being streamed";
-		return false;
-	}
-
-	if (!m_paused) {
-		return false;
-	}
-
-	// Resuming streaming
-	m_paused = false;
-
-	emit isPausedChanged();
-
-	// Processing all received packets
-	processReceivedPackets();
-
-	return true;
+	return callEngine("resumeStream");
 }
 
 bool SerialCommunication::startImmediate(Sequence* sequence)
 {
-	if (!m_serialPort.isOpen()) {
-		qDebug() << "SerialCommunication error: cannot start streaming with a closed serial port";
+	if (!callEngine("startImmediate", Q_ARG(int, sequence->pointDim()))) {
 		return false;
 	}
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot start a new stream while a sequence is already being streamed";
-		return false;
-	}
-
-	m_incomingData.clear();
-	m_indexToProcess = 0;
-
-	// Setting the m_is*Mode flags
-	m_stopping = false;
-	setIsStreamMode(false);
-	setIsImmediateMode(true);
 
 	// Saving the sequence
 	m_sequence = sequence;
 
-	// Emitting the signal telling that we started streaming
-	emit isStreamingChanged();
-
 	// Connecting the signals of the sequence telling us when the current point changes
 	connect(m_sequence, &Sequence::curPointChanged, this, &SerialCommunication::curPointChanged);
 	connect(m_sequence, &Sequence::curPointValuesChanged, this, &SerialCommunication::curPointChanged);
 
-	// If the m_arduinoBoot timer is running, we have to wait, otherwise we explicitly call
-	// the arduinoBootFinished() function to send the current point of the sequence
-	if (!m_arduinoBoot.isActive()) {
-		arduinoBootFinished();
-	}
+	// Sending the current point
+	curPointChanged();
 
 	return true;
 }
 
-bool SerialCommunication::stop()
+bool SerialCommunication::uploadSequence(Sequence* sequence)
 {
-	if (!isStreaming()) {
-		qDebug() << "SerialCommunication error: no stream to stop";
-		return false;
-	}
-
-	// Setting the stopping flag
-	m_stopping = true;
-
-	// Sending packet to stop streaming
-	sendData(QByteArray("H"));
-
-	// If we are in immediate mode, we can end here, otherwise we must wait
-	// for the hardware to tell us that the sequence is finished
-	if (isImmediateMode()) {
-		sequenceStreamEnded();
-	}
-
-	return true;
+	return callEngine("uploadSequence", Q_ARG(SequenceSnapshot, sequence->snapshot()));
 }
 
-void SerialCommunication::handleReadyRead()
-{
-	// Getting data and adding to the buffer
-	m_incomingData.append(m_serialPort.readAll());
-
-	// Processing received data
-	processReceivedPackets();
-}
-
-void SerialCommunication::handleError(QSerialPort::SerialPortError error)
-{
-	if (error != QSerialPort::NoError) {
-		const QString errorString = "Error streaming: " + m_serialPort.errorString();
-		emit streamError(errorString);
-		qDebug() << errorString;
-
-//		QString errorString = "Error streaming, error code: ";
-
-//		switch (error) {
-//			case QSerialPort::DeviceNotFoundError:
-//				errorString += "DeviceNotFoundError (an error occurred while attempting to open an non-existing device)";
-//				break;
-//			case QSerialPort::PermissionError:
-//				errorString += "PermissionError (an error occurred while attempting to open an already opened device by another process or a user not having enough permission and credentials to open)";
-//				break;
-//			case QSerialPort::OpenError:
-//				errorString += "OpenError (an error occurred while attempting to open an already opened device in this object)";
-//				break;
-//			case QSerialPort::NotOpenError:
-//				errorString += "NotOpenError (this error occurs when an operation is executed that can only be successfully performed if the device is open)";
-//				break;
-//			case QSerialPort::ParityError:
-//				errorString += "ParityError (parity error detected by the hardware while reading data)";
-//				break;
-//			case QSerialPort::FramingError:
-//				errorString += "FramingError (framing error detected by the hardware while reading data)";
-//				break;
-//			case QSerialPort::BreakConditionError:
-//				errorString += "BreakConditionError (break condition detected by the hardware on the input line)";
-//				break;
-//			case QSerialPort::WriteError:
-//				errorString += "WriteError (an I/O error occurred while writing the data)";
-//				break;
-//			case QSerialPort::ReadError:
-//				errorString += "ReadError (an I/O error occurred while reading the data)";
-//				break;
-//			case QSerialPort::ResourceError:
-//				errorString += "ResourceError (an I/O error occurred when a resource becomes unavailable, e.g. when the device is unexpectedly removed from the system)";
-//				break;
-//			case QSerialPort::UnsupportedOperationError:
-//				errorString += "UnsupportedOperationError (the requested device operation is not supported or prohibited by the running operating system)";
-//				break;
-//			case QSerialPort::TimeoutError:
-//				errorString += "TimeoutError (a timeout error occurred)";
-//				break;
-//			case QSerialPort::UnknownError:
-//			default:
-//				errorString += "UnknownError (an unidentified error occurred)";
-//				break;
-//		}
-
-//		emit streamError(errorString);
-//		qDebug() << "Serial error." << errorString;
-	}
+bool SerialCommunication::playStored()
+{
+	return playStoredAt(-1);
 }
 
-void SerialCommunication::arduinoBootFinished()
+bool SerialCommunication::playStoredAt(qint64 startTime)
 {
-	// If we are streaming, sending data, otherwise doing nothing
-	if (isStreaming()) {
-		// First sending the start packet
-		QByteArray startPacket;
-		if (isStreamMode()) {
-			startPacket.append('S');
-		} else if (isImmediateMode()) {
-			startPacket.append('I');
-		} else {
-			qFatal("Unknown mode, we should never get here");
-		}
-		// Adding the number of dimension of point to the start packet
-		startPacket.append(m_sequence->pointDim() & 0xFF);
-		sendData(startPacket);
+	return callEngine("playStored", Q_ARG(qint64, startTime));
+}
 
-		// Now sending the first sequence packet if present
-		if (m_sequence->curPoint() != -1) {
-			sendData(createSequencePacketForPoint(m_sequence->point()));
-		}
+bool SerialCommunication::sendCalibration(const CalibrationProfile& profile)
+{
+	return callEngine("sendCalibration", Q_ARG(CalibrationProfile, profile));
+}
 
-		// If we are in stream mode, we have to move the current point forward
-		if (isStreamMode()) {
-			incrementCurPoint();
-		}
-	}
+bool SerialCommunication::stop()
+{
+	return callEngine("stop");
 }
 
 void SerialCommunication::curPointChanged()
 {
-	// Safety check that we are in immediate mode (this slot is only connected in immediate mode)
-	if (Q_UNLIKELY(!isImmediateMode())) {
+	// Safety check that we have a sequence (this slot is only connected in immediate mode)
+	if (Q_UNLIKELY(m_sequence == nullptr)) {
 		qDebug() << "Received curPointChanged() signal but not in immediate mode";
 
 		return;
@@ -377,230 +273,168 @@ void SerialCommunication::curPointChanged()
 
 	// Sending the current point if present
 	if (m_sequence->curPoint() != -1) {
-		sendData(createSequencePacketForPoint(m_sequence->point()));
+		QMetaObject::invokeMethod(m_engine, "setImmediatePoint", Qt::QueuedConnection, Q_ARG(SequencePoint, m_sequence->point()));
 	}
 }
 
-QByteArray SerialCommunication::createSequencePacketForPoint(const SequencePoint& p) const
+void SerialCommunication::updateTrajectoryCompilation()
 {
-	QByteArray pkt(5 + p.point.size(), 0);
-
-	// Packet type
-	pkt[0] = 'P';
-
-	// Point duration
-	pkt[1] = (p.duration >> 8) & 0xFF;
-	pkt[2] = p.duration & 0xFF;
+	QMetaObject::invokeMethod(m_engine, "setTrajectoryCompilation", Qt::QueuedConnection, Q_ARG(bool, m_compileTrajectory), Q_ARG(double, m_trajectoryTolerance), Q_ARG(bool, m_trajectoryEasing));
+}
 
-	// Point time to target
-	pkt[3] = (p.timeToTarget >> 8) & 0xFF;
-	pkt[4] = p.timeToTarget & 0xFF;
+bool SerialCommunication::callEngine(const char* method, QGenericArgument arg0, QGenericArgument arg1, QGenericArgument arg2, QGenericArgument arg3)
+{
+	bool ret = false;
 
-	// Values
-	for (int c = 0; c < p.point.size(); ++c) {
-		pkt[5 + c] = static_cast<unsigned int>(p.point[c]) & 0xFF;
+	if (!QMetaObject::invokeMethod(m_engine, method, Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ret), arg0, arg1, arg2, arg3)) {
+		qFatal("Cannot call function %s of the stream engine, we should never get here", method);
 	}
 
-	return pkt;
+	return ret;
 }
 
-void SerialCommunication::processReceivedPackets()
+void SerialCommunication::setMode(int mode)
 {
-	// If we are not in pause, we can process all the packets, also old ones
-	if (!m_paused) {
-		m_indexToProcess = 0;
+	const StreamEngine::Mode oldMode = m_mode;
+	const bool wasStreaming = isStreaming();
+
+	m_mode = static_cast<StreamEngine::Mode>(mode);
+	if (m_mode == oldMode) {
+		return;
 	}
 
-	// If this is true, we only received part of a packet
-	bool partialPacket = false;
-	while ((m_indexToProcess < m_incomingData.size()) && (!partialPacket)) {
-		if ((m_incomingData[m_indexToProcess] == 'N') && isStreamMode()) {
-			if (m_paused || m_stopping) {
-				// Skipping this packet, we are paused or stopping
-				++m_indexToProcess;
-			} else {
-				qDebug() << "RECEIVED BUFFER NOT FULL";
-
-				// Buffer not full, we can send the current point in the sequence and move
-				// the current point forward
-				m_hardwareQueueFull = false;
-				if (m_sequence->curPoint() != -1) {
-					sendData(createSequencePacketForPoint(m_sequence->point()));
-				}
-				incrementCurPoint();
-
-				// Removing packet from buffer. The next index to process remains the current one
-				m_incomingData.remove(m_indexToProcess, 1);
-			}
-		} else if ((m_incomingData[m_indexToProcess] == 'F') && isStreamMode()) {
-			if (m_paused || m_stopping) {
-				// Skipping this packet, we are paused
-				++m_indexToProcess;
-			} else {
-				qDebug() << "RECEIVED BUFFER FULL";
-
-				// Buffer full
-				m_hardwareQueueFull = true;
-
-				// Removing packet from buffer. The next index to process remains the current one
-				m_incomingData.remove(m_indexToProcess, 1);
-			}
-		} else if (m_incomingData[m_indexToProcess] == 'E') {
-			if (m_paused) {
-				// Skipping this packet, we are paused
-				++m_indexToProcess;
-			} else {
-				qDebug() << "RECEIVED SEQUENCE ENDED";
-
-				// Calling the sequenceStreamEnded() function. This will also terminate the
-				// while cycle, because the m_incomingData buffer will be cleared
-				sequenceStreamEnded();
-			}
-		} else if (m_incomingData[m_indexToProcess] == 'D') {
-			// Debug packet, printing and emitting signal if the message is complete
-			if (m_incomingData.size() < (m_indexToProcess + 2)) {
-				partialPacket = true;
-			} else {
-				// Reading message length
-				int msgLength = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
-
-				// Checking we have the whole message
-				if (m_incomingData.size() < (m_indexToProcess + 2 + msgLength)) {
-					partialPacket = true;
-				} else {
-					// We have the whole message, putting in a QString
-					const QString msg(m_incomingData.mid(m_indexToProcess + 2, msgLength));
-
-					// Emitting signal and printing
-					emit debugMessage(msg);
-					qDebug() << "Debug packet, content:" << msg;
-
-					// Removing packet from our buffer. The next index to process remains
-					// the current one
-					m_incomingData.remove(m_indexToProcess, 2 + msgLength);
-				}
-			}
-		} else if (m_incomingData[m_indexToProcess] == 'B') {
-			// Battery packet, checking that the packet is finished and updating the charge
-			if (m_incomingData.size() < (m_indexToProcess + 2)) {
-				partialPacket = true;
-			} else {
-				// Reading charge level
-				int chargeLevel = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
-
-				// Setting the charge level
-				setBatteryCharge((float(chargeLevel) / 255.0) * 100.0);
-
-				// Removing packet from our buffer. The next index to process remains
-				// the current one
-				m_incomingData.remove(m_indexToProcess, 2);
-			}
-		} else {
-			if ((m_incomingData[m_indexToProcess] == 'N') || (m_incomingData[m_indexToProcess] == 'F')) {
-				qDebug() << "Received spurious N or F packet";
-			} else {
-				const QString errorString = QString("Received unknown or invalid packet type %1 (ascii %2)").arg(static_cast<unsigned int>(m_incomingData[m_indexToProcess])).arg(m_incomingData[m_indexToProcess]);
-				emit streamError(errorString);
-				qDebug() << errorString;
-			}
-
-			// Removing the unknown character. The next index to process remains the current one
-			m_incomingData.remove(m_indexToProcess, 1);
+	// When a modality ends we forget the sequence and the playhead
+	if (m_mode == StreamEngine::NoMode) {
+		if (m_sequence != nullptr) {
+			m_sequence->disconnect(this);
+			m_sequence = nullptr;
 		}
+		setPlayhead(-1);
+	}
+
+	if (wasStreaming != isStreaming()) {
+		emit isStreamingChanged();
+	}
+	if ((oldMode == StreamEngine::StreamMode) || (m_mode == StreamEngine::StreamMode)) {
+		emit isStreamModeChanged();
+	}
+	if ((oldMode == StreamEngine::ImmediateMode) || (m_mode == StreamEngine::ImmediateMode)) {
+		emit isImmediateModeChanged();
+	}
+	if ((oldMode == StreamEngine::UploadMode) || (m_mode == StreamEngine::UploadMode)) {
+		emit isUploadModeChanged();
+	}
+	if ((oldMode == StreamEngine::StoredPlaybackMode) || (m_mode == StreamEngine::StoredPlaybackMode)) {
+		emit isStoredPlaybackModeChanged();
 	}
 }
 
-void SerialCommunication::sequenceStreamEnded()
+void SerialCommunication::setIsConnected(bool v)
 {
-	// Disconnecting all signals from the sequence to us
-	m_sequence->disconnect(this);
+	if (v != m_isConnected) {
+		m_isConnected = v;
 
-	// Setting the sequence to nullptr
-	m_sequence = nullptr;
+		emit isConnectedChanged();
+	}
+}
 
-	// Emitting the signal telling that we stopped streaming
-	emit isStreamingChanged();
+void SerialCommunication::setIsCapturing(bool v)
+{
+	if (v != m_isCapturing) {
+		m_isCapturing = v;
 
-	// Resetting flags
-	m_paused = false;
-	m_hardwareQueueFull = false;
-	m_stopping = false;
-	setIsStreamMode(false);
-	setIsImmediateMode(false);
+		emit isCapturingChanged();
+	}
+}
+
+void SerialCommunication::setIsPaused(bool v)
+{
+	if (v != m_paused) {
+		m_paused = v;
 
-	m_incomingData.clear();
-	m_indexToProcess = 0;
+		emit isPausedChanged();
+	}
 }
 
-void SerialCommunication::incrementCurPoint()
+void SerialCommunication::setUploadedPoints(int v)
 {
-	const int curPoint = m_sequence->curPoint();
+	if (v != m_uploadedPoints) {
+		m_uploadedPoints = v;
 
-	if (curPoint == (m_sequence->numPoints() - 1)) {
-		// We are at the last point, checking what to do
-		if (oneShotSequence()) {
-			// Stopping
-			stop();
-		} else {
-			// Restarting from the beginning
-			m_sequence->setCurPoint(0);
-		}
-	} else {
-		m_sequence->setCurPoint(curPoint + 1);
+		emit uploadedPointsChanged();
 	}
 }
 
-void SerialCommunication::sendData(const QByteArray& dataToSend)
+void SerialCommunication::setPlayhead(int v)
 {
-	if (dataToSend.isEmpty()) {
-		return;
+	if (v != m_playhead) {
+		m_playhead = v;
+
+		emit playheadChanged();
 	}
+}
 
-	if (!dataToSend.isEmpty()) {
-		QString strData = QChar(dataToSend[0]);
-		for (int i = 1; i < dataToSend.size(); ++i) {
-			strData += " " + QString::number(dataToSend[i]);
-		}
-		qDebug() << "SENDING DATA: " << strData;
+void SerialCommunication::setBatteryCharge(float v)
+{
+	if (v != m_batteryCharge) {
+		m_batteryCharge = v;
+
+		emit batteryChargeChanged();
 	}
+}
 
-	// Writing data
-	qint64 bytesWritten = m_serialPort.write(dataToSend);
+void SerialCommunication::setTaskOverruns(const QVariantList& v)
+{
+	if (v != m_taskOverruns) {
+		m_taskOverruns = v;
 
-	if (bytesWritten == -1) {
-		qDebug() << "Error writing data";
-	} else if (bytesWritten != dataToSend.size()) {
-		qDebug() << "Cannot write all data";
+		emit taskOverrunsChanged();
 	}
 }
 
-void SerialCommunication::setIsStreamMode(bool v)
+void SerialCommunication::setTelemetry(const HardwareTelemetry& v)
 {
-	if (v != m_isStreamMode) {
-		m_isStreamMode = v;
+	if (v != m_telemetry) {
+		m_telemetry = v;
 
-		emit isStreamModeChanged();
+		emit telemetryChanged();
 	}
 }
 
-void SerialCommunication::setIsImmediateMode(bool v)
+void SerialCommunication::setHardwareBufferSize(int v)
 {
-	if (v != m_isImmediateMode) {
-		m_isImmediateMode = v;
+	if (v != m_hardwareBufferSize) {
+		m_hardwareBufferSize = v;
 
-		emit isImmediateModeChanged();
+		emit hardwareBufferSizeChanged();
 	}
 }
 
-void SerialCommunication::setBatteryCharge(float v)
+void SerialCommunication::setLinkBaudRate(int v)
+{
+	if (v != m_linkBaudRate) {
+		m_linkBaudRate = v;
+
+		emit linkBaudRateChanged();
+	}
+}
+
+void SerialCommunication::setStatistics(const StreamStatistics& v)
 {
-	if (v < 0.0) {
-		v = -1.0;
+	if (v != m_statistics) {
+		m_statistics = v;
+
+		emit statisticsChanged();
 	}
+}
 
-	if (v != m_batteryCharge) {
-		m_batteryCharge = v;
+void SerialCommunication::setClockSyncState(bool synced, int roundTrip, double drift)
+{
+	if ((synced != m_isClockSynced) || (roundTrip != m_clockRoundTrip) || (drift != m_clockDrift)) {
+		m_isClockSynced = synced;
+		m_clockRoundTrip = roundTrip;
+		m_clockDrift = drift;
 
-		emit batteryChargeChanged();
+		emit clockSyncStateChanged();
 	}
 }
@@ -22,12 +22,11 @@
 #ifndef SERIALCOMMUNICATION_H
 #define SERIALCOMMUNICATION_H
 
-#include <QSerialPort>
-#include <QByteArray>
 #include <QObject>
-#include <QTimer>
-#include <memory>
+#include <QThread>
+#include <QVariantList>
 #include "sequence.h"
+#include "streamengine.h"
 
 /**
  * \brief The class handling the communication with Arduino through the serial
@@ -55,93 +54,81 @@
  * error when functions of one modality are called before the modality is
  * started or when the serial port is not open.
  *
- * The communication protocol between this program and the Arduino board is the
- * following. The packets the PC may send to the hardware are the following
- * ones:
- *	- sequence packet
- *	- start sequence
- *	- start immediate mode
- *	- stop
+ * A sequence can also be stored in the memory of the hardware and played
+ * without the PC. The uploadSequence() function starts the upload modality,
+ * which terminates by itself when the whole sequence has been stored (the
+ * uploadFinished() signal is emitted) or when stop() is called (the upload is
+ * aborted). The playStored() function starts the stored playback modality: the
+ * hardware plays the stored sequence once or continuously depending on the
+ * oneShotSequence property and the modality terminates as for stream mode.
  *
- * The packes the hardware may send to the PC are the following ones:
- *	- sequence buffer not full
- *	- sequence buffer full
- *	- sequence finished
- *	- debug packet
- *	- battery charge packet
+ * If the clockSync property is true, the clock used by the hardware to play
+ * sequences is kept synchronized with the clock of the PC (see StreamEngine).
+ * Streams and stored playback started with a start time (startStreamAt() and
+ * playStoredAt()) then begin at that time on the hardware, so that more
+ * hardware connected to the same PC play together and stay aligned.
  *
- * The "start sequence" and "start immediate mode" packets tell the hardware in
- * which modality it should work. The "start sequence" makes the hardware expect
- * the sequence to be continuously sent and timing of each point of the sequence
- * are respected. Moreover the hardware responds to each sequence packet with
- * either a "sequence buffer not full" or a "sequence buffer full" packet. This
- * way the PC can send sequence packets until the hardware internal buffer is
- * full, to avoid delays in sequence timings. If the hardware sent a "sequence
- * buffer full" packet, it will send a "sequence buffer not full" packet as soon
- * as the buffer is no longer full (this "sequence buffer not full" packet can
- * be sent at any time, not only in response to a packet from the PC). To
- * terminate sequence execution the PC sends a "stop" packet. The hardware then
- * answers with a "sequence finished" packet as soon as the last point is
- * reached and kept for its whose duration. The "start immediate mode" packet
- * instructs the hardware to immediately process incoming sequence packets. This
- * means that the "duration" property of sequence points is not respected and
- * that a pose it kept until a new sequence point arrives. In this case the
- * hardware does not send any packet back (there is no buffer). To termiante the
- * immediate mode, the PC sends a "stop" packet. Packets sent before either
- * "start sequence" or "start immediate mode" are discarded.
+ * The communication with the hardware (and the protocol, see StreamEngine) is
+ * handled by an object living in a separate thread. This way answering the
+ * packets of the hardware never waits for the user interface, which could be
+ * slow to update. This class only keeps a copy of the state of the
+ * communication for QML, which is updated through queued signals. Because of
+ * this, the properties change shortly after the functions starting or stopping
+ * a modality return. When a stream is started a snapshot of the sequence is
+ * taken (see SequenceSnapshot), so changing the sequence while streaming has no
+ * effect on the stream. The progress of the stream is reported by the playhead
+ * property (updated at most once every 16 milliseconds), the current point of
+ * the sequence is never changed by streaming.
  *
- * The debug packet is used by the hardware for debugging purpouse. It contains
- * a string of maximum length 255 bytes which is simply displayed (no other
- * action is performed). The battery charge packet is used to communicate the
- * current charge of batteries. It could be sent at any time.
- *
- * Here is the detailed description of every packet in the protocol.
- *
- * "sequence packet"
- * the character 'P' (1 byte) - step duration (2 bytes, milliseconds, most
- * significant byte first) - step time to target (2 bytes, milliseconds, most
- * significant byte first) - positions (numElements bytes, one byte per point
- * dimension)
- *
- * "start sequence" (numElements is the dimension of each point of the sequence)
- * the character 'S' (1 byte) - numElements (1 byte)
- *
- * "start immediate mode" (numElements is the dimension of each point of the
- * sequence)
- * the character 'I' (1 byte) - numElements (1 byte)
- *
- * "stop"
- * the character 'H' (1 byte)
- *
- * "sequence buffer not full"
- * the character 'N' (1 byte)
- *
- * "sequence buffer full"
- * the character 'F' (1 byte)
- *
- * "sequence finished"
- * the characted 'E' (1 byte)
- *
- * "debug packet"
- * the character 'D' (1 byte) - length of message (1 byte) - message (length of
- * message elements)
- *
- * "battery charge packet" (battery charge is 0 to indicate depleted battery,
- * 255 for fully charged batteries)
- * the character 'B' (1 byte) - battery charge (1 byte)
+ * If the compileTrajectory property is true, the snapshot is compiled before
+ * streaming (see TrajectoryCompiler): points that can be dropped within
+ * trajectoryTolerance are not sent and, if trajectoryEasing is true, the
+ * remaining segments get easing profiles. The compilation runs in the thread
+ * of the stream engine, so it does not block the GUI. The playhead still
+ * refers to the points of the sequence. Uploaded sequences are never compiled, because the
+ * hardware does not store easing profiles.
  */
 class SerialCommunication : public QObject
 {
 	Q_OBJECT
 	Q_PROPERTY(QString serialPortName READ serialPortName WRITE setSerialPortName NOTIFY serialPortNameChanged)
 	Q_PROPERTY(int baudRate READ baudRate WRITE setBaudRate NOTIFY baudRateChanged)
+	Q_PROPERTY(int streamBaudRate READ streamBaudRate WRITE setStreamBaudRate NOTIFY streamBaudRateChanged)
+	Q_PROPERTY(int linkBaudRate READ linkBaudRate NOTIFY linkBaudRateChanged)
 	Q_PROPERTY(bool oneShotSequence READ oneShotSequence WRITE setOneShotSequence NOTIFY oneShotSequenceChanged)
+	Q_PROPERTY(bool compileTrajectory READ compileTrajectory WRITE setCompileTrajectory NOTIFY compileTrajectoryChanged)
+	Q_PROPERTY(double trajectoryTolerance READ trajectoryTolerance WRITE setTrajectoryTolerance NOTIFY trajectoryToleranceChanged)
+	Q_PROPERTY(bool trajectoryEasing READ trajectoryEasing WRITE setTrajectoryEasing NOTIFY trajectoryEasingChanged)
+	Q_PROPERTY(bool clockSync READ clockSync WRITE setClockSync NOTIFY clockSyncChanged)
+	Q_PROPERTY(bool isClockSynced READ isClockSynced NOTIFY clockSyncStateChanged)
+	Q_PROPERTY(int clockRoundTrip READ clockRoundTrip NOTIFY clockSyncStateChanged)
+	Q_PROPERTY(double clockDrift READ clockDrift NOTIFY clockSyncStateChanged)
 	Q_PROPERTY(bool isConnected READ isConnected NOTIFY isConnectedChanged)
 	Q_PROPERTY(bool isStreaming READ isStreaming NOTIFY isStreamingChanged)
 	Q_PROPERTY(bool isStreamMode READ isStreamMode NOTIFY isStreamModeChanged)
 	Q_PROPERTY(bool isImmediateMode READ isImmediateMode NOTIFY isImmediateModeChanged)
+	Q_PROPERTY(bool isUploadMode READ isUploadMode NOTIFY isUploadModeChanged)
+	Q_PROPERTY(bool isStoredPlaybackMode READ isStoredPlaybackMode NOTIFY isStoredPlaybackModeChanged)
+	Q_PROPERTY(int uploadedPoints READ uploadedPoints NOTIFY uploadedPointsChanged)
+	Q_PROPERTY(int playhead READ playhead NOTIFY playheadChanged)
 	Q_PROPERTY(bool isPaused READ isPaused NOTIFY isPausedChanged)
 	Q_PROPERTY(float batteryCharge READ batteryCharge NOTIFY batteryChargeChanged)
+	Q_PROPERTY(QVariantList taskOverruns READ taskOverruns NOTIFY taskOverrunsChanged)
+	Q_PROPERTY(int loopsPerSecond READ loopsPerSecond NOTIFY telemetryChanged)
+	Q_PROPERTY(int maxStepTime READ maxStepTime NOTIFY telemetryChanged)
+	Q_PROPERTY(int meanStepTime READ meanStepTime NOTIFY telemetryChanged)
+	Q_PROPERTY(int bufferedPoints READ bufferedPoints NOTIFY telemetryChanged)
+	Q_PROPERTY(int underruns READ underruns NOTIFY telemetryChanged)
+	Q_PROPERTY(int receiveOverruns READ receiveOverruns NOTIFY telemetryChanged)
+	Q_PROPERTY(int droppedPoints READ droppedPoints NOTIFY telemetryChanged)
+	Q_PROPERTY(int receiveBufferPeak READ receiveBufferPeak NOTIFY telemetryChanged)
+	Q_PROPERTY(bool isCapturing READ isCapturing NOTIFY isCapturingChanged)
+	Q_PROPERTY(int hardwareBufferSize READ hardwareBufferSize NOTIFY hardwareBufferSizeChanged)
+	Q_PROPERTY(int credits READ credits NOTIFY statisticsChanged)
+	Q_PROPERTY(qint64 pointsSent READ pointsSent NOTIFY statisticsChanged)
+	Q_PROPERTY(qint64 framesRetransmitted READ framesRetransmitted NOTIFY statisticsChanged)
+	Q_PROPERTY(qint64 bytesSent READ bytesSent NOTIFY statisticsChanged)
+	Q_PROPERTY(qint64 bytesReceived READ bytesReceived NOTIFY statisticsChanged)
 
 public:
 	/**
@@ -154,7 +141,8 @@ public:
 	/**
 	 * \brief Destructor
 	 *
-	 * This stops any streamed sequence and closes the port
+	 * This stops any streamed sequence, closes the port and waits for the
+	 * thread of the stream engine to finish
 	 */
 	virtual ~SerialCommunication();
 
@@ -216,6 +204,37 @@ public:
 	 */
 	void setBaudRate(int baudRate);
 
+	/**
+	 * \brief Returns the baud rate to ask the hardware to use when
+	 *        streaming
+	 *
+	 * \return the baud rate to use when streaming
+	 */
+	int streamBaudRate() const
+	{
+		return m_streamBaudRate;
+	}
+
+	/**
+	 * \brief Sets the baud rate to ask the hardware to use when streaming
+	 *
+	 * If this is not greater than baudRate(), no baud rate negotiation is
+	 * performed
+	 * \param streamBaudRate the new baud rate to use when streaming
+	 */
+	void setStreamBaudRate(int streamBaudRate);
+
+	/**
+	 * \brief Returns the baud rate currently used on the serial port
+	 *
+	 * This is -1 if the serial port is closed
+	 * \return the baud rate currently used on the serial port
+	 */
+	int linkBaudRate() const
+	{
+		return m_linkBaudRate;
+	}
+
 	/**
 	 * \brief Returns whether the sequence is played once or continuously
 	 *
@@ -233,6 +252,114 @@ public:
 	 */
 	void setOneShotSequence(bool oneShot);
 
+	/**
+	 * \brief Returns whether sequences are compiled before streaming
+	 *
+	 * \return whether sequences are compiled before streaming
+	 */
+	bool compileTrajectory() const
+	{
+		return m_compileTrajectory;
+	}
+
+	/**
+	 * \brief Sets whether sequences are compiled before streaming
+	 *
+	 * This only affects streams started later
+	 * \param compile whether sequences are compiled before streaming
+	 */
+	void setCompileTrajectory(bool compile);
+
+	/**
+	 * \brief Returns the maximum distance of compiled sequences from the
+	 *        original ones
+	 *
+	 * \return the maximum distance from the original sequence
+	 */
+	double trajectoryTolerance() const
+	{
+		return m_trajectoryTolerance;
+	}
+
+	/**
+	 * \brief Sets the maximum distance of compiled sequences from the
+	 *        original ones
+	 *
+	 * \param tolerance the maximum distance from the original sequence, in
+	 *                  the units of positions
+	 */
+	void setTrajectoryTolerance(double tolerance);
+
+	/**
+	 * \brief Returns whether compiled sequences have easing profiles
+	 *
+	 * \return whether compiled sequences have easing profiles
+	 */
+	bool trajectoryEasing() const
+	{
+		return m_trajectoryEasing;
+	}
+
+	/**
+	 * \brief Sets whether compiled sequences have easing profiles
+	 *
+	 * \param easing if false compiled sequences are linear
+	 */
+	void setTrajectoryEasing(bool easing);
+
+	/**
+	 * \brief Returns whether the clock of the hardware is synchronized
+	 *        with the one of the PC
+	 *
+	 * \return whether clock synchronization is enabled
+	 */
+	bool clockSync() const
+	{
+		return m_clockSync;
+	}
+
+	/**
+	 * \brief Sets whether the clock of the hardware is synchronized with
+	 *        the one of the PC
+	 *
+	 * \param enabled whether clock synchronization is enabled
+	 */
+	void setClockSync(bool enabled);
+
+	/**
+	 * \brief Returns true if the clock of the hardware has been
+	 *        synchronized
+	 *
+	 * \return true if the clock of the hardware is synchronized
+	 */
+	bool isClockSynced() const
+	{
+		return m_isClockSynced;
+	}
+
+	/**
+	 * \brief Returns the round trip time of the last clock ping used to
+	 *        synchronize the clock
+	 *
+	 * \return the round trip time in milliseconds, -1 if the clock is not
+	 *         synchronized
+	 */
+	int clockRoundTrip() const
+	{
+		return m_clockRoundTrip;
+	}
+
+	/**
+	 * \brief Returns the correction of the rate of the clock of the
+	 *        hardware
+	 *
+	 * \return the drift in parts per million
+	 */
+	double clockDrift() const
+	{
+		return m_clockDrift;
+	}
+
 	/**
 	 * \brief Opens the serial port
 	 *
@@ -251,21 +378,59 @@ public:
 	 */
 	Q_INVOKABLE bool closeSerial();
 
+	/**
+	 * \brief Starts writing all data sent and received to a file
+	 *
+	 * See FrameCapture for the format of the file. If a capture is already
+	 * running, it is closed and the new file is used
+	 * \param filename the name of the file to write
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool startCapture(QString filename);
+
+	/**
+	 * \brief Stops writing data to the capture file
+	 */
+	Q_INVOKABLE void stopCapture();
+
+	/**
+	 * \brief Returns true if data is being written to a capture file
+	 *
+	 * \return true if data is being written to a capture file
+	 */
+	bool isCapturing() const
+	{
+		return m_isCapturing;
+	}
+
 	/**
 	 * \brief Starts streaming the sequence
 	 *
-	 * The sequence current point is updated as data is streamed (the
-	 * current point will be the next point to sent through the port). If
-	 * the current point is changed externally, the next point that is sent
-	 * sequence will be the new current point.
-	 * \param sequence the sequence to send. It must remain valid until the
-	 *                 stop() function is called or the sequence is finished
+	 * A snapshot of the sequence is streamed, so changes to the sequence
+	 * have no effect on the stream. The playhead property tells which is
+	 * the next point to send through the port.
+	 * \param sequence the sequence to send
 	 * \param startFromCurrent if true the streaming starts from the current
 	 *                         point, otherwise starts from the beginning
 	 * \return false in case of error
 	 */
 	Q_INVOKABLE bool startStream(Sequence* sequence, bool startFromCurrent = false);
 
+	/**
+	 * \brief Starts streaming the sequence at the given time
+	 *
+	 * This is like startStream(), but the first point is sent at the given
+	 * time. It is used to start streams on more hardware together (see
+	 * DeviceManager)
+	 * \param sequence the sequence to send
+	 * \param startFromCurrent if true the streaming starts from the current
+	 *                         point, otherwise starts from the beginning
+	 * \param startTime the time when the first point is sent (see
+	 *                  StreamEngine::currentTime())
+	 * \return false in case of error
+	 */
+	bool startStreamAt(Sequence* sequence, bool startFromCurrent, qint64 startTime);
+
 	/**
 	 * \brief Pauses streaming data
 	 *
@@ -295,6 +460,48 @@ public:
 	 */
 	Q_INVOKABLE bool startImmediate(Sequence* sequence);
 
+	/**
+	 * \brief Starts storing the sequence in the memory of the hardware
+	 *
+	 * A snapshot of the sequence is uploaded, so the sequence can be
+	 * modified or destroyed during the upload
+	 * \param sequence the sequence to upload
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool uploadSequence(Sequence* sequence);
+
+	/**
+	 * \brief Starts playing the sequence stored in the memory of the
+	 *        hardware
+	 *
+	 * The sequence is played once or continuously depending on the
+	 * oneShotSequence property
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool playStored();
+
+	/**
+	 * \brief Starts playing the sequence stored in the memory of the
+	 *        hardware at the given time
+	 *
+	 * This is like playStored(), but the sequence starts at the given time
+	 * (see startStreamAt())
+	 * \param startTime the time when the sequence starts (see
+	 *                  StreamEngine::currentTime())
+	 * \return false in case of error
+	 */
+	bool playStoredAt(qint64 startTime);
+
+	/**
+	 * \brief Sends the calibration of servos to the hardware
+	 *
+	 * The hardware stores the calibration and uses it from then on. The
+	 * answer of the hardware is notified with calibrationSet()
+	 * \param profile the calibration to send
+	 * \return false in case of error
+	 */
+	bool sendCalibration(const CalibrationProfile& profile);
+
 	/**
 	 * \brief Stops sending the sequence
 	 *
@@ -309,19 +516,22 @@ public:
 	 */
 	bool isConnected() const
 	{
-		return m_serialPort.isOpen();
+		return m_isConnected;
 	}
 
 	/**
-	 * \brief Returns true if we have an associated stream, either in stream
-	 *        or immediate mode
+	 * \brief Returns true if we are in any modality (stream, immediate,
+	 *        upload or stored playback)
 	 *
-	 * \return true if we have an associated stream, either in stream or
-	 *         immediate mode
+	 * This is a copy of the modality of the stream engine, updated by a
+	 * queued signal, so it lags behind the engine and is only advisory.
+	 * Functions starting a modality do not check it, the engine checks its
+	 * own state
+	 * \return true if we are in any modality
 	 */
 	bool isStreaming() const
 	{
-		return (m_sequence != nullptr);
+		return m_mode != StreamEngine::NoMode;
 	}
 
 	/**
@@ -331,7 +541,7 @@ public:
 	 */
 	bool isStreamMode() const
 	{
-		return m_isStreamMode;
+		return m_mode == StreamEngine::StreamMode;
 	}
 
 	/**
@@ -341,7 +551,50 @@ public:
 	 */
 	bool isImmediateMode() const
 	{
-		return m_isImmediateMode;
+		return m_mode == StreamEngine::ImmediateMode;
+	}
+
+	/**
+	 * \brief Returns true if we are uploading a sequence
+	 *
+	 * \return true if we are uploading a sequence
+	 */
+	bool isUploadMode() const
+	{
+		return m_mode == StreamEngine::UploadMode;
+	}
+
+	/**
+	 * \brief Returns true if the hardware is playing the stored sequence
+	 *
+	 * \return true if the hardware is playing the stored sequence
+	 */
+	bool isStoredPlaybackMode() const
+	{
+		return m_mode == StreamEngine::StoredPlaybackMode;
+	}
+
+	/**
+	 * \brief Returns how many points have been sent during the current
+	 *        upload
+	 *
+	 * \return the number of uploaded points
+	 */
+	int uploadedPoints() const
+	{
+		return m_uploadedPoints;
+	}
+
+	/**
+	 * \brief Returns the position of the next point to stream
+	 *
+	 * This is -1 when not in stream mode
+	 * \return the position in the streamed sequence of the next point to
+	 *         stream
+	 */
+	int playhead() const
+	{
+		return m_playhead;
 	}
 
 	/**
@@ -366,6 +619,186 @@ public:
 		return m_batteryCharge;
 	}
 
+	/**
+	 * \brief Returns how many times each task on the hardware missed its
+	 *        deadline
+	 *
+	 * The list is empty if we have not received the task overruns packet
+	 * yet
+	 * \return the list of overruns of hardware tasks
+	 */
+	QVariantList taskOverruns() const
+	{
+		return m_taskOverruns;
+	}
+
+	/**
+	 * \brief Returns the iterations per second of the main loop of the
+	 *        hardware
+	 *
+	 * This and the other telemetry values are -1 if we have not received
+	 * the telemetry packet yet
+	 * \return the iterations per second of the main loop
+	 */
+	int loopsPerSecond() const
+	{
+		return m_telemetry.loopsPerSecond;
+	}
+
+	/**
+	 * \brief Returns the maximum time the hardware took to move servos
+	 *
+	 * \return the maximum time to move servos in microseconds in the last
+	 *         telemetry period
+	 */
+	int maxStepTime() const
+	{
+		return m_telemetry.maxStepTime;
+	}
+
+	/**
+	 * \brief Returns the mean time the hardware took to move servos
+	 *
+	 * \return the mean time to move servos in microseconds in the last
+	 *         telemetry period
+	 */
+	int meanStepTime() const
+	{
+		return m_telemetry.meanStepTime;
+	}
+
+	/**
+	 * \brief Returns the number of points in the buffer of the hardware
+	 *
+	 * \return the number of points in the buffer of the hardware
+	 */
+	int bufferedPoints() const
+	{
+		return m_telemetry.bufferedPoints;
+	}
+
+	/**
+	 * \brief Returns how many times the buffer of the hardware became empty
+	 *        while streaming
+	 *
+	 * \return the number of underruns of the hardware buffer
+	 */
+	int underruns() const
+	{
+		return m_telemetry.underruns;
+	}
+
+	/**
+	 * \brief Returns how many times the receive buffer of the serial line of
+	 *        the hardware was full
+	 *
+	 * \return the number of overruns of the receive buffer
+	 */
+	int receiveOverruns() const
+	{
+		return m_telemetry.receiveOverruns;
+	}
+
+	/**
+	 * \brief Returns how many points the hardware dropped because its
+	 *        buffer was full
+	 *
+	 * \return the number of dropped points
+	 */
+	int droppedPoints() const
+	{
+		return m_telemetry.droppedPoints;
+	}
+
+	/**
+	 * \brief Returns the maximum number of bytes in the receive buffer of
+	 *        the serial line of the hardware during the last second
+	 *
+	 * \return the peak of the receive buffer
+	 */
+	int receiveBufferPeak() const
+	{
+		return m_telemetry.receiveBufferPeak;
+	}
+
+	/**
+	 * \brief Returns how many points the hardware can buffer
+	 *
+	 * This is the value received in the last "stream started" packet, it
+	 * is -1 if we have not received it yet
+	 * \return the number of points the hardware can buffer
+	 */
+	int hardwareBufferSize() const
+	{
+		return m_hardwareBufferSize;
+	}
+
+	/**
+	 * \brief Returns the flow control state and the amount of data
+	 *        exchanged with the hardware
+	 *
+	 * \return the statistics of the stream
+	 */
+	const StreamStatistics& statistics() const
+	{
+		return m_statistics;
+	}
+
+	/**
+	 * \brief Returns how many points we can send before the buffer of the
+	 *        hardware is full
+	 *
+	 * \return the available credits
+	 */
+	int credits() const
+	{
+		return m_statistics.credits;
+	}
+
+	/**
+	 * \brief Returns the number of points streamed or uploaded since the
+	 *        serial port was opened
+	 *
+	 * \return the number of points sent
+	 */
+	qint64 pointsSent() const
+	{
+		return m_statistics.pointsSent;
+	}
+
+	/**
+	 * \brief Returns the number of frames sent again since the serial port
+	 *        was opened
+	 *
+	 * \return the number of frames sent again
+	 */
+	qint64 framesRetransmitted() const
+	{
+		return m_statistics.framesRetransmitted;
+	}
+
+	/**
+	 * \brief Returns the number of bytes written to the serial port since
+	 *        it was opened
+	 *
+	 * \return the number of bytes sent
+	 */
+	qint64 bytesSent() const
+	{
+		return m_statistics.bytesSent;
+	}
+
+	/**
+	 * \brief Returns the number of bytes read from the serial port since it
+	 *        was opened
+	 *
+	 * \return the number of bytes received
+	 */
+	qint64 bytesReceived() const
+	{
+		return m_statistics.bytesReceived;
+	}
+
 signals:
 	/**
 	 * \brief The signal emitted when the serial port name changes
@@ -377,16 +810,60 @@ signals:
 	 */
 	void baudRateChanged();
 
+	/**
+	 * \brief The signal emitted when the stream baud rate changes
+	 */
+	void streamBaudRateChanged();
+
+	/**
+	 * \brief The signal emitted when the baud rate used on the serial port
+	 *        changes
+	 */
+	void linkBaudRateChanged();
+
 	/**
 	 * \brief The signal emitted when the oneShotSequence property changes
 	 */
 	void oneShotSequenceChanged();
 
+	/**
+	 * \brief The signal emitted when the compileTrajectory property
+	 *        changes
+	 */
+	void compileTrajectoryChanged();
+
+	/**
+	 * \brief The signal emitted when the trajectoryTolerance property
+	 *        changes
+	 */
+	void trajectoryToleranceChanged();
+
+	/**
+	 * \brief The signal emitted when the trajectoryEasing property changes
+	 */
+	void trajectoryEasingChanged();
+
+	/**
+	 * \brief The signal emitted when the clockSync property changes
+	 */
+	void clockSyncChanged();
+
+	/**
+	 * \brief The signal emitted when the state of the synchronization of
+	 *        the clock of the hardware changes
+	 */
+	void clockSyncStateChanged();
+
 	/**
 	 * \brief The signal emitted when the serial port is opened/closed
 	 */
 	void isConnectedChanged();
 
+	/**
+	 * \brief The signal emitted when a capture is started or stopped
+	 */
+	void isCapturingChanged();
+
 	/**
 	 * \brief The signal emitted when the isStreaming property changes
 	 */
@@ -402,6 +879,41 @@ signals:
 	 */
 	void isImmediateModeChanged();
 
+	/**
+	 * \brief The signal emitted when the isUploadMode property changes
+	 */
+	void isUploadModeChanged();
+
+	/**
+	 * \brief The signal emitted when the isStoredPlaybackMode property
+	 *        changes
+	 */
+	void isStoredPlaybackModeChanged();
+
+	/**
+	 * \brief The signal emitted when the number of uploaded points changes
+	 */
+	void uploadedPointsChanged();
+
+	/**
+	 * \brief The signal emitted when the playhead changes
+	 */
+	void playheadChanged();
+
+	/**
+	 * \brief The signal emitted when the whole sequence has been stored by
+	 *        the hardware
+	 */
+	void uploadFinished();
+
+	/**
+	 * \brief The signal emitted when the hardware answers to
+	 *        sendCalibration()
+	 *
+	 * \param accepted true if the hardware stored the calibration
+	 */
+	void calibrationSet(bool accepted);
+
 	/**
 	 * \brief The signal emitted when streaming is paused/resumed
 	 */
@@ -428,36 +940,30 @@ signals:
 	 */
 	void batteryChargeChanged();
 
-private slots:
 	/**
-	 * \brief The slot called when there is data ready to be read
+	 * \brief The signal emitted when the task overruns change
 	 */
-	void handleReadyRead();
+	void taskOverrunsChanged();
 
 	/**
-	 * \brief The function called when there is an error in the serial
-	 *        communication
-	 *
-	 * \param error the error code
+	 * \brief The signal emitted when the telemetry of the hardware changes
 	 */
-	void handleError(QSerialPort::SerialPortError error);
+	void telemetryChanged();
 
 	/**
-	 * \brief The slot called a second after the serial port is opened to
-	 *        start sending data
-	 *
-	 * This is needed to give Arduino time to boot. This function is also
-	 * called if a sequence is started after arduino has booted. Basically
-	 * this function automatically sends data if called from the timer and
-	 * streaming has already been requested. If called from the timer but
-	 * streaming hasn't been requested yet, it does nothing. When streaming
-	 * is requested, this function is called by either startStream() or
-	 * startImmediate() and starts sending data.
+	 * \brief The signal emitted when the hardware buffer size changes
+	 */
+	void hardwareBufferSizeChanged();
+
+	/**
+	 * \brief The signal emitted when the statistics of the stream change
 	 */
-	void arduinoBootFinished();
+	void statisticsChanged();
 
+private slots:
 	/**
 	 * \brief The slot called when the current point in the sequence changes
+	 *        in immediate mode
 	 *
 	 * This is connected to both the curPointChanged() and the
 	 * curPointValuesChanged() signals of the sequence
@@ -466,70 +972,130 @@ private slots:
 
 private:
 	/**
-	 * \brief Returns a sequence packet for the given point
-	 *
-	 * This function doesn't check that p has the length that was used in
-	 * the start stream or start immediate package, ensure this externally
-	 * (this condition is fulfilled if the same sequence is used for the
-	 * start and this function, as it should be)
-	 * \param p the point for which to create a packet
-	 * \return the packet for the point
+	 * \brief Sends the settings of the compilation of trajectories to the
+	 *        stream engine
 	 */
-	QByteArray createSequencePacketForPoint(const SequencePoint& p) const;
+	void updateTrajectoryCompilation();
 
 	/**
-	 * \brief Processes received packets
+	 * \brief Calls a function of the stream engine and waits for it to
+	 *        return
+	 *
+	 * \param method the name of the function to call
+	 * \param arg0 the first argument of the function
+	 * \param arg1 the second argument of the function
+	 * \param arg2 the third argument of the function
+	 * \param arg3 the fourth argument of the function
+	 * \return the value returned by the function
 	 */
-	void processReceivedPackets();
+	bool callEngine(const char* method, QGenericArgument arg0 = QGenericArgument(), QGenericArgument arg1 = QGenericArgument(), QGenericArgument arg2 = QGenericArgument(), QGenericArgument arg3 = QGenericArgument());
 
 	/**
-	 * \brief The function to call when the sequence is no longer streamed
+	 * \brief Changes the modality and emits the changed signals if needed
 	 *
-	 * This is called when either immediate mode stops or the "sequence
-	 * finished" packet is received
+	 * This is connected to the modeChanged() signal of the stream engine
+	 * \param mode the new modality (one of the values of StreamEngine::Mode)
 	 */
-	void sequenceStreamEnded();
+	void setMode(int mode);
 
 	/**
-	 * \brief Moves the current point forward
+	 * \brief Changes the connected flag and emits the changed signal if
+	 *        needed
 	 *
-	 * This function moves the current point forward by one. If we reach the
-	 * end of the sequence in stream mode, terminates the streaming.
+	 * \param v the new value of the flag
 	 */
-	void incrementCurPoint();
+	void setIsConnected(bool v);
 
 	/**
-	 * \brief The function that actually sends data
+	 * \brief Changes the capturing flag and emits the changed signal if
+	 *        needed
 	 *
-	 * \param dataToSend the data to send through the serial port
+	 * \param v the new value of the flag
 	 */
-	void sendData(const QByteArray& dataToSend);
+	void setIsCapturing(bool v);
 
 	/**
-	 * \brief Changes the value of the m_isStreamMode flag and emits the
-	 *        changed signal if needed
+	 * \brief Changes the pause flag and emits the changed signal if needed
 	 *
 	 * \param v the new value of the flag
 	 */
-	void setIsStreamMode(bool v);
+	void setIsPaused(bool v);
 
 	/**
-	 * \brief Changes the value of the m_isImmediateMode flag and emits the
-	 *        changed signal if needed
+	 * \brief Changes the number of uploaded points and emits the changed
+	 *        signal if needed
 	 *
-	 * \param v the new value of the flag
+	 * \param v the new number of uploaded points
 	 */
-	void setIsImmediateMode(bool v);
+	void setUploadedPoints(int v);
+
+	/**
+	 * \brief Changes the playhead and emits the changed signal if needed
+	 *
+	 * \param v the new playhead
+	 */
+	void setPlayhead(int v);
 
 	/**
 	 * \brief Changes the value of the battery charge and emits the changed
 	 *        signal if needed
 	 *
-	 * \param v the new value of the battery charge (if negative, -1.0 is
-	 *          used)
+	 * \param v the new value of the battery charge
 	 */
 	void setBatteryCharge(float v);
 
+	/**
+	 * \brief Changes the value of the task overruns and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new list of task overruns
+	 */
+	void setTaskOverruns(const QVariantList& v);
+
+	/**
+	 * \brief Changes the telemetry and emits the changed signal if needed
+	 *
+	 * \param v the new telemetry
+	 */
+	void setTelemetry(const HardwareTelemetry& v);
+
+	/**
+	 * \brief Changes the value of the hardware buffer size and emits the
+	 *        changed signal if needed
+	 *
+	 * \param v the new hardware buffer size
+	 */
+	void setHardwareBufferSize(int v);
+
+	/**
+	 * \brief Changes the value of the link baud rate and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new link baud rate
+	 */
+	void setLinkBaudRate(int v);
+
+	/**
+	 * \brief Changes the statistics of the stream and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new statistics
+	 */
+	void setStatistics(const StreamStatistics& v);
+
+	/**
+	 * \brief Changes the state of the synchronization of the clock and
+	 *        emits the changed signal if needed
+	 *
+	 * This is connected to the clockSyncChanged() signal of the stream
+	 * engine
+	 * \param synced true if the clock of the hardware is synchronized
+	 * \param roundTrip the round trip time of the last kept ping
+	 * \param drift the correction of the rate of the clock in parts per
+	 *              million
+	 */
+	void setClockSyncState(bool synced, int roundTrip, double drift);
+
 	/**
 	 * \brief The name of the serial port to open
 	 */
@@ -540,6 +1106,16 @@ private:
 	 */
 	int m_baudRate;
 
+	/**
+	 * \brief The baud rate to ask the hardware to use when streaming
+	 */
+	int m_streamBaudRate;
+
+	/**
+	 * \brief The baud rate currently used on the serial port
+	 */
+	int m_linkBaudRate;
+
 	/**
 	 * \brief Whether the sequence is played only once or continuously
 	 *
@@ -548,43 +1124,76 @@ private:
 	bool m_oneShotSequence;
 
 	/**
-	 * \brief The serial communication port
+	 * \brief Whether sequences are compiled before streaming
 	 */
-	QSerialPort m_serialPort;
+	bool m_compileTrajectory;
 
 	/**
-	 * \brief The sequence to stream
-	 *
-	 * This is nullptr if there is no sequence to stream
+	 * \brief The maximum distance of compiled sequences from the original
+	 *        ones
 	 */
-	Sequence* m_sequence;
+	double m_trajectoryTolerance;
+
+	/**
+	 * \brief Whether compiled sequences have easing profiles
+	 */
+	bool m_trajectoryEasing;
+
+	/**
+	 * \brief Whether the clock of the hardware is synchronized with the one
+	 *        of the PC
+	 */
+	bool m_clockSync;
+
+	/**
+	 * \brief True if the clock of the hardware has been synchronized
+	 */
+	bool m_isClockSynced;
 
 	/**
-	 * \brief True if we are in stream modality
+	 * \brief The round trip time of the last clock ping used
 	 */
-	bool m_isStreamMode;
+	int m_clockRoundTrip;
 
 	/**
-	 * \brief True if we are in immediate modality
+	 * \brief The correction of the rate of the clock of the hardware in
+	 *        parts per million
 	 */
-	bool m_isImmediateMode;
+	double m_clockDrift;
 
 	/**
-	 * \brief The timer to wait for Arduino boot to finish
+	 * \brief The thread where the stream engine lives
+	 */
+	QThread m_thread;
+
+	/**
+	 * \brief The object actually communicating with the hardware
 	 *
-	 * See arduinoBootFinished() description
+	 * This lives in m_thread and is deleted when the thread finishes
+	 */
+	StreamEngine* m_engine;
+
+	/**
+	 * \brief True if the serial port is open
 	 */
-	QTimer m_arduinoBoot;
+	bool m_isConnected;
 
 	/**
-	 * \brief The buffer of data from the serial port
+	 * \brief True if data is being written to a capture file
 	 */
-	QByteArray m_incomingData;
+	bool m_isCapturing;
 
 	/**
-	 * \brief The index in m_incomingData to process
+	 * \brief The current modality
 	 */
-	int m_indexToProcess;
+	StreamEngine::Mode m_mode;
+
+	/**
+	 * \brief The sequence whose current point is sent in immediate mode
+	 *
+	 * This is nullptr in the other modalities
+	 */
+	Sequence* m_sequence;
 
 	/**
 	 * \brief If true streaming is paused in stream mode
@@ -592,10 +1201,19 @@ private:
 	bool m_paused;
 
 	/**
-	 * \brief True if we cannot send more sequence points because the queue
-	 *        of the hardware is full
+	 * \brief The number of points sent during the current upload
 	 */
-	bool m_hardwareQueueFull;
+	int m_uploadedPoints;
+
+	/**
+	 * \brief The position of the next point to stream
+	 */
+	int m_playhead;
+
+	/**
+	 * \brief How many points the hardware can buffer
+	 */
+	int m_hardwareBufferSize;
 
 	/**
 	 * \brief The current charge level of the battery
@@ -603,10 +1221,19 @@ private:
 	float m_batteryCharge;
 
 	/**
-	 * \brief True if we have sent a stop sequence packet and are waiting
-	 *        for the end of the sequence
+	 * \brief The number of missed deadlines of each task on the hardware
+	 */
+	QVariantList m_taskOverruns;
+
+	/**
+	 * \brief The last telemetry received from the hardware
+	 */
+	HardwareTelemetry m_telemetry;
+
+	/**
+	 * \brief The last statistics of the stream
 	 */
-	bool m_stopping;
+	StreamStatistics m_statistics;
 };
 
 #endif // SERIALCOMMUNICATION_H
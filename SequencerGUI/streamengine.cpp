@@ -0,0 +1,1475 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "streamengine.h"
+#include "logging.h"
+#include "crc8.h"
+#include "pointcodec.h"
+#include "trajectorycompiler.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+	// How long to wait for an answer of the hardware during baud rate negotiation, in milliseconds.
+	// This is longer than the time the hardware waits for the confirmation of the new rate, so that
+	// on timeout the hardware has surely gone back to the normal baud rate
+	const int baudRateNegotiationTimeoutMs = 1500;
+
+	// The minimum interval between two progress notifications, in milliseconds. This is about the
+	// refresh rate of the display, notifying more often would only load the GUI thread
+	const int progressNotificationIntervalMs = 16;
+
+	// The minimum interval between two points in immediate mode, in milliseconds. The hardware
+	// updates servos at 100 Hz, points sent more often would be overwritten before being used
+	const int immediateSendIntervalMs = 10;
+
+	// The interval between two clock pings, in milliseconds. A new estimate of the clock of the
+	// hardware is sent every ClockSync::pingsPerWindow pings, i.e. every two seconds
+	const int clockPingIntervalMs = 250;
+
+	// How long to wait for an ack before sending frames again, in milliseconds. The hardware repeats
+	// its ack every 100 milliseconds, so this only expires if frames or acks are lost
+	const int retransmitTimeoutMs = 300;
+
+	// The flag of ack packets asking to send frames again
+	const int retransmitFlag = 0x01;
+
+	// The number of servos of the hardware (SequencePoint::dim in the firmware). Calibration packets
+	// always have one channel per servo
+	const int hardwareChannels = 16;
+
+	// The maximum dimension of points and the maximum size of their packets
+	const int maxPointDim = PointCodec<1>::maxDim;
+	const int maxPacketSize = PointCodec<maxPointDim>::maxPacketSize;
+
+	// Records of snapshots have the layout of sequence packets
+	static_assert(SequenceSnapshot::recordHeaderSize == PointCodec<1>::timesSize, "Records of snapshots must have the layout of sequence packets");
+	static_assert(SequenceSnapshot::linearSlope == PointCodec<1>::linearSlope, "The linear slope must be the one of the protocol");
+
+	// Writes the shortest packet for a point of a stream with DimT positions
+	template <unsigned char DimT>
+	int encodeStreamPacket(const char* record, const char* previousRecord, int startSlope, int endSlope, char* packet)
+	{
+		const unsigned char* const r = reinterpret_cast<const unsigned char*>(record);
+		const unsigned int duration = (r[0] << 8) | r[1];
+		const unsigned int timeToTarget = (r[2] << 8) | r[3];
+		const unsigned char* const previousValues = (previousRecord == nullptr) ? nullptr : (reinterpret_cast<const unsigned char*>(previousRecord) + SequenceSnapshot::recordHeaderSize);
+
+		return PointCodec<DimT>::encodeStreamPacket(duration, timeToTarget, startSlope, endSlope, r + SequenceSnapshot::recordHeaderSize, previousValues, reinterpret_cast<unsigned char*>(packet));
+	}
+
+	// Returns the CRC-8 of the given bytes, computed as the hardware does (see crc8.h)
+	quint8 crc8(const char* data, int size)
+	{
+		quint8 crc = 0;
+		for (int i = 0; i < size; ++i) {
+			crc = crc8Update(crc, static_cast<quint8>(data[i]));
+		}
+
+		return crc;
+	}
+}
+
+StreamEngine::StreamEngine(QObject* parent)
+	: QObject(parent)
+	, m_serialPort(this)
+	, m_baudRate(115200)
+	, m_streamBaudRate(0)
+	, m_linkBaudRate(-1)
+	, m_streamBaudRateFailed(false)
+	, m_baudRateNegotiation(NoNegotiation)
+	, m_baudRateNegotiationTimer(this)
+	, m_oneShotSequence(true)
+	, m_compileTrajectory(false)
+	, m_trajectoryTolerance(1.0)
+	, m_trajectoryEasing(true)
+	, m_streamStartPoint(0)
+	, m_mode(NoMode)
+	, m_snapshot()
+	, m_pointDim(0)
+	, m_streamPacketEncoder(nullptr)
+	, m_playhead(-1)
+	, m_immediatePoint()
+	, m_hasImmediatePoint(false)
+	, m_immediatePointPending(false)
+	, m_immediateTimer(this)
+	, m_uploadedPoints(0)
+	, m_progressTimer(this)
+	, m_startTime(-1)
+	, m_startTimer(this)
+	, m_clockSyncEnabled(false)
+	, m_clockSync()
+	, m_clockSyncTimer(this)
+	, m_arduinoBoot(this)
+	, m_pendingCalibration()
+	, m_frameCapture()
+	, m_incomingData()
+	, m_readOffset(0)
+	, m_deferredPackets()
+	, m_paused(false)
+	, m_credits(0)
+	, m_framing(false)
+	, m_nextSequence(0)
+	, m_firstUnackedSequence(0)
+	, m_unackedFrames()
+	, m_retransmitTimer(this)
+	, m_lastStreamedPoint(-1)
+	, m_hardwareBufferSize(-1)
+	, m_batteryCharge(-1.0)
+	, m_taskOverruns()
+	, m_telemetry()
+	, m_statistics()
+	, m_stopping(false)
+{
+	// Connecting signals from the serial port
+	connect(&m_serialPort, &QSerialPort::readyRead, this, &StreamEngine::handleReadyRead);
+	connect(&m_serialPort, static_cast<void (QSerialPort::*)(QSerialPort::SerialPortError)>(&QSerialPort::error), this, &StreamEngine::handleError);
+
+	// Connecting the signal for the Arduino boot timer. Also setting the timer to be singleShot
+	m_arduinoBoot.setSingleShot(true);
+	connect(&m_arduinoBoot, &QTimer::timeout, this, &StreamEngine::arduinoBootFinished);
+
+	// The same for the baud rate negotiation timer
+	m_baudRateNegotiationTimer.setSingleShot(true);
+	connect(&m_baudRateNegotiationTimer, &QTimer::timeout, this, &StreamEngine::baudRateNegotiationTimeout);
+
+	// And for the timer of progress notifications
+	m_progressTimer.setSingleShot(true);
+	connect(&m_progressTimer, &QTimer::timeout, this, &StreamEngine::notifyProgress);
+
+	// And for the timer limiting the rate of points in immediate mode
+	m_immediateTimer.setSingleShot(true);
+	connect(&m_immediateTimer, &QTimer::timeout, this, &StreamEngine::immediateIntervalExpired);
+
+	// And for the timer waiting for the start time of the stream. It must be precise, streams
+	// on different ports are started with it
+	m_startTimer.setSingleShot(true);
+	m_startTimer.setTimerType(Qt::PreciseTimer);
+	connect(&m_startTimer, &QTimer::timeout, this, &StreamEngine::startTimeReached);
+
+	// The timer sending clock pings is periodic
+	connect(&m_clockSyncTimer, &QTimer::timeout, this, &StreamEngine::sendClockPing);
+
+	// The timer to send frames again is restarted every time frames are acknowledged
+	m_retransmitTimer.setSingleShot(true);
+	connect(&m_retransmitTimer, &QTimer::timeout, this, &StreamEngine::retransmitTimeout);
+}
+
+StreamEngine::~StreamEngine()
+{
+}
+
+qint64 StreamEngine::currentTime()
+{
+	QElapsedTimer clock;
+	clock.start();
+
+	return clock.msecsSinceReference();
+}
+
+bool StreamEngine::openSerial(QString portName, int baudRate)
+{
+	if (isStreaming()) {
+		qDebug() << "StreamEngine error: cannot open port while a sequence is being streamed";
+		return false;
+	}
+
+	// Closing the old port
+	closeSerial();
+
+	// Setting the name and baud rate of the port
+	m_baudRate = baudRate;
+	m_serialPort.setPortName(portName);
+	m_serialPort.setBaudRate(m_baudRate);
+
+	// Trying to open the port
+	if (!m_serialPort.open(QIODevice::ReadWrite)) {
+		return false;
+	}
+
+	// Signalling that the port is open
+	emit connectedChanged(true);
+	setLinkBaudRate(m_baudRate);
+	m_streamBaudRateFailed = false;
+	m_statistics = StreamStatistics();
+	notifyStatistics();
+
+	// The board has just been reset
+	resetClockSync();
+
+	// This is necessary to give time to Arduino to "boot" (the board reboots every time the serial port
+	// is opened, and then there are 0.5 seconds taken by the bootloader)
+	m_arduinoBoot.start(1000);
+
+	return true;
+}
+
+bool StreamEngine::closeSerial()
+{
+	if (isStreaming()) {
+		qDebug() << "StreamEngine error: cannot close port while a sequence is being streamed";
+		return false;
+	}
+
+	// Closing the port
+	if (m_serialPort.isOpen()) {
+		m_serialPort.close();
+		m_serialPort.clearError();
+
+		// Signalling that the port is closed
+		emit connectedChanged(false);
+
+		// Setting the battery charge to -1.0 and forgetting task overruns
+		setBatteryCharge(-1.0);
+		setTaskOverruns(QVariantList());
+		setTelemetry(HardwareTelemetry());
+		setHardwareBufferSize(-1);
+		setLinkBaudRate(-1);
+		resetClockSync();
+		m_pendingCalibration.clear();
+	}
+
+	return true;
+}
+
+bool StreamEngine::startCapture(QString filename)
+{
+	const bool wasCapturing = m_frameCapture.isOpen();
+
+	const bool ok = m_frameCapture.open(filename);
+	if (!ok) {
+		qDebug() << "StreamEngine error: cannot open capture file" << filename;
+	}
+
+	if (wasCapturing != m_frameCapture.isOpen()) {
+		emit capturingChanged(m_frameCapture.isOpen());
+	}
+
+	return ok;
+}
+
+void StreamEngine::stopCapture()
+{
+	if (m_frameCapture.isOpen()) {
+		m_frameCapture.close();
+
+		emit capturingChanged(false);
+	}
+}
+
+void StreamEngine::setOneShotSequence(bool oneShot)
+{
+	m_oneShotSequence = oneShot;
+}
+
+void StreamEngine::setTrajectoryCompilation(bool compile, double tolerance, bool easing)
+{
+	m_compileTrajectory = compile;
+	m_trajectoryTolerance = tolerance;
+	m_trajectoryEasing = easing;
+}
+
+bool StreamEngine::startStream(SequenceSnapshot snapshot, int startPoint, int streamBaudRate, qint64 startTime)
+{
+	if (!canStart("start a new stream")) {
+		return false;
+	}
+
+	if (!setPointDim(snapshot.pointDim())) {
+		return false;
+	}
+
+	// Saving the points and the first point to send
+	m_snapshot = snapshot;
+	m_streamStartPoint = startPoint;
+	m_streamBaudRate = streamBaudRate;
+
+	m_startTime = startTime;
+
+	// Compiling large sequences takes long, we do it after returning so that the caller does not
+	// wait for it. Calls queued after this one are executed when the stream has begun
+	if (m_compileTrajectory) {
+		QMetaObject::invokeMethod(this, "compileAndBeginStream", Qt::QueuedConnection);
+	} else {
+		beginStream();
+	}
+
+	return true;
+}
+
+bool StreamEngine::pauseStream()
+{
+	if (m_mode != StreamMode) {
+		qDebug() << "StreamEngine error: cannot pause when no sequence is being streamed";
+		return false;
+	}
+
+	if (m_paused) {
+		return false;
+	}
+
+	setPaused(true);
+
+	return true;
+}
+
+bool StreamEngine::resumeStream()
+{
+	if (m_mode != StreamMode) {
+		qDebug() << "StreamEngine error: cannot pause when no sequence is being streamed";
+		return false;
+	}
+
+	if (!m_paused) {
+		return false;
+	}
+
+	// Resuming streaming
+	setPaused(false);
+
+	// Processing all received packets, then sending points for the credits we already had
+	processReceivedPackets();
+	streamWhileCredits();
+
+	return true;
+}
+
+bool StreamEngine::startImmediate(int pointDim)
+{
+	if (!canStart("start a new stream")) {
+		return false;
+	}
+
+	if (!setPointDim(pointDim)) {
+		return false;
+	}
+
+	// The point is set by setImmediatePoint()
+	m_snapshot = SequenceSnapshot();
+	m_hasImmediatePoint = false;
+
+	beginMode(ImmediateMode);
+
+	return true;
+}
+
+void StreamEngine::setImmediatePoint(SequencePoint point)
+{
+	if (m_mode != ImmediateMode) {
+		return;
+	}
+
+	m_immediatePoint = point;
+	m_hasImmediatePoint = true;
+
+	// If the hardware is still booting, the point is sent together with the start packet. If
+	// the last point was sent too recently, this one is sent when the interval expires (unless
+	// it is replaced by a newer one)
+	if (m_arduinoBoot.isActive()) {
+		return;
+	} else if (m_immediateTimer.isActive()) {
+		m_immediatePointPending = true;
+	} else {
+		sendImmediatePoint();
+	}
+}
+
+bool StreamEngine::uploadSequence(SequenceSnapshot snapshot)
+{
+	if (!canStart("upload a sequence")) {
+		return false;
+	}
+	if (snapshot.isEmpty()) {
+		qDebug() << "StreamEngine error: cannot upload an empty sequence";
+		return false;
+	}
+
+	if (!setPointDim(snapshot.pointDim())) {
+		return false;
+	}
+
+	// Saving the points to upload
+	m_snapshot = snapshot;
+
+	beginMode(UploadMode);
+
+	return true;
+}
+
+bool StreamEngine::playStored(qint64 startTime)
+{
+	if (!canStart("play the stored sequence")) {
+		return false;
+	}
+
+	// There are no points in this modality
+	m_snapshot = SequenceSnapshot();
+	m_startTime = startTime;
+
+	beginMode(StoredPlaybackMode);
+
+	return true;
+}
+
+bool StreamEngine::sendCalibration(CalibrationProfile profile)
+{
+	if (!canStart("send the calibration")) {
+		return false;
+	}
+	if (!profile.isValid()) {
+		qDebug() << "StreamEngine error: cannot send an invalid calibration";
+		return false;
+	}
+	// The hardware reads a fixed number of bytes, a different number of channels would break the
+	// parsing of all following commands
+	if (profile.numChannels() != hardwareChannels) {
+		qDebug() << "StreamEngine error: the calibration must have" << hardwareChannels << "channels, it has" << profile.numChannels();
+		return false;
+	}
+
+	QByteArray pkt(2 + 6 * profile.numChannels(), 0);
+	pkt[0] = 'L';
+	pkt[1] = profile.numChannels();
+	for (int c = 0; c < profile.numChannels(); ++c) {
+		const CalibrationProfile::Channel& ch = profile.channel(c);
+		const int values[3] = {ch.pwmMin, ch.pwmMax, ch.pwmRest};
+		for (int i = 0; i < 3; ++i) {
+			pkt[2 + 6 * c + 2 * i] = (values[i] >> 8) & 0xFF;
+			pkt[3 + 6 * c + 2 * i] = values[i] & 0xFF;
+		}
+	}
+
+	// Anything sent while the hardware boots is lost
+	if (m_arduinoBoot.isActive()) {
+		m_pendingCalibration = pkt;
+	} else {
+		sendData(pkt);
+	}
+
+	return true;
+}
+
+bool StreamEngine::stop()
+{
+	if (!isStreaming()) {
+		qDebug() << "StreamEngine error: no stream to stop";
+		return false;
+	}
+
+	// If we are still negotiating the baud rate, the hardware has not started streaming yet and
+	// we can end here (the hardware goes back to the normal baud rate by itself)
+	if (m_baudRateNegotiation != NoNegotiation) {
+		m_baudRateNegotiationTimer.stop();
+		m_baudRateNegotiation = NoNegotiation;
+		sequenceStreamEnded();
+
+		return true;
+	}
+
+	// Setting the stopping flag
+	m_stopping = true;
+
+	// Sending packet to stop streaming
+	sendPacket(QByteArray("H"), true);
+
+	// If we are in immediate or upload mode, we can end here, otherwise we must
+	// wait for the hardware to tell us that the sequence is finished
+	if ((m_mode == ImmediateMode) || (m_mode == UploadMode)) {
+		sequenceStreamEnded();
+	}
+
+	return true;
+}
+
+void StreamEngine::handleReadyRead()
+{
+	// Getting data and adding to the buffer
+	const QByteArray data = m_serialPort.readAll();
+	m_incomingData.append(data);
+	m_statistics.bytesReceived += data.size();
+
+	// Tracing. The hex conversion only happens if the category is enabled
+	m_frameCapture.captureReceived(data);
+	qCDebug(serialData) << "RX" << data.toHex();
+
+	// Processing received data
+	processReceivedPackets();
+}
+
+void StreamEngine::handleError(QSerialPort::SerialPortError error)
+{
+	if (error != QSerialPort::NoError) {
+		const QString errorString = "Error streaming: " + m_serialPort.errorString();
+		emit streamError(errorString);
+		qDebug() << errorString;
+
+		// Framing errors while using the stream baud rate mean that the link is not reliable at
+		// that speed, not using it again
+		if (((error == QSerialPort::FramingError) || (error == QSerialPort::ParityError)) && (m_linkBaudRate != m_baudRate)) {
+			qDebug() << "Framing errors at" << m_linkBaudRate << "baud, falling back to" << m_baudRate << "baud for next streams";
+			m_streamBaudRateFailed = true;
+		}
+
+//		QString errorString = "Error streaming, error code: ";
+
+//		switch (error) {
+//			case QSerialPort::DeviceNotFoundError:
+//				errorString += "DeviceNotFoundError (an error occurred while attempting to open an non-existing device)";
+//				break;
+//			case QSerialPort::PermissionError:
+//				errorString += "PermissionError (an error occurred while attempting to open an already opened device by another process or a user not having enough permission and credentials to open)";
+//				break;
+//			case QSerialPort::OpenError:
+//				errorString += "OpenError (an error occurred while attempting to open an already opened device in this object)";
+//				break;
+//			case QSerialPort::NotOpenError:
+//				errorString += "NotOpenError (this error occurs when an operation is executed that can only be successfully performed if the device is open)";
+//				break;
+//			case QSerialPort::ParityError:
+//				errorString += "ParityError (parity error detected by the hardware while reading data)";
+//				break;
+//			case QSerialPort::FramingError:
+//				errorString += "FramingError (framing error detected by the hardware while reading data)";
+//				break;
+//			case QSerialPort::BreakConditionError:
+//				errorString += "BreakConditionError (break condition detected by the hardware on the input line)";
+//				break;
+//			case QSerialPort::WriteError:
+//				errorString += "WriteError (an I/O error occurred while writing the data)";
+//				break;
+//			case QSerialPort::ReadError:
+//				errorString += "ReadError (an I/O error occurred while reading the data)";
+//				break;
+//			case QSerialPort::ResourceError:
+//				errorString += "ResourceError (an I/O error occurred when a resource becomes unavailable, e.g. when the device is unexpectedly removed from the system)";
+//				break;
+//			case QSerialPort::UnsupportedOperationError:
+//				errorString += "UnsupportedOperationError (the requested device operation is not supported or prohibited by the running operating system)";
+//				break;
+//			case QSerialPort::TimeoutError:
+//				errorString += "TimeoutError (a timeout error occurred)";
+//				break;
+//			case QSerialPort::UnknownError:
+//			default:
+//				errorString += "UnknownError (an unidentified error occurred)";
+//				break;
+//		}
+
+//		emit streamError(errorString);
+//		qDebug() << "Serial error." << errorString;
+	}
+}
+
+void StreamEngine::arduinoBootFinished()
+{
+	if (!m_pendingCalibration.isEmpty()) {
+		sendData(m_pendingCalibration);
+		m_pendingCalibration.clear();
+	}
+
+	// If we are streaming, sending data, otherwise doing nothing
+	if (isStreaming()) {
+		if ((m_mode == StreamMode) && (m_streamBaudRate > m_baudRate) && !m_streamBaudRateFailed) {
+			// Asking the hardware to use the stream baud rate before starting
+			QByteArray pkt(5, 0);
+			pkt[0] = 'R';
+			pkt[1] = (m_streamBaudRate >> 24) & 0xFF;
+			pkt[2] = (m_streamBaudRate >> 16) & 0xFF;
+			pkt[3] = (m_streamBaudRate >> 8) & 0xFF;
+			pkt[4] = m_streamBaudRate & 0xFF;
+			sendData(pkt);
+
+			m_baudRateNegotiation = WaitingBaudRateChanged;
+			m_baudRateNegotiationTimer.start(baudRateNegotiationTimeoutMs);
+		} else {
+			sendStartPacket();
+		}
+	}
+}
+
+void StreamEngine::baudRateNegotiationTimeout()
+{
+	if (m_baudRateNegotiation == NoNegotiation) {
+		return;
+	}
+
+	qDebug() << "No answer from the hardware during baud rate negotiation, streaming at" << m_baudRate << "baud";
+
+	// Going back to the normal baud rate (the hardware has already done the same) and starting
+	m_baudRateNegotiation = NoNegotiation;
+	m_streamBaudRateFailed = true;
+	switchLinkBaudRate(m_baudRate);
+	sendStartPacket();
+}
+
+void StreamEngine::startTimeReached()
+{
+	if ((m_mode == StreamMode) && !m_paused) {
+		streamWhileCredits();
+	} else if ((m_mode == StoredPlaybackMode) && !m_arduinoBoot.isActive()) {
+		// The start packet was held until now
+		sendStartPacket();
+	}
+}
+
+void StreamEngine::sendClockPing()
+{
+	// Pings are not sent while the baud rate is changing, they would be lost
+	const qint64 now = currentTime();
+	if (!m_serialPort.isOpen() || m_arduinoBoot.isActive() || (m_baudRateNegotiation != NoNegotiation) || !m_clockSync.canPing(now)) {
+		return;
+	}
+
+	QByteArray pkt(2, 0);
+	pkt[0] = 'C';
+	pkt[1] = m_clockSync.pingSent(now);
+	sendPacket(pkt, false);
+}
+
+void StreamEngine::compileAndBeginStream()
+{
+	m_snapshot = TrajectoryCompiler(m_trajectoryTolerance, m_trajectoryEasing).compile(m_snapshot);
+
+	// The port could have been closed by an error in the meantime
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "StreamEngine error: the serial port was closed while compiling the sequence";
+		m_snapshot = SequenceSnapshot();
+		return;
+	}
+
+	beginStream();
+}
+
+void StreamEngine::notifyProgress()
+{
+	if (m_mode == StreamMode) {
+		emit playheadChanged((m_playhead == -1) ? -1 : m_snapshot.sourcePoint(m_playhead));
+	} else if (m_mode == UploadMode) {
+		emit uploadedPointsChanged(m_uploadedPoints);
+	}
+
+	notifyStatistics();
+}
+
+void StreamEngine::immediateIntervalExpired()
+{
+	if ((m_mode == ImmediateMode) && m_immediatePointPending) {
+		sendImmediatePoint();
+	}
+}
+
+void StreamEngine::retransmitTimeout()
+{
+	if (m_framing && !m_unackedFrames.isEmpty()) {
+		retransmitFrames();
+	}
+}
+
+bool StreamEngine::setPointDim(int pointDim)
+{
+	if ((pointDim < 1) || (pointDim > maxPointDim)) {
+		qDebug() << "StreamEngine error: points must have 1 to" << maxPointDim << "positions";
+		return false;
+	}
+
+	// The encoders for points with 1 to maxPointDim positions
+	static const StreamPacketEncoder encoders[maxPointDim] = {
+		&encodeStreamPacket<1>, &encodeStreamPacket<2>, &encodeStreamPacket<3>, &encodeStreamPacket<4>,
+		&encodeStreamPacket<5>, &encodeStreamPacket<6>, &encodeStreamPacket<7>, &encodeStreamPacket<8>,
+		&encodeStreamPacket<9>, &encodeStreamPacket<10>, &encodeStreamPacket<11>, &encodeStreamPacket<12>,
+		&encodeStreamPacket<13>, &encodeStreamPacket<14>, &encodeStreamPacket<15>, &encodeStreamPacket<16>
+	};
+
+	m_pointDim = pointDim;
+	m_streamPacketEncoder = encoders[pointDim - 1];
+
+	return true;
+}
+
+bool StreamEngine::canStart(const char* what) const
+{
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "StreamEngine error: cannot" << what << "with a closed serial port";
+		return false;
+	}
+	if (isStreaming()) {
+		qDebug() << "StreamEngine error: cannot" << what << "while a sequence is being streamed";
+		return false;
+	}
+
+	return true;
+}
+
+void StreamEngine::beginStream()
+{
+	m_playhead = m_snapshot.isEmpty() ? -1 : m_snapshot.pointForSource(qMax(0, m_streamStartPoint));
+
+	beginMode(StreamMode);
+}
+
+void StreamEngine::beginMode(Mode mode)
+{
+	m_incomingData.clear();
+	m_readOffset = 0;
+	m_deferredPackets.clear();
+
+	// Resetting flags and setting the modality
+	setPaused(false);
+	m_credits = 0;
+	m_lastStreamedPoint = -1;
+	m_stopping = false;
+	m_uploadedPoints = 0;
+	endFraming();
+	setMode(mode);
+
+	// If the hardware cannot wait for the start time by itself, we hold points (or the start
+	// packet in stored playback mode) until then. The handshake is performed in the meantime
+	const qint64 delay = ((m_startTime == -1) || hardwareWaitsStartTime()) ? 0 : (m_startTime - currentTime());
+	if (delay > 0) {
+		m_startTimer.start(delay);
+	}
+
+	// Notifying the initial progress immediately
+	notifyProgress();
+
+	// If the m_arduinoBoot timer is running, we have to wait, otherwise we explicitly call
+	// the arduinoBootFinished() function to start sending data
+	if (!m_arduinoBoot.isActive()) {
+		arduinoBootFinished();
+	}
+}
+
+void StreamEngine::sendStartPacket()
+{
+	if (isStreaming()) {
+		// First sending the start packet
+		// In stored playback mode the packet is held until the start time, if the hardware cannot
+		// wait by itself
+		if ((m_mode == StoredPlaybackMode) && m_startTimer.isActive()) {
+			return;
+		}
+
+		QByteArray startPacket;
+		switch (m_mode) {
+			case StreamMode:
+				startPacket.append(hardwareWaitsStartTime() ? 'G' : 'S');
+				break;
+			case ImmediateMode:
+				startPacket.append('I');
+				break;
+			case UploadMode:
+				startPacket.append('U');
+				break;
+			case StoredPlaybackMode:
+				startPacket.append('Y');
+				break;
+			default:
+				qFatal("Unknown mode, we should never get here");
+		}
+		if (m_mode == StoredPlaybackMode) {
+			// Adding the flags to the play stored sequence packet, followed by the start time if
+			// the hardware waits for it
+			const char flags = char((m_oneShotSequence ? 0x00 : 0x01) | (hardwareWaitsStartTime() ? 0x02 : 0x00));
+			startPacket.append(flags);
+			if (hardwareWaitsStartTime()) {
+				appendStartTime(startPacket);
+			}
+		} else {
+			// Adding the number of dimension of point to the start packet
+			startPacket.append(m_pointDim & 0xFF);
+
+			// The start sequence at time packet also has the start time
+			if ((m_mode == StreamMode) && hardwareWaitsStartTime()) {
+				appendStartTime(startPacket);
+			}
+
+			// The upload packet also has the number of points
+			if (m_mode == UploadMode) {
+				startPacket.append((m_snapshot.numPoints() >> 8) & 0xFF);
+				startPacket.append(m_snapshot.numPoints() & 0xFF);
+			}
+		}
+		sendData(startPacket);
+
+		// From now on the hardware only accepts frames in stream mode
+		if (m_mode == StreamMode) {
+			m_framing = true;
+		}
+
+		// In immediate mode we send the current point now, in stream mode we wait for the
+		// "stream started" packet to know how many points we can send
+		if ((m_mode == ImmediateMode) && m_hasImmediatePoint) {
+			sendImmediatePoint();
+		}
+	}
+}
+
+QByteArray StreamEngine::createSequencePacketForPoint(const SequencePoint& p) const
+{
+	QByteArray record(SequenceSnapshot::recordHeaderSize + p.point.size(), 0);
+	SequenceSnapshot::packPoint(p, record.data());
+
+	return createSequencePacketForRecord(record.constData());
+}
+
+QByteArray StreamEngine::createSequencePacketForRecord(const char* record) const
+{
+	// Packet type followed by the record, which has the same layout of the packet
+	QByteArray pkt;
+	pkt.reserve(1 + SequenceSnapshot::recordHeaderSize + m_pointDim);
+	pkt.append('P');
+	pkt.append(record, SequenceSnapshot::recordHeaderSize + m_pointDim);
+
+	return pkt;
+}
+
+QByteArray StreamEngine::createStreamPacket(int pos)
+{
+	// The encoder chooses between the sequence packet and the delta one, points with an easing
+	// profile always need the delta packet
+	const char* const previousRecord = (m_lastStreamedPoint != -1) ? m_snapshot.record(m_lastStreamedPoint) : nullptr;
+	char pkt[maxPacketSize];
+	const int size = m_streamPacketEncoder(m_snapshot.record(pos), previousRecord, m_snapshot.startSlope(pos), m_snapshot.endSlope(pos), pkt);
+	m_lastStreamedPoint = pos;
+
+	return QByteArray(pkt, size);
+}
+
+void StreamEngine::processReceivedPackets()
+{
+	// If we are no longer paused, the packets we deferred must be processed before the new ones.
+	// This only copies the few packets received while paused plus the unprocessed data
+	if (!m_paused && !m_deferredPackets.isEmpty()) {
+		m_deferredPackets.append(m_incomingData.constData() + m_readOffset, m_incomingData.size() - m_readOffset);
+		m_incomingData.swap(m_deferredPackets);
+		m_deferredPackets.clear();
+		m_readOffset = 0;
+	}
+
+	// Packets are consumed by moving m_readOffset forward. The offset is always moved before
+	// acting on a packet, because actions could reset the buffer (e.g. sequenceStreamEnded())
+	bool partialPacket = false;
+	while ((m_readOffset < m_incomingData.size()) && (!partialPacket)) {
+		const char* const data = m_incomingData.constData() + m_readOffset;
+		const int available = m_incomingData.size() - m_readOffset;
+		const char type = data[0];
+
+		if ((type == 'A') && (m_mode == StreamMode)) {
+			if (available < 2) {
+				partialPacket = true;
+			} else if (m_stopping) {
+				// Discarding this packet, we are stopping
+				m_readOffset += 2;
+			} else if (m_paused) {
+				// Keeping this packet for when we are resumed
+				deferPacket(2);
+			} else {
+				const int freeSlots = static_cast<unsigned char>(data[1]);
+				m_readOffset += 2;
+
+				setHardwareBufferSize(freeSlots);
+
+				// Filling the hardware buffer without waiting for answers
+				m_credits = freeSlots;
+				streamWhileCredits();
+			}
+		} else if ((type == 'X') && m_framing) {
+			if (available < 5) {
+				partialPacket = true;
+			} else if (crc8(data + 1, 3) != static_cast<quint8>(data[4])) {
+				// This is not a valid ack, skipping one byte to get in sync again. The hardware
+				// repeats its ack, so nothing is lost
+				m_readOffset += 1;
+			} else {
+				// Acks are processed also when paused, so that frames the hardware has are not sent
+				// again
+				const quint8 expected = static_cast<quint8>(data[1]);
+				const int freeSlots = static_cast<unsigned char>(data[2]);
+				const int flags = static_cast<unsigned char>(data[3]);
+				m_readOffset += 5;
+
+				ackReceived(expected, freeSlots, flags);
+			}
+		} else if ((type == 'R') && (m_baudRateNegotiation == WaitingBaudRateChanged)) {
+			if (available < 2) {
+				partialPacket = true;
+			} else {
+				const bool accepted = (data[1] != 0);
+				m_readOffset += 2;
+				m_baudRateNegotiationTimer.stop();
+
+				if (accepted) {
+					// Switching to the new baud rate and confirming. This discards anything
+					// left in the buffer, so the cycle ends here
+					switchLinkBaudRate(m_streamBaudRate);
+					sendData(QByteArray("K"));
+
+					m_baudRateNegotiation = WaitingBaudRateConfirmed;
+					m_baudRateNegotiationTimer.start(baudRateNegotiationTimeoutMs);
+				} else {
+					qDebug() << "The hardware refused to use" << m_streamBaudRate << "baud";
+
+					m_baudRateNegotiation = NoNegotiation;
+					m_streamBaudRateFailed = true;
+					sendStartPacket();
+				}
+			}
+		} else if ((type == 'K') && (m_baudRateNegotiation == WaitingBaudRateConfirmed)) {
+			m_readOffset += 1;
+			m_baudRateNegotiationTimer.stop();
+
+			// Now we can start streaming at the new baud rate
+			m_baudRateNegotiation = NoNegotiation;
+			sendStartPacket();
+		} else if ((type == 'U') && (m_mode == UploadMode)) {
+			if (available < 4) {
+				partialPacket = true;
+			} else {
+				const bool accepted = (data[1] != 0);
+				const int capacity = (static_cast<unsigned char>(data[2]) << 8) | static_cast<unsigned char>(data[3]);
+				m_readOffset += 4;
+
+				if (accepted) {
+					// We can send the first point
+					m_credits = 1;
+					uploadWhileCredits();
+				} else {
+					const QString errorString = QString("Cannot upload the sequence, the hardware can store at most %1 points").arg(capacity);
+					emit streamError(errorString);
+					qDebug() << errorString;
+
+					// This also terminates the while cycle, because the m_incomingData buffer is cleared
+					sequenceStreamEnded();
+				}
+			}
+		} else if ((type == 'W') && (m_mode == UploadMode)) {
+			m_readOffset += 1;
+
+			qCDebug(serialProtocol) << "RECEIVED UPLOAD FINISHED";
+
+			// This also terminates the while cycle, because the m_incomingData buffer is cleared
+			sequenceStreamEnded();
+			emit uploadFinished();
+		} else if ((type == 'N') && ((m_mode == StreamMode) || (m_mode == UploadMode))) {
+			if (available < 2) {
+				partialPacket = true;
+			} else if (m_stopping) {
+				// Discarding this packet, we are stopping
+				m_readOffset += 2;
+			} else if (m_paused) {
+				// Keeping this packet for when we are resumed
+				deferPacket(2);
+			} else {
+				qCDebug(serialProtocol) << "RECEIVED CREDITS";
+
+				const int credits = static_cast<unsigned char>(data[1]);
+				m_readOffset += 2;
+
+				// Sending as many points as the hardware can accept
+				m_credits += credits;
+				if ((m_mode == UploadMode)) {
+					uploadWhileCredits();
+				} else {
+					streamWhileCredits();
+				}
+			}
+		} else if (type == 'E') {
+			if (m_paused) {
+				// Keeping this packet for when we are resumed
+				deferPacket(1);
+			} else {
+				qCDebug(serialProtocol) << "RECEIVED SEQUENCE ENDED";
+
+				// Calling the sequenceStreamEnded() function. This will also terminate the
+				// while cycle, because the m_incomingData buffer will be cleared
+				m_readOffset += 1;
+				sequenceStreamEnded();
+			}
+		} else if (type == 'D') {
+			// Debug packet, printing and emitting signal if the message is complete
+			if (available < 2) {
+				partialPacket = true;
+			} else {
+				// Reading message length
+				const int msgLength = static_cast<unsigned char>(data[1]);
+
+				// Checking we have the whole message
+				if (available < (2 + msgLength)) {
+					partialPacket = true;
+				} else {
+					// We have the whole message, putting in a QString
+					const QString msg = QString::fromUtf8(data + 2, msgLength);
+					m_readOffset += 2 + msgLength;
+
+					// Emitting signal and printing
+					emit debugMessage(msg);
+					qCDebug(serialProtocol) << "Debug packet, content:" << msg;
+				}
+			}
+		} else if (type == 'B') {
+			// Battery packet, checking that the packet is finished and updating the charge
+			if (available < 2) {
+				partialPacket = true;
+			} else {
+				// Reading charge level
+				const int chargeLevel = static_cast<unsigned char>(data[1]);
+				m_readOffset += 2;
+
+				// Setting the charge level
+				setBatteryCharge((float(chargeLevel) / 255.0) * 100.0);
+			}
+		} else if (type == 'O') {
+			// Task overruns packet, checking that the packet is finished and updating overruns
+			if (available < 2) {
+				partialPacket = true;
+			} else {
+				// Reading the number of tasks
+				const int numTasks = static_cast<unsigned char>(data[1]);
+
+				// Checking we have the whole packet
+				if (available < (2 + 2 * numTasks)) {
+					partialPacket = true;
+				} else {
+					QVariantList overruns;
+					for (int i = 0; i < numTasks; ++i) {
+						const int msb = static_cast<unsigned char>(data[2 + 2 * i]);
+						const int lsb = static_cast<unsigned char>(data[3 + 2 * i]);
+						overruns.append((msb << 8) | lsb);
+					}
+					m_readOffset += 2 + 2 * numTasks;
+
+					setTaskOverruns(overruns);
+				}
+			}
+		} else if (type == 'C') {
+			// Clock pong, processed in any state (also when paused) to measure the round trip
+			if (available < 6) {
+				partialPacket = true;
+			} else {
+				const unsigned char* const v = reinterpret_cast<const unsigned char*>(data);
+				const quint8 id = v[1];
+				const quint32 localTime = (quint32(v[2]) << 24) | (quint32(v[3]) << 16) | (quint32(v[4]) << 8) | quint32(v[5]);
+				m_readOffset += 6;
+
+				if (m_clockSyncEnabled && m_clockSync.pongReceived(id, localTime, currentTime())) {
+					// Sending the new estimate to the hardware
+					QByteArray pkt(13, 0);
+					const quint32 values[3] = {m_clockSync.referenceLocalTime(), m_clockSync.referenceTime(), quint32(m_clockSync.drift())};
+					pkt[0] = 'Z';
+					for (int i = 0; i < 3; ++i) {
+						pkt[1 + i * 4] = (values[i] >> 24) & 0xFF;
+						pkt[2 + i * 4] = (values[i] >> 16) & 0xFF;
+						pkt[3 + i * 4] = (values[i] >> 8) & 0xFF;
+						pkt[4 + i * 4] = values[i] & 0xFF;
+					}
+					sendPacket(pkt, false);
+
+					emit clockSyncChanged(true, m_clockSync.roundTrip(), m_clockSync.driftPpm());
+				}
+			}
+		} else if (type == 'L') {
+			// The answer to the set calibration packet, this can arrive in any state
+			if (available < 2) {
+				partialPacket = true;
+			} else {
+				const bool accepted = (data[1] != 0);
+				m_readOffset += 2;
+
+				if (!accepted) {
+					const QString errorString("The hardware refused the calibration");
+					emit streamError(errorString);
+					qDebug() << errorString;
+				}
+				emit calibrationSet(accepted);
+			}
+		} else if (type == 'T') {
+			// Telemetry packet, all values are most significant byte first
+			if (available < 17) {
+				partialPacket = true;
+			} else {
+				const unsigned char* const v = reinterpret_cast<const unsigned char*>(data);
+				HardwareTelemetry telemetry;
+				telemetry.loopsPerSecond = int((quint32(v[1]) << 24) | (quint32(v[2]) << 16) | (quint32(v[3]) << 8) | quint32(v[4]));
+				telemetry.maxStepTime = (v[5] << 8) | v[6];
+				telemetry.meanStepTime = (v[7] << 8) | v[8];
+				telemetry.bufferedPoints = v[9];
+				telemetry.underruns = (v[10] << 8) | v[11];
+				telemetry.receiveOverruns = (v[12] << 8) | v[13];
+				telemetry.droppedPoints = (v[14] << 8) | v[15];
+				telemetry.receiveBufferPeak = v[16];
+				m_readOffset += 17;
+
+				setTelemetry(telemetry);
+			}
+		} else {
+			// Skipping the unknown character
+			m_readOffset += 1;
+
+			if ((type == 'N') || (type == 'A') || (type == 'R') || (type == 'K') || (type == 'U') || (type == 'W') || (type == 'X')) {
+				qCDebug(serialProtocol) << "Received spurious N, A, R, K, U, W or X packet";
+			} else {
+				const QString errorString = QString("Received unknown or invalid packet type %1 (ascii %2)").arg(static_cast<unsigned int>(static_cast<unsigned char>(type))).arg(type);
+				emit streamError(errorString);
+				qDebug() << errorString;
+			}
+		}
+	}
+
+	// Removing consumed data, so that only a partial packet (if any) remains in the buffer
+	if (m_readOffset > 0) {
+		m_incomingData.remove(0, m_readOffset);
+		m_readOffset = 0;
+	}
+}
+
+void StreamEngine::deferPacket(int size)
+{
+	m_deferredPackets.append(m_incomingData.constData() + m_readOffset, size);
+	m_readOffset += size;
+}
+
+void StreamEngine::sequenceStreamEnded()
+{
+	// Notifying the final progress before the end of the modality
+	m_progressTimer.stop();
+	m_startTimer.stop();
+	m_startTime = -1;
+	notifyProgress();
+
+	// Resetting flags, the modality is the last, so that when it is notified everything
+	// is ready for a new one
+	setPaused(false);
+	m_credits = 0;
+	m_lastStreamedPoint = -1;
+	m_stopping = false;
+	endFraming();
+	m_snapshot = SequenceSnapshot();
+	m_playhead = -1;
+	m_hasImmediatePoint = false;
+	m_immediatePointPending = false;
+	m_immediateTimer.stop();
+
+	m_incomingData.clear();
+	m_readOffset = 0;
+	m_deferredPackets.clear();
+
+	// Going back to the normal baud rate (the hardware does the same after the sequence finished
+	// packet)
+	switchLinkBaudRate(m_baudRate);
+	notifyStatistics();
+
+	setMode(NoMode);
+}
+
+void StreamEngine::incrementPlayhead()
+{
+	if (m_playhead == (m_snapshot.numPoints() - 1)) {
+		// We are at the last point, checking what to do
+		if (m_oneShotSequence) {
+			// Stopping
+			stop();
+		} else {
+			// Restarting from the beginning
+			m_playhead = 0;
+			progressChanged();
+		}
+	} else {
+		++m_playhead;
+		progressChanged();
+	}
+}
+
+bool StreamEngine::streamPointAtPlayhead()
+{
+	const bool pointSent = (m_playhead != -1);
+	if (pointSent) {
+		sendPacket(createStreamPacket(m_playhead), true);
+		--m_credits;
+		++m_statistics.pointsSent;
+	}
+	incrementPlayhead();
+
+	return pointSent;
+}
+
+void StreamEngine::streamWhileCredits()
+{
+	// Stopping also if the stream ends (incrementPlayhead() could call stop())
+	// Points are held until the start time
+	if (m_startTimer.isActive()) {
+		return;
+	}
+
+	while ((m_credits > 0) && (m_mode == StreamMode) && !m_stopping) {
+		if (!streamPointAtPlayhead()) {
+			break;
+		}
+	}
+}
+
+void StreamEngine::uploadWhileCredits()
+{
+	while ((m_credits > 0) && (m_uploadedPoints < m_snapshot.numPoints())) {
+		sendData(createStreamPacket(m_uploadedPoints));
+		--m_credits;
+		++m_uploadedPoints;
+		++m_statistics.pointsSent;
+		progressChanged();
+	}
+}
+
+void StreamEngine::sendImmediatePoint()
+{
+	sendData(createSequencePacketForPoint(m_immediatePoint));
+
+	m_immediatePointPending = false;
+	m_immediateTimer.start(immediateSendIntervalMs);
+}
+
+void StreamEngine::progressChanged()
+{
+	if (!m_progressTimer.isActive()) {
+		m_progressTimer.start(progressNotificationIntervalMs);
+	}
+}
+
+void StreamEngine::sendData(const QByteArray& dataToSend)
+{
+	if (dataToSend.isEmpty()) {
+		return;
+	}
+
+	// Tracing. The hex conversion only happens if the category is enabled
+	m_frameCapture.captureSent(dataToSend);
+	qCDebug(serialData) << "TX" << dataToSend.toHex();
+
+	// Writing data
+	qint64 bytesWritten = m_serialPort.write(dataToSend);
+
+	if (bytesWritten == -1) {
+		qDebug() << "Error writing data";
+		return;
+	}
+
+	m_statistics.bytesSent += bytesWritten;
+	if (bytesWritten != dataToSend.size()) {
+		qDebug() << "Cannot write all data";
+	}
+}
+
+void StreamEngine::sendPacket(const QByteArray& packet, bool sequenced)
+{
+	if (!m_framing) {
+		sendData(packet);
+		return;
+	}
+
+	// Packets the hardware accepts in any order do not use sequence numbers
+	QByteArray frame;
+	frame.reserve(packet.size() + 3);
+	frame.append('F');
+	frame.append(char(sequenced ? m_nextSequence : 0));
+	frame.append(packet);
+	frame.append(char(crc8(frame.constData() + 1, frame.size() - 1)));
+	sendData(frame);
+
+	if (sequenced) {
+		++m_nextSequence;
+		m_unackedFrames.append(frame);
+		if (!m_retransmitTimer.isActive()) {
+			m_retransmitTimer.start(retransmitTimeoutMs);
+		}
+	}
+}
+
+void StreamEngine::ackReceived(quint8 expected, int freeSlots, int flags)
+{
+	// Forgetting the frames the hardware has. The ack can be older than the first frame we still
+	// have, if acks were repeated
+	const int acked = quint8(expected - m_firstUnackedSequence);
+	if ((acked != 0) && (acked <= m_unackedFrames.size())) {
+		m_unackedFrames.erase(m_unackedFrames.begin(), m_unackedFrames.begin() + acked);
+		m_firstUnackedSequence = expected;
+
+		if (m_unackedFrames.isEmpty()) {
+			m_retransmitTimer.stop();
+		} else {
+			m_retransmitTimer.start(retransmitTimeoutMs);
+		}
+	}
+
+	// The hardware accepts points up to expected + freeSlots. This never goes back, so the newest
+	// ack always gives the right number of credits
+	m_credits = qMax(0, int(qint8(quint8(expected + freeSlots - m_nextSequence))));
+
+	if (((flags & retransmitFlag) != 0) && (expected == m_firstUnackedSequence) && !m_unackedFrames.isEmpty()) {
+		retransmitFrames();
+	}
+
+	if (!m_paused && !m_stopping) {
+		streamWhileCredits();
+	}
+}
+
+void StreamEngine::retransmitFrames()
+{
+	qCDebug(serialProtocol) << "SENDING" << m_unackedFrames.size() << "FRAMES AGAIN";
+
+	// Go-back-N: the hardware discards frames after a missing one, so all of them are sent
+	for (const QByteArray& frame: m_unackedFrames) {
+		sendData(frame);
+	}
+	m_statistics.framesRetransmitted += m_unackedFrames.size();
+	m_retransmitTimer.start(retransmitTimeoutMs);
+}
+
+void StreamEngine::endFraming()
+{
+	m_framing = false;
+	m_nextSequence = 0;
+	m_firstUnackedSequence = 0;
+	m_unackedFrames.clear();
+	m_retransmitTimer.stop();
+}
+
+void StreamEngine::switchLinkBaudRate(int baudRate)
+{
+	if (!m_serialPort.isOpen() || (baudRate == m_linkBaudRate)) {
+		return;
+	}
+
+	m_serialPort.setBaudRate(baudRate);
+	setLinkBaudRate(baudRate);
+
+	// Discarding data received so far: we could have received it with the wrong baud rate
+	m_serialPort.clear(QSerialPort::Input);
+	m_incomingData.truncate(m_readOffset);
+}
+
+void StreamEngine::setMode(Mode mode)
+{
+	if (mode != m_mode) {
+		m_mode = mode;
+
+		emit modeChanged(m_mode);
+	}
+}
+
+void StreamEngine::setPaused(bool v)
+{
+	if (v != m_paused) {
+		m_paused = v;
+
+		emit pausedChanged(m_paused);
+	}
+}
+
+void StreamEngine::setBatteryCharge(float v)
+{
+	if (v < 0.0) {
+		v = -1.0;
+	}
+
+	if (v != m_batteryCharge) {
+		m_batteryCharge = v;
+
+		emit batteryChargeChanged(m_batteryCharge);
+	}
+}
+
+void StreamEngine::setTaskOverruns(const QVariantList& v)
+{
+	if (v != m_taskOverruns) {
+		m_taskOverruns = v;
+
+		emit taskOverrunsChanged(m_taskOverruns);
+	}
+}
+
+void StreamEngine::setTelemetry(const HardwareTelemetry& v)
+{
+	if (v != m_telemetry) {
+		m_telemetry = v;
+
+		emit telemetryChanged(m_telemetry);
+	}
+}
+
+void StreamEngine::setClockSync(bool enabled)
+{
+	if (enabled == m_clockSyncEnabled) {
+		return;
+	}
+
+	m_clockSyncEnabled = enabled;
+	if (m_clockSyncEnabled) {
+		m_clockSyncTimer.start(clockPingIntervalMs);
+	} else {
+		m_clockSyncTimer.stop();
+		resetClockSync();
+	}
+}
+
+void StreamEngine::resetClockSync()
+{
+	const bool wasSynced = m_clockSync.isSynced();
+
+	m_clockSync.reset();
+
+	if (wasSynced) {
+		emit clockSyncChanged(false, -1, 0.0);
+	}
+}
+
+void StreamEngine::appendStartTime(QByteArray& packet) const
+{
+	// The hardware only uses the lower 32 bits of the time
+	const quint32 t = quint32(m_startTime);
+	packet.append((t >> 24) & 0xFF);
+	packet.append((t >> 16) & 0xFF);
+	packet.append((t >> 8) & 0xFF);
+	packet.append(t & 0xFF);
+}
+
+void StreamEngine::notifyStatistics()
+{
+	m_statistics.credits = m_credits;
+
+	emit statisticsChanged(m_statistics);
+}
+
+void StreamEngine::setHardwareBufferSize(int v)
+{
+	if (v != m_hardwareBufferSize) {
+		m_hardwareBufferSize = v;
+
+		emit hardwareBufferSizeChanged(m_hardwareBufferSize);
+	}
+}
+
+void StreamEngine::setLinkBaudRate(int v)
+{
+	if (v != m_linkBaudRate) {
+		m_linkBaudRate = v;
+
+		emit linkBaudRateChanged(m_linkBaudRate);
+	}
+}
@@ -0,0 +1,1316 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef STREAMENGINE_H
+#define STREAMENGINE_H
+
+#include <QSerialPort>
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <QVariantList>
+#include "sequencepoint.h"
+#include "sequencesnapshot.h"
+#include "calibrationprofile.h"
+#include "hardwaretelemetry.h"
+#include "streamstatistics.h"
+#include "framecapture.h"
+#include "clocksync.h"
+
+/**
+ * \brief The class implementing the communication protocol with Arduino
+ *
+ * This object lives in the I/O thread created by SerialCommunication, which is
+ * the class to use from the rest of the program. All public slots must be
+ * called with queued (or blocking queued) connections and all signals reach
+ * the GUI thread through queued connections, so that answering the hardware
+ * never waits for the user interface. Sequences are not accessed directly: a
+ * snapshot of the points to stream or upload is passed when the modality is
+ * started. Progress (the playhead, i.e. the next point to stream, and the
+ * number of uploaded points) is notified at most once every 16 milliseconds,
+ * which is enough for the user interface.
+ *
+ * The communication protocol between this program and the Arduino board is the
+ * following. The packets the PC may send to the hardware are the following
+ * ones:
+ *	- sequence packet
+ *	- delta sequence packet
+ *	- start sequence
+ *	- start immediate mode
+ *	- stop
+ *	- change baud rate
+ *	- confirm baud rate
+ *	- upload sequence
+ *	- play stored sequence
+ *	- start sequence at time
+ *	- clock ping
+ *	- set clock
+ *	- set calibration
+ *	- frame
+ *
+ * The packes the hardware may send to the PC are the following ones:
+ *	- stream started
+ *	- baud rate changed
+ *	- baud rate confirmed
+ *	- upload started
+ *	- upload finished
+ *	- credits
+ *	- ack
+ *	- sequence finished
+ *	- debug packet
+ *	- battery charge packet
+ *	- task overruns packet
+ *	- telemetry packet
+ *	- clock pong
+ *	- calibration set
+ *
+ * The "start sequence" and "start immediate mode" packets tell the hardware in
+ * which modality it should work. The "start sequence" makes the hardware expect
+ * the sequence to be continuously sent and timing of each point of the sequence
+ * are respected. Flow control is credit based: the hardware answers with a
+ * "stream started" packet containing the number of points it can buffer, which
+ * is the initial number of credits of the PC. Every sequence packet sent by the
+ * PC consumes one credit and the PC never sends sequence packets when it has no
+ * credits. The hardware does not answer sequence packets; instead it sends a
+ * "credits" packet every time slots of its buffer are freed (this can happen at
+ * any time), with the number of new credits for the PC. This way the hardware
+ * internal buffer is kept full, to avoid delays in sequence timings, without
+ * waiting for a round trip for each point. In stream mode, after the first
+ * point the PC sends the "delta sequence packet" instead of the "sequence
+ * packet" whenever it is shorter: it only contains the positions that changed
+ * with respect to the previous point, the hardware keeps the other ones. A
+ * delta sequence packet also consumes one credit. To terminate sequence
+ * execution the PC sends a "stop" packet. The hardware then answers with a
+ * "sequence finished" packet as soon as the last point is reached and kept for
+ * its whose duration. The "start immediate mode" packet instructs the hardware
+ * to immediately process incoming sequence packets. This means that the
+ * "duration" property of sequence points is not respected and that a pose it
+ * kept until a new sequence point arrives. In this case the hardware does not
+ * send any packet back (there is no buffer). To termiante the immediate mode,
+ * the PC sends a "stop" packet. Packets sent before either "start sequence" or
+ * "start immediate mode" are discarded.
+ *
+ * In stream mode, after the "stream started" packet the hardware only accepts
+ * packets inside a "frame", which adds a sequence number and a CRC-8 (see
+ * crc8()) to a packet, and discards everything else. Frames the hardware
+ * cannot accept because they are corrupted or out of order are never used
+ * and, instead of credits packets, the hardware sends "ack" packets with the
+ * sequence number of the next frame it expects and how many points it can
+ * still buffer after it. The hardware repeats the ack periodically and sets
+ * its retransmit flag as soon as a frame is missing: in that case, or if no
+ * ack arrives in time, the PC sends again all frames not acknowledged yet.
+ * Sequence packets, delta sequence packets and the stop packet are numbered,
+ * the sequence number of the first one is 0. Clock pings and set clock
+ * packets are also sent in frames (with sequence number 0), but the hardware
+ * accepts them in any order. Credits packets are only used in upload mode.
+ *
+ * The link normally works at the baud rate set with
+ * SerialCommunication::setBaudRate(), but before sending the "start sequence"
+ * packet the PC can ask to use a faster one (see
+ * SerialCommunication::setStreamBaudRate()). The PC sends a "change baud rate"
+ * packet, the hardware answers with a "baud rate changed" packet using the old
+ * baud rate and, if it accepted the new rate, switches to it. Then the PC
+ * switches too and sends a "confirm baud rate" packet with the new rate, to
+ * which the hardware answers with a "baud rate confirmed" packet. If the
+ * hardware doesn't receive the confirmation within one second it goes back to
+ * the old baud rate (the PC does the same if it doesn't receive the answer).
+ * Both the hardware and the PC go back to the old baud rate when the "sequence
+ * finished" packet is sent. If the faster baud rate cannot be used or framing
+ * errors are detected while using it, the PC does not ask for it again until
+ * the serial port is reopened.
+ *
+ * The "upload sequence" packet asks the hardware to store a sequence with the
+ * given number of points. The hardware answers with an "upload started" packet
+ * telling whether the sequence fits in its memory and, if so, the PC has one
+ * credit. Points are sent as in stream mode ("sequence packet" or "delta
+ * sequence packet"), but the hardware gives one credit at a time, because
+ * storing points is slow. After the last point is stored the hardware sends the
+ * "upload finished" packet. A "stop" packet aborts the upload and leaves no
+ * valid sequence stored. The "play stored sequence" packet asks the hardware to
+ * play the stored sequence: the hardware sends no packet during playback and
+ * behaves as in stream mode when it receives a "stop" packet or when the
+ * sequence ends (it sends a "sequence finished" packet immediately if no
+ * sequence is stored).
+ *
+ * The "set calibration" packet sends the calibration of servos (see
+ * CalibrationProfile), which the hardware stores in its EEPROM and uses from
+ * then on, also after a reset. The hardware only accepts it when no modality
+ * is active and answers with a "calibration set" packet.
+ *
+ * The debug packet is used by the hardware for debugging purpouse. It contains
+ * a string of maximum length 255 bytes which is simply displayed (no other
+ * action is performed). The battery charge packet is used to communicate the
+ * current charge of batteries. It could be sent at any time. The task overruns
+ * packet is sent periodically and contains, for each task of the scheduler on
+ * the hardware, how many times the task missed its deadline (the counters are
+ * never reset, so a lost packet is not a problem). Tasks are, in order: servo
+ * update, serial communication, battery charge, task overruns, telemetry and
+ * face animation.
+ *
+ * If clock synchronization is enabled (see setClockSync()), the PC
+ * periodically sends "clock ping" packets, which the hardware answers in any
+ * state with a "clock pong" packet containing its local time. From these the
+ * PC estimates the offset and the drift of the clock of the hardware (see
+ * ClockSync) and sends a "set clock" packet after every few pings: the
+ * hardware then plays sequences using a clock that follows the one of the PC.
+ * When the clock is synchronized, a stream started with a start time uses the
+ * "start sequence at time" packet instead of "start sequence": points are sent
+ * as usual, but the hardware only starts playing them at the given time. The
+ * same happens for the "play stored sequence" packet with a start time. This
+ * way more hardware connected to the same PC start together and, since each
+ * point starts when the previous one ends on the synchronized clock, they stay
+ * aligned. Without synchronization the PC waits for the start time before
+ * sending the first point (or the "play stored sequence" packet).
+ *
+ * Here is the detailed description of every packet in the protocol.
+ *
+ * "sequence packet"
+ * the character 'P' (1 byte) - step duration (2 bytes, milliseconds, most
+ * significant byte first) - step time to target (2 bytes, milliseconds, most
+ * significant byte first) - positions (numElements bytes, one byte per point
+ * dimension)
+ *
+ * "delta sequence packet" (flags bit 0 set means duration is 1 byte, bit 1 set
+ * means time to target is 1 byte, bit 2 set means the slopes of the easing
+ * profile are present, otherwise the motion is linear; bit i of mask is set if
+ * position i changed, mask only supports points with up to 16 elements)
+ * the character 'Q' (1 byte) - flags (1 byte) - start slope and end slope (1
+ * byte each, Q6 fixed point, only if flags bit 2 is set) - step duration (1 or
+ * 2 bytes, milliseconds, most significant byte first) - step time to target (1
+ * or 2 bytes, milliseconds, most significant byte first) - mask (2 bytes, most
+ * significant byte first) - changed positions (one byte for each bit set in
+ * mask, in increasing position order)
+ *
+ * "start sequence" (numElements is the dimension of each point of the sequence)
+ * the character 'S' (1 byte) - numElements (1 byte)
+ *
+ * "start immediate mode" (numElements is the dimension of each point of the
+ * sequence)
+ * the character 'I' (1 byte) - numElements (1 byte)
+ *
+ * "stop"
+ * the character 'H' (1 byte)
+ *
+ * "change baud rate"
+ * the character 'R' (1 byte) - baud rate (4 bytes, most significant byte first)
+ *
+ * "confirm baud rate"
+ * the character 'K' (1 byte)
+ *
+ * "upload sequence" (numElements is the dimension of each point of the
+ * sequence)
+ * the character 'U' (1 byte) - numElements (1 byte) - number of points (2
+ * bytes, most significant byte first)
+ *
+ * "play stored sequence" (flags bit 0 set means the sequence is played
+ * continuously, bit 1 set means the start time follows)
+ * the character 'Y' (1 byte) - flags (1 byte) - start time (0 or 4 bytes,
+ * milliseconds of the synchronized clock, most significant byte first)
+ *
+ * "start sequence at time" (numElements is the dimension of each point of the
+ * sequence)
+ * the character 'G' (1 byte) - numElements (1 byte) - start time (4 bytes,
+ * milliseconds of the synchronized clock, most significant byte first)
+ *
+ * "clock ping" (id is repeated in the answer)
+ * the character 'C' (1 byte) - id (1 byte)
+ *
+ * "set clock" (the clock of the hardware had the given time at the given local
+ * time and advances by 1 + drift / 2^24 milliseconds per local millisecond)
+ * the character 'Z' (1 byte) - local time (4 bytes) - time (4 bytes) - drift
+ * (4 bytes, signed). All values are most significant byte first
+ *
+ * "set calibration" (numElements is the number of servos, which must be the
+ * one of the hardware, PWM values are most significant byte first)
+ * the character 'L' (1 byte) - numElements (1 byte) - minimum PWM, maximum PWM
+ * and rest PWM of each servo (2 bytes each)
+ *
+ * "frame" (the CRC is computed on the sequence number and the packet)
+ * the character 'F' (1 byte) - sequence number (1 byte) - packet (any packet
+ * above) - CRC (1 byte)
+ *
+ * "stream started" (freeSlots is the number of points the hardware can buffer)
+ * the character 'A' (1 byte) - freeSlots (1 byte)
+ *
+ * "baud rate changed" (accepted is 1 if the new baud rate is used, 0 otherwise)
+ * the character 'R' (1 byte) - accepted (1 byte)
+ *
+ * "baud rate confirmed"
+ * the character 'K' (1 byte)
+ *
+ * "upload started" (accepted is 1 if the sequence will be stored, capacity is
+ * the maximum number of points that can be stored)
+ * the character 'U' (1 byte) - accepted (1 byte) - capacity (2 bytes, most
+ * significant byte first)
+ *
+ * "upload finished"
+ * the character 'W' (1 byte)
+ *
+ * "credits" (credits is the number of further points the PC can send)
+ * the character 'N' (1 byte) - credits (1 byte)
+ *
+ * "ack" (expected is the sequence number of the next frame the hardware
+ * accepts, freeSlots is the number of points it can buffer after that one,
+ * flags bit 0 set means frames must be sent again, the CRC is computed on the
+ * other bytes after the character)
+ * the character 'X' (1 byte) - expected (1 byte) - freeSlots (1 byte) - flags
+ * (1 byte) - CRC (1 byte)
+ *
+ * "sequence finished"
+ * the characted 'E' (1 byte)
+ *
+ * "debug packet"
+ * the character 'D' (1 byte) - length of message (1 byte) - message (length of
+ * message elements)
+ *
+ * "battery charge packet" (battery charge is 0 to indicate depleted battery,
+ * 255 for fully charged batteries)
+ * the character 'B' (1 byte) - battery charge (1 byte)
+ *
+ * "task overruns packet"
+ * the character 'O' (1 byte) - number of tasks (1 byte) - overruns of each task
+ * (2 bytes per task, most significant byte first)
+ *
+ * "telemetry packet" (see HardwareTelemetry, all values are most significant
+ * byte first)
+ * the character 'T' (1 byte) - loop iterations per second (4 bytes) - maximum
+ * step time in microseconds (2 bytes) - mean step time in microseconds (2
+ * bytes) - buffered points (1 byte) - underruns (2 bytes) - receive overruns (2
+ * bytes) - dropped points (2 bytes) - peak of the receive buffer in bytes (1
+ * byte)
+ *
+ * "clock pong" (id is the one of the ping, local time is the value of millis()
+ * when the ping was processed)
+ * the character 'C' (1 byte) - id (1 byte) - local time (4 bytes, most
+ * significant byte first)
+ *
+ * "calibration set" (accepted is 1 if the calibration has been stored and is
+ * in use, 0 otherwise)
+ * the character 'L' (1 byte) - accepted (1 byte)
+ */
+class StreamEngine : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * \brief The possible modalities
+	 */
+	enum Mode {
+		NoMode,
+		StreamMode,
+		ImmediateMode,
+		UploadMode,
+		StoredPlaybackMode
+	};
+
+	/**
+	 * \brief Constructor
+	 *
+	 * \param parent the parent object
+	 */
+	explicit StreamEngine(QObject* parent = nullptr);
+
+	/**
+	 * \brief Destructor
+	 */
+	virtual ~StreamEngine();
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	StreamEngine(const StreamEngine& other) = delete;
+
+	/**
+	 * \brief Move constructor is deleted
+	 *
+	 * \param other the object to move into this
+	 */
+	StreamEngine(StreamEngine&& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	StreamEngine& operator=(const StreamEngine& other) = delete;
+
+	/**
+	 * \brief Move operator is deleted
+	 */
+	StreamEngine& operator=(StreamEngine&& other) = delete;
+
+	/**
+	 * \brief Returns the current time of the clock used for start times
+	 *
+	 * This is a monotonic clock shared by all threads of the program
+	 * \return the current time in milliseconds
+	 */
+	static qint64 currentTime();
+
+public slots:
+	/**
+	 * \brief Opens the serial port
+	 *
+	 * If a port was already opened, closes it before opening the new one.
+	 * \param portName the name of the serial port to open
+	 * \param baudRate the baud rate of the serial port
+	 * \return false in case of error, true if the port was opened
+	 *         successfully
+	 */
+	bool openSerial(QString portName, int baudRate);
+
+	/**
+	 * \brief Closes the serial port
+	 *
+	 * This cannot be called if a stream is being sent (call stop(),
+	 * before). If the stream is already closed, this does nothing
+	 * \return false in case of error
+	 */
+	bool closeSerial();
+
+	/**
+	 * \brief Starts writing all data sent and received to a file
+	 *
+	 * \param filename the name of the file to write
+	 * \return false in case of error
+	 */
+	bool startCapture(QString filename);
+
+	/**
+	 * \brief Stops writing data to the capture file
+	 */
+	void stopCapture();
+
+	/**
+	 * \brief Sets whether the sequence is played once or continuously
+	 *
+	 * This can be changed while streaming
+	 * \param oneShot whether the sequence is played once or continuously
+	 */
+	void setOneShotSequence(bool oneShot);
+
+	/**
+	 * \brief Sets whether snapshots are compiled before being streamed
+	 *
+	 * See TrajectoryCompiler. This only affects streams started later
+	 * \param compile whether snapshots are compiled
+	 * \param tolerance the maximum distance of dropped points from the
+	 *                  compiled trajectory
+	 * \param easing whether compiled segments get easing profiles
+	 */
+	void setTrajectoryCompilation(bool compile, double tolerance, bool easing);
+
+	/**
+	 * \brief Starts streaming points
+	 *
+	 * If compilation is enabled (see setTrajectoryCompilation()), the
+	 * snapshot is compiled in the thread of the engine after this function
+	 * returns, so that callers waiting for the result are not blocked by
+	 * the compilation of large sequences. The stream starts when the
+	 * compilation ends, calls made in the meantime are executed after that
+	 * \param snapshot the points to stream. Points with an easing profile
+	 *                 are always sent with delta sequence packets
+	 * \param startPoint the index of the first point to stream, as a
+	 *                   source point of the snapshot
+	 * \param streamBaudRate the baud rate to ask the hardware to use. If
+	 *                       this is not greater than the baud rate of the
+	 *                       port, no negotiation is performed
+	 * \param startTime the time (see currentTime()) when the first point
+	 *                  is played. The start packet and the baud rate
+	 *                  negotiation happen immediately, so that streams
+	 *                  started on different ports with the same start time
+	 *                  begin together. If the clock of the hardware is
+	 *                  synchronized, points are sent immediately and the
+	 *                  hardware waits for the start time, otherwise points
+	 *                  are only sent at the start time. If this is -1 or in
+	 *                  the past, points are played as soon as possible
+	 * \return false in case of error
+	 */
+	bool startStream(SequenceSnapshot snapshot, int startPoint, int streamBaudRate, qint64 startTime = -1);
+
+	/**
+	 * \brief Pauses streaming data
+	 *
+	 * \return false in case of error
+	 */
+	bool pauseStream();
+
+	/**
+	 * \brief Resumes a paused stream
+	 *
+	 * \return false in case of error
+	 */
+	bool resumeStream();
+
+	/**
+	 * \brief Starts the immediate modality
+	 *
+	 * \param pointDim the dimension of each point
+	 * \return false in case of error
+	 */
+	bool startImmediate(int pointDim);
+
+	/**
+	 * \brief Sets the point to send in immediate mode
+	 *
+	 * The point is sent as soon as possible, but points are not sent more
+	 * often than the hardware updates servos: if a point arrives too early
+	 * it is sent when the interval expires, unless a newer one replaces it
+	 * in the meantime. If not in immediate mode this
+	 * does nothing
+	 * \param point the point
+	 */
+	void setImmediatePoint(SequencePoint point);
+
+	/**
+	 * \brief Starts storing points in the memory of the hardware
+	 *
+	 * \param snapshot the points to upload
+	 * \return false in case of error
+	 */
+	bool uploadSequence(SequenceSnapshot snapshot);
+
+	/**
+	 * \brief Starts playing the sequence stored in the memory of the
+	 *        hardware
+	 *
+	 * \param startTime the time (see currentTime()) when the sequence
+	 *                  starts, -1 to start immediately. See the description
+	 *                  of startStream()
+	 * \return false in case of error
+	 */
+	bool playStored(qint64 startTime = -1);
+
+	/**
+	 * \brief Sends the calibration of servos to the hardware
+	 *
+	 * The answer is notified with calibrationSet(). If the hardware is still
+	 * booting, the calibration is sent when it is ready
+	 * \param profile the calibration to send. It must have one channel for
+	 *                each servo of the hardware (16)
+	 * \return false in case of error
+	 */
+	bool sendCalibration(CalibrationProfile profile);
+
+	/**
+	 * \brief Enables or disables the synchronization of the clock of the
+	 *        hardware
+	 *
+	 * When disabled, the hardware keeps the last clock correction it
+	 * received and start times are handled by the PC
+	 * \param enabled whether the clock is synchronized
+	 */
+	void setClockSync(bool enabled);
+
+	/**
+	 * \brief Stops the current modality
+	 *
+	 * \return false in case of error
+	 */
+	bool stop();
+
+signals:
+	/**
+	 * \brief The signal emitted when the serial port is opened/closed
+	 *
+	 * \param connected true if the serial port is open
+	 */
+	void connectedChanged(bool connected);
+
+	/**
+	 * \brief The signal emitted when a capture is started or stopped
+	 *
+	 * \param capturing true if data is being written to a capture file
+	 */
+	void capturingChanged(bool capturing);
+
+	/**
+	 * \brief The signal emitted when the modality changes
+	 *
+	 * \param mode the new modality (one of the values of Mode)
+	 */
+	void modeChanged(int mode);
+
+	/**
+	 * \brief The signal emitted when streaming is paused/resumed
+	 *
+	 * \param paused true if streaming is paused
+	 */
+	void pausedChanged(bool paused);
+
+	/**
+	 * \brief The signal emitted when the next point to stream changes
+	 *
+	 * This is emitted at most once every 16 milliseconds and when the
+	 * stream starts or ends
+	 * \param playhead the index of the next point to stream, as a source
+	 *                 point of the snapshot (see SequenceSnapshot)
+	 */
+	void playheadChanged(int playhead);
+
+	/**
+	 * \brief The signal emitted when the number of uploaded points changes
+	 *
+	 * This is emitted at most once every 16 milliseconds and when the
+	 * upload ends
+	 * \param uploadedPoints the number of points sent so far
+	 */
+	void uploadedPointsChanged(int uploadedPoints);
+
+	/**
+	 * \brief The signal emitted when the whole sequence has been stored by
+	 *        the hardware
+	 */
+	void uploadFinished();
+
+	/**
+	 * \brief The signal emitted when the hardware answers to the
+	 *        calibration sent with sendCalibration()
+	 *
+	 * \param accepted true if the hardware stored the calibration
+	 */
+	void calibrationSet(bool accepted);
+
+	/**
+	 * \brief The signal emitted if there is an error writing or reading
+	 *        from the serial port
+	 *
+	 * \param error a description of the error
+	 */
+	void streamError(QString error);
+
+	/**
+	 * \brief The signal emitted when we receive a debug message from the
+	 *        hardware
+	 *
+	 * \param msg the message the hardware sent
+	 */
+	void debugMessage(QString msg);
+
+	/**
+	 * \brief The signal emitted when the battery charge changes
+	 *
+	 * \param charge the battery charge in percentage, -1 if unknown
+	 */
+	void batteryChargeChanged(float charge);
+
+	/**
+	 * \brief The signal emitted when the task overruns change
+	 *
+	 * \param overruns the overruns of each task of the hardware
+	 */
+	void taskOverrunsChanged(QVariantList overruns);
+
+	/**
+	 * \brief The signal emitted when a telemetry packet is received
+	 *
+	 * \param telemetry the received telemetry
+	 */
+	void telemetryChanged(HardwareTelemetry telemetry);
+
+	/**
+	 * \brief The signal emitted when the hardware buffer size changes
+	 *
+	 * \param size the number of points the hardware can buffer, -1 if
+	 *             unknown
+	 */
+	void hardwareBufferSizeChanged(int size);
+
+	/**
+	 * \brief The signal emitted when the baud rate used on the serial port
+	 *        changes
+	 *
+	 * \param baudRate the baud rate used on the serial port, -1 if the
+	 *                 port is closed
+	 */
+	void linkBaudRateChanged(int baudRate);
+
+	/**
+	 * \brief The signal emitted when the flow control state or the amount
+	 *        of exchanged data changes
+	 *
+	 * This is emitted together with progress notifications, so at most
+	 * once every 16 milliseconds while streaming
+	 * \param statistics the new statistics
+	 */
+	void statisticsChanged(StreamStatistics statistics);
+
+	/**
+	 * \brief The signal emitted when the estimate of the clock of the
+	 *        hardware changes
+	 *
+	 * \param synced true if the clock of the hardware is synchronized
+	 * \param roundTrip the round trip time of the last kept ping in
+	 *                  milliseconds, -1 if not synchronized
+	 * \param driftPpm the correction of the rate of the clock of the
+	 *                 hardware in parts per million
+	 */
+	void clockSyncChanged(bool synced, int roundTrip, double driftPpm);
+
+private slots:
+	/**
+	 * \brief The slot called when there is data ready to be read
+	 */
+	void handleReadyRead();
+
+	/**
+	 * \brief The function called when there is an error in the serial
+	 *        communication
+	 *
+	 * \param error the error code
+	 */
+	void handleError(QSerialPort::SerialPortError error);
+
+	/**
+	 * \brief The slot called a second after the serial port is opened to
+	 *        start sending data
+	 *
+	 * This is needed to give Arduino time to boot. This function is also
+	 * called if a modality is started after arduino has booted. Basically
+	 * this function automatically sends data if called from the timer and
+	 * streaming has already been requested. If called from the timer but
+	 * streaming hasn't been requested yet, it does nothing.
+	 */
+	void arduinoBootFinished();
+
+	/**
+	 * \brief The slot called when the hardware did not answer in time
+	 *        during baud rate negotiation
+	 *
+	 * This gives up using the stream baud rate and starts the stream with
+	 * the normal one
+	 */
+	void baudRateNegotiationTimeout();
+
+	/**
+	 * \brief The slot called when the start time of the stream is reached
+	 *
+	 * This sends the points for which we already have credits
+	 */
+	void startTimeReached();
+
+	/**
+	 * \brief The slot called periodically to send clock pings
+	 */
+	void sendClockPing();
+
+	/**
+	 * \brief The slot called after startStream() returns to compile the
+	 *        snapshot and start the stream
+	 */
+	void compileAndBeginStream();
+
+	/**
+	 * \brief The slot called when progress has to be notified
+	 */
+	void notifyProgress();
+
+	/**
+	 * \brief The slot called when the minimum interval between two points
+	 *        in immediate mode expires
+	 *
+	 * This sends the last point set if it has not been sent yet
+	 */
+	void immediateIntervalExpired();
+
+	/**
+	 * \brief The slot called when frames were not acknowledged in time
+	 *
+	 * This sends all of them again
+	 */
+	void retransmitTimeout();
+
+private:
+	/**
+	 * \brief The type of the functions writing the shortest packet for a
+	 *        point of a stream
+	 *
+	 * There is one function for each dimension of points, see PointCodec.
+	 * The parameters are the record of the point (see SequenceSnapshot),
+	 * the record of the previous point sent (nullptr if there is none), the
+	 * slopes of the easing profile and the buffer for the packet, which
+	 * must have room for maxPacketSize bytes. The size of the packet is
+	 * returned
+	 */
+	typedef int (*StreamPacketEncoder)(const char*, const char*, int, int, char*);
+
+	/**
+	 * \brief Sets the dimension of points for a new modality
+	 *
+	 * \param pointDim the dimension of points
+	 * \return false if points of this dimension cannot be sent
+	 */
+	bool setPointDim(int pointDim);
+
+	/**
+	 * \brief Returns true if we are in any modality
+	 *
+	 * \return true if we are in any modality
+	 */
+	bool isStreaming() const
+	{
+		return m_mode != NoMode;
+	}
+
+	/**
+	 * \brief Checks that we can start a new modality
+	 *
+	 * \param what a description of the modality, used in error messages
+	 * \return false if a new modality cannot be started
+	 */
+	bool canStart(const char* what) const;
+
+	/**
+	 * \brief Resets the state of the communication and sets the modality
+	 *
+	 * \param mode the new modality
+	 */
+	void beginMode(Mode mode);
+
+	/**
+	 * \brief Starts the stream of m_snapshot from m_streamStartPoint
+	 */
+	void beginStream();
+
+	/**
+	 * \brief Returns a sequence packet for the given point
+	 *
+	 * This function doesn't check that p has the length that was used in
+	 * the start immediate package, ensure this externally
+	 * \param p the point for which to create a packet
+	 * \return the packet for the point
+	 */
+	QByteArray createSequencePacketForPoint(const SequencePoint& p) const;
+
+	/**
+	 * \brief Returns a sequence packet for the given record
+	 *
+	 * \param record the record of the point (see SequenceSnapshot) with
+	 *               m_pointDim positions
+	 * \return the packet for the point
+	 */
+	QByteArray createSequencePacketForRecord(const char* record) const;
+
+	/**
+	 * \brief Returns the shortest packet for the given point of the
+	 *        snapshot in stream or upload mode
+	 *
+	 * This chooses between a sequence packet and a delta sequence packet
+	 * (the only one that can carry the easing profile) and remembers the
+	 * point as the last one streamed
+	 * \param pos the position of the point in the snapshot
+	 * \return the packet to send for the point
+	 */
+	QByteArray createStreamPacket(int pos);
+
+	/**
+	 * \brief Sends the start packet for the current modality
+	 *
+	 * In immediate mode this also sends the current point
+	 */
+	void sendStartPacket();
+
+	/**
+	 * \brief Switches the serial port to the given baud rate
+	 *
+	 * Data not yet processed is discarded, because it could have been
+	 * received with the wrong baud rate
+	 * \param baudRate the new baud rate
+	 */
+	void switchLinkBaudRate(int baudRate);
+
+	/**
+	 * \brief Processes received packets
+	 *
+	 * All complete packets in m_incomingData are processed in a single
+	 * pass, then consumed data is removed from the buffer at once
+	 */
+	void processReceivedPackets();
+
+	/**
+	 * \brief Moves the packet at m_readOffset to the queue of packets to
+	 *        process when the stream is resumed
+	 *
+	 * \param size the size of the packet
+	 */
+	void deferPacket(int size);
+
+	/**
+	 * \brief The function to call when the modality ends
+	 *
+	 * This is called when either immediate mode stops or the "sequence
+	 * finished" packet is received
+	 */
+	void sequenceStreamEnded();
+
+	/**
+	 * \brief Moves the playhead forward
+	 *
+	 * This function moves the playhead forward by one. If we reach the
+	 * end of the sequence in stream mode, terminates the streaming.
+	 */
+	void incrementPlayhead();
+
+	/**
+	 * \brief Sends the point at the playhead in stream mode and moves the
+	 *        playhead forward
+	 *
+	 * This also consumes one credit
+	 * \return false if there was no point to send
+	 */
+	bool streamPointAtPlayhead();
+
+	/**
+	 * \brief Sends points in stream mode until we have no more credits
+	 */
+	void streamWhileCredits();
+
+	/**
+	 * \brief Sends points in upload mode until we have no more credits or
+	 *        all points have been sent
+	 */
+	void uploadWhileCredits();
+
+	/**
+	 * \brief Schedules the notification of progress
+	 */
+	void progressChanged();
+
+	/**
+	 * \brief Sends the point in immediate mode and starts the interval
+	 *        before the next one can be sent
+	 */
+	void sendImmediatePoint();
+
+	/**
+	 * \brief The function that actually sends data
+	 *
+	 * \param dataToSend the data to send through the serial port
+	 */
+	void sendData(const QByteArray& dataToSend);
+
+	/**
+	 * \brief Sends a packet, in a frame if the hardware expects frames
+	 *
+	 * Frames with a sequence number are kept until the hardware
+	 * acknowledges them
+	 * \param packet the packet to send
+	 * \param sequenced true if the hardware must receive the packet in
+	 *                  order (points and the stop packet)
+	 */
+	void sendPacket(const QByteArray& packet, bool sequenced);
+
+	/**
+	 * \brief Processes the content of an ack packet
+	 *
+	 * \param expected the sequence number of the next frame the hardware
+	 *                 accepts
+	 * \param freeSlots the number of points the hardware can buffer after
+	 *                  that frame
+	 * \param flags the flags of the packet
+	 */
+	void ackReceived(quint8 expected, int freeSlots, int flags);
+
+	/**
+	 * \brief Sends again all frames not acknowledged yet
+	 */
+	void retransmitFrames();
+
+	/**
+	 * \brief Stops sending frames and forgets the ones not acknowledged
+	 */
+	void endFraming();
+
+	/**
+	 * \brief Changes the modality and emits the changed signal if needed
+	 *
+	 * \param mode the new modality
+	 */
+	void setMode(Mode mode);
+
+	/**
+	 * \brief Changes the value of the pause flag and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new value of the flag
+	 */
+	void setPaused(bool v);
+
+	/**
+	 * \brief Changes the value of the battery charge and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new value of the battery charge (if negative, -1.0 is
+	 *          used)
+	 */
+	void setBatteryCharge(float v);
+
+	/**
+	 * \brief Changes the value of the task overruns and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new list of task overruns
+	 */
+	void setTaskOverruns(const QVariantList& v);
+
+	/**
+	 * \brief Changes the telemetry and emits the changed signal if needed
+	 *
+	 * \param v the new telemetry
+	 */
+	void setTelemetry(const HardwareTelemetry& v);
+
+	/**
+	 * \brief Updates the credits in the statistics and emits the changed
+	 *        signal
+	 */
+	void notifyStatistics();
+
+	/**
+	 * \brief Forgets the estimate of the clock of the hardware
+	 *
+	 * This is called when the hardware could have been restarted
+	 */
+	void resetClockSync();
+
+	/**
+	 * \brief Appends the start time to a start packet
+	 *
+	 * \param packet the packet to which the start time is appended
+	 */
+	void appendStartTime(QByteArray& packet) const;
+
+	/**
+	 * \brief Returns true if the hardware waits for the start time by
+	 *        itself
+	 *
+	 * \return true if there is a start time and the clock is synchronized
+	 */
+	bool hardwareWaitsStartTime() const
+	{
+		return (m_startTime != -1) && m_clockSync.isSynced();
+	}
+
+	/**
+	 * \brief Changes the value of the hardware buffer size and emits the
+	 *        changed signal if needed
+	 *
+	 * \param v the new hardware buffer size
+	 */
+	void setHardwareBufferSize(int v);
+
+	/**
+	 * \brief Changes the value of the link baud rate and emits the changed
+	 *        signal if needed
+	 *
+	 * \param v the new link baud rate
+	 */
+	void setLinkBaudRate(int v);
+
+	/**
+	 * \brief The serial communication port
+	 *
+	 * This is a child of this object, so that it is moved to the I/O
+	 * thread together with us
+	 */
+	QSerialPort m_serialPort;
+
+	/**
+	 * \brief The baud rate of the serial port
+	 */
+	int m_baudRate;
+
+	/**
+	 * \brief The baud rate to ask the hardware to use when streaming
+	 */
+	int m_streamBaudRate;
+
+	/**
+	 * \brief The baud rate currently used on the serial port
+	 */
+	int m_linkBaudRate;
+
+	/**
+	 * \brief True if the stream baud rate didn't work
+	 *
+	 * This is reset when the serial port is opened
+	 */
+	bool m_streamBaudRateFailed;
+
+	/**
+	 * \brief The possible steps of baud rate negotiation
+	 */
+	enum BaudRateNegotiation {
+		NoNegotiation,
+		WaitingBaudRateChanged,
+		WaitingBaudRateConfirmed
+	};
+
+	/**
+	 * \brief The current step of baud rate negotiation
+	 */
+	BaudRateNegotiation m_baudRateNegotiation;
+
+	/**
+	 * \brief The timer to wait for the answers of the hardware during baud
+	 *        rate negotiation
+	 */
+	QTimer m_baudRateNegotiationTimer;
+
+	/**
+	 * \brief Whether the sequence is played only once or continuously
+	 *
+	 * If true the sequence is played only once, if false continuously
+	 */
+	bool m_oneShotSequence;
+
+	/**
+	 * \brief Whether snapshots are compiled before being streamed
+	 */
+	bool m_compileTrajectory;
+
+	/**
+	 * \brief The tolerance of the compilation of snapshots
+	 */
+	double m_trajectoryTolerance;
+
+	/**
+	 * \brief Whether compiled segments get easing profiles
+	 */
+	bool m_trajectoryEasing;
+
+	/**
+	 * \brief The first point to stream, as a source point of the snapshot
+	 *
+	 * This is only used until the stream begins, then m_playhead is used
+	 */
+	int m_streamStartPoint;
+
+	/**
+	 * \brief The current modality
+	 */
+	Mode m_mode;
+
+	/**
+	 * \brief The points to stream or upload
+	 *
+	 * This is a snapshot of the sequence taken when the modality is started
+	 */
+	SequenceSnapshot m_snapshot;
+
+	/**
+	 * \brief The dimension of each point
+	 */
+	int m_pointDim;
+
+	/**
+	 * \brief The function writing packets of points of m_pointDim
+	 *        dimensions
+	 */
+	StreamPacketEncoder m_streamPacketEncoder;
+
+	/**
+	 * \brief The index of the next point to stream, -1 if there are no
+	 *        points
+	 */
+	int m_playhead;
+
+	/**
+	 * \brief The point to send in immediate mode
+	 */
+	SequencePoint m_immediatePoint;
+
+	/**
+	 * \brief True if m_immediatePoint is valid
+	 */
+	bool m_hasImmediatePoint;
+
+	/**
+	 * \brief True if m_immediatePoint has not been sent yet because it
+	 *        arrived before the end of the interval between points
+	 */
+	bool m_immediatePointPending;
+
+	/**
+	 * \brief The timer used to limit the rate of points in immediate mode
+	 */
+	QTimer m_immediateTimer;
+
+	/**
+	 * \brief The number of points sent during the current upload
+	 */
+	int m_uploadedPoints;
+
+	/**
+	 * \brief The timer used to limit the rate of progress notifications
+	 */
+	QTimer m_progressTimer;
+
+	/**
+	 * \brief The time when the current modality starts playing, -1 if
+	 *        it starts as soon as possible
+	 */
+	qint64 m_startTime;
+
+	/**
+	 * \brief The timer to wait for the start time of the stream
+	 *
+	 * Points (or the "play stored sequence" packet) are not sent while this
+	 * is active. This is only used if the clock of the hardware is not
+	 * synchronized
+	 */
+	QTimer m_startTimer;
+
+	/**
+	 * \brief Whether the clock of the hardware is synchronized
+	 */
+	bool m_clockSyncEnabled;
+
+	/**
+	 * \brief The estimate of the clock of the hardware
+	 */
+	ClockSync m_clockSync;
+
+	/**
+	 * \brief The timer to send clock pings
+	 */
+	QTimer m_clockSyncTimer;
+
+	/**
+	 * \brief The timer to wait for Arduino boot to finish
+	 *
+	 * See arduinoBootFinished() description
+	 */
+	QTimer m_arduinoBoot;
+
+	/**
+	 * \brief The "set calibration" packet to send when the hardware has
+	 *        booted, empty if there is none
+	 */
+	QByteArray m_pendingCalibration;
+
+	/**
+	 * \brief The object writing raw data to the capture file
+	 */
+	FrameCapture m_frameCapture;
+
+	/**
+	 * \brief The buffer of data from the serial port
+	 */
+	QByteArray m_incomingData;
+
+	/**
+	 * \brief The offset in m_incomingData of the first byte not yet
+	 *        processed
+	 */
+	int m_readOffset;
+
+	/**
+	 * \brief The packets received while paused which must be processed
+	 *        when the stream is resumed
+	 *
+	 * These are complete packets, stored as received
+	 */
+	QByteArray m_deferredPackets;
+
+	/**
+	 * \brief If true streaming is paused in stream mode
+	 */
+	bool m_paused;
+
+	/**
+	 * \brief How many sequence packets we can send before the queue of the
+	 *        hardware is full
+	 */
+	int m_credits;
+
+	/**
+	 * \brief True if the hardware only accepts packets in frames
+	 */
+	bool m_framing;
+
+	/**
+	 * \brief The sequence number of the next frame with a sequence number
+	 */
+	quint8 m_nextSequence;
+
+	/**
+	 * \brief The sequence number of the first frame in m_unackedFrames
+	 */
+	quint8 m_firstUnackedSequence;
+
+	/**
+	 * \brief The frames sent but not acknowledged yet, in order
+	 */
+	QList<QByteArray> m_unackedFrames;
+
+	/**
+	 * \brief The timer to send frames again if the hardware does not
+	 *        acknowledge them
+	 */
+	QTimer m_retransmitTimer;
+
+	/**
+	 * \brief The position in the snapshot of the last point sent in stream
+	 *        or upload mode
+	 *
+	 * This is -1 if no point has been sent yet. Delta sequence packets are
+	 * computed with respect to this
+	 */
+	int m_lastStreamedPoint;
+
+	/**
+	 * \brief How many points the hardware can buffer
+	 */
+	int m_hardwareBufferSize;
+
+	/**
+	 * \brief The current charge level of the battery
+	 */
+	float m_batteryCharge;
+
+	/**
+	 * \brief The number of missed deadlines of each task on the hardware
+	 */
+	QVariantList m_taskOverruns;
+
+	/**
+	 * \brief The last telemetry received from the hardware
+	 */
+	HardwareTelemetry m_telemetry;
+
+	/**
+	 * \brief The flow control state and the amount of exchanged data
+	 *
+	 * Credits are only updated when the statistics are notified
+	 */
+	StreamStatistics m_statistics;
+
+	/**
+	 * \brief True if we have sent a stop sequence packet and are waiting
+	 *        for the end of the sequence
+	 */
+	bool m_stopping;
+};
+
+#endif // STREAMENGINE_H
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef STREAMSTATISTICS_H
+#define STREAMSTATISTICS_H
+
+#include <QMetaType>
+#include <QtGlobal>
+
+/**
+ * \brief The state of the flow control and the amount of data exchanged with
+ *        the hardware
+ *
+ * Counters are totals since the serial port was opened, credits are the ones
+ * available when the statistics were taken
+ */
+struct StreamStatistics
+{
+	/**
+	 * \brief Constructor
+	 *
+	 * All values are set to 0
+	 */
+	StreamStatistics()
+		: credits(0)
+		, pointsSent(0)
+		, framesRetransmitted(0)
+		, bytesSent(0)
+		, bytesReceived(0)
+	{
+	}
+
+	/**
+	 * \brief Returns true if all values are equal to the ones of other
+	 *
+	 * \param other the object to compare
+	 * \return true if all values are equal
+	 */
+	bool operator==(const StreamStatistics& other) const
+	{
+		return (credits == other.credits) &&
+		       (pointsSent == other.pointsSent) &&
+		       (framesRetransmitted == other.framesRetransmitted) &&
+		       (bytesSent == other.bytesSent) &&
+		       (bytesReceived == other.bytesReceived);
+	}
+
+	/**
+	 * \brief Returns true if any value is different from the ones of other
+	 *
+	 * \param other the object to compare
+	 * \return true if any value is different
+	 */
+	bool operator!=(const StreamStatistics& other) const
+	{
+		return !(*this == other);
+	}
+
+	/**
+	 * \brief How many points we can send before the buffer of the hardware
+	 *        is full
+	 */
+	int credits;
+
+	/**
+	 * \brief The number of points streamed or uploaded
+	 */
+	qint64 pointsSent;
+
+	/**
+	 * \brief The number of frames sent again because the hardware did not
+	 *        receive them
+	 */
+	qint64 framesRetransmitted;
+
+	/**
+	 * \brief The number of bytes written to the serial port
+	 */
+	qint64 bytesSent;
+
+	/**
+	 * \brief The number of bytes read from the serial port
+	 */
+	qint64 bytesReceived;
+};
+
+// Statistics are passed between threads with queued connections
+Q_DECLARE_METATYPE(StreamStatistics)
+
+#endif // STREAMSTATISTICS_H
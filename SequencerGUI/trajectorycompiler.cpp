@@ -0,0 +1,491 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "trajectorycompiler.h"
+#include <QVector>
+#include <QPair>
+#include <cmath>
+
+namespace {
+	/**
+	 * \brief The default interval at which the trajectory is resampled in
+	 *        milliseconds
+	 */
+	const int defaultSampleIntervalMs = 20;
+
+	/**
+	 * \brief The original trajectory of a snapshot, resampled
+	 *
+	 * Samples are sorted by time. The samples of point k are those from
+	 * firstSample[k] to firstSample[k + 1] - 1: the samples taken while
+	 * moving to the point, the instant at which the point is reached (the
+	 * sample at reachSample[k]) and the samples taken while the point is
+	 * held, including the instant at which it ends
+	 */
+	struct Trajectory
+	{
+		/**
+		 * \brief The time at which each point is reached
+		 */
+		QVector<qint64> reachTimes;
+
+		/**
+		 * \brief The time at which each point ends
+		 */
+		QVector<qint64> endTimes;
+
+		/**
+		 * \brief The index of the first sample of each point
+		 *
+		 * This has one more element, the number of samples
+		 */
+		QVector<int> firstSample;
+
+		/**
+		 * \brief The index of the sample at which each point is reached
+		 */
+		QVector<int> reachSample;
+
+		/**
+		 * \brief The times of samples
+		 */
+		QVector<qint64> sampleTimes;
+
+		/**
+		 * \brief The point each sample belongs to
+		 */
+		QVector<int> samplePoints;
+
+		/**
+		 * \brief The positions of all samples, pointDim values per sample
+		 */
+		QVector<double> sampleValues;
+	};
+
+	/**
+	 * \brief Adds a sample to the trajectory
+	 *
+	 * \param trajectory the trajectory
+	 * \param snapshot the snapshot
+	 * \param point the point the sample belongs to
+	 * \param time the time of the sample
+	 * \param from the position of the previous point, or -1 if the sample
+	 *             is taken while the point is held
+	 * \param fraction the covered fraction of the motion towards the point
+	 */
+	void addSample(Trajectory& trajectory, const SequenceSnapshot& snapshot, int point, qint64 time, int from, double fraction)
+	{
+		trajectory.sampleTimes.append(time);
+		trajectory.samplePoints.append(point);
+		for (int c = 0; c < snapshot.pointDim(); ++c) {
+			const double to = snapshot.value(point, c);
+			trajectory.sampleValues.append((from == -1) ? to : (snapshot.value(from, c) + (to - snapshot.value(from, c)) * fraction));
+		}
+	}
+
+	/**
+	 * \brief Resamples the piecewise linear trajectory of a snapshot
+	 *
+	 * The motion towards the first point is not sampled, because it starts
+	 * from the position the hardware has when the sequence starts
+	 * \param snapshot the snapshot
+	 * \param interval the interval between samples in milliseconds
+	 * \return the resampled trajectory
+	 */
+	Trajectory resample(const SequenceSnapshot& snapshot, int interval)
+	{
+		Trajectory trajectory;
+		trajectory.reachTimes.resize(snapshot.numPoints());
+		trajectory.endTimes.resize(snapshot.numPoints());
+		trajectory.firstSample.resize(snapshot.numPoints() + 1);
+		trajectory.reachSample.resize(snapshot.numPoints());
+
+		qint64 start = 0;
+		for (int k = 0; k < snapshot.numPoints(); ++k) {
+			const int timeToTarget = snapshot.timeToTarget(k);
+			const int duration = snapshot.duration(k);
+
+			trajectory.reachTimes[k] = start + timeToTarget;
+			trajectory.endTimes[k] = trajectory.reachTimes[k] + duration;
+			trajectory.firstSample[k] = trajectory.sampleTimes.size();
+
+			// Moving to the point...
+			if (k != 0) {
+				for (int t = interval; t < timeToTarget; t += interval) {
+					addSample(trajectory, snapshot, k, start + t, k - 1, double(t) / double(timeToTarget));
+				}
+			}
+
+			// ... reaching it...
+			trajectory.reachSample[k] = trajectory.sampleTimes.size();
+			addSample(trajectory, snapshot, k, trajectory.reachTimes[k], -1, 1.0);
+
+			// ... and holding it
+			if (duration > 0) {
+				for (int t = interval; t < duration; t += interval) {
+					addSample(trajectory, snapshot, k, trajectory.reachTimes[k] + t, -1, 1.0);
+				}
+				addSample(trajectory, snapshot, k, trajectory.endTimes[k], -1, 1.0);
+			}
+
+			start = trajectory.endTimes[k];
+		}
+		trajectory.firstSample[snapshot.numPoints()] = trajectory.sampleTimes.size();
+
+		return trajectory;
+	}
+
+	/**
+	 * \brief The easing profile as a function of the covered fraction of
+	 *        time
+	 *
+	 * This is the same curve the firmware evaluates in fixed point
+	 * \param fraction the fraction of time, between 0 and 1
+	 * \param startSlope the slope at the start
+	 * \param endSlope the slope at the end
+	 * \return the covered fraction of the motion
+	 */
+	double ease(double fraction, double startSlope, double endSlope)
+	{
+		const double f2 = fraction * fraction;
+		const double f3 = f2 * fraction;
+
+		return (3.0 * f2 - 2.0 * f3) + startSlope * (f3 - 2.0 * f2 + fraction) + endSlope * (f3 - f2);
+	}
+
+	/**
+	 * \brief A segment replacing the points of the original trajectory
+	 *        from first + 1 to last, starting when point first ends
+	 */
+	class Segment
+	{
+	public:
+		/**
+		 * \brief Constructor
+		 *
+		 * \param snapshot the original snapshot
+		 * \param trajectory the resampled trajectory of the snapshot
+		 * \param first the point where the segment starts
+		 * \param last the point where the segment ends
+		 */
+		Segment(const SequenceSnapshot& snapshot, const Trajectory& trajectory, int first, int last)
+			: m_snapshot(snapshot)
+			, m_trajectory(trajectory)
+			, m_first(first)
+			, m_last(last)
+			, m_startTime(trajectory.endTimes[first])
+			, m_timeToTarget(trajectory.reachTimes[last] - m_startTime)
+		{
+		}
+
+		/**
+		 * \brief Returns the time to target of the segment
+		 *
+		 * \return the time to target of the segment
+		 */
+		qint64 timeToTarget() const
+		{
+			return m_timeToTarget;
+		}
+
+		/**
+		 * \brief Fits the slopes of the easing profile by least squares
+		 *
+		 * \return the slopes in Q6 fixed point, clamped to the valid range.
+		 *         The profile is linear if the fit is not possible
+		 */
+		QPair<int, int> fitProfile() const
+		{
+			// The position is from + delta * (h01 + s * h10 + e * h11), linear in the
+			// slopes s and e: accumulating the normal equations
+			double a00 = 0.0;
+			double a01 = 0.0;
+			double a11 = 0.0;
+			double b0 = 0.0;
+			double b1 = 0.0;
+			for (int i = firstSample(); i < lastSample(); ++i) {
+				const double f = fraction(i);
+				const double f2 = f * f;
+				const double f3 = f2 * f;
+				const double h01 = 3.0 * f2 - 2.0 * f3;
+				const double h10 = f3 - 2.0 * f2 + f;
+				const double h11 = f3 - f2;
+
+				const double* const values = sampleValues(i);
+				for (int c = 0; c < m_snapshot.pointDim(); ++c) {
+					const double from = m_snapshot.value(m_first, c);
+					const double delta = m_snapshot.value(m_last, c) - from;
+					const double x0 = delta * h10;
+					const double x1 = delta * h11;
+					const double y = values[c] - from - delta * h01;
+
+					a00 += x0 * x0;
+					a01 += x0 * x1;
+					a11 += x1 * x1;
+					b0 += x0 * y;
+					b1 += x1 * y;
+				}
+			}
+
+			const double det = a00 * a11 - a01 * a01;
+			if (std::fabs(det) < 1e-9) {
+				return qMakePair(int(SequenceSnapshot::linearSlope), int(SequenceSnapshot::linearSlope));
+			}
+
+			const double startSlope = (b0 * a11 - b1 * a01) / det;
+			const double endSlope = (a00 * b1 - a01 * b0) / det;
+
+			return qMakePair(toFixedPoint(startSlope), toFixedPoint(endSlope));
+		}
+
+		/**
+		 * \brief Returns the maximum distance of samples from the segment
+		 *
+		 * \param startSlope the slope at the start in Q6 fixed point
+		 * \param endSlope the slope at the end in Q6 fixed point
+		 * \param worstPoint filled with the point of the farthest sample. It
+		 *                   is always between first + 1 and last - 1
+		 * \return the maximum distance over all positions
+		 */
+		double error(int startSlope, int endSlope, int& worstPoint) const
+		{
+			const double s = double(startSlope) / SequenceSnapshot::linearSlope;
+			const double e = double(endSlope) / SequenceSnapshot::linearSlope;
+
+			double maxError = 0.0;
+			worstPoint = (m_first + m_last) / 2;
+			for (int i = firstSample(); i < lastSample(); ++i) {
+				const double covered = ease(fraction(i), s, e);
+
+				const double* const values = sampleValues(i);
+				for (int c = 0; c < m_snapshot.pointDim(); ++c) {
+					const double from = m_snapshot.value(m_first, c);
+					const double position = from + (m_snapshot.value(m_last, c) - from) * covered;
+					const double error = std::fabs(position - values[c]);
+
+					if (error > maxError) {
+						maxError = error;
+						worstPoint = qBound(m_first + 1, m_trajectory.samplePoints[i], m_last - 1);
+					}
+				}
+			}
+
+			return maxError;
+		}
+
+	private:
+		/**
+		 * \brief Returns the first sample covered by the segment
+		 *
+		 * \return the first sample covered by the segment
+		 */
+		int firstSample() const
+		{
+			return m_trajectory.firstSample[m_first + 1];
+		}
+
+		/**
+		 * \brief Returns the sample at which the segment ends
+		 *
+		 * \return the sample at which the segment ends (it is not covered)
+		 */
+		int lastSample() const
+		{
+			return m_trajectory.reachSample[m_last];
+		}
+
+		/**
+		 * \brief Returns the fraction of time of the segment at a sample
+		 *
+		 * \param i the sample
+		 * \return the fraction of time of the segment at the sample
+		 */
+		double fraction(int i) const
+		{
+			// If the time to target is 0 the end of the segment is reached immediately
+			if (m_timeToTarget == 0) {
+				return 1.0;
+			}
+
+			return double(m_trajectory.sampleTimes[i] - m_startTime) / double(m_timeToTarget);
+		}
+
+		/**
+		 * \brief Returns the positions of a sample
+		 *
+		 * \param i the sample
+		 * \return a pointer to the positions of the sample
+		 */
+		const double* sampleValues(int i) const
+		{
+			return m_trajectory.sampleValues.constData() + i * m_snapshot.pointDim();
+		}
+
+		/**
+		 * \brief Converts a slope to Q6 fixed point
+		 *
+		 * \param slope the slope
+		 * \return the slope in Q6 fixed point, clamped to the valid range
+		 */
+		static int toFixedPoint(double slope)
+		{
+			return qBound(0, int(std::lround(slope * SequenceSnapshot::linearSlope)), int(SequenceSnapshot::maxSlope));
+		}
+
+		/**
+		 * \brief The original snapshot
+		 */
+		const SequenceSnapshot& m_snapshot;
+
+		/**
+		 * \brief The resampled trajectory of the snapshot
+		 */
+		const Trajectory& m_trajectory;
+
+		/**
+		 * \brief The point where the segment starts
+		 */
+		const int m_first;
+
+		/**
+		 * \brief The point where the segment ends
+		 */
+		const int m_last;
+
+		/**
+		 * \brief The time at which the segment starts
+		 */
+		const qint64 m_startTime;
+
+		/**
+		 * \brief The time to target of the segment
+		 */
+		const qint64 m_timeToTarget;
+	};
+}
+
+TrajectoryCompiler::TrajectoryCompiler(double tolerance, bool easing)
+	: m_tolerance(tolerance)
+	, m_easing(easing)
+	, m_sampleInterval(defaultSampleIntervalMs)
+{
+}
+
+void TrajectoryCompiler::setTolerance(double tolerance)
+{
+	m_tolerance = tolerance;
+}
+
+void TrajectoryCompiler::setEasing(bool easing)
+{
+	m_easing = easing;
+}
+
+void TrajectoryCompiler::setSampleInterval(int sampleInterval)
+{
+	m_sampleInterval = qMax(1, sampleInterval);
+}
+
+SequenceSnapshot TrajectoryCompiler::compile(const SequenceSnapshot& snapshot) const
+{
+	const int numPoints = snapshot.numPoints();
+	if (numPoints < 3) {
+		return snapshot;
+	}
+
+	const Trajectory trajectory = resample(snapshot, m_sampleInterval);
+
+	// The kept points and the profiles of the segments ending at them
+	QVector<bool> kept(numPoints, false);
+	QVector<int> startSlopes(numPoints, int(SequenceSnapshot::linearSlope));
+	QVector<int> endSlopes(numPoints, int(SequenceSnapshot::linearSlope));
+	kept[0] = true;
+	kept[numPoints - 1] = true;
+
+	// Ramer-Douglas-Peucker reduction, using a stack of ranges instead of recursion because
+	// sequences can be long
+	QVector<QPair<int, int>> ranges;
+	ranges.append(qMakePair(0, numPoints - 1));
+	while (!ranges.isEmpty()) {
+		const QPair<int, int> range = ranges.takeLast();
+		const int first = range.first;
+		const int last = range.second;
+		if ((last - first) < 2) {
+			continue;
+		}
+
+		const Segment segment(snapshot, trajectory, first, last);
+		int split = (first + last) / 2;
+		bool replace = false;
+		if (segment.timeToTarget() <= maxTimeToTarget) {
+			int worstPoint;
+			double error = segment.error(SequenceSnapshot::linearSlope, SequenceSnapshot::linearSlope, worstPoint);
+			split = worstPoint;
+
+			if (m_easing && (error > 0.0)) {
+				const QPair<int, int> slopes = segment.fitProfile();
+				const double easedError = segment.error(slopes.first, slopes.second, worstPoint);
+				if (easedError < error) {
+					error = easedError;
+					split = worstPoint;
+					startSlopes[last] = slopes.first;
+					endSlopes[last] = slopes.second;
+				}
+			}
+
+			replace = (error <= m_tolerance);
+		}
+
+		if (replace) {
+			continue;
+		}
+
+		// Splitting the range, the profile of the last point is computed again
+		startSlopes[last] = SequenceSnapshot::linearSlope;
+		endSlopes[last] = SequenceSnapshot::linearSlope;
+		kept[split] = true;
+		ranges.append(qMakePair(first, split));
+		ranges.append(qMakePair(split, last));
+	}
+
+	// Building the compiled snapshot
+	SequenceSnapshot compiled(snapshot.pointDim(), kept.count(true));
+	int pos = 0;
+	int previous = -1;
+	for (int k = 0; k < numPoints; ++k) {
+		if (!kept[k]) {
+			continue;
+		}
+
+		const qint64 timeToTarget = (previous == -1) ? snapshot.timeToTarget(k) : (trajectory.reachTimes[k] - trajectory.endTimes[previous]);
+		const unsigned char* const values = reinterpret_cast<const unsigned char*>(snapshot.record(k)) + SequenceSnapshot::recordHeaderSize;
+		compiled.setPoint(pos, snapshot.duration(k), int(timeToTarget), values);
+		compiled.setSourcePoint(pos, k);
+		if ((startSlopes[k] != SequenceSnapshot::linearSlope) || (endSlopes[k] != SequenceSnapshot::linearSlope)) {
+			compiled.setProfile(pos, startSlopes[k], endSlopes[k]);
+		}
+
+		previous = k;
+		++pos;
+	}
+
+	return compiled;
+}
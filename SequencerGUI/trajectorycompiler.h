@@ -0,0 +1,150 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TRAJECTORYCOMPILER_H
+#define TRAJECTORYCOMPILER_H
+
+#include "sequencesnapshot.h"
+
+/**
+ * \brief The class turning a sequence into fewer segments with easing
+ *        profiles before it is streamed
+ *
+ * Smooth motions are usually obtained by adding many intermediate points to a
+ * sequence, which are all sent to the hardware. This class removes the points
+ * that can be dropped without moving the trajectory more than tolerance() from
+ * the original one, with a Ramer-Douglas-Peucker reduction over all positions:
+ * the trajectory is resampled every sampleInterval() milliseconds (plus the
+ * instants at which points are reached and end) and a range of points is
+ * replaced by a single segment if no sample is farther than the tolerance on
+ * any position; otherwise the range is split at the point of the farthest
+ * sample and both halves are processed again. The first and the last point and
+ * the durations of the remaining points are always kept, the time to target of
+ * the segment replacing a range is the time of the whole range.
+ * If easing() is true, each segment replacing a range also gets the easing
+ * profile (see SequenceSnapshot) that best fits the dropped points, which is
+ * evaluated by the firmware with a fixed point polynomial. Slopes are fitted
+ * by least squares on the samples, then the fitted profile is used only if it
+ * has a lower error than the linear one. The result is a snapshot whose source
+ * points are the positions of the kept points in the original sequence.
+ */
+class TrajectoryCompiler
+{
+public:
+	/**
+	 * \brief The maximum time to target of a segment in milliseconds
+	 *
+	 * This is the maximum value that fits the packets sent to the hardware
+	 */
+	static const int maxTimeToTarget = 65535;
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param tolerance the maximum distance from the original trajectory
+	 * \param easing whether to fit easing profiles or not
+	 */
+	explicit TrajectoryCompiler(double tolerance = 1.0, bool easing = true);
+
+	/**
+	 * \brief Returns the maximum distance from the original trajectory
+	 *
+	 * \return the maximum distance from the original trajectory
+	 */
+	double tolerance() const
+	{
+		return m_tolerance;
+	}
+
+	/**
+	 * \brief Sets the maximum distance from the original trajectory
+	 *
+	 * \param tolerance the maximum distance from the original trajectory, in
+	 *                  the units of positions
+	 */
+	void setTolerance(double tolerance);
+
+	/**
+	 * \brief Returns true if easing profiles are fitted
+	 *
+	 * \return true if easing profiles are fitted
+	 */
+	bool easing() const
+	{
+		return m_easing;
+	}
+
+	/**
+	 * \brief Sets whether to fit easing profiles or not
+	 *
+	 * \param easing if false all segments are linear
+	 */
+	void setEasing(bool easing);
+
+	/**
+	 * \brief Returns the interval at which the trajectory is resampled
+	 *
+	 * \return the interval at which the trajectory is resampled in
+	 *         milliseconds
+	 */
+	int sampleInterval() const
+	{
+		return m_sampleInterval;
+	}
+
+	/**
+	 * \brief Sets the interval at which the trajectory is resampled
+	 *
+	 * \param sampleInterval the interval in milliseconds. It must be
+	 *                       greater than 0
+	 */
+	void setSampleInterval(int sampleInterval);
+
+	/**
+	 * \brief Compiles a snapshot
+	 *
+	 * Easing profiles of the input snapshot are ignored, it is taken as the
+	 * piecewise linear trajectory the hardware would play
+	 * \param snapshot the snapshot to compile
+	 * \return the compiled snapshot
+	 */
+	SequenceSnapshot compile(const SequenceSnapshot& snapshot) const;
+
+private:
+	/**
+	 * \brief The maximum distance from the original trajectory
+	 */
+	double m_tolerance;
+
+	/**
+	 * \brief Whether to fit easing profiles or not
+	 */
+	bool m_easing;
+
+	/**
+	 * \brief The interval at which the trajectory is resampled in
+	 *        milliseconds
+	 */
+	int m_sampleInterval;
+};
+
+#endif // TRAJECTORYCOMPILER_H
@@ -25,6 +25,7 @@
 #include <QVector>
 #include <QJsonObject>
 #include "utils.h"
+#include "pointcodec.h"
 
 /**
  * \brief A single point in a sequence
@@ -45,6 +46,20 @@ struct SequencePoint
 	 */
 	using Array = std::array<double, pointDim>;
 
+	/**
+	 * \brief The encoding of points of this dimension in packets (the same
+	 *        used by the firmware)
+	 */
+	using Codec = PointCodec<pointDim>;
+
+	/**
+	 * \brief The type of sequence packets for points of this dimension
+	 *
+	 * This does not compile if the protocol cannot send points of this
+	 * dimension
+	 */
+	using SequencePacket = std::array<unsigned char, Codec::sequencePacketSize>;
+
 	/**
 	 * \brief Constructor
 	 */
@@ -74,6 +89,15 @@ struct SequencePoint
 	 */
 	QJsonObject toJson() const;
 
+	/**
+	 * \brief Returns the sequence packet for this point
+	 *
+	 * Positions are converted to integers and only the least significant
+	 * byte is sent
+	 * \return the sequence packet for this point
+	 */
+	SequencePacket toSequencePacket() const;
+
 	/**
 	 * \brief Returns true if the two points are equal
 	 *
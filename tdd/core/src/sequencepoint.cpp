@@ -100,6 +100,20 @@ QJsonObject SequencePoint<PointDimT>::toJson() const
 	return o;
 }
 
+template <std::size_t PointDimT>
+typename SequencePoint<PointDimT>::SequencePacket SequencePoint<PointDimT>::toSequencePacket() const
+{
+	std::array<unsigned char, pointDim> values;
+	for (std::size_t i = 0; i < pointDim; ++i) {
+		values[i] = static_cast<unsigned int>(point[i]) & 0xFF;
+	}
+
+	SequencePacket packet;
+	Codec::encodeSequencePacket(duration, timeToTarget, values.data(), packet.data());
+
+	return packet;
+}
+
 template <std::size_t PointDimT>
 bool SequencePoint<PointDimT>::operator==(const SequencePoint& other) const
 {
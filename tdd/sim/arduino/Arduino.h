@@ -0,0 +1,217 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "binary.h"
+#include "Print.h"
+
+/**
+ * \file Arduino.h
+ *
+ * The subset of the Arduino core used by the firmware, implemented on top of
+ * the simulated hardware (see hardware.h). Time is virtual: it only advances
+ * when the simulation advances it or when the firmware calls something that
+ * takes time on the real board (delays, I²C transmissions, writing to a full
+ * serial buffer, writing the EEPROM)
+ */
+
+/**
+ * \brief The frequency of the CPU of the simulated board (an Arduino Uno)
+ */
+#ifndef F_CPU
+	#define F_CPU 16000000UL
+#endif
+
+/**
+ * \brief The size of the receive and transmit buffers of the serial port
+ */
+#define SERIAL_RX_BUFFER_SIZE 64
+#define SERIAL_TX_BUFFER_SIZE 64
+
+/**
+ * \brief The boolean type of the Arduino core
+ */
+typedef bool boolean;
+
+/**
+ * \brief The byte type of the Arduino core
+ */
+typedef uint8_t byte;
+
+/**
+ * \brief Returns the minimum of two values
+ *
+ * The Arduino core defines this as a macro, here we use a template so that it
+ * doesn't clash with std::min in the code of the simulator
+ */
+template <class T, class U>
+inline auto min(const T& a, const U& b) -> decltype(a < b ? a : b)
+{
+	return (a < b) ? a : b;
+}
+
+/**
+ * \brief Returns the maximum of two values
+ *
+ * The Arduino core defines this as a macro, here we use a template so that it
+ * doesn't clash with std::max in the code of the simulator
+ */
+template <class T, class U>
+inline auto max(const T& a, const U& b) -> decltype(a > b ? a : b)
+{
+	return (a > b) ? a : b;
+}
+
+/**
+ * \brief Returns the virtual time in milliseconds
+ *
+ * \return the virtual time in milliseconds
+ */
+unsigned long millis();
+
+/**
+ * \brief Returns the virtual time in microseconds
+ *
+ * \return the virtual time in microseconds
+ */
+unsigned long micros();
+
+/**
+ * \brief Advances the virtual time
+ *
+ * \param ms the number of milliseconds to wait
+ */
+void delay(unsigned long ms);
+
+/**
+ * \brief Advances the virtual time
+ *
+ * \param us the number of microseconds to wait
+ */
+void delayMicroseconds(unsigned int us);
+
+/**
+ * \brief Reads an analog pin
+ *
+ * \param pin the pin to read
+ * \return the value set with Hardware::setAnalogValue() (0 by default)
+ */
+int analogRead(uint8_t pin);
+
+/**
+ * \brief The serial port of the board
+ *
+ * Bytes are exchanged with the other end of the line (see Hardware::hostWrite()
+ * and Hardware::hostRead()) at the current baud rate: each byte takes ten bit
+ * times to be transmitted. As on the real board, the receive buffer holds at
+ * most SERIAL_RX_BUFFER_SIZE - 1 bytes (received bytes that don't fit are
+ * lost) and writing when SERIAL_TX_BUFFER_SIZE bytes are waiting to be
+ * transmitted blocks until there is room
+ */
+class HardwareSerial : public Print
+{
+public:
+	/**
+	 * \brief Opens the port
+	 *
+	 * \param baudRate the baud rate
+	 */
+	void begin(unsigned long baudRate);
+
+	/**
+	 * \brief Closes the port
+	 *
+	 * This waits for pending bytes to be transmitted and discards the
+	 * received bytes that were not read
+	 */
+	void end();
+
+	/**
+	 * \brief Returns the number of bytes that can be read
+	 *
+	 * \return the number of bytes that can be read
+	 */
+	int available();
+
+	/**
+	 * \brief Reads a byte
+	 *
+	 * \return the byte or -1 if there is nothing to read
+	 */
+	int read();
+
+	/**
+	 * \brief Returns the next byte without removing it
+	 *
+	 * \return the byte or -1 if there is nothing to read
+	 */
+	int peek();
+
+	/**
+	 * \brief Writes a byte
+	 *
+	 * \param v the byte to write
+	 * \return the number of bytes written
+	 */
+	virtual size_t write(uint8_t v) override;
+
+	/**
+	 * \brief Writes a buffer
+	 *
+	 * \param buffer the bytes to write
+	 * \param size the number of bytes to write
+	 * \return the number of bytes written
+	 */
+	virtual size_t write(const uint8_t* buffer, size_t size) override;
+
+	/**
+	 * \brief Returns how many bytes can be written without blocking
+	 *
+	 * \return how many bytes can be written without blocking
+	 */
+	int availableForWrite();
+
+	/**
+	 * \brief Waits until all bytes have been transmitted
+	 */
+	void flush();
+
+	/**
+	 * \brief Returns true if the port is open
+	 */
+	operator bool() const;
+};
+
+/**
+ * \brief The serial port of the board
+ */
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_H
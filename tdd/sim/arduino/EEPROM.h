@@ -0,0 +1,74 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "Arduino.h"
+
+/**
+ * \brief The EEPROM of the board
+ *
+ * This has the size of the EEPROM of the ATmega328P. As on the real board
+ * each write takes about 3.3 milliseconds, update() only writes bytes that
+ * change
+ */
+class EEPROMClass
+{
+public:
+	/**
+	 * \brief Reads a byte
+	 *
+	 * \param address the address to read
+	 * \return the byte
+	 */
+	uint8_t read(int address);
+
+	/**
+	 * \brief Writes a byte
+	 *
+	 * \param address the address to write
+	 * \param v the byte to write
+	 */
+	void write(int address, uint8_t v);
+
+	/**
+	 * \brief Writes a byte only if it is different from the stored one
+	 *
+	 * \param address the address to write
+	 * \param v the byte to write
+	 */
+	void update(int address, uint8_t v);
+
+	/**
+	 * \brief Returns the size of the EEPROM in bytes
+	 *
+	 * \return the size of the EEPROM in bytes
+	 */
+	uint16_t length();
+};
+
+/**
+ * \brief The EEPROM of the board
+ */
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_H
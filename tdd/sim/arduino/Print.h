@@ -0,0 +1,194 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * \brief The base class of objects that can print text
+ *
+ * Derived classes only have to implement write(uint8_t). Numbers are printed
+ * in base 10
+ */
+class Print
+{
+public:
+	/**
+	 * \brief Destructor
+	 */
+	virtual ~Print()
+	{
+	}
+
+	/**
+	 * \brief Writes a byte
+	 *
+	 * \param v the byte to write
+	 * \return the number of bytes written
+	 */
+	virtual size_t write(uint8_t v) = 0;
+
+	/**
+	 * \brief Writes a buffer
+	 *
+	 * \param buffer the bytes to write
+	 * \param size the number of bytes to write
+	 * \return the number of bytes written
+	 */
+	virtual size_t write(const uint8_t* buffer, size_t size)
+	{
+		size_t n = 0;
+		while (size-- > 0) {
+			n += write(*buffer++);
+		}
+
+		return n;
+	}
+
+	/**
+	 * \brief Prints a string
+	 *
+	 * \param s the string to print
+	 * \return the number of bytes written
+	 */
+	size_t print(const char* s)
+	{
+		return write((const uint8_t*) s, strlen(s));
+	}
+
+	/**
+	 * \brief Prints a character
+	 *
+	 * \param c the character to print
+	 * \return the number of bytes written
+	 */
+	size_t print(char c)
+	{
+		return write(uint8_t(c));
+	}
+
+	/**
+	 * \brief Prints an integer
+	 *
+	 * \param n the number to print
+	 * \return the number of bytes written
+	 */
+	size_t print(long n)
+	{
+		char buffer[24];
+		snprintf(buffer, sizeof(buffer), "%ld", n);
+
+		return print(buffer);
+	}
+
+	/**
+	 * \brief Prints an integer
+	 *
+	 * \param n the number to print
+	 * \return the number of bytes written
+	 */
+	size_t print(int n)
+	{
+		return print(long(n));
+	}
+
+	/**
+	 * \brief Prints an unsigned integer
+	 *
+	 * \param n the number to print
+	 * \return the number of bytes written
+	 */
+	size_t print(unsigned long n)
+	{
+		char buffer[24];
+		snprintf(buffer, sizeof(buffer), "%lu", n);
+
+		return print(buffer);
+	}
+
+	/**
+	 * \brief Prints an unsigned integer
+	 *
+	 * \param n the number to print
+	 * \return the number of bytes written
+	 */
+	size_t print(unsigned int n)
+	{
+		return print((unsigned long) n);
+	}
+
+	/**
+	 * \brief Prints a byte as a number
+	 *
+	 * \param n the number to print
+	 * \return the number of bytes written
+	 */
+	size_t print(unsigned char n)
+	{
+		return print((unsigned long) n);
+	}
+
+	/**
+	 * \brief Prints a floating point number
+	 *
+	 * \param n the number to print
+	 * \param digits the number of decimal digits
+	 * \return the number of bytes written
+	 */
+	size_t print(double n, int digits = 2)
+	{
+		char buffer[48];
+		snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+
+		return print(buffer);
+	}
+
+	/**
+	 * \brief Prints a new line
+	 *
+	 * \return the number of bytes written
+	 */
+	size_t println()
+	{
+		return print("\r\n");
+	}
+
+	/**
+	 * \brief Prints a value followed by a new line
+	 *
+	 * \param v the value to print
+	 * \return the number of bytes written
+	 */
+	template <class T>
+	size_t println(const T& v)
+	{
+		const size_t n = print(v);
+
+		return n + println();
+	}
+};
+
+#endif // PRINT_H
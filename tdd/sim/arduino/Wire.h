@@ -0,0 +1,108 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "Arduino.h"
+
+/**
+ * \brief The size of the transmit buffer of the Wire library
+ */
+#define BUFFER_LENGTH 32
+
+/**
+ * \brief The I²C bus of the board
+ *
+ * Transmissions take the time needed to send all bytes on the bus at the
+ * current clock (nine bit times per byte, including the acknowledge bit, plus
+ * the start and stop conditions). Writes to the address of the PCA9685 servo
+ * driver update a register file, so that the simulation knows the PWM value
+ * of all channels (see Hardware::servoPWM()); reads are served from the same
+ * registers
+ */
+class TwoWire
+{
+public:
+	/**
+	 * \brief Joins the bus as master
+	 */
+	void begin();
+
+	/**
+	 * \brief Sets the clock of the bus
+	 *
+	 * \param clock the clock frequency in Hz
+	 */
+	void setClock(unsigned long clock);
+
+	/**
+	 * \brief Starts a transmission to a device
+	 *
+	 * \param address the address of the device
+	 */
+	void beginTransmission(uint8_t address);
+
+	/**
+	 * \brief Adds a byte to the transmission
+	 *
+	 * \param v the byte to send
+	 * \return 1 if the byte was added, 0 if the buffer is full
+	 */
+	size_t write(uint8_t v);
+
+	/**
+	 * \brief Sends the bytes of the transmission
+	 *
+	 * \return 0 (success)
+	 */
+	uint8_t endTransmission();
+
+	/**
+	 * \brief Reads bytes from a device
+	 *
+	 * \param address the address of the device
+	 * \param quantity the number of bytes to read
+	 * \return the number of bytes read
+	 */
+	uint8_t requestFrom(uint8_t address, uint8_t quantity);
+
+	/**
+	 * \brief Returns the number of bytes that can be read
+	 *
+	 * \return the number of bytes that can be read
+	 */
+	int available();
+
+	/**
+	 * \brief Reads a byte received with requestFrom()
+	 *
+	 * \return the byte or -1 if there is nothing to read
+	 */
+	int read();
+};
+
+/**
+ * \brief The I²C bus of the board
+ */
+extern TwoWire Wire;
+
+#endif // WIRE_H
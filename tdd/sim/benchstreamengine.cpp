@@ -0,0 +1,529 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QProcess>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include "sequence.h"
+#include "sequencepoint.h"
+#include "serialcommunication.h"
+
+/**
+ * \file benchstreamengine.cpp
+ *
+ * The benchmark of the streaming path of the GUI. Each synthetic sequence is
+ * streamed by SerialCommunication (and so by StreamEngine, with its credits,
+ * go-back-N retransmissions, delta packets and baud rate negotiation) to a new
+ * instance of firmwaresim, through its pseudo terminal. For each sequence we
+ * measure how many points per second are streamed, how much the stream lasts
+ * more than the timing of the sequence (drift), the underruns and dropped
+ * points counted by the firmware (from its telemetry packets), the I²C bytes
+ * sent per servo tick, the bytes lost by the board and the frames sent again.
+ * Everything runs in real time, so results change a bit at every run; the
+ * deterministic measures of the firmware are taken by benchstreaming, which
+ * runs the same scenarios against a minimal host of its own (see
+ * streamdriver.h) and is the baseline for this benchmark. The program prints a
+ * table with the results and fails if any sequence has underruns, dropped
+ * points, bytes lost, debug messages or errors from the stream, doesn't
+ * complete or, in scenarios which corrupt bytes on the line, never sends frames
+ * again. Overruns of the servo task are only reported: in real time they also
+ * happen when the simulator is not scheduled in time by the computer
+ */
+
+namespace {
+	/**
+	 * \brief The path of the firmware simulator, set by CMake
+	 */
+	const char* const firmwareSimulator = FIRMWARESIM_PATH;
+
+	/**
+	 * \brief The line printed by the firmware simulator before the name of
+	 *        the pseudo terminal
+	 */
+	const char* const boardBanner = "Simulated board on ";
+
+	/**
+	 * \brief The baud rate used by the firmware when idle
+	 */
+	const int defaultBaudRate = 115200;
+
+	/**
+	 * \brief The dimension of points, the number of servos of the board
+	 */
+	const int pointDim = 16;
+
+	/**
+	 * \brief The number of points of synthetic sequences
+	 *
+	 * Fewer than in benchstreaming, because here sequences play in real time
+	 */
+	const int numPoints = 200;
+
+	/**
+	 * \brief How long to wait after opening the serial port, in milliseconds
+	 *
+	 * More than the boot time StreamEngine waits for, so that the measures
+	 * do not include it
+	 */
+	const int bootTime = 1200;
+
+	/**
+	 * \brief How long to wait after a stream for a new telemetry packet, in
+	 *        milliseconds
+	 *
+	 * The firmware sends one every second
+	 */
+	const int telemetryWait = 1500;
+
+	/**
+	 * \brief A sequence to stream
+	 */
+	struct Scenario
+	{
+		/**
+		 * \brief The name of the scenario
+		 */
+		QString name;
+
+		/**
+		 * \brief The baud rate to use during the stream
+		 */
+		int baudRate;
+
+		/**
+		 * \brief The points of the sequence
+		 */
+		QList<SequencePoint> points;
+
+		/**
+		 * \brief One received byte out of this many is corrupted by the
+		 *        board, 0 to never corrupt bytes
+		 */
+		int corruptEvery;
+	};
+
+	/**
+	 * \brief The results of streaming a sequence
+	 */
+	struct Result
+	{
+		/**
+		 * \brief True if the stream finished before the timeout
+		 */
+		bool completed = false;
+
+		/**
+		 * \brief The error that stopped the scenario, empty if none
+		 */
+		QString error;
+
+		/**
+		 * \brief The number of points streamed
+		 */
+		qint64 pointsSent = 0;
+
+		/**
+		 * \brief The points per second from the start of the stream to its
+		 *        end
+		 */
+		double pointsPerSecond = 0.0;
+
+		/**
+		 * \brief How much the stream lasted more than the sequence, in
+		 *        milliseconds
+		 */
+		qint64 drift = 0;
+
+		/**
+		 * \brief The underruns of the player counted by the firmware
+		 */
+		int underruns = -1;
+
+		/**
+		 * \brief The points dropped by the firmware
+		 */
+		int droppedPoints = -1;
+
+		/**
+		 * \brief The mean number of I²C bytes per servo tick while playing
+		 */
+		double wireBytesPerTick = 0.0;
+
+		/**
+		 * \brief The maximum number of I²C bytes in a call to loop()
+		 */
+		unsigned long maxWireBytes = 0;
+
+		/**
+		 * \brief Received bytes lost by the board
+		 */
+		unsigned long serialOverflows = 0;
+
+		/**
+		 * \brief The overruns of the servo task
+		 */
+		unsigned int servoOverruns = 0;
+
+		/**
+		 * \brief True if the statistics of the board have been read
+		 */
+		bool boardStatistics = false;
+
+		/**
+		 * \brief The bytes sent by the computer
+		 */
+		qint64 bytesSent = 0;
+
+		/**
+		 * \brief The number of frames sent again
+		 */
+		qint64 retransmissions = 0;
+
+		/**
+		 * \brief The debug messages and errors of the stream
+		 */
+		int debugMessages = 0;
+
+		/**
+		 * \brief The last debug message or error of the stream
+		 */
+		QString lastDebugMessage;
+	};
+
+	/**
+	 * \brief A triangle wave with values between 0 and 255
+	 *
+	 * \param t the time (any integer, the period is 510)
+	 * \return the value of the wave
+	 */
+	int triangle(int t)
+	{
+		const int p = t % 510;
+
+		return (p < 256) ? p : (510 - p);
+	}
+
+	/**
+	 * \brief Creates a sequence where all servos move smoothly
+	 *
+	 * Each servo follows a triangle wave with a different phase, so that all
+	 * positions change at every point. This is the same sequence of
+	 * benchstreaming
+	 * \param timeToTarget the time to target of all points
+	 * \param duration the duration of all points
+	 * \return the points of the sequence
+	 */
+	QList<SequencePoint> smoothSequence(int timeToTarget, int duration)
+	{
+		QList<SequencePoint> points;
+		for (int i = 0; i < numPoints; ++i) {
+			QVector<double> p(pointDim);
+			for (int c = 0; c < pointDim; ++c) {
+				p[c] = triangle(7 * i + 31 * c + 1);
+			}
+			points.append(SequencePoint(p, duration, timeToTarget));
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates a sequence where a single servo moves at each point
+	 *
+	 * The moving servo changes at each point, so that packets are small
+	 * \param timeToTarget the time to target of all points
+	 * \param duration the duration of all points
+	 * \return the points of the sequence
+	 */
+	QList<SequencePoint> sparseSequence(int timeToTarget, int duration)
+	{
+		QList<SequencePoint> points;
+		QVector<double> p(pointDim, 64.0);
+		for (int i = 0; i < numPoints; ++i) {
+			const int c = i % pointDim;
+			p[c] = (p[c] == 64.0) ? 192.0 : 64.0;
+			points.append(SequencePoint(p, duration, timeToTarget));
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates a sequence of jumps between two positions
+	 *
+	 * Points have no duration and no time to target, so the player consumes
+	 * one point per tick, the fastest possible rate
+	 * \return the points of the sequence
+	 */
+	QList<SequencePoint> burstSequence()
+	{
+		QList<SequencePoint> points;
+		for (int i = 0; i < numPoints; ++i) {
+			points.append(SequencePoint(QVector<double>(pointDim, ((i % 2) == 0) ? 32.0 : 224.0), 0, 0));
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates the sequence of the GUI with the given points
+	 *
+	 * The sequence is loaded from its JSON representation, as it was read
+	 * from file
+	 * \param points the points of the sequence
+	 * \return the sequence or nullptr in case of error
+	 */
+	std::unique_ptr<Sequence> createSequence(const QList<SequencePoint>& points)
+	{
+		QJsonArray json;
+		json.append(SequencePoint(QVector<double>(pointDim, 0.0), 0, 0).toJson());
+		json.append(SequencePoint(QVector<double>(pointDim, 255.0), 10000, 10000).toJson());
+		for (const auto& p: points) {
+			json.append(p.toJson());
+		}
+
+		return Sequence::load(QJsonDocument(json));
+	}
+
+	/**
+	 * \brief Runs the event loop until a condition is true
+	 *
+	 * Signals from the thread of the stream engine are delivered meanwhile
+	 * \param condition the condition to wait for
+	 * \param timeout the maximum time to wait in milliseconds
+	 * \return true if the condition became true, false on timeout
+	 */
+	bool waitUntil(const std::function<bool()>& condition, qint64 timeout)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		while (!condition()) {
+			if (timer.hasExpired(timeout)) {
+				return false;
+			}
+
+			QEventLoop loop;
+			QTimer::singleShot(5, &loop, SLOT(quit()));
+			loop.exec();
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief Runs the event loop for the given time
+	 *
+	 * \param time the time to wait in milliseconds
+	 */
+	void wait(qint64 time)
+	{
+		waitUntil([]() { return false; }, time);
+	}
+
+	/**
+	 * \brief Stops the firmware simulator and reads its statistics
+	 *
+	 * \param board the process of the firmware simulator
+	 * \param result the results to which statistics are added
+	 */
+	void readBoardStatistics(QProcess& board, Result& result)
+	{
+		board.terminate();
+		if (!board.waitForFinished(3000)) {
+			board.kill();
+			board.waitForFinished();
+			return;
+		}
+
+		bool lost = false;
+		bool overruns = false;
+		bool wire = false;
+		while (board.canReadLine()) {
+			const QByteArray line = board.readLine();
+			unsigned long received;
+			unsigned long corrupted;
+
+			lost = lost || (std::sscanf(line.constData(), "Received bytes: %lu, corrupted: %lu, lost: %lu", &received, &corrupted, &result.serialOverflows) == 3);
+			overruns = overruns || (std::sscanf(line.constData(), "Servo task overruns: %u", &result.servoOverruns) == 1);
+			wire = wire || (std::sscanf(line.constData(), "I2C bytes per tick: %lf, max per loop: %lu", &result.wireBytesPerTick, &result.maxWireBytes) == 2);
+		}
+		result.boardStatistics = lost && overruns && wire;
+	}
+
+	/**
+	 * \brief Streams a sequence to a new simulated board and takes measures
+	 *
+	 * \param scenario the sequence to stream
+	 * \return the results
+	 */
+	Result run(const Scenario& scenario)
+	{
+		Result result;
+
+		std::unique_ptr<Sequence> sequence = createSequence(scenario.points);
+		if (!sequence) {
+			result.error = "invalid sequence";
+			return result;
+		}
+
+		// The time the whole sequence should take, used for the timeout and the drift
+		qint64 sequenceTime = 0;
+		for (const auto& p: scenario.points) {
+			sequenceTime += p.timeToTarget + p.duration;
+		}
+
+		// Starting the board and reading the name of its pseudo terminal
+		QProcess board;
+		QStringList arguments;
+		if (scenario.corruptEvery != 0) {
+			arguments << QString::number(scenario.corruptEvery);
+		}
+		board.start(firmwareSimulator, arguments);
+		if (!board.waitForStarted() || !waitUntil([&board]() { return board.canReadLine(); }, 5000)) {
+			result.error = QString("cannot start ") + firmwareSimulator;
+			return result;
+		}
+		const QString banner = QString::fromLocal8Bit(board.readLine()).trimmed();
+		if (!banner.startsWith(boardBanner)) {
+			result.error = "unexpected output from the board: " + banner;
+			readBoardStatistics(board, result);
+			return result;
+		}
+
+		SerialCommunication serial;
+		serial.setSerialPortName(banner.mid(int(std::strlen(boardBanner))));
+		serial.setBaudRate(defaultBaudRate);
+		serial.setStreamBaudRate(scenario.baudRate);
+		serial.setOneShotSequence(true);
+		QObject::connect(&serial, &SerialCommunication::debugMessage, [&result](QString msg) {
+			++result.debugMessages;
+			result.lastDebugMessage = msg;
+		});
+		QObject::connect(&serial, &SerialCommunication::streamError, [&result](QString error) {
+			++result.debugMessages;
+			result.lastDebugMessage = error;
+		});
+
+		if (!serial.openSerial()) {
+			result.error = "cannot open " + serial.serialPortName();
+			readBoardStatistics(board, result);
+			return result;
+		}
+		wait(bootTime);
+
+		// Streaming. The stream ends when the board tells the last point was played
+		QElapsedTimer streamTimer;
+		streamTimer.start();
+		if (!serial.startStream(sequence.get())) {
+			result.error = "cannot start the stream";
+		} else if (!waitUntil([&serial]() { return serial.isStreaming(); }, 1000)) {
+			result.error = "the stream did not start";
+		} else {
+			result.completed = waitUntil([&serial]() { return !serial.isStreaming(); }, 2 * sequenceTime + 5000);
+		}
+		const qint64 streamTime = streamTimer.elapsed();
+		if (!result.completed) {
+			serial.stop();
+		}
+
+		// The counters of the firmware are updated by the next telemetry packet
+		wait(telemetryWait);
+		result.pointsSent = serial.pointsSent();
+		result.pointsPerSecond = (streamTime == 0) ? 0.0 : (result.pointsSent * 1000.0 / streamTime);
+		result.drift = streamTime - sequenceTime;
+		result.underruns = serial.underruns();
+		result.droppedPoints = serial.droppedPoints();
+		result.bytesSent = serial.bytesSent();
+		result.retransmissions = serial.framesRetransmitted();
+
+		serial.closeSerial();
+		readBoardStatistics(board, result);
+
+		return result;
+	}
+
+	/**
+	 * \brief Returns true if the results of a scenario are good
+	 *
+	 * \param scenario the scenario
+	 * \param result the results
+	 * \return true if the results are good
+	 */
+	bool passed(const Scenario& scenario, const Result& result)
+	{
+		return result.completed && result.boardStatistics && (result.pointsSent == scenario.points.size()) && (result.underruns == 0) && (result.droppedPoints == 0) && (result.serialOverflows == 0) && (result.debugMessages == 0) && ((scenario.corruptEvery == 0) || (result.retransmissions != 0));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	// Corrupting one byte every 151 is about one frame every 7 with full packets, as in
+	// benchstreaming
+	QList<Scenario> scenarios;
+	scenarios.append(Scenario{"smooth", defaultBaudRate, smoothSequence(40, 10), 0});
+	scenarios.append(Scenario{"smooth-1M", 1000000, smoothSequence(40, 10), 0});
+	scenarios.append(Scenario{"sparse", defaultBaudRate, sparseSequence(20, 0), 0});
+	scenarios.append(Scenario{"burst", defaultBaudRate, burstSequence(), 0});
+	scenarios.append(Scenario{"burst-1M", 1000000, burstSequence(), 0});
+	scenarios.append(Scenario{"noisy", defaultBaudRate, smoothSequence(40, 10), 151});
+	scenarios.append(Scenario{"noisy-1M", 1000000, smoothSequence(40, 10), 151});
+
+	std::printf("%-10s %8s %8s %9s %9s %9s %9s %9s %9s %9s %9s %s\n", "scenario", "baud", "points", "points/s", "drift", "underrun", "dropped", "i2c/tick", "i2c max", "overflow", "resent", "result");
+
+	bool allPassed = true;
+	for (const auto& s: scenarios) {
+		const Result r = run(s);
+		const bool ok = passed(s, r);
+		allPassed = allPassed && ok;
+
+		std::printf("%-10s %8d %8lld %9.2f %9lld %9d %9d %9.2f %9lu %9lu %9lld %s\n", qPrintable(s.name), s.baudRate, r.pointsSent, r.pointsPerSecond, r.drift, r.underruns, r.droppedPoints, r.wireBytesPerTick, r.maxWireBytes, r.serialOverflows, r.retransmissions, ok ? "ok" : "FAILED");
+		if (!r.error.isEmpty()) {
+			std::printf("    %s\n", qPrintable(r.error));
+		} else if (!r.completed) {
+			std::printf("    the stream did not complete\n");
+		}
+		if (!r.boardStatistics) {
+			std::printf("    cannot read the statistics of the board\n");
+		}
+		if (r.servoOverruns != 0) {
+			std::printf("    servo task overruns: %u\n", r.servoOverruns);
+		}
+		if (r.debugMessages != 0) {
+			std::printf("    debug messages and errors: %d, last one: %s\n", r.debugMessages, qPrintable(r.lastDebugMessage));
+		}
+	}
+	std::printf("\nDrift is in milliseconds, it includes the handshake before the stream\n");
+
+	return allPassed ? 0 : 1;
+}
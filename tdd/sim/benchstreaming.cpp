@@ -0,0 +1,463 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "hardware.h"
+#include "firmware.h"
+#include "streamdriver.h"
+
+/**
+ * \file benchstreaming.cpp
+ *
+ * The benchmark of the streaming path. Synthetic sequences are streamed to the
+ * firmware running on the simulated board (see hardware.h), each one at a
+ * given baud rate. For each sequence we measure how many points per second
+ * reach the servos, the latency of each point (from when the computer starts
+ * sending it to when all servos are at its position), how many times the
+ * buffer of the sequence player runs empty before the end of the sequence
+ * (underruns), the I²C bytes sent per servo tick and how much the time at which
+ * points are reached drifts from the timing of the sequence. Everything runs
+ * in virtual time, so results are the same at every run and only change when
+ * the firmware or the protocol change. The program prints a table with the
+ * results and fails if any sequence has underruns, overflows of the serial
+ * buffer, debug packets from the board, overruns of the servo task or doesn't
+ * complete. Some scenarios corrupt frames on the line, to check that the
+ * board asks for them again and the stream recovers in time. The computer side
+ * is the minimal host in streamdriver.h, not the GUI: this is the baseline of
+ * benchstreamengine, which streams the same scenarios in real time with the
+ * StreamEngine of the GUI
+ */
+
+namespace {
+	/**
+	 * \brief The virtual time taken by a call to loop() when no task does
+	 *        anything, in microseconds
+	 *
+	 * Tasks only take time when they use the hardware (serial line, I²C bus,
+	 * EEPROM), computations are considered instantaneous
+	 */
+	const unsigned long loopTime = 20;
+
+	/**
+	 * \brief The baud rate used by the firmware when idle
+	 */
+	const unsigned long defaultBaudRate = 115200;
+
+	/**
+	 * \brief The number of points of synthetic sequences
+	 */
+	const int numPoints = 400;
+
+	/**
+	 * \brief The value of the battery pin (about 80% of the charge)
+	 */
+	const int batteryValue = 400;
+
+	/**
+	 * \brief A sequence to stream
+	 */
+	struct Scenario
+	{
+		/**
+		 * \brief The name of the scenario
+		 */
+		std::string name;
+
+		/**
+		 * \brief The baud rate to use during the stream
+		 */
+		unsigned long baudRate;
+
+		/**
+		 * \brief The points of the sequence
+		 */
+		std::vector<SequencePoint> points;
+
+		/**
+		 * \brief One frame out of this many is corrupted, 0 to never corrupt
+		 *        frames
+		 */
+		unsigned int corruptEvery;
+	};
+
+	/**
+	 * \brief The results of streaming a sequence
+	 */
+	struct Result
+	{
+		/**
+		 * \brief True if the stream finished before the timeout
+		 */
+		bool completed = false;
+
+		/**
+		 * \brief The number of points whose position was reached
+		 */
+		unsigned int pointsReached = 0;
+
+		/**
+		 * \brief The points per second from the first point sent to the
+		 *        last one reached
+		 */
+		double pointsPerSecond = 0.0;
+
+		/**
+		 * \brief The minimum latency of points in milliseconds
+		 */
+		double minLatency = 0.0;
+
+		/**
+		 * \brief The mean latency of points in milliseconds
+		 */
+		double meanLatency = 0.0;
+
+		/**
+		 * \brief The maximum latency of points in milliseconds
+		 */
+		double maxLatency = 0.0;
+
+		/**
+		 * \brief The maximum difference in milliseconds between the time
+		 *        points were reached and the time they should have been
+		 *        reached according to the timing of the sequence
+		 */
+		double maxDrift = 0.0;
+
+		/**
+		 * \brief How many times the buffer of the player ran empty before
+		 *        the last point
+		 */
+		unsigned int underruns = 0;
+
+		/**
+		 * \brief The mean number of I²C bytes per servo tick
+		 */
+		double meanWireBytesPerTick = 0.0;
+
+		/**
+		 * \brief The maximum number of I²C bytes in a servo tick
+		 */
+		unsigned long maxWireBytesPerTick = 0;
+
+		/**
+		 * \brief The bytes sent by the computer
+		 */
+		unsigned long bytesSent = 0;
+
+		/**
+		 * \brief Received bytes lost by the board
+		 */
+		unsigned long serialOverflows = 0;
+
+		/**
+		 * \brief The overruns of the servo task
+		 */
+		unsigned int servoOverruns = 0;
+
+		/**
+		 * \brief The number of frames sent again
+		 */
+		unsigned int retransmissions = 0;
+
+		/**
+		 * \brief The debug packets sent by the board
+		 */
+		unsigned int debugPackets = 0;
+
+		/**
+		 * \brief The message of the last debug packet
+		 */
+		std::string lastDebugMessage;
+	};
+
+	/**
+	 * \brief A triangle wave with values between 0 and 255
+	 *
+	 * \param t the time (any integer, the period is 510)
+	 * \return the value of the wave
+	 */
+	unsigned char triangle(int t)
+	{
+		const int p = t % 510;
+
+		return (p < 256) ? p : (510 - p);
+	}
+
+	/**
+	 * \brief Creates a sequence where all servos move smoothly
+	 *
+	 * Each servo follows a triangle wave with a different phase, so that all
+	 * positions change at every point
+	 * \param timeToTarget the time to target of all points
+	 * \param duration the duration of all points
+	 * \return the points of the sequence
+	 */
+	std::vector<SequencePoint> smoothSequence(unsigned int timeToTarget, unsigned int duration)
+	{
+		std::vector<SequencePoint> points(numPoints);
+		for (int i = 0; i < numPoints; ++i) {
+			points[i].duration = duration;
+			points[i].timeToTarget = timeToTarget;
+			for (int c = 0; c < SequencePoint::dim; ++c) {
+				points[i].point[c] = triangle(7 * i + 31 * c + 1);
+			}
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates a sequence where a single servo moves at each point
+	 *
+	 * The moving servo changes at each point, so that packets are small
+	 * \param timeToTarget the time to target of all points
+	 * \param duration the duration of all points
+	 * \return the points of the sequence
+	 */
+	std::vector<SequencePoint> sparseSequence(unsigned int timeToTarget, unsigned int duration)
+	{
+		std::vector<SequencePoint> points(numPoints);
+		for (int i = 0; i < numPoints; ++i) {
+			if (i == 0) {
+				memset(points[i].point, 64, sizeof(points[i].point));
+			} else {
+				points[i] = points[i - 1];
+			}
+			points[i].duration = duration;
+			points[i].timeToTarget = timeToTarget;
+
+			const int c = i % SequencePoint::dim;
+			points[i].point[c] = (points[i].point[c] == 64) ? 192 : 64;
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates a sequence of jumps between two positions
+	 *
+	 * Points have no duration and no time to target, so the player consumes
+	 * one point per tick, the fastest possible rate
+	 * \return the points of the sequence
+	 */
+	std::vector<SequencePoint> burstSequence()
+	{
+		std::vector<SequencePoint> points(numPoints);
+		for (int i = 0; i < numPoints; ++i) {
+			points[i].duration = 0;
+			points[i].timeToTarget = 0;
+			memset(points[i].point, ((i % 2) == 0) ? 32 : 224, sizeof(points[i].point));
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Returns true if all servos are at the position of a point
+	 *
+	 * \param p the point
+	 * \return true if the PWM of all servos is the one of p
+	 */
+	bool servosAt(const SequencePoint& p)
+	{
+		for (int c = 0; c < SequencePoint::dim; ++c) {
+			if (Hardware::servoPWM(c) != Firmware::servoPWM(c, p.point[c])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief Streams a sequence and takes measures
+	 *
+	 * The firmware must be idle when this is called and is idle again when
+	 * this returns if the stream completed
+	 * \param scenario the sequence to stream
+	 * \return the results
+	 */
+	Result run(const Scenario& scenario)
+	{
+		const std::vector<SequencePoint>& points = scenario.points;
+
+		// The time the whole sequence should take, used for the timeout
+		unsigned long long sequenceTime = 0;
+		for (const SequencePoint& p : points) {
+			sequenceTime += (p.timeToTarget + p.duration) * 1000ULL;
+		}
+		const unsigned long long timeout = Hardware::time() + 2 * sequenceTime + 5000000ULL;
+
+		const unsigned long startOverflows = Hardware::serialOverflows();
+		const unsigned int startOverruns = Firmware::scheduler().overruns(0);
+
+		StreamDriver driver(points, scenario.baudRate, scenario.corruptEvery);
+		driver.start();
+
+		Result result;
+		std::vector<unsigned long long> reachTimes;
+		bool bufferWasEmpty = true;
+		unsigned long long wireStartTime = 0;
+		unsigned long wireStartBytes = 0;
+		unsigned long long wireEndTime = 0;
+		unsigned long wireEndBytes = 0;
+		while (!driver.finished() && (Hardware::time() < timeout)) {
+			const unsigned long wireBytesBefore = Hardware::wireBytes();
+
+			Hardware::advanceTime(loopTime);
+			Firmware::loop();
+			driver.update();
+
+			// Checking if the servos reached the next point. Consecutive points are different,
+			// so the position of a point can only be reached after the previous one
+			while ((reachTimes.size() < driver.pointsSent()) && servosAt(points[reachTimes.size()])) {
+				reachTimes.push_back(Hardware::time());
+			}
+
+			// Counting I²C bytes from the first point sent to the last one reached
+			if ((driver.pointsSent() != 0) && (wireStartTime == 0)) {
+				wireStartTime = Hardware::time();
+				wireStartBytes = wireBytesBefore;
+			}
+			if ((wireStartTime != 0) && (reachTimes.size() < points.size())) {
+				wireEndTime = Hardware::time();
+				wireEndBytes = Hardware::wireBytes();
+				result.maxWireBytesPerTick = std::max(result.maxWireBytesPerTick, Hardware::wireBytes() - wireBytesBefore);
+			}
+
+			// An underrun happens when the player has nothing to play but the sequence is not
+			// finished
+			const bool bufferEmpty = Firmware::sequencePlayer().bufferEmpty();
+			if (bufferEmpty && !bufferWasEmpty && !reachTimes.empty() && (reachTimes.size() < points.size())) {
+				++result.underruns;
+			}
+			bufferWasEmpty = bufferEmpty;
+		}
+
+		result.completed = driver.finished();
+		result.pointsReached = reachTimes.size();
+		result.bytesSent = driver.bytesSent();
+		result.serialOverflows = Hardware::serialOverflows() - startOverflows;
+		result.servoOverruns = Firmware::scheduler().overruns(0) - startOverruns;
+		result.retransmissions = driver.retransmissions();
+		result.debugPackets = driver.debugPackets();
+		result.lastDebugMessage = driver.lastDebugMessage();
+
+		if (!reachTimes.empty()) {
+			const std::vector<unsigned long long>& sendTimes = driver.sendTimes();
+			const unsigned long long totalTime = reachTimes.back() - sendTimes.front();
+			result.pointsPerSecond = (totalTime == 0) ? 0.0 : (reachTimes.size() * 1000000.0 / totalTime);
+
+			result.minLatency = (reachTimes[0] - sendTimes[0]) / 1000.0;
+			double latencySum = 0.0;
+			long long idealTime = 0;
+			for (unsigned int i = 0; i < reachTimes.size(); ++i) {
+				const double latency = (reachTimes[i] - sendTimes[i]) / 1000.0;
+				result.minLatency = std::min(result.minLatency, latency);
+				result.maxLatency = std::max(result.maxLatency, latency);
+				latencySum += latency;
+
+				// Point i should be reached when point i - 1 ends plus its time to target. The
+				// player moves servos once per tick, so a point cannot take less than a tick
+				if (i != 0) {
+					idealTime += std::max((points[i - 1].duration + points[i].timeToTarget) * 1000LL, (long long) Firmware::servoUpdatePeriod());
+				}
+				const long long drift = (long long) (reachTimes[i] - reachTimes[0]) - idealTime;
+				result.maxDrift = std::max(result.maxDrift, std::abs(drift) / 1000.0);
+			}
+			result.meanLatency = latencySum / reachTimes.size();
+		}
+
+		const unsigned long long wireTime = wireEndTime - wireStartTime;
+		const double ticks = double(wireTime) / Firmware::servoUpdatePeriod();
+		result.meanWireBytesPerTick = (ticks < 1.0) ? 0.0 : ((wireEndBytes - wireStartBytes) / ticks);
+
+		// Letting the firmware go back to idle and to the default baud rate
+		const unsigned long long idleTime = Hardware::time() + 100000;
+		while (Hardware::time() < idleTime) {
+			Hardware::advanceTime(loopTime);
+			Firmware::loop();
+			driver.update();
+		}
+
+		return result;
+	}
+
+	/**
+	 * \brief Returns true if the results of a scenario are good
+	 *
+	 * \param scenario the scenario
+	 * \param result the results
+	 * \return true if the results are good
+	 */
+	bool passed(const Scenario& scenario, const Result& result)
+	{
+		return result.completed && (result.pointsReached == scenario.points.size()) && (result.underruns == 0) && (result.serialOverflows == 0) && (result.servoOverruns == 0) && (result.debugPackets == 0);
+	}
+}
+
+int main()
+{
+	std::vector<Scenario> scenarios;
+	scenarios.push_back({"smooth", defaultBaudRate, smoothSequence(40, 10), 0});
+	scenarios.push_back({"smooth-1M", 1000000, smoothSequence(40, 10), 0});
+	scenarios.push_back({"sparse", defaultBaudRate, sparseSequence(20, 0), 0});
+	scenarios.push_back({"burst", defaultBaudRate, burstSequence(), 0});
+	scenarios.push_back({"burst-1M", 1000000, burstSequence(), 0});
+	scenarios.push_back({"noisy", defaultBaudRate, smoothSequence(40, 10), 7});
+	scenarios.push_back({"noisy-1M", 1000000, smoothSequence(40, 10), 7});
+
+	Hardware::reset();
+	Hardware::setAnalogValue(batteryValue);
+	Firmware::setup();
+
+	std::printf("Player buffer: %d segments, servo tick: %lu us\n\n", SequencePlayer::bufferDimension, Firmware::servoUpdatePeriod());
+	std::printf("%-10s %8s %8s %9s %9s %9s %9s %9s %9s %9s %9s %9s %s\n", "scenario", "baud", "points", "points/s", "lat min", "lat mean", "lat max", "drift", "underrun", "i2c/tick", "i2c max", "overflow", "result");
+
+	bool allPassed = true;
+	for (const Scenario& s : scenarios) {
+		const Result r = run(s);
+		const bool ok = passed(s, r);
+		allPassed = allPassed && ok;
+
+		std::printf("%-10s %8lu %8u %9.2f %9.2f %9.2f %9.2f %9.2f %9u %9.2f %9lu %9lu %s\n", s.name.c_str(), s.baudRate, r.pointsReached, r.pointsPerSecond, r.minLatency, r.meanLatency, r.maxLatency, r.maxDrift, r.underruns, r.meanWireBytesPerTick, r.maxWireBytesPerTick, r.serialOverflows, ok ? "ok" : "FAILED");
+		if (!r.completed) {
+			std::printf("    the stream did not complete\n");
+		}
+		if (r.retransmissions != 0) {
+			std::printf("    frames sent again: %u\n", r.retransmissions);
+		}
+		if (r.servoOverruns != 0) {
+			std::printf("    servo task overruns: %u\n", r.servoOverruns);
+		}
+		if (r.debugPackets != 0) {
+			std::printf("    debug packets: %u, last one: %s\n", r.debugPackets, r.lastDebugMessage.c_str());
+		}
+	}
+	std::printf("\nLatencies and drift are in milliseconds\n");
+
+	return allPassed ? 0 : 1;
+}
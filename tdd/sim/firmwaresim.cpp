@@ -0,0 +1,193 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "hardware.h"
+#include "firmware.h"
+
+/**
+ * \file firmwaresim.cpp
+ *
+ * Runs the firmware on the simulated board in real time, connecting its serial
+ * line to a pseudo terminal. The name of the pseudo terminal is printed at
+ * startup: write it as the serial port name in the options of the GUI to use
+ * the simulated board in place of the robot. The virtual time follows the
+ * real time, except that operations that would block on the real board make it
+ * run ahead. Bytes from the pseudo terminal are sent to the board at the
+ * current baud rate of the firmware, whatever baud rate the GUI sets. If a
+ * number N is given on the command line, one byte out of every N received from
+ * the pseudo terminal is corrupted (the first N - 1 never are, so that
+ * the handshake before a stream goes through), to test retransmissions. On
+ * SIGINT or SIGTERM the program prints its statistics and exits (see
+ * benchstreamengine.cpp, which parses them)
+ */
+
+namespace {
+	/**
+	 * \brief How long to sleep between two calls to loop(), in microseconds
+	 */
+	const int loopSleep = 100;
+
+	/**
+	 * \brief The value of the battery pin (about 80% of the charge)
+	 */
+	const int batteryValue = 400;
+
+	/**
+	 * \brief Set by the signal handler to exit the main loop
+	 */
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	/**
+	 * \brief The handler of SIGINT and SIGTERM
+	 *
+	 * \param signal the signal received
+	 */
+	void requestStop(int signal)
+	{
+		(void) signal;
+
+		stopRequested = 1;
+	}
+
+	/**
+	 * \brief Opens the master side of a pseudo terminal in raw mode
+	 *
+	 * \return the file descriptor or -1 in case of error
+	 */
+	int openPseudoTerminal()
+	{
+		const int fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if (fd == -1) {
+			return -1;
+		}
+
+		termios t;
+		if ((grantpt(fd) == -1) || (unlockpt(fd) == -1) || (tcgetattr(fd, &t) == -1)) {
+			close(fd);
+			return -1;
+		}
+		cfmakeraw(&t);
+		tcsetattr(fd, TCSANOW, &t);
+
+		// We never want to block on the pseudo terminal
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+		return fd;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long corruptEvery = 0;
+	if (argc > 1) {
+		corruptEvery = std::strtoul(argv[1], nullptr, 10);
+		if (corruptEvery < 2) {
+			std::fprintf(stderr, "Usage: %s [N], with N at least 2 to corrupt one received byte out of every N\n", argv[0]);
+			return 1;
+		}
+	}
+
+	const int fd = openPseudoTerminal();
+	if (fd == -1) {
+		std::perror("Cannot open a pseudo terminal");
+		return 1;
+	}
+	std::printf("Simulated board on %s\n", ptsname(fd));
+	std::fflush(stdout);
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+
+	Hardware::reset();
+	Hardware::setAnalogValue(batteryValue);
+	Firmware::setup();
+
+	// The statistics. I²C bytes are only counted while the player has something to play, so that
+	// they measure the cost of playing sequences
+	unsigned long bytesReceived = 0;
+	unsigned long bytesCorrupted = 0;
+	unsigned long long playTime = 0;
+	unsigned long playWireBytes = 0;
+	unsigned long maxLoopWireBytes = 0;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (!stopRequested) {
+		uint8_t buffer[256];
+
+		// Bytes from the GUI. read() fails with EIO while nobody has the slave side open,
+		// that is fine
+		const ssize_t received = read(fd, buffer, sizeof(buffer));
+		if (received > 0) {
+			for (ssize_t i = 0; i < received; ++i) {
+				++bytesReceived;
+				if ((corruptEvery != 0) && ((bytesReceived % corruptEvery) == 0)) {
+					buffer[i] ^= 0x5A;
+					++bytesCorrupted;
+				}
+			}
+			Hardware::hostWrite(buffer, received);
+		}
+
+		const bool playing = !Firmware::sequencePlayer().bufferEmpty();
+		const unsigned long long timeBefore = Hardware::time();
+		const unsigned long wireBytesBefore = Hardware::wireBytes();
+
+		const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+		Hardware::advanceTimeTo(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+		Firmware::loop();
+
+		if (playing) {
+			playTime += Hardware::time() - timeBefore;
+			playWireBytes += Hardware::wireBytes() - wireBytesBefore;
+			maxLoopWireBytes = std::max(maxLoopWireBytes, Hardware::wireBytes() - wireBytesBefore);
+		}
+
+		// Bytes to the GUI. If nobody is listening they are lost, as with a real board
+		size_t n;
+		while ((n = Hardware::hostRead(buffer, sizeof(buffer))) != 0) {
+			if (write(fd, buffer, n) < 0) {
+				break;
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(loopSleep));
+	}
+
+	close(fd);
+
+	const double ticks = double(playTime) / Firmware::servoUpdatePeriod();
+	std::printf("Received bytes: %lu, corrupted: %lu, lost: %lu\n", bytesReceived, bytesCorrupted, Hardware::serialOverflows());
+	std::printf("Servo task overruns: %u\n", Firmware::scheduler().overruns(0));
+	std::printf("I2C bytes per tick: %.2f, max per loop: %lu\n", (ticks < 1.0) ? 0.0 : (playWireBytes / ticks), maxLoopWireBytes);
+	std::fflush(stdout);
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef FIRMWARE_H
+#define FIRMWARE_H
+
+#include "sequenceplayer.h"
+#include "scheduler.h"
+
+/**
+ * \file firmware.h
+ *
+ * The entry points of the firmware compiled for the simulated board, plus
+ * some read-only access to its internal state used to take measures. The
+ * sketch (Firmware.ino) is compiled as is, see firmware.cpp
+ */
+
+namespace Firmware {
+	/**
+	 * \brief Calls the setup() function of the sketch
+	 *
+	 * Call Hardware::reset() before this. This can only be called once per
+	 * process, because the global objects of the sketch are not
+	 * reinitialized
+	 */
+	void setup();
+
+	/**
+	 * \brief Calls the loop() function of the sketch
+	 */
+	void loop();
+
+	/**
+	 * \brief Returns the object controlling servos
+	 *
+	 * \return the object controlling servos
+	 */
+	const SequencePlayer& sequencePlayer();
+
+	/**
+	 * \brief Returns the scheduler running the tasks of the firmware
+	 *
+	 * Task 0 is the servo task
+	 * \return the scheduler running the tasks of the firmware
+	 */
+	const Scheduler& scheduler();
+
+	/**
+	 * \brief Returns the period of the servo task in microseconds
+	 *
+	 * \return the period of the servo task in microseconds
+	 */
+	unsigned long servoUpdatePeriod();
+
+	/**
+	 * \brief Returns the PWM value of a servo for a position
+	 *
+	 * This is the same mapping used by SequencePlayer, so that the
+	 * simulation can tell when servos reach a point
+	 * \param servo the servo
+	 * \param pos the position (0 - 255)
+	 * \return the PWM value
+	 */
+	uint16_t servoPWM(int servo, unsigned char pos);
+}
+
+#endif // FIRMWARE_H
@@ -0,0 +1,158 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \file hardware.h
+ *
+ * The functions to control the simulated board on which the firmware runs.
+ * The simulation is deterministic: the virtual time only advances when
+ * advanceTime() is called or when the firmware does something that takes time
+ * on the real board. Everything the firmware does with the hardware (see the
+ * shims of the Arduino core in the arduino directory) is timed using the
+ * virtual time
+ */
+
+namespace Hardware {
+	/**
+	 * \brief The I²C address of the PCA9685 servo driver
+	 */
+	const uint8_t servoDriverAddress = 0x40;
+
+	/**
+	 * \brief The number of channels of the PCA9685 servo driver
+	 */
+	const int servoDriverChannels = 16;
+
+	/**
+	 * \brief Resets the simulated board
+	 *
+	 * The virtual time goes back to 0, all buffers, registers and counters
+	 * are cleared and the EEPROM is erased (all bytes set to 0xFF)
+	 */
+	void reset();
+
+	/**
+	 * \brief Returns the virtual time in microseconds
+	 *
+	 * \return the virtual time in microseconds
+	 */
+	unsigned long long time();
+
+	/**
+	 * \brief Advances the virtual time
+	 *
+	 * Bytes sent by the other end of the serial line that arrive in this
+	 * time are moved to the receive buffer of the board
+	 * \param us the number of microseconds to advance
+	 */
+	void advanceTime(unsigned long long us);
+
+	/**
+	 * \brief Advances the virtual time up to the given time
+	 *
+	 * Nothing happens if the virtual time is already past t
+	 * \param t the time in microseconds
+	 */
+	void advanceTimeTo(unsigned long long t);
+
+	/**
+	 * \brief Sends bytes to the board through the serial line
+	 *
+	 * Bytes are queued on the line after the ones already being sent and
+	 * arrive at the current baud rate of the board
+	 * \param data the bytes to send
+	 * \param size the number of bytes to send
+	 */
+	void hostWrite(const uint8_t* data, size_t size);
+
+	/**
+	 * \brief Reads the bytes the board sent through the serial line
+	 *
+	 * Only bytes whose transmission has been completed are returned
+	 * \param data the buffer for the bytes
+	 * \param maxSize the size of the buffer
+	 * \return the number of bytes read
+	 */
+	size_t hostRead(uint8_t* data, size_t maxSize);
+
+	/**
+	 * \brief Returns the time needed to transmit a byte on the serial line
+	 *
+	 * \return the time needed to transmit a byte at the current baud rate in
+	 *         microseconds
+	 */
+	unsigned long serialByteTime();
+
+	/**
+	 * \brief Returns the current baud rate of the serial line
+	 *
+	 * \return the current baud rate or 0 if the board has not opened the
+	 *         serial port
+	 */
+	unsigned long serialBaudRate();
+
+	/**
+	 * \brief Returns how many received bytes have been lost because the
+	 *        receive buffer of the board was full
+	 *
+	 * \return the number of bytes lost
+	 */
+	unsigned long serialOverflows();
+
+	/**
+	 * \brief Returns the number of bytes sent on the I²C bus
+	 *
+	 * This includes the address byte of each transmission
+	 * \return the number of bytes sent on the I²C bus
+	 */
+	unsigned long wireBytes();
+
+	/**
+	 * \brief Returns the number of I²C transmissions
+	 *
+	 * \return the number of I²C transmissions
+	 */
+	unsigned long wireTransmissions();
+
+	/**
+	 * \brief Returns the PWM value of a channel of the servo driver
+	 *
+	 * This is the value of the OFF register of the channel
+	 * \param channel the channel
+	 * \return the PWM value
+	 */
+	uint16_t servoPWM(int channel);
+
+	/**
+	 * \brief Sets the value returned by analogRead()
+	 *
+	 * \param v the value for all analog pins
+	 */
+	void setAnalogValue(int v);
+}
+
+#endif // HARDWARE_H
@@ -0,0 +1,293 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef STREAMDRIVER_H
+#define STREAMDRIVER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "sequencepoint.h"
+
+/**
+ * \brief The computer side of the streaming protocol
+ *
+ * This streams a sequence to the simulated board as the GUI does: if needed it
+ * first switches to the requested baud rate, then it starts the stream, sends
+ * points as soon as the board grants credits (using delta packets when they
+ * are shorter than full ones) and stops the stream after the last point.
+ * Points and the stop command are sent in frames, which are sent again when
+ * the board asks for it or when it doesn't acknowledge them in time. To test
+ * retransmissions, the driver can corrupt one byte of some frames. Call
+ * start() once, then call update() after each call to Firmware::loop() until
+ * finished() returns true. Packets are written with Hardware::hostWrite(), so
+ * they take the time needed to travel on the serial line. This is only used by
+ * benchstreaming, which runs in virtual time; the StreamEngine of the GUI is
+ * benchmarked by benchstreamengine
+ */
+class StreamDriver
+{
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param points the points of the sequence to stream
+	 * \param baudRate the baud rate to use during the stream
+	 * \param corruptEvery if not 0, one byte of a frame every corruptEvery
+	 *                     frames written is corrupted
+	 */
+	StreamDriver(const std::vector<SequencePoint>& points, unsigned long baudRate, unsigned int corruptEvery = 0);
+
+	/**
+	 * \brief Starts streaming
+	 */
+	void start();
+
+	/**
+	 * \brief Reads the packets sent by the board and sends new packets
+	 */
+	void update();
+
+	/**
+	 * \brief Returns true when the board has told us the sequence finished
+	 *
+	 * \return true if the stream is over
+	 */
+	bool finished() const
+	{
+		return m_state == Finished;
+	}
+
+	/**
+	 * \brief Returns the number of points sent so far
+	 *
+	 * \return the number of points sent so far
+	 */
+	unsigned int pointsSent() const
+	{
+		return m_sendTimes.size();
+	}
+
+	/**
+	 * \brief Returns the time at which each point was sent
+	 *
+	 * This is the time at which the first byte of the packet of the point
+	 * was written to the line, in microseconds
+	 * \return the time at which each point sent so far was sent
+	 */
+	const std::vector<unsigned long long>& sendTimes() const
+	{
+		return m_sendTimes;
+	}
+
+	/**
+	 * \brief Returns the number of bytes sent to the board
+	 *
+	 * \return the number of bytes sent to the board
+	 */
+	unsigned long bytesSent() const
+	{
+		return m_bytesSent;
+	}
+
+	/**
+	 * \brief Returns the number of frames sent again
+	 *
+	 * \return the number of frames sent again
+	 */
+	unsigned int retransmissions() const
+	{
+		return m_retransmissions;
+	}
+
+	/**
+	 * \brief Returns the number of debug packets received
+	 *
+	 * The board only sends debug packets when something goes wrong
+	 * \return the number of debug packets received
+	 */
+	unsigned int debugPackets() const
+	{
+		return m_debugPackets;
+	}
+
+	/**
+	 * \brief Returns the message of the last debug packet received
+	 *
+	 * \return the message of the last debug packet received
+	 */
+	const std::string& lastDebugMessage() const
+	{
+		return m_lastDebugMessage;
+	}
+
+private:
+	/**
+	 * \brief The possible states of the stream
+	 */
+	enum State {
+		Idle,
+		ChangingBaudRate,
+		ConfirmingBaudRate,
+		Starting,
+		Streaming,
+		Stopping,
+		Finished
+	};
+
+	/**
+	 * \brief Handles a complete packet from the board
+	 *
+	 * \param packet the packet, starting with the packet type
+	 */
+	void packetReceived(const std::vector<uint8_t>& packet);
+
+	/**
+	 * \brief Returns the length of the packet being received
+	 *
+	 * \return the length of the packet in m_packet or 0 if it is not yet
+	 *         known
+	 */
+	unsigned int receivedPacketLength() const;
+
+	/**
+	 * \brief Sends points as long as we have credits
+	 *
+	 * When the last point has been sent, the stop packet is sent
+	 */
+	void sendPoints();
+
+	/**
+	 * \brief Handles an ack packet
+	 *
+	 * \param packet the packet, starting with the packet type
+	 */
+	void ackReceived(const std::vector<uint8_t>& packet);
+
+	/**
+	 * \brief Sends a command in a frame with the next sequence number
+	 *
+	 * The frame is kept until the board acknowledges it
+	 * \param command the command to send
+	 */
+	void sendFrame(const std::vector<uint8_t>& command);
+
+	/**
+	 * \brief Sends again all frames the board did not acknowledge
+	 */
+	void retransmit();
+
+	/**
+	 * \brief Writes a frame, corrupting it if needed
+	 *
+	 * \param frame the frame to write
+	 */
+	void writeFrame(const std::vector<uint8_t>& frame);
+
+	/**
+	 * \brief Sends bytes to the board
+	 *
+	 * \param data the bytes to send
+	 */
+	void send(const std::vector<uint8_t>& data);
+
+	/**
+	 * \brief The points to stream
+	 */
+	const std::vector<SequencePoint> m_points;
+
+	/**
+	 * \brief The baud rate to use during the stream
+	 */
+	const unsigned long m_baudRate;
+
+	/**
+	 * \brief The current state
+	 */
+	State m_state;
+
+	/**
+	 * \brief How many points we can send without waiting
+	 */
+	unsigned int m_credits;
+
+	/**
+	 * \brief If not 0, a frame every m_corruptEvery is corrupted
+	 */
+	const unsigned int m_corruptEvery;
+
+	/**
+	 * \brief The sequence number of the next frame
+	 */
+	uint8_t m_nextSequence;
+
+	/**
+	 * \brief The frames sent and not acknowledged yet, oldest first
+	 */
+	std::deque<std::vector<uint8_t>> m_unackedFrames;
+
+	/**
+	 * \brief The sequence number of the first frame in m_unackedFrames
+	 */
+	uint8_t m_firstUnackedSequence;
+
+	/**
+	 * \brief The last time a frame was acknowledged or sent again
+	 */
+	unsigned long long m_lastAckTime;
+
+	/**
+	 * \brief The number of frames written
+	 */
+	unsigned long m_framesWritten;
+
+	/**
+	 * \brief The number of frames sent again
+	 */
+	unsigned int m_retransmissions;
+
+	/**
+	 * \brief The time each point was sent
+	 */
+	std::vector<unsigned long long> m_sendTimes;
+
+	/**
+	 * \brief The number of bytes sent
+	 */
+	unsigned long m_bytesSent;
+
+	/**
+	 * \brief The bytes of the packet being received
+	 */
+	std::vector<uint8_t> m_packet;
+
+	/**
+	 * \brief The number of debug packets received
+	 */
+	unsigned int m_debugPackets;
+
+	/**
+	 * \brief The message of the last debug packet
+	 */
+	std::string m_lastDebugMessage;
+};
+
+#endif // STREAMDRIVER_H
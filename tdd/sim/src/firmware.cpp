@@ -0,0 +1,61 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// The whole sketch is part of this translation unit, so that all its global
+// objects and its constants are available to the functions below
+#include "Firmware.ino"
+#include "firmware.h"
+
+namespace Firmware {
+	void setup()
+	{
+		::setup();
+	}
+
+	void loop()
+	{
+		::loop();
+	}
+
+	const SequencePlayer& sequencePlayer()
+	{
+		return ::sequencePlayer;
+	}
+
+	const Scheduler& scheduler()
+	{
+		return ::scheduler;
+	}
+
+	unsigned long servoUpdatePeriod()
+	{
+		return ::servoUpdatePeriod;
+	}
+
+	uint16_t servoPWM(int servo, unsigned char pos)
+	{
+		// The same computation of SequencePlayer::servoPWM()
+		const unsigned long range = calibration.servoMax[servo] - calibration.servoMin[servo];
+		const unsigned long scale = ((range << 16) + 127) / 255;
+
+		return ((pos * scale + (1UL << 15)) >> 16) + calibration.servoMin[servo];
+	}
+}
@@ -0,0 +1,524 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "hardware.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace {
+	/**
+	 * \brief The time needed to write a byte of the EEPROM in microseconds
+	 */
+	const unsigned long eepromWriteTime = 3300;
+
+	/**
+	 * \brief The size of the EEPROM of the ATmega328P
+	 */
+	const int eepromSize = E2END + 1;
+
+	/**
+	 * \brief The default clock of the I²C bus in Hz
+	 */
+	const unsigned long defaultWireClock = 100000;
+
+	/**
+	 * \brief The number of registers of the PCA9685
+	 */
+	const int servoDriverRegisters = 256;
+
+	/**
+	 * \brief The address of the OFF register (low byte) of the first channel
+	 *        of the PCA9685
+	 */
+	const int servoDriverFirstOffRegister = 0x08;
+
+	/**
+	 * \brief The state of the simulated board
+	 */
+	struct Board
+	{
+		/**
+		 * \brief The virtual time in microseconds
+		 */
+		unsigned long long time = 0;
+
+		/**
+		 * \brief The baud rate of the serial line, 0 if closed
+		 */
+		unsigned long baudRate = 0;
+
+		/**
+		 * \brief The bytes travelling from the host to the board, with the
+		 *        time at which they arrive
+		 */
+		std::deque<std::pair<unsigned long long, uint8_t>> hostToBoard;
+
+		/**
+		 * \brief When the line from the host is free to send a new byte
+		 */
+		unsigned long long hostToBoardFree = 0;
+
+		/**
+		 * \brief The receive buffer of the board
+		 */
+		std::deque<uint8_t> receiveBuffer;
+
+		/**
+		 * \brief The number of received bytes lost because the receive
+		 *        buffer was full
+		 */
+		unsigned long overflows = 0;
+
+		/**
+		 * \brief The bytes travelling from the board to the host, with the
+		 *        time at which their transmission is complete
+		 */
+		std::deque<std::pair<unsigned long long, uint8_t>> boardToHost;
+
+		/**
+		 * \brief When the line to the host is free to send a new byte
+		 */
+		unsigned long long boardToHostFree = 0;
+
+		/**
+		 * \brief The clock of the I²C bus in Hz
+		 */
+		unsigned long wireClock = defaultWireClock;
+
+		/**
+		 * \brief The address of the current I²C transmission
+		 */
+		uint8_t wireAddress = 0;
+
+		/**
+		 * \brief The bytes of the current I²C transmission
+		 */
+		std::vector<uint8_t> wireBuffer;
+
+		/**
+		 * \brief The bytes received with the last requestFrom()
+		 */
+		std::deque<uint8_t> wireReceived;
+
+		/**
+		 * \brief The number of bytes sent on the I²C bus
+		 */
+		unsigned long wireBytes = 0;
+
+		/**
+		 * \brief The number of I²C transmissions
+		 */
+		unsigned long wireTransmissions = 0;
+
+		/**
+		 * \brief The registers of the PCA9685
+		 */
+		uint8_t servoDriver[servoDriverRegisters] = {};
+
+		/**
+		 * \brief The register pointer of the PCA9685
+		 */
+		int servoDriverPointer = 0;
+
+		/**
+		 * \brief The content of the EEPROM
+		 */
+		std::vector<uint8_t> eeprom = std::vector<uint8_t>(eepromSize, 0xFF);
+
+		/**
+		 * \brief The value returned by analogRead()
+		 */
+		int analogValue = 0;
+	};
+
+	/**
+	 * \brief The simulated board
+	 */
+	Board board;
+
+	/**
+	 * \brief Returns the time to transmit a byte at the given baud rate
+	 *
+	 * \param baudRate the baud rate, must not be 0
+	 * \return the time to transmit a byte in microseconds (at least 1)
+	 */
+	unsigned long byteTime(unsigned long baudRate)
+	{
+		// Ten bits per byte (start, eight data bits and stop)
+		return max(1UL, (10000000UL + (baudRate / 2)) / baudRate);
+	}
+
+	/**
+	 * \brief Moves the bytes from the host that have arrived to the receive
+	 *        buffer
+	 */
+	void receiveBytes()
+	{
+		while (!board.hostToBoard.empty() && (board.hostToBoard.front().first <= board.time)) {
+			if (board.baudRate == 0) {
+				// Nobody is listening
+			} else if (int(board.receiveBuffer.size()) < (SERIAL_RX_BUFFER_SIZE - 1)) {
+				board.receiveBuffer.push_back(board.hostToBoard.front().second);
+			} else {
+				++board.overflows;
+			}
+			board.hostToBoard.pop_front();
+		}
+	}
+
+	/**
+	 * \brief Returns the number of bytes in the transmit buffer of the board
+	 *
+	 * \return the number of bytes whose transmission is not complete
+	 */
+	int bytesBeingTransmitted()
+	{
+		int n = 0;
+		for (auto it = board.boardToHost.rbegin(); (it != board.boardToHost.rend()) && (it->first > board.time); ++it) {
+			++n;
+		}
+
+		return n;
+	}
+
+	/**
+	 * \brief Handles the bytes of a transmission to the PCA9685
+	 *
+	 * The first byte is the register address, the following ones are
+	 * written to consecutive registers (the firmware always enables the auto
+	 * increment)
+	 * \param data the bytes of the transmission
+	 */
+	void servoDriverTransmission(const std::vector<uint8_t>& data)
+	{
+		if (data.empty()) {
+			return;
+		}
+
+		board.servoDriverPointer = data[0];
+		for (unsigned int i = 1; i < data.size(); ++i) {
+			board.servoDriver[board.servoDriverPointer] = data[i];
+			board.servoDriverPointer = (board.servoDriverPointer + 1) % servoDriverRegisters;
+		}
+	}
+}
+
+namespace Hardware {
+	void reset()
+	{
+		board = Board();
+	}
+
+	unsigned long long time()
+	{
+		return board.time;
+	}
+
+	void advanceTime(unsigned long long us)
+	{
+		advanceTimeTo(board.time + us);
+	}
+
+	void advanceTimeTo(unsigned long long t)
+	{
+		// Bytes must be received one by one, so that the buffer is checked for
+		// overflows when each byte arrives
+		while (!board.hostToBoard.empty() && (board.hostToBoard.front().first <= t)) {
+			board.time = max(board.time, board.hostToBoard.front().first);
+			receiveBytes();
+		}
+		board.time = max(board.time, t);
+	}
+
+	void hostWrite(const uint8_t* data, size_t size)
+	{
+		const unsigned long t = byteTime(max(1UL, board.baudRate));
+		for (size_t i = 0; i < size; ++i) {
+			board.hostToBoardFree = max(board.hostToBoardFree, board.time) + t;
+			board.hostToBoard.push_back(std::make_pair(board.hostToBoardFree, data[i]));
+		}
+	}
+
+	size_t hostRead(uint8_t* data, size_t maxSize)
+	{
+		size_t n = 0;
+		while ((n < maxSize) && !board.boardToHost.empty() && (board.boardToHost.front().first <= board.time)) {
+			data[n++] = board.boardToHost.front().second;
+			board.boardToHost.pop_front();
+		}
+
+		return n;
+	}
+
+	unsigned long serialByteTime()
+	{
+		return byteTime(max(1UL, board.baudRate));
+	}
+
+	unsigned long serialBaudRate()
+	{
+		return board.baudRate;
+	}
+
+	unsigned long serialOverflows()
+	{
+		return board.overflows;
+	}
+
+	unsigned long wireBytes()
+	{
+		return board.wireBytes;
+	}
+
+	unsigned long wireTransmissions()
+	{
+		return board.wireTransmissions;
+	}
+
+	uint16_t servoPWM(int channel)
+	{
+		const int r = servoDriverFirstOffRegister + 4 * channel;
+
+		return (uint16_t(board.servoDriver[r + 1] & 0x0F) << 8) | board.servoDriver[r];
+	}
+
+	void setAnalogValue(int v)
+	{
+		board.analogValue = v;
+	}
+}
+
+unsigned long millis()
+{
+	return board.time / 1000;
+}
+
+unsigned long micros()
+{
+	return board.time;
+}
+
+void delay(unsigned long ms)
+{
+	Hardware::advanceTime(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	Hardware::advanceTime(us);
+}
+
+int analogRead(uint8_t)
+{
+	return board.analogValue;
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baudRate)
+{
+	board.baudRate = baudRate;
+}
+
+void HardwareSerial::end()
+{
+	flush();
+	board.baudRate = 0;
+	board.receiveBuffer.clear();
+}
+
+int HardwareSerial::available()
+{
+	receiveBytes();
+
+	return board.receiveBuffer.size();
+}
+
+int HardwareSerial::read()
+{
+	const int v = peek();
+	if (v != -1) {
+		board.receiveBuffer.pop_front();
+	}
+
+	return v;
+}
+
+int HardwareSerial::peek()
+{
+	receiveBytes();
+
+	return board.receiveBuffer.empty() ? -1 : board.receiveBuffer.front();
+}
+
+size_t HardwareSerial::write(uint8_t v)
+{
+	if (board.baudRate == 0) {
+		return 0;
+	}
+
+	// If the buffer is full we have to wait until the oldest byte being transmitted leaves it
+	if (availableForWrite() == 0) {
+		const int oldest = board.boardToHost.size() - bytesBeingTransmitted();
+		Hardware::advanceTimeTo(board.boardToHost[oldest].first);
+	}
+
+	board.boardToHostFree = max(board.boardToHostFree, board.time) + byteTime(board.baudRate);
+	board.boardToHost.push_back(std::make_pair(board.boardToHostFree, v));
+
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	while (size-- > 0) {
+		n += write(*buffer++);
+	}
+
+	return n;
+}
+
+int HardwareSerial::availableForWrite()
+{
+	return SERIAL_TX_BUFFER_SIZE - bytesBeingTransmitted();
+}
+
+void HardwareSerial::flush()
+{
+	Hardware::advanceTimeTo(board.boardToHostFree);
+}
+
+HardwareSerial::operator bool() const
+{
+	return board.baudRate != 0;
+}
+
+TwoWire Wire;
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::setClock(unsigned long clock)
+{
+	board.wireClock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+	board.wireAddress = address;
+	board.wireBuffer.clear();
+}
+
+size_t TwoWire::write(uint8_t v)
+{
+	if (board.wireBuffer.size() >= BUFFER_LENGTH) {
+		return 0;
+	}
+	board.wireBuffer.push_back(v);
+
+	return 1;
+}
+
+uint8_t TwoWire::endTransmission()
+{
+	// The address byte plus the data, nine bits each. Two more bits for the start and
+	// stop conditions
+	const unsigned long bytes = board.wireBuffer.size() + 1;
+	const unsigned long bits = bytes * 9 + 2;
+	++board.wireTransmissions;
+	board.wireBytes += bytes;
+
+	if (board.wireAddress == Hardware::servoDriverAddress) {
+		servoDriverTransmission(board.wireBuffer);
+	}
+	board.wireBuffer.clear();
+
+	Hardware::advanceTime((bits * 1000000ULL + (board.wireClock / 2)) / board.wireClock);
+
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+	board.wireReceived.clear();
+	for (uint8_t i = 0; i < quantity; ++i) {
+		if (address == Hardware::servoDriverAddress) {
+			board.wireReceived.push_back(board.servoDriver[board.servoDriverPointer]);
+			board.servoDriverPointer = (board.servoDriverPointer + 1) % servoDriverRegisters;
+		} else {
+			board.wireReceived.push_back(0);
+		}
+	}
+
+	// The address byte plus the data, nine bits each
+	const unsigned long bits = (quantity + 1UL) * 9 + 2;
+	Hardware::advanceTime((bits * 1000000ULL + (board.wireClock / 2)) / board.wireClock);
+
+	return quantity;
+}
+
+int TwoWire::available()
+{
+	return board.wireReceived.size();
+}
+
+int TwoWire::read()
+{
+	if (board.wireReceived.empty()) {
+		return -1;
+	}
+
+	const int v = board.wireReceived.front();
+	board.wireReceived.pop_front();
+
+	return v;
+}
+
+EEPROMClass EEPROM;
+
+uint8_t EEPROMClass::read(int address)
+{
+	return board.eeprom[address % eepromSize];
+}
+
+void EEPROMClass::write(int address, uint8_t v)
+{
+	board.eeprom[address % eepromSize] = v;
+	Hardware::advanceTime(eepromWriteTime);
+}
+
+void EEPROMClass::update(int address, uint8_t v)
+{
+	if (read(address) != v) {
+		write(address, v);
+	}
+}
+
+uint16_t EEPROMClass::length()
+{
+	return eepromSize;
+}
@@ -0,0 +1,273 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "streamdriver.h"
+#include "hardware.h"
+#include "crc8.h"
+
+namespace {
+	/**
+	 * \brief How long to wait for the ack of a frame before sending it
+	 *        again, in microseconds
+	 *
+	 * The board repeats its ack every 100 milliseconds
+	 */
+	const unsigned long long retransmitTimeout = 200000;
+
+	/**
+	 * \brief The flag of ack packets asking to send frames again
+	 */
+	const uint8_t retransmitFlag = 0x01;
+}
+
+StreamDriver::StreamDriver(const std::vector<SequencePoint>& points, unsigned long baudRate, unsigned int corruptEvery)
+	: m_points(points)
+	, m_baudRate(baudRate)
+	, m_state(Idle)
+	, m_credits(0)
+	, m_corruptEvery(corruptEvery)
+	, m_nextSequence(0)
+	, m_unackedFrames()
+	, m_firstUnackedSequence(0)
+	, m_lastAckTime(0)
+	, m_framesWritten(0)
+	, m_retransmissions(0)
+	, m_sendTimes()
+	, m_bytesSent(0)
+	, m_packet()
+	, m_debugPackets(0)
+	, m_lastDebugMessage()
+{
+}
+
+void StreamDriver::start()
+{
+	if (m_baudRate != Hardware::serialBaudRate()) {
+		m_state = ChangingBaudRate;
+		send({'R', uint8_t((m_baudRate >> 24) & 0xFF), uint8_t((m_baudRate >> 16) & 0xFF), uint8_t((m_baudRate >> 8) & 0xFF), uint8_t(m_baudRate & 0xFF)});
+	} else {
+		m_state = Starting;
+		send({'S', uint8_t(SequencePoint::dim)});
+	}
+}
+
+void StreamDriver::update()
+{
+	uint8_t buffer[64];
+	size_t n;
+	while ((n = Hardware::hostRead(buffer, sizeof(buffer))) != 0) {
+		for (size_t i = 0; i < n; ++i) {
+			m_packet.push_back(buffer[i]);
+
+			const unsigned int length = receivedPacketLength();
+			if ((length != 0) && (m_packet.size() == length)) {
+				packetReceived(m_packet);
+				m_packet.clear();
+			}
+		}
+	}
+
+	// Frames not acknowledged in time could have been lost after the last one the board received,
+	// in that case the board cannot ask for them
+	if (!m_unackedFrames.empty() && ((Hardware::time() - m_lastAckTime) > retransmitTimeout)) {
+		retransmit();
+	}
+}
+
+void StreamDriver::packetReceived(const std::vector<uint8_t>& packet)
+{
+	switch (packet[0]) {
+		case 'R':
+			if ((m_state == ChangingBaudRate) && (packet[1] != 0)) {
+				// The board has switched to the new baud rate, confirming it
+				m_state = ConfirmingBaudRate;
+				send({'K'});
+			} else if (m_state == ChangingBaudRate) {
+				// Baud rate refused, streaming with the current one
+				m_state = Starting;
+				send({'S', uint8_t(SequencePoint::dim)});
+			}
+			break;
+		case 'K':
+			if (m_state == ConfirmingBaudRate) {
+				m_state = Starting;
+				send({'S', uint8_t(SequencePoint::dim)});
+			}
+			break;
+		case 'A':
+			if (m_state == Starting) {
+				m_state = Streaming;
+				m_credits = packet[1];
+				m_nextSequence = 0;
+				m_firstUnackedSequence = 0;
+				sendPoints();
+			}
+			break;
+		case 'X':
+			if ((m_state == Streaming) || (m_state == Stopping)) {
+				ackReceived(packet);
+			}
+			break;
+		case 'E':
+			m_state = Finished;
+			m_unackedFrames.clear();
+			break;
+		case 'D':
+			++m_debugPackets;
+			m_lastDebugMessage.assign(packet.begin() + 2, packet.end());
+			break;
+		default:
+			// Battery charge, task overruns and telemetry, nothing to do here
+			break;
+	}
+}
+
+unsigned int StreamDriver::receivedPacketLength() const
+{
+	switch (m_packet[0]) {
+		case 'E':
+		case 'K':
+		case 'W':
+			return 1;
+		case 'A':
+		case 'N':
+		case 'R':
+		case 'B':
+			return 2;
+		case 'U':
+			return 4;
+		case 'X':
+			return 5;
+		case 'T':
+			return 17;
+		case 'D':
+			return (m_packet.size() < 2) ? 0 : (2 + m_packet[1]);
+		case 'O':
+			return (m_packet.size() < 2) ? 0 : (2 + 2 * m_packet[1]);
+		default:
+			// Unknown packet, skipping the byte
+			return 1;
+	}
+}
+
+void StreamDriver::sendPoints()
+{
+	while ((m_credits > 0) && (m_sendTimes.size() < m_points.size())) {
+		// Points are always sent as linear ones, with the shortest packet as the GUI does
+		const unsigned int i = m_sendTimes.size();
+		const SequencePoint& p = m_points[i];
+		uint8_t buffer[SequencePoint::Codec::maxPacketSize];
+		const uint8_t size = SequencePoint::Codec::encodeStreamPacket(p.duration, p.timeToTarget, SequencePoint::linearSlope, SequencePoint::linearSlope, p.point, (i == 0) ? nullptr : m_points[i - 1].point, buffer);
+		const std::vector<uint8_t> pkt(buffer, buffer + size);
+
+		m_sendTimes.push_back(Hardware::time());
+		sendFrame(pkt);
+		--m_credits;
+	}
+
+	// The stop command does not need credits
+	if ((m_state == Streaming) && (m_sendTimes.size() == m_points.size())) {
+		m_state = Stopping;
+		sendFrame({'H'});
+	}
+}
+
+void StreamDriver::ackReceived(const std::vector<uint8_t>& packet)
+{
+	// Acks the board did not send correctly are ignored, the next one is the same or newer
+	if (crc8Update(crc8Update(crc8Update(0, packet[1]), packet[2]), packet[3]) != packet[4]) {
+		return;
+	}
+	const uint8_t expectedSequence = packet[1];
+	const uint8_t freeSlots = packet[2];
+	const uint8_t flags = packet[3];
+
+	// Forgetting the frames the board has, the sequence number of the ack can be older than the
+	// first frame we still have
+	const unsigned int acked = uint8_t(expectedSequence - m_firstUnackedSequence);
+	if ((acked != 0) && (acked <= m_unackedFrames.size())) {
+		m_unackedFrames.erase(m_unackedFrames.begin(), m_unackedFrames.begin() + acked);
+		m_firstUnackedSequence = expectedSequence;
+		m_lastAckTime = Hardware::time();
+	}
+
+	// The board accepts points up to expectedSequence + freeSlots. This never goes back, so a
+	// newer ack always gives the right number of credits
+	const int window = int8_t(uint8_t(expectedSequence + freeSlots - m_nextSequence));
+	m_credits = (window > 0) ? window : 0;
+
+	if (((flags & retransmitFlag) != 0) && (expectedSequence == m_firstUnackedSequence)) {
+		retransmit();
+	}
+	sendPoints();
+}
+
+void StreamDriver::sendFrame(const std::vector<uint8_t>& command)
+{
+	std::vector<uint8_t> frame;
+	frame.reserve(command.size() + 3);
+	frame.push_back('F');
+	frame.push_back(m_nextSequence);
+	frame.insert(frame.end(), command.begin(), command.end());
+
+	uint8_t crc = 0;
+	for (unsigned int i = 1; i < frame.size(); ++i) {
+		crc = crc8Update(crc, frame[i]);
+	}
+	frame.push_back(crc);
+
+	if (m_unackedFrames.empty()) {
+		m_lastAckTime = Hardware::time();
+	}
+	m_unackedFrames.push_back(frame);
+	++m_nextSequence;
+
+	writeFrame(frame);
+}
+
+void StreamDriver::retransmit()
+{
+	for (const std::vector<uint8_t>& frame: m_unackedFrames) {
+		writeFrame(frame);
+		++m_retransmissions;
+	}
+	m_lastAckTime = Hardware::time();
+}
+
+void StreamDriver::writeFrame(const std::vector<uint8_t>& frame)
+{
+	++m_framesWritten;
+	if ((m_corruptEvery == 0) || ((m_framesWritten % m_corruptEvery) != 0)) {
+		send(frame);
+		return;
+	}
+
+	// Flipping a bit of a byte that changes with the frame, to also hit the header
+	std::vector<uint8_t> corrupted(frame);
+	corrupted[m_framesWritten % corrupted.size()] ^= 0x10;
+	send(corrupted);
+}
+
+void StreamDriver::send(const std::vector<uint8_t>& data)
+{
+	Hardware::hostWrite(data.data(), data.size());
+	m_bytesSent += data.size();
+}
@@ -0,0 +1,628 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include <QtTest/QtTest>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QTemporaryDir>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <cstdlib>
+#include <memory>
+#include "sequence.h"
+#include "sequencefile.h"
+#include "sequencepoint.h"
+#include "pointstorage.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// NOTES AND TODOS
+//
+// Allocations are only measured with glibc, the *Memory slots are skipped
+// elsewhere
+
+namespace {
+	/**
+	 * \brief The dimension of points in benchmarks
+	 */
+	const unsigned int benchPointDim = 7;
+
+	/**
+	 * \brief The layout of points used by Sequence before PointStorage, one
+	 *        allocated object per point
+	 */
+	using PointsAoS = QList<SequencePoint>;
+
+	/**
+	 * \brief The layout of points used by Sequence
+	 */
+	using PointsSoA = PointStorage<SequenceValue>;
+
+	/**
+	 * \brief Returns the number of bytes currently allocated on the heap
+	 *
+	 * Qt containers allocate with malloc(), so this uses the statistics of
+	 * the allocator instead of counting calls to operator new. Blocks
+	 * mapped directly from the system (big arrays) are included
+	 * \return the number of bytes allocated, or -1 if unknown
+	 */
+	qint64 allocatedBytes()
+	{
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+		const auto info = mallinfo2();
+		return qint64(info.uordblks) + qint64(info.hblkhd);
+#elif defined(__GLIBC__)
+		const auto info = mallinfo();
+		return qint64(info.uordblks) + qint64(info.hblkhd);
+#else
+		return -1;
+#endif
+	}
+
+	/**
+	 * \brief Returns the minimum values of points in benchmarks
+	 *
+	 * \return the minimum values of points
+	 */
+	SequencePoint minBenchPoint()
+	{
+		return SequencePoint(QVector<double>(benchPointDim, 0.0), 0, 0);
+	}
+
+	/**
+	 * \brief Returns the maximum values of points in benchmarks
+	 *
+	 * \return the maximum values of points
+	 */
+	SequencePoint maxBenchPoint()
+	{
+		return SequencePoint(QVector<double>(benchPointDim, 255.0), 10000, 10000);
+	}
+
+	/**
+	 * \brief Creates a point
+	 *
+	 * Consecutive points are different. Positions are integers within the
+	 * limits, so that they are not changed by 8 bits storage nor by
+	 * clamping
+	 * \param i the index of the point
+	 * \param offset a value added to all positions. The result is kept
+	 *               within the limits
+	 * \return the point
+	 */
+	SequencePoint generateBenchPoint(int i, int offset = 0)
+	{
+		QVector<double> p(benchPointDim);
+		for (unsigned int c = 0; c < benchPointDim; ++c) {
+			p[c] = double((i * 7 + c * 31 + offset) % 256);
+		}
+
+		return SequencePoint(p, (i % 100) * 10 + 10, (i % 50) * 10);
+	}
+
+	/**
+	 * \brief Creates the given number of points
+	 *
+	 * \param numPoints the number of points
+	 * \param offset the value added to all positions (see
+	 *               generateBenchPoint())
+	 * \return the points
+	 */
+	QList<SequencePoint> generateBenchPoints(int numPoints, int offset = 0)
+	{
+		QList<SequencePoint> points;
+		points.reserve(numPoints);
+		for (int i = 0; i < numPoints; ++i) {
+			points.append(generateBenchPoint(i, offset));
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Creates a sequence with the given number of points
+	 *
+	 * The sequence is loaded from its JSON representation, as it was read
+	 * from file
+	 * \param numPoints the number of points
+	 * \return the sequence
+	 */
+	std::unique_ptr<Sequence> generateBenchSequence(int numPoints)
+	{
+		QJsonArray json;
+		json.append(minBenchPoint().toJson());
+		json.append(maxBenchPoint().toJson());
+		for (int i = 0; i < numPoints; ++i) {
+			json.append(generateBenchPoint(i).toJson());
+		}
+
+		return Sequence::load(QJsonDocument(json));
+	}
+
+	/**
+	 * \brief Appends points to the AoS layout
+	 *
+	 * \param points the points to which source is appended
+	 * \param source the points to append
+	 */
+	void appendAll(PointsAoS& points, const QList<SequencePoint>& source)
+	{
+		for (const auto& p: source) {
+			points.append(p);
+		}
+	}
+
+	/**
+	 * \brief Appends points to the SoA layout
+	 *
+	 * \param points the points to which source is appended
+	 * \param source the points to append
+	 */
+	void appendAll(PointsSoA& points, const QList<SequencePoint>& source)
+	{
+		for (const auto& p: source) {
+			points.append(p);
+		}
+	}
+
+	/**
+	 * \brief Increments all positions of all points in the AoS layout
+	 *
+	 * \param points the points to change
+	 */
+	void incrementCoordinates(PointsAoS& points)
+	{
+		for (int i = 0; i < points.size(); ++i) {
+			for (auto& c: points[i].point) {
+				c += 1.0;
+			}
+		}
+	}
+
+	/**
+	 * \brief Increments all positions of all points in the SoA layout
+	 *
+	 * \param points the points to change
+	 */
+	void incrementCoordinates(PointsSoA& points)
+	{
+		for (int i = 0; i < points.size(); ++i) {
+			for (unsigned int c = 0; c < benchPointDim; ++c) {
+				points.setCoordinate(i, c, points.coordinate(i, c) + 1.0);
+			}
+		}
+	}
+
+	/**
+	 * \brief Converts the XML output of QtTest to a JSON array
+	 *
+	 * Each element of the array is one benchmark result, with the keys
+	 * function, tag, metric, value and iterations
+	 * \param xml the XML output of QtTest
+	 * \return the JSON document
+	 */
+	QByteArray benchmarkResultsToJson(QIODevice* xml)
+	{
+		QJsonArray results;
+		QString function;
+
+		QXmlStreamReader reader(xml);
+		while (!reader.atEnd()) {
+			if (!reader.readNextStartElement()) {
+				continue;
+			}
+
+			const auto attributes = reader.attributes();
+			if (reader.name() == QLatin1String("TestFunction")) {
+				function = attributes.value("name").toString();
+			} else if (reader.name() == QLatin1String("BenchmarkResult")) {
+				QJsonObject result;
+				result.insert("function", function);
+				result.insert("tag", attributes.value("tag").toString());
+				result.insert("metric", attributes.value("metric").toString());
+				result.insert("value", attributes.value("value").toDouble());
+				result.insert("iterations", attributes.value("iterations").toInt());
+				results.append(result);
+			}
+		}
+
+		return QJsonDocument(results).toJson();
+	}
+}
+
+/**
+ * \brief The class with the benchmarks of sequences
+ *
+ * The benchmarks use the Sequence, SequenceFile and PointStorage of the GUI.
+ * Each private slot is a benchmark, run on sequences with 1k, 100k and 1M
+ * points. Slots with a binary column have one row for JSON files and one for
+ * binary files, slots with a soa column have one row for the AoS layout
+ * (QList<SequencePoint>) and one for PointStorage. The *Memory and *Size slots
+ * report bytes instead of time
+ */
+class BenchSequence : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase()
+	{
+		QVERIFY(m_dir.isValid());
+	}
+
+	void load_data()
+	{
+		addFormatsAndSizes();
+	}
+
+	void load()
+	{
+		QFETCH(bool, binary);
+		QFETCH(int, numPoints);
+
+		const QString filename = benchFile(binary, numPoints);
+		std::unique_ptr<Sequence> sequence;
+
+		QBENCHMARK {
+			sequence = Sequence::load(filename);
+		}
+
+		QVERIFY(sequence->isValid());
+		QCOMPARE(sequence->numPoints(), numPoints);
+	}
+
+	void save_data()
+	{
+		addFormatsAndSizes();
+	}
+
+	void save()
+	{
+		QFETCH(bool, binary);
+		QFETCH(int, numPoints);
+
+		const auto sequence = generateBenchSequence(numPoints);
+		const QString filename = m_dir.filePath(QString("save.") + suffix(binary));
+
+		QBENCHMARK {
+			QVERIFY(binary ? sequence->saveBinary(filename) : sequence->save(filename));
+		}
+	}
+
+	void setPointCoordinates_data()
+	{
+		// The undo stack keeps one command per changed point until the
+		// batch ends. Commands are small, but with 1M points they would
+		// still take hundreds of megabytes
+		addSizes(100000);
+	}
+
+	void setPointCoordinates()
+	{
+		QFETCH(int, numPoints);
+
+		const auto sequence = generateBenchSequence(numPoints);
+
+		// Clearing the undo stack in the loop, otherwise it would keep the
+		// edits of all iterations
+		QBENCHMARK {
+			sequence->beginUpdate();
+			for (int i = 0; i < numPoints; ++i) {
+				const double v = sequence->pointCoordinate(i, 0);
+				sequence->setPointCoordinate(i, 0, (v < 128.0) ? (v + 1.0) : (v - 1.0));
+			}
+			sequence->endUpdate();
+			sequence->undoStack()->clear();
+		}
+	}
+
+	void setPoints_data()
+	{
+		addSizes();
+	}
+
+	void setPoints()
+	{
+		QFETCH(int, numPoints);
+
+		const auto sequence = generateBenchSequence(numPoints);
+		// Alternating between two sets of points, so that all points change
+		// at each iteration
+		const QList<SequencePoint> points[] = {generateBenchPoints(numPoints, 1), generateBenchPoints(numPoints)};
+		int next = 0;
+
+		QBENCHMARK {
+			sequence->setPoints(0, points[next]);
+			next = 1 - next;
+			sequence->undoStack()->clear();
+		}
+	}
+
+	void storageAppend_data()
+	{
+		addLayoutsAndSizes();
+	}
+
+	void storageAppend()
+	{
+		QFETCH(bool, soa);
+		QFETCH(int, numPoints);
+
+		const auto source = generateBenchPoints(numPoints);
+
+		if (soa) {
+			QBENCHMARK {
+				PointsSoA points(benchPointDim);
+				appendAll(points, source);
+			}
+		} else {
+			QBENCHMARK {
+				PointsAoS points;
+				appendAll(points, source);
+			}
+		}
+	}
+
+	void storageSetCoordinates_data()
+	{
+		addLayoutsAndSizes();
+	}
+
+	void storageSetCoordinates()
+	{
+		QFETCH(bool, soa);
+		QFETCH(int, numPoints);
+
+		const auto source = generateBenchPoints(numPoints);
+		PointsSoA soaPoints(benchPointDim);
+		PointsAoS aosPoints;
+
+		if (soa) {
+			appendAll(soaPoints, source);
+			QBENCHMARK {
+				incrementCoordinates(soaPoints);
+			}
+		} else {
+			appendAll(aosPoints, source);
+			QBENCHMARK {
+				incrementCoordinates(aosPoints);
+			}
+		}
+	}
+
+	void storageMemory_data()
+	{
+		addLayoutsAndSizes();
+	}
+
+	void storageMemory()
+	{
+		QFETCH(bool, soa);
+		QFETCH(int, numPoints);
+
+		const auto source = generateBenchPoints(numPoints);
+		PointsSoA soaPoints(benchPointDim);
+		PointsAoS aosPoints;
+
+		const qint64 before = allocatedBytes();
+		if (soa) {
+			appendAll(soaPoints, source);
+		} else {
+			appendAll(aosPoints, source);
+		}
+		reportAllocation(before);
+	}
+
+	void sequenceMemory_data()
+	{
+		addSizes();
+	}
+
+	void sequenceMemory()
+	{
+		QFETCH(int, numPoints);
+
+		const QString filename = benchFile(true, numPoints);
+
+		const qint64 before = allocatedBytes();
+		const auto sequence = Sequence::load(filename);
+		reportAllocation(before);
+
+		QCOMPARE(sequence->numPoints(), numPoints);
+	}
+
+	void fileSize_data()
+	{
+		addFormatsAndSizes();
+	}
+
+	void fileSize()
+	{
+		QFETCH(bool, binary);
+		QFETCH(int, numPoints);
+
+		QTest::setBenchmarkResult(QFileInfo(benchFile(binary, numPoints)).size(), QTest::BytesAllocated);
+	}
+
+private:
+	/**
+	 * \brief Returns the suffix of files in the given format
+	 *
+	 * \param binary if true the suffix of binary files is returned,
+	 *               otherwise the one of JSON files
+	 * \return the suffix
+	 */
+	static QString suffix(bool binary)
+	{
+		return binary ? QString(SequenceFile::binarySuffix) : QString("json");
+	}
+
+	/**
+	 * \brief Returns the name of the file with a sequence of the given size
+	 *
+	 * The file is created the first time it is requested
+	 * \param binary if true the file is in the binary format, otherwise it
+	 *               is in JSON
+	 * \param numPoints the number of points of the sequence
+	 * \return the name of the file
+	 */
+	QString benchFile(bool binary, int numPoints)
+	{
+		const QString filename = m_dir.filePath(QString("points%1.%2").arg(numPoints).arg(suffix(binary)));
+
+		if (!QFileInfo::exists(filename)) {
+			const auto sequence = generateBenchSequence(numPoints);
+			if (!(binary ? sequence->saveBinary(filename) : sequence->save(filename))) {
+				qWarning() << "Cannot write" << filename;
+			}
+		}
+
+		return filename;
+	}
+
+	/**
+	 * \brief Reports the bytes allocated since before as the result of the
+	 *        benchmark
+	 *
+	 * The benchmark is skipped if allocations cannot be measured
+	 * \param before the value of allocatedBytes() before the measured code
+	 */
+	void reportAllocation(qint64 before)
+	{
+		const qint64 after = allocatedBytes();
+		if ((before < 0) || (after < 0)) {
+			QSKIP("Allocations can only be measured with glibc");
+		}
+
+		QTest::setBenchmarkResult(after - before, QTest::BytesAllocated);
+	}
+
+	/**
+	 * \brief Adds the numPoints column and one row for each size of the
+	 *        sequences
+	 *
+	 * \param maxPoints the maximum number of points, bigger sizes are not
+	 *                  added
+	 */
+	void addSizes(int maxPoints = 1000000)
+	{
+		QTest::addColumn<int>("numPoints");
+
+		for (auto s: sizes()) {
+			if (s.second <= maxPoints) {
+				QTest::newRow(s.first) << s.second;
+			}
+		}
+	}
+
+	/**
+	 * \brief Adds the binary and numPoints columns and one row for each
+	 *        file format and size of the sequences
+	 */
+	void addFormatsAndSizes()
+	{
+		QTest::addColumn<bool>("binary");
+		QTest::addColumn<int>("numPoints");
+
+		for (auto binary: {false, true}) {
+			for (auto s: sizes()) {
+				QTest::newRow(qPrintable(QString("%1 %2").arg(binary ? "binary" : "json").arg(s.first))) << binary << s.second;
+			}
+		}
+	}
+
+	/**
+	 * \brief Adds the soa and numPoints columns and one row for each layout
+	 *        of points and size of the sequences
+	 */
+	void addLayoutsAndSizes()
+	{
+		QTest::addColumn<bool>("soa");
+		QTest::addColumn<int>("numPoints");
+
+		for (auto soa: {false, true}) {
+			for (auto s: sizes()) {
+				QTest::newRow(qPrintable(QString("%1 %2").arg(soa ? "soa" : "aos").arg(s.first))) << soa << s.second;
+			}
+		}
+	}
+
+	/**
+	 * \brief Returns the sizes of the sequences with their names
+	 *
+	 * \return the list of pairs with the name and number of points of each
+	 *         size
+	 */
+	static QList<QPair<const char*, int>> sizes()
+	{
+		return QList<QPair<const char*, int>>{{"1k", 1000}, {"100k", 100000}, {"1M", 1000000}};
+	}
+
+	/**
+	 * \brief The directory with the files of the benchmarks
+	 */
+	QTemporaryDir m_dir;
+};
+
+// The usual QtTest options are accepted. With -json <file> the results are
+// also written to file as JSON (QtTest has no JSON output), to compare them
+// across commits
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	BenchSequence benchmarks;
+
+	QStringList arguments = app.arguments();
+	const int jsonIndex = arguments.indexOf("-json");
+	if (jsonIndex == -1) {
+		return QTest::qExec(&benchmarks, arguments);
+	}
+	if (jsonIndex == arguments.size() - 1) {
+		qWarning() << "Missing file name after -json";
+		return 1;
+	}
+	const QString jsonFilename = arguments[jsonIndex + 1];
+	arguments.erase(arguments.begin() + jsonIndex, arguments.begin() + jsonIndex + 2);
+
+	QTemporaryFile xml;
+	if (!xml.open()) {
+		qWarning() << "Cannot create temporary file for benchmark results";
+		return 1;
+	}
+	xml.close();
+	arguments << "-o" << (xml.fileName() + ",xml") << "-o" << "-,txt";
+	const int result = QTest::qExec(&benchmarks, arguments);
+
+	QFile json(jsonFilename);
+	if (!xml.open() || !json.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot write benchmark results to" << jsonFilename;
+		return 1;
+	}
+	json.write(benchmarkResultsToJson(&xml));
+
+	return result;
+}
+
+#include "benchsequence.moc"
@@ -86,6 +86,15 @@ private slots:
 		QCOMPARE(pointJsonObject, txtJsonObject);
 	}
 
+	void toSequencePacket()
+	{
+		const typename SequencePoint<2>::Array p = {17.2, 255.0};
+		const SequencePoint<2> point(p, 745, 9934);
+		const typename SequencePoint<2>::SequencePacket expected = {{'P', 0x02, 0xE9, 0x26, 0xCE, 17, 255}};
+
+		QCOMPARE(point.toSequencePacket(), expected);
+	}
+
 	void fromJsonValid()
 	{
 		QJsonObject txtJsonObject = QJsonDocument::fromJson("{\"duration\":745, \"point\":[17.2,989.4], \"timeToTarget\":9934}").object();